@@ -0,0 +1,207 @@
+//
+//  GrowingCrashAddressMapTests.m
+//  GrowingAPMCrashMonitorTests
+//
+//  Created by YoloMao on 2022/10/8.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import "GrowingCrashAddressMap.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#define kImageCount 2000
+#define kReaderCount 4
+
+/** Synthetic load address of image i. Images are 16KB aligned, like dyld's. */
+static uintptr_t imageAddress(int i)
+{
+    return (uintptr_t) 0x100000000ULL + (uintptr_t) i * 0x14000;
+}
+
+/** Synthetic original __cxa_throw of image i. */
+static uintptr_t functionAddress(int i)
+{
+    return imageAddress(i) + 0x3f10;
+}
+
+/** Image indices in the order dyld might report them. */
+static void shuffledImages(int* images, int count)
+{
+    for(int i = 0; i < count; i++)
+    {
+        images[i] = i;
+    }
+    srand(19);
+    for(int i = count - 1; i > 0; i--)
+    {
+        int j = rand() % (i + 1);
+        int swap = images[i];
+        images[i] = images[j];
+        images[j] = swap;
+    }
+}
+
+static GrowingCrashAddressMap g_map = GROWINGCRASHAM_INITIALIZER;
+
+/** Add every image in shuffled order. Returns the number of adds that failed. */
+static int addImages(void)
+{
+    static int images[kImageCount];
+    shuffledImages(images, kImageCount);
+    int failures = 0;
+    for(int i = 0; i < kImageCount; i++)
+    {
+        if(!growingcrasham_add(&g_map, imageAddress(images[i]), functionAddress(images[i])))
+        {
+            failures++;
+        }
+    }
+    return failures;
+}
+
+typedef struct
+{
+    GrowingCrashAddressMap* map;
+    volatile int* done;
+    int wrongValues;
+    int lookups;
+} ReaderContext;
+
+static void* readImages(void* userData)
+{
+    ReaderContext* context = userData;
+    int i = 0;
+    while(!__atomic_load_n(context->done, __ATOMIC_ACQUIRE))
+    {
+        uintptr_t function = growingcrasham_find(context->map, imageAddress(i));
+        // Not added yet is fine. Anything else must be the image's own function.
+        if(function != 0 && function != functionAddress(i))
+        {
+            context->wrongValues++;
+        }
+        context->lookups++;
+        i = (i + 1) % kImageCount;
+    }
+    return NULL;
+}
+
+@interface GrowingCrashAddressMapTests : XCTestCase
+
+@end
+
+@implementation GrowingCrashAddressMapTests
+
+- (void)setUp
+{
+    [super setUp];
+    growingcrasham_reset(&g_map);
+}
+
+- (void)tearDown
+{
+    growingcrasham_reset(&g_map);
+    [super tearDown];
+}
+
+- (void)testEmptyMap
+{
+    XCTAssertEqual(growingcrasham_count(&g_map), 0);
+    XCTAssertEqual(growingcrasham_find(&g_map, imageAddress(0)), 0);
+}
+
+- (void)testFindsEveryImage
+{
+    XCTAssertEqual(addImages(), 0);
+    XCTAssertEqual(growingcrasham_count(&g_map), kImageCount);
+    for(int i = 0; i < kImageCount; i++)
+    {
+        XCTAssertEqual(growingcrasham_find(&g_map, imageAddress(i)), functionAddress(i));
+    }
+}
+
+- (void)testAddressesThatAreNotImages
+{
+    XCTAssertEqual(addImages(), 0);
+    XCTAssertEqual(growingcrasham_find(&g_map, 0), 0);
+    XCTAssertEqual(growingcrasham_find(&g_map, imageAddress(0) - 1), 0);
+    XCTAssertEqual(growingcrasham_find(&g_map, imageAddress(kImageCount / 2) + 1), 0);
+    XCTAssertEqual(growingcrasham_find(&g_map, functionAddress(kImageCount / 2)), 0);
+    XCTAssertEqual(growingcrasham_find(&g_map, imageAddress(kImageCount - 1) + 1), 0);
+    XCTAssertEqual(growingcrasham_find(&g_map, imageAddress(kImageCount)), 0);
+    XCTAssertEqual(growingcrasham_find(&g_map, UINTPTR_MAX), 0);
+}
+
+- (void)testFirstValueForAnImageIsKept
+{
+    XCTAssertEqual(addImages(), 0);
+    // Rebinding an image again must not replace the original with our own handler.
+    XCTAssertFalse(growingcrasham_add(&g_map, imageAddress(7), 0xbad));
+    XCTAssertEqual(growingcrasham_find(&g_map, imageAddress(7)), functionAddress(7));
+    XCTAssertEqual(growingcrasham_count(&g_map), kImageCount);
+}
+
+- (void)testResetEmptiesTheMap
+{
+    XCTAssertEqual(addImages(), 0);
+    growingcrasham_reset(&g_map);
+    XCTAssertEqual(growingcrasham_count(&g_map), 0);
+    XCTAssertEqual(growingcrasham_find(&g_map, imageAddress(3)), 0);
+    XCTAssertTrue(growingcrasham_add(&g_map, imageAddress(3), functionAddress(3)));
+    XCTAssertEqual(growingcrasham_find(&g_map, imageAddress(3)), functionAddress(3));
+}
+
+- (void)testLookupsWhileImagesAreAdded
+{
+    volatile int done = 0;
+    ReaderContext contexts[kReaderCount];
+    pthread_t readers[kReaderCount];
+    for(int i = 0; i < kReaderCount; i++)
+    {
+        contexts[i] = (ReaderContext) {&g_map, &done, 0, 0};
+        XCTAssertEqual(pthread_create(&readers[i], NULL, readImages, &contexts[i]), 0);
+    }
+
+    XCTAssertEqual(addImages(), 0);
+
+    __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+    for(int i = 0; i < kReaderCount; i++)
+    {
+        pthread_join(readers[i], NULL);
+        XCTAssertEqual(contexts[i].wrongValues, 0);
+        XCTAssertGreaterThan(contexts[i].lookups, 0);
+    }
+    XCTAssertEqual(growingcrasham_count(&g_map), kImageCount);
+}
+
+- (void)testLookupPerformance
+{
+    XCTAssertEqual(addImages(), 0);
+    [self measureBlock:^{
+        uintptr_t found = 0;
+        for(int round = 0; round < 100; round++)
+        {
+            for(int i = 0; i < kImageCount; i++)
+            {
+                found += growingcrasham_find(&g_map, imageAddress(i)) != 0;
+            }
+        }
+        XCTAssertEqual(found, 100 * kImageCount);
+    }];
+}
+
+@end
@@ -0,0 +1,732 @@
+//
+//  GrowingCrashBinaryCodecTests.m
+//  GrowingAPMCrashMonitorTests
+//
+//  Created by YoloMao on 2022/10/8.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import "GrowingCrashBinaryCodec.h"
+#import "GrowingCrashGrowableBuffer.h"
+#import "GrowingCrashJSONCodec.h"
+#import "GrowingCrashReportStore.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef enum
+{
+    SampleOpBeginObject,
+    SampleOpBeginArray,
+    SampleOpEndContainer,
+    SampleOpBoolean,
+    SampleOpInteger,
+    SampleOpUInteger,
+    SampleOpFloatingPoint,
+    SampleOpNull,
+    SampleOpString,
+    SampleOpStringChunks,
+    SampleOpData,
+    SampleOpDataChunks,
+    SampleOpUUID,
+    SampleOpJSON,
+    SampleOpJSONFile,
+    SampleOpNumberedFields,
+} SampleOpType;
+
+typedef struct
+{
+    SampleOpType type;
+    const char* name;
+    const char* value;
+    int length;
+    int64_t integer;
+    uint64_t uinteger;
+    double number;
+} SampleOp;
+
+static const unsigned char g_uuid[16] =
+{
+    0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0, 0x0f, 0xed, 0xcb, 0xa9, 0x87, 0x65, 0x43, 0x21,
+};
+
+static const char g_data[] = {0x00, 0x01, 0x7f, (char)0x80, (char)0xff, 'a', 'b', 'c'};
+
+static char g_longName[300];
+static char g_longString[20000];
+static char g_directory[500];
+static char g_jsonFilePath[600];
+
+/** Covers every element type, names that get interned, referenced, not
+ * interned and escaped, values that need escaping, and an embedded document.
+ */
+static const SampleOp g_sampleReport[] =
+{
+    {SampleOpBeginObject, NULL},
+    {SampleOpBeginObject, "report"},
+    {SampleOpString, "version", "3.2.0", -1},
+    {SampleOpString, "id", "0C6A2F4E-1B3D-4E5F-8A9B-0C1D2E3F4A5B", -1},
+    {SampleOpInteger, "timestamp", NULL, 0, 1665187200},
+    {SampleOpString, "type", "standard", -1},
+    {SampleOpEndContainer},
+    {SampleOpBeginObject, "crash"},
+    {SampleOpBeginArray, "threads"},
+    {SampleOpBeginObject, NULL},
+    {SampleOpInteger, "index", NULL, 0, 0},
+    {SampleOpBoolean, "crashed", NULL, 0, 1},
+    {SampleOpBoolean, "current_thread", NULL, 0, 0},
+    {SampleOpString, "name", "com.apple.main-thread", -1},
+    {SampleOpNull, "dispatch_queue"},
+    {SampleOpEndContainer},
+    {SampleOpBeginObject, NULL},
+    {SampleOpInteger, "index", NULL, 0, 1},
+    {SampleOpBoolean, "crashed", NULL, 0, 0},
+    {SampleOpBoolean, "current_thread", NULL, 0, 1},
+    {SampleOpString, "name", "worker \"quoted\"\n\ttabbed \\ slashed \x01", -1},
+    {SampleOpEndContainer},
+    {SampleOpEndContainer},
+    {SampleOpBeginObject, "registers"},
+    {SampleOpUInteger, "pc", NULL, 0, 0, UINT64_MAX},
+    {SampleOpUInteger, "sp", NULL, 0, 0, (uint64_t)INT64_MAX + 1},
+    {SampleOpInteger, "x0", NULL, 0, INT64_MIN},
+    {SampleOpInteger, "x1", NULL, 0, INT64_MAX},
+    {SampleOpInteger, "x2", NULL, 0, -1},
+    {SampleOpInteger, "x3", NULL, 0, 127},
+    {SampleOpInteger, "x4", NULL, 0, 128},
+    {SampleOpEndContainer},
+    {SampleOpFloatingPoint, "uptime", NULL, 0, 0, 0, 12345.678},
+    {SampleOpFloatingPoint, "zero", NULL, 0, 0, 0, 0.0},
+    {SampleOpFloatingPoint, "tiny", NULL, 0, 0, 0, -4.9406564584124654e-324},
+    {SampleOpString, "empty", "", 0},
+    {SampleOpString, "partial", "only this part is written", 9},
+    {SampleOpString, "unicode", "\xe6\xb1\x89\xe5\xad\x97 \xf0\x9f\x98\x80", -1},
+    {SampleOpString, "quote\"name", "value", -1},
+    {SampleOpString, "null_string", NULL, -1},
+    {SampleOpStringChunks, "console", "line one\nline \"two\"\n", -1},
+    {SampleOpString, "long_string", g_longString, -1},
+    {SampleOpString, g_longName, "name too long to intern", -1},
+    {SampleOpString, g_longName, "and again", -1},
+    {SampleOpData, "data", g_data, sizeof(g_data)},
+    {SampleOpData, "empty_data", g_data, 0},
+    {SampleOpDataChunks, "chunked_data", g_data, sizeof(g_data)},
+    {SampleOpUUID, "uuid"},
+    {SampleOpUUID, "null_uuid"},
+    {SampleOpJSON, "user", "{\"a\":[1,-2,3.5,true,false,null,\"s\\u00e9\\n\"],\"b\":{}}", -1},
+    {SampleOpJSON, "user_array", "[\"x\", {\"y\": 18446744073709551615}]", -1},
+    {SampleOpJSON, "truncated_user", "{\"a\":[1,{\"b\":\"cut", -1},
+    {SampleOpJSONFile, "system"},
+    {SampleOpNumberedFields, "fields", NULL, 300},
+    {SampleOpEndContainer},
+    {SampleOpEndContainer},
+};
+
+#define SAMPLE_OP_COUNT (int)(sizeof(g_sampleReport) / sizeof(*g_sampleReport))
+
+static int addToBuffer(const char* data, int length, void* userData)
+{
+    GrowingCrashGrowableBuffer* buffer = userData;
+    return growingcrashgb_append(buffer, data, length) ? GrowingCrashJSON_OK : GrowingCrashJSON_ERROR_CANNOT_ADD_DATA;
+}
+
+static void formatUUID(const unsigned char* uuid, char* buffer)
+{
+    static const int groupLengths[] = {4, 2, 2, 2, 6};
+    char* dst = buffer;
+    for(int i = 0; i < 5; i++)
+    {
+        if(i > 0)
+        {
+            *dst++ = '-';
+        }
+        growingcrashjson_encodeHex(uuid, groupLengths[i], dst);
+        uuid += groupLengths[i];
+        dst += groupLengths[i] * 2;
+    }
+    *dst = '\0';
+}
+
+static const unsigned char* uuidForOp(const SampleOp* op)
+{
+    return strcmp(op->name, "uuid") == 0 ? g_uuid : NULL;
+}
+
+static void addJSONSample(GrowingCrashJSONEncodeContext* context, const SampleOp* ops, int count)
+{
+    for(int i = 0; i < count; i++)
+    {
+        const SampleOp* op = &ops[i];
+        switch(op->type)
+        {
+            case SampleOpBeginObject: growingcrashjson_beginObject(context, op->name); break;
+            case SampleOpBeginArray: growingcrashjson_beginArray(context, op->name); break;
+            case SampleOpEndContainer: growingcrashjson_endContainer(context); break;
+            case SampleOpBoolean: growingcrashjson_addBooleanElement(context, op->name, op->integer != 0); break;
+            case SampleOpInteger: growingcrashjson_addIntegerElement(context, op->name, op->integer); break;
+            case SampleOpUInteger: growingcrashjson_addUIntegerElement(context, op->name, op->uinteger); break;
+            case SampleOpFloatingPoint: growingcrashjson_addFloatingPointElement(context, op->name, op->number); break;
+            case SampleOpNull: growingcrashjson_addNullElement(context, op->name); break;
+            case SampleOpString: growingcrashjson_addStringElement(context, op->name, op->value, op->length); break;
+            case SampleOpStringChunks:
+                growingcrashjson_beginStringElement(context, op->name);
+                for(int offset = 0, length = (int)strlen(op->value); offset < length; offset += 3)
+                {
+                    growingcrashjson_appendStringElement(context, op->value + offset, length - offset < 3 ? length - offset : 3);
+                }
+                growingcrashjson_endStringElement(context);
+                break;
+            case SampleOpData: growingcrashjson_addDataElement(context, op->name, op->value, op->length); break;
+            case SampleOpDataChunks:
+                growingcrashjson_beginDataElement(context, op->name);
+                growingcrashjson_appendDataElement(context, op->value, 3);
+                growingcrashjson_appendDataElement(context, op->value + 3, op->length - 3);
+                growingcrashjson_endDataElement(context);
+                break;
+            case SampleOpUUID:
+            {
+                const unsigned char* uuid = uuidForOp(op);
+                if(uuid == NULL)
+                {
+                    growingcrashjson_addNullElement(context, op->name);
+                }
+                else
+                {
+                    char buffer[37];
+                    formatUUID(uuid, buffer);
+                    growingcrashjson_addStringElement(context, op->name, buffer, (int)strlen(buffer));
+                }
+                break;
+            }
+            case SampleOpJSON:
+                growingcrashjson_addJSONElement(context, op->name, op->value, (int)strlen(op->value), true);
+                break;
+            case SampleOpJSONFile: growingcrashjson_addJSONFromFile(context, op->name, g_jsonFilePath, true); break;
+            case SampleOpNumberedFields:
+                growingcrashjson_beginObject(context, op->name);
+                for(int field = 0; field < op->length; field++)
+                {
+                    char name[32];
+                    snprintf(name, sizeof(name), "numbered_field_%03d", field);
+                    growingcrashjson_addIntegerElement(context, name, field);
+                }
+                growingcrashjson_endContainer(context);
+                break;
+        }
+    }
+}
+
+static void addBinarySample(GrowingCrashBinaryEncodeContext* context, const SampleOp* ops, int count)
+{
+    for(int i = 0; i < count; i++)
+    {
+        const SampleOp* op = &ops[i];
+        switch(op->type)
+        {
+            case SampleOpBeginObject: growingcrashbin_beginObject(context, op->name); break;
+            case SampleOpBeginArray: growingcrashbin_beginArray(context, op->name); break;
+            case SampleOpEndContainer: growingcrashbin_endContainer(context); break;
+            case SampleOpBoolean: growingcrashbin_addBooleanElement(context, op->name, op->integer != 0); break;
+            case SampleOpInteger: growingcrashbin_addIntegerElement(context, op->name, op->integer); break;
+            case SampleOpUInteger: growingcrashbin_addUIntegerElement(context, op->name, op->uinteger); break;
+            case SampleOpFloatingPoint: growingcrashbin_addFloatingPointElement(context, op->name, op->number); break;
+            case SampleOpNull: growingcrashbin_addNullElement(context, op->name); break;
+            case SampleOpString: growingcrashbin_addStringElement(context, op->name, op->value, op->length); break;
+            case SampleOpStringChunks:
+                growingcrashbin_beginStringElement(context, op->name);
+                for(int offset = 0, length = (int)strlen(op->value); offset < length; offset += 3)
+                {
+                    growingcrashbin_appendStringElement(context, op->value + offset, length - offset < 3 ? length - offset : 3);
+                }
+                growingcrashbin_endStringElement(context);
+                break;
+            case SampleOpData: growingcrashbin_addDataElement(context, op->name, op->value, op->length); break;
+            case SampleOpDataChunks:
+                growingcrashbin_beginDataElement(context, op->name);
+                growingcrashbin_appendDataElement(context, op->value, 3);
+                growingcrashbin_appendDataElement(context, op->value + 3, op->length - 3);
+                growingcrashbin_endDataElement(context);
+                break;
+            case SampleOpUUID: growingcrashbin_addUUIDElement(context, op->name, uuidForOp(op)); break;
+            case SampleOpJSON:
+                growingcrashbin_addJSONElement(context, op->name, op->value, (int)strlen(op->value), true);
+                break;
+            case SampleOpJSONFile: growingcrashbin_addJSONFromFile(context, op->name, g_jsonFilePath, true); break;
+            case SampleOpNumberedFields:
+                growingcrashbin_beginObject(context, op->name);
+                for(int field = 0; field < op->length; field++)
+                {
+                    char name[32];
+                    snprintf(name, sizeof(name), "numbered_field_%03d", field);
+                    growingcrashbin_addIntegerElement(context, name, field);
+                }
+                growingcrashbin_endContainer(context);
+                break;
+        }
+    }
+}
+
+static GrowingCrashGrowableBuffer encodeJSON(const SampleOp* ops, int count, bool prettyPrint)
+{
+    GrowingCrashGrowableBuffer buffer = {0};
+    GrowingCrashJSONEncodeContext context;
+    growingcrashjson_beginEncode(&context, prettyPrint, addToBuffer, &buffer);
+    addJSONSample(&context, ops, count);
+    growingcrashjson_endEncode(&context);
+    growingcrashgb_terminate(&buffer);
+    return buffer;
+}
+
+static GrowingCrashGrowableBuffer encodeBinary(const SampleOp* ops, int count)
+{
+    GrowingCrashGrowableBuffer buffer = {0};
+    GrowingCrashBinaryEncodeContext context;
+    growingcrashbin_beginEncode(&context, addToBuffer, &buffer);
+    addBinarySample(&context, ops, count);
+    growingcrashbin_endEncode(&context);
+    return buffer;
+}
+
+static GrowingCrashGrowableBuffer transcode(const char* data, int length, bool prettyPrint, int* result)
+{
+    GrowingCrashGrowableBuffer buffer = {0};
+    GrowingCrashJSONEncodeContext context;
+    growingcrashjson_beginEncode(&context, prettyPrint, addToBuffer, &buffer);
+    *result = growingcrashbin_transcodeToJSON(&context, NULL, data, length, true);
+    growingcrashjson_endEncode(&context);
+    growingcrashgb_terminate(&buffer);
+    return buffer;
+}
+
+static bool writeFile(const char* path, const char* data, int length)
+{
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0)
+    {
+        return false;
+    }
+    bool success = write(fd, data, (size_t)length) == length;
+    close(fd);
+    return success;
+}
+
+static void removeDirectory(const char* path)
+{
+    DIR* dir = opendir(path);
+    if(dir == NULL)
+    {
+        return;
+    }
+    struct dirent* ent;
+    while((ent = readdir(dir)) != NULL)
+    {
+        if(strcmp(ent->d_name, ".") != 0 && strcmp(ent->d_name, "..") != 0)
+        {
+            char entryPath[1000];
+            snprintf(entryPath, sizeof(entryPath), "%s/%s", path, ent->d_name);
+            unlink(entryPath);
+        }
+    }
+    closedir(dir);
+    rmdir(path);
+}
+
+typedef struct
+{
+    int depth;
+    bool wentNegative;
+} DepthCount;
+
+static int countElement(__unused const GrowingCrashJSONStringView* name, __unused void* userData)
+{
+    return GrowingCrashJSON_OK;
+}
+
+static int countBooleanElement(__unused const GrowingCrashJSONStringView* name, __unused bool value, __unused void* userData)
+{
+    return GrowingCrashJSON_OK;
+}
+
+static int countFloatingPointElement(__unused const GrowingCrashJSONStringView* name, __unused double value, __unused void* userData)
+{
+    return GrowingCrashJSON_OK;
+}
+
+static int countIntegerElement(__unused const GrowingCrashJSONStringView* name, __unused int64_t value, __unused void* userData)
+{
+    return GrowingCrashJSON_OK;
+}
+
+static int countUIntegerElement(__unused const GrowingCrashJSONStringView* name, __unused uint64_t value, __unused void* userData)
+{
+    return GrowingCrashJSON_OK;
+}
+
+static int countStringElement(__unused const GrowingCrashJSONStringView* name,
+                              __unused const GrowingCrashJSONStringView* value,
+                              __unused void* userData)
+{
+    return GrowingCrashJSON_OK;
+}
+
+static int countBeginContainer(__unused const GrowingCrashJSONStringView* name, void* userData)
+{
+    ((DepthCount*)userData)->depth++;
+    return GrowingCrashJSON_OK;
+}
+
+static int countEndContainer(void* userData)
+{
+    DepthCount* count = userData;
+    if(--count->depth < 0)
+    {
+        count->wentNegative = true;
+    }
+    return GrowingCrashJSON_OK;
+}
+
+static int countEndData(__unused void* userData)
+{
+    return GrowingCrashJSON_OK;
+}
+
+static GrowingCrashJSONDecodeStringViewCallbacks g_countCallbacks =
+{
+    .onBeginArray = countBeginContainer,
+    .onBeginObject = countBeginContainer,
+    .onBooleanElement = countBooleanElement,
+    .onEndContainer = countEndContainer,
+    .onEndData = countEndData,
+    .onFloatingPointElement = countFloatingPointElement,
+    .onIntegerElement = countIntegerElement,
+    .onUIntegerElement = countUIntegerElement,
+    .onNullElement = countElement,
+    .onStringElement = countStringElement,
+};
+
+/** Check that JSON parses, and that every container it opens is closed. */
+static bool isBalancedJSON(const char* json, int length)
+{
+    DepthCount count = {0};
+    int result = growingcrashjson_decodeStringViews(json, length, &g_countCallbacks, &count, NULL);
+    return result == GrowingCrashJSON_OK && count.depth == 0 && !count.wentNegative;
+}
+
+static int decodeBinary(const char* data, int length)
+{
+    DepthCount count = {0};
+    return growingcrashbin_decode(data, length, &g_countCallbacks, &count);
+}
+
+/** Header, a named unsigned integer element, then the varint bytes. */
+static int decodeVarint(const uint8_t* varint, int length)
+{
+    char data[32] = {(char)0xC7, 'G', 'C', 'R', 1, 0x01, 0x86, 0x04, 'a', 0x00};
+    int headerLength = 10;
+    memcpy(data + headerLength, varint, (size_t)length);
+    data[headerLength + length] = 0x00;
+    return decodeBinary(data, headerLength + length + 1);
+}
+
+@interface GrowingCrashBinaryCodecTests : XCTestCase
+@end
+
+@implementation GrowingCrashBinaryCodecTests
+
+- (void)setUp
+{
+    [super setUp];
+    memset(g_longName, 'n', sizeof(g_longName) - 1);
+    for(int i = 0; i < (int)sizeof(g_longString) - 1; i++)
+    {
+        g_longString[i] = i % 100 == 99 ? '"' : 'a' + i % 26;
+    }
+
+    const char* tmpDir = getenv("TMPDIR");
+    snprintf(g_directory, sizeof(g_directory), "%s/GrowingCrashBinaryCodecTests.XXXXXX", tmpDir != NULL ? tmpDir : "/tmp");
+    XCTAssertTrue(mkdtemp(g_directory) != NULL);
+    snprintf(g_jsonFilePath, sizeof(g_jsonFilePath), "%s/system.json", g_directory);
+    const char* json = "{\"os\":\"iOS\",\"cpu\":[\"arm64\",12],\"free\":1.5e9,\"jailbroken\":false}";
+    XCTAssertTrue(writeFile(g_jsonFilePath, json, (int)strlen(json)));
+}
+
+- (void)tearDown
+{
+    removeDirectory(g_directory);
+    [super tearDown];
+}
+
+- (void)testTranscodedReportMatchesJSONEncoder
+{
+    GrowingCrashGrowableBuffer binary = encodeBinary(g_sampleReport, SAMPLE_OP_COUNT);
+    XCTAssertTrue(growingcrashbin_isBinaryData(binary.data, binary.length));
+    for(int prettyPrint = 0; prettyPrint <= 1; prettyPrint++)
+    {
+        GrowingCrashGrowableBuffer expected = encodeJSON(g_sampleReport, SAMPLE_OP_COUNT, prettyPrint);
+        int result;
+        GrowingCrashGrowableBuffer actual = transcode(binary.data, binary.length, prettyPrint, &result);
+        XCTAssertEqual(result, GrowingCrashJSON_OK);
+        XCTAssertEqual(actual.length, expected.length);
+        XCTAssertTrue(strcmp(actual.data, expected.data) == 0, @"%s", actual.data);
+        free(expected.data);
+        free(actual.data);
+    }
+    // The binary encoding is the smaller one.
+    GrowingCrashGrowableBuffer json = encodeJSON(g_sampleReport, SAMPLE_OP_COUNT, false);
+    XCTAssertLessThan(binary.length, json.length);
+    free(json.data);
+    free(binary.data);
+}
+
+- (void)testDecodeMatchesDecodingTheJSON
+{
+    GrowingCrashGrowableBuffer binary = encodeBinary(g_sampleReport, SAMPLE_OP_COUNT);
+    XCTAssertEqual(decodeBinary(binary.data, binary.length), GrowingCrashJSON_OK);
+    free(binary.data);
+}
+
+- (void)testEmbeddedBinaryFileTranscodesLikeEmbeddedJSON
+{
+    static const SampleOp embedded[] =
+    {
+        {SampleOpBeginObject, NULL},
+        {SampleOpString, "name", "embedded \"binary\"", -1},
+        {SampleOpBeginArray, "values"},
+        {SampleOpInteger, NULL, NULL, 0, -42},
+        {SampleOpNull, NULL},
+        {SampleOpEndContainer},
+        {SampleOpEndContainer},
+    };
+    static const SampleOp embedding[] =
+    {
+        {SampleOpBeginObject, NULL},
+        {SampleOpJSONFile, "system"},
+        {SampleOpString, "after", "still here", -1},
+        {SampleOpEndContainer},
+    };
+    int embeddedCount = (int)(sizeof(embedded) / sizeof(*embedded));
+    int embeddingCount = (int)(sizeof(embedding) / sizeof(*embedding));
+
+    GrowingCrashGrowableBuffer json = encodeJSON(embedded, embeddedCount, false);
+    XCTAssertTrue(writeFile(g_jsonFilePath, json.data, json.length));
+    GrowingCrashGrowableBuffer expected = encodeJSON(embedding, embeddingCount, false);
+
+    GrowingCrashGrowableBuffer embeddedBinary = encodeBinary(embedded, embeddedCount);
+    XCTAssertTrue(writeFile(g_jsonFilePath, embeddedBinary.data, embeddedBinary.length));
+    GrowingCrashGrowableBuffer binary = encodeBinary(embedding, embeddingCount);
+    int result;
+    GrowingCrashGrowableBuffer actual = transcode(binary.data, binary.length, false, &result);
+
+    XCTAssertEqual(result, GrowingCrashJSON_OK);
+    XCTAssertTrue(strcmp(actual.data, expected.data) == 0, @"%s", actual.data);
+    free(json.data);
+    free(expected.data);
+    free(embeddedBinary.data);
+    free(binary.data);
+    free(actual.data);
+}
+
+- (void)testTruncationAtEveryOffsetIsBalanced
+{
+    GrowingCrashGrowableBuffer binary = encodeBinary(g_sampleReport, SAMPLE_OP_COUNT);
+    const int headerLength = 5;
+    for(int length = headerLength; length < binary.length; length++)
+    {
+        int result;
+        GrowingCrashGrowableBuffer json = transcode(binary.data, length, false, &result);
+        XCTAssertEqual(result, GrowingCrashJSON_ERROR_INCOMPLETE, @"%d", length);
+        if(length > headerLength)
+        {
+            XCTAssertTrue(isBalancedJSON(json.data, json.length), @"%d: %s", length, json.data);
+        }
+        XCTAssertEqual(decodeBinary(binary.data, length), GrowingCrashJSON_ERROR_INCOMPLETE, @"%d", length);
+        free(json.data);
+    }
+    free(binary.data);
+}
+
+- (void)testTruncatedNestedReportKeepsWhatWasWritten
+{
+    static const SampleOp ops[] =
+    {
+        {SampleOpBeginObject, NULL},
+        {SampleOpBeginArray, "outer"},
+        {SampleOpBeginObject, NULL},
+        {SampleOpString, "kept", "yes", -1},
+        {SampleOpString, "lost", "no", -1},
+        {SampleOpEndContainer},
+        {SampleOpEndContainer},
+        {SampleOpEndContainer},
+    };
+    GrowingCrashGrowableBuffer binary = encodeBinary(ops, (int)(sizeof(ops) / sizeof(*ops)));
+    const char* lost = memmem(binary.data, (size_t)binary.length, "lost", 4);
+    XCTAssertTrue(lost != NULL);
+
+    int result;
+    GrowingCrashGrowableBuffer json = transcode(binary.data, (int)(lost - binary.data), false, &result);
+    XCTAssertEqual(result, GrowingCrashJSON_ERROR_INCOMPLETE);
+    XCTAssertTrue(strcmp(json.data, "{\"outer\":[{\"kept\":\"yes\"}]}") == 0, @"%s", json.data);
+    free(json.data);
+
+    // Elements written after a truncated one don't end up inside it.
+    GrowingCrashGrowableBuffer outer = {0};
+    GrowingCrashJSONEncodeContext context;
+    growingcrashjson_beginEncode(&context, false, addToBuffer, &outer);
+    growingcrashjson_beginObject(&context, NULL);
+    result = growingcrashbin_transcodeToJSON(&context, "truncated", binary.data, (int)(lost - binary.data), true);
+    growingcrashjson_addStringElement(&context, "after", "ok", 2);
+    growingcrashjson_endEncode(&context);
+    growingcrashgb_terminate(&outer);
+    XCTAssertEqual(result, GrowingCrashJSON_ERROR_INCOMPLETE);
+    XCTAssertTrue(strcmp(outer.data, "{\"truncated\":{\"outer\":[{\"kept\":\"yes\"}]},\"after\":\"ok\"}") == 0, @"%s", outer.data);
+    free(outer.data);
+    free(binary.data);
+}
+
+- (void)testRejectsBadMagicAndVersion
+{
+    GrowingCrashGrowableBuffer binary = encodeBinary(g_sampleReport, SAMPLE_OP_COUNT);
+    for(int i = 0; i < 5; i++)
+    {
+        binary.data[i] ^= 0x20;
+        XCTAssertEqual(growingcrashbin_isBinaryData(binary.data, binary.length), i == 4);
+        XCTAssertEqual(decodeBinary(binary.data, binary.length), GrowingCrashJSON_ERROR_INVALID_DATA, @"%d", i);
+        int result;
+        GrowingCrashGrowableBuffer json = transcode(binary.data, binary.length, false, &result);
+        XCTAssertEqual(result, GrowingCrashJSON_ERROR_INVALID_DATA, @"%d", i);
+        XCTAssertEqual(json.length, 0);
+        free(json.data);
+        binary.data[i] ^= 0x20;
+    }
+    XCTAssertFalse(growingcrashbin_isBinaryData(binary.data, 4));
+    XCTAssertFalse(growingcrashbin_isBinaryData(NULL, 0));
+    XCTAssertFalse(growingcrashbin_isBinaryData("{\"a\":1}", 7));
+    free(binary.data);
+}
+
+- (void)testRejectsCorruptVarints
+{
+    static const uint8_t valid[] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01};
+    XCTAssertEqual(decodeVarint(valid, sizeof(valid)), GrowingCrashJSON_OK);
+
+    static const uint8_t tooBig[] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x02};
+    XCTAssertEqual(decodeVarint(tooBig, sizeof(tooBig)), GrowingCrashJSON_ERROR_INVALID_DATA);
+
+    static const uint8_t tooLong[] = {0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00};
+    XCTAssertEqual(decodeVarint(tooLong, sizeof(tooLong)), GrowingCrashJSON_ERROR_INVALID_DATA);
+
+    // A varint running past the end is truncation.
+    XCTAssertEqual(decodeBinary((const char*)(const uint8_t[]){0xC7, 'G', 'C', 'R', 1, 0x06, 0x80, 0x80, 0x80}, 9),
+                   GrowingCrashJSON_ERROR_INCOMPLETE);
+
+    // A string length running past the end is truncation.
+    XCTAssertEqual(decodeBinary((const char*)(const uint8_t[]){0xC7, 'G', 'C', 'R', 1, 0x09, 0x10, 'a'}, 8),
+                   GrowingCrashJSON_ERROR_INCOMPLETE);
+    // An overlong name length is corrupt.
+    XCTAssertEqual(decodeBinary((const char*)(const uint8_t[]){0xC7, 'G', 'C', 'R', 1, 0x01,
+                                                               0x86, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f,
+                                                               0x03, 0x00}, 19),
+                   GrowingCrashJSON_ERROR_INVALID_DATA);
+}
+
+- (void)testRejectsCorruptElements
+{
+    // Name reference before any name was interned.
+    XCTAssertEqual(decodeBinary((const char*)(const uint8_t[]){0xC7, 'G', 'C', 'R', 1, 0x01, 0x83, 0x01, 0x00}, 9),
+                   GrowingCrashJSON_ERROR_INVALID_DATA);
+    // Inline name that isn't NUL terminated.
+    XCTAssertEqual(decodeBinary((const char*)(const uint8_t[]){0xC7, 'G', 'C', 'R', 1, 0x01, 0x83, 0x04, 'a', 'b', 0x00}, 11),
+                   GrowingCrashJSON_ERROR_INVALID_DATA);
+    // Unknown element type.
+    XCTAssertEqual(decodeBinary((const char*)(const uint8_t[]){0xC7, 'G', 'C', 'R', 1, 0x01, 0x7e, 0x00}, 8),
+                   GrowingCrashJSON_ERROR_INVALID_DATA);
+    // End of a container that was never opened.
+    XCTAssertEqual(decodeBinary((const char*)(const uint8_t[]){0xC7, 'G', 'C', 'R', 1, 0x00}, 6),
+                   GrowingCrashJSON_ERROR_INVALID_DATA);
+    // Negative integer below INT64_MIN.
+    XCTAssertEqual(decodeBinary((const char*)(const uint8_t[]){0xC7, 'G', 'C', 'R', 1, 0x01, 0x07,
+                                                               0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x01,
+                                                               0x00}, 18),
+                   GrowingCrashJSON_ERROR_INVALID_DATA);
+}
+
+- (void)testReadReportRoundTripsThroughStore
+{
+    growingcrs_initialize("GrowingCrashBinaryCodecTests", g_directory);
+    growingcrs_deleteAllReports();
+
+    GrowingCrashGrowableBuffer binary = encodeBinary(g_sampleReport, SAMPLE_OP_COUNT);
+    char path[GROWINGCRS_MAX_PATH_LENGTH];
+    int64_t reportID = growingcrs_getNextCrashReport(path);
+    XCTAssertTrue(writeFile(path, binary.data, binary.length));
+    growingcrs_commitCrashReport(reportID);
+
+    GrowingCrashGrowableBuffer expected = encodeJSON(g_sampleReport, SAMPLE_OP_COUNT, true);
+    char* report = growingcrs_readReport(reportID);
+    XCTAssertTrue(report != NULL);
+    if(report != NULL)
+    {
+        XCTAssertTrue(strcmp(report, expected.data) == 0, @"%s", report);
+    }
+    free(report);
+
+    // A report cut short by a crash during crash handling still reads as valid JSON.
+    reportID = growingcrs_getNextCrashReport(path);
+    XCTAssertTrue(writeFile(path, binary.data, binary.length / 2));
+    growingcrs_commitCrashReport(reportID);
+    report = growingcrs_readReport(reportID);
+    XCTAssertTrue(report != NULL);
+    if(report != NULL)
+    {
+        XCTAssertTrue(isBalancedJSON(report, (int)strlen(report)), @"%s", report);
+        XCTAssertTrue(strncmp(report, expected.data, 64) == 0, @"%s", report);
+    }
+    free(report);
+
+    // JSON reports are passed through as they are.
+    GrowingCrashGrowableBuffer json = encodeJSON(g_sampleReport, SAMPLE_OP_COUNT, false);
+    reportID = growingcrs_addUserReport(json.data, json.length);
+    report = growingcrs_readReport(reportID);
+    XCTAssertTrue(report != NULL);
+    if(report != NULL)
+    {
+        XCTAssertTrue(strcmp(report, json.data) == 0, @"%s", report);
+    }
+    free(report);
+
+    growingcrs_deleteAllReports();
+    free(json.data);
+    free(expected.data);
+    free(binary.data);
+}
+
+- (void)testTranscodePerformance
+{
+    GrowingCrashGrowableBuffer binary = encodeBinary(g_sampleReport, SAMPLE_OP_COUNT);
+    [self measureBlock:^{
+        for(int i = 0; i < 200; i++)
+        {
+            int result;
+            GrowingCrashGrowableBuffer json = transcode(binary.data, binary.length, true, &result);
+            free(json.data);
+        }
+    }];
+    free(binary.data);
+}
+
+@end
@@ -0,0 +1,335 @@
+//
+//  GrowingCrashCPPExceptionTests.mm
+//  GrowingAPMCrashMonitorTests
+//
+//  Created by YoloMao on 2022/10/8.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import "GrowingCrashMonitor_CPPException.h"
+
+#include <pthread.h>
+
+#define kBenchmarkThrowCount 10000
+
+#define kConcurrentThreadCount 4
+
+// Each test throws its own types, since the monitor keeps counting a type's
+// throws for as long as the process runs.
+struct EveryNthFirst {};
+struct EveryNthSecond {};
+struct FirstOnly {};
+struct EveryThrow {};
+struct BenchmarkException {};
+struct ConcurrentException {};
+struct InnerException {};
+struct RecordedException {};
+struct UnrecordedException {};
+struct SampledException {};
+
+template <typename T>
+static void throwAndCatch(int count)
+{
+    for(int i = 0; i < count; i++)
+    {
+        try
+        {
+            throw T();
+        }
+        catch(const T&)
+        {
+        }
+    }
+}
+
+/** Throw from depth nested calls, so that the return address of the nested
+ * call shows up depth times in a row in the throw's backtrace.
+ */
+template <typename T>
+__attribute__((noinline))
+static void throwAtDepth(int depth)
+{
+    if(depth == 0)
+    {
+        throw T();
+    }
+    throwAtDepth<T>(depth - 1);
+    // Keeps the nested call from becoming a jump.
+    __asm__ volatile("");
+}
+
+/** The longest run of one address repeated in a row. */
+static int longestRepeatedRun(GrowingCrashStackCursor* cursor)
+{
+    int longest = 0;
+    int run = 0;
+    uintptr_t previous = 0;
+    while(cursor->advanceCursor(cursor))
+    {
+        run = cursor->stackEntry.address == previous ? run + 1 : 1;
+        previous = cursor->stackEntry.address;
+        longest = run > longest ? run : longest;
+    }
+    return longest;
+}
+
+/** The repeated run in the backtrace of the exception being handled, or -1 if
+ * it has none.
+ */
+static int currentExceptionRun(void)
+{
+    GrowingCrashStackCursor cursor;
+    if(!growingcrashcm_initCPPExceptionStackCursor(&cursor))
+    {
+        return -1;
+    }
+    return longestRepeatedRun(&cursor);
+}
+
+/** Throw and catch from depth nested calls, and return the repeated run in
+ * the stack the cursor walks for the exception being handled.
+ */
+__attribute__((noinline))
+static int catchAtDepth(int depth, bool* isThrowTrace)
+{
+    if(depth == 0)
+    {
+        try
+        {
+            throw SampledException();
+        }
+        catch(const SampledException&)
+        {
+            GrowingCrashStackCursor cursor;
+            growingcrashsc_initCursor(&cursor, NULL, NULL);
+            *isThrowTrace = growingcrashcm_initCPPExceptionStackCursor(&cursor);
+            return longestRepeatedRun(&cursor);
+        }
+    }
+    int run = catchAtDepth(depth - 1, isThrowTrace);
+    // Keeps the nested call from becoming a jump.
+    __asm__ volatile("");
+    return run;
+}
+
+typedef struct
+{
+    int depth;
+    int* arrivedCount;
+    int run;
+    int innerRun;
+    int runAfterInner;
+} ConcurrentThrow;
+
+static void* throwOnThread(void* userData)
+{
+    ConcurrentThrow* work = (ConcurrentThrow*)userData;
+    try
+    {
+        throwAtDepth<ConcurrentException>(work->depth);
+    }
+    catch(const ConcurrentException&)
+    {
+        // Wait until every thread has thrown, so that a trace recorded by
+        // another thread would be there to be picked up by mistake.
+        __atomic_fetch_add(work->arrivedCount, 1, __ATOMIC_ACQ_REL);
+        while(__atomic_load_n(work->arrivedCount, __ATOMIC_ACQUIRE) < kConcurrentThreadCount)
+        {
+        }
+        work->run = currentExceptionRun();
+
+        // A newer throw on the same thread mustn't take the exception's place.
+        try
+        {
+            throwAtDepth<InnerException>(work->depth + 10);
+        }
+        catch(const InnerException&)
+        {
+            work->innerRun = currentExceptionRun();
+        }
+        work->runAfterInner = currentExceptionRun();
+    }
+    return NULL;
+}
+
+static GrowingCrashCPPExceptionStats getStats(void)
+{
+    GrowingCrashCPPExceptionStats stats;
+    growingcrashcm_getCPPExceptionStats(&stats);
+    return stats;
+}
+
+@interface GrowingCrashCPPExceptionTests : XCTestCase
+
+@end
+
+@implementation GrowingCrashCPPExceptionTests
+
+- (void)setUp
+{
+    [super setUp];
+    growingcrashcm_cppexception_getAPI()->setEnabled(true);
+    growingcrashcm_resetCPPExceptionStats();
+}
+
+- (void)tearDown
+{
+    growingcrashcm_cppexception_getAPI()->setEnabled(false);
+    growingcrashcm_setCPPExceptionCaptureInterval(1);
+    growingcrashcm_resetCPPExceptionStats();
+    [super tearDown];
+}
+
+- (void)testCapturesFirstThrowThenEveryNth
+{
+    growingcrashcm_setCPPExceptionCaptureInterval(3);
+
+    // Captured at the 1st, 4th and 7th throws.
+    throwAndCatch<EveryNthFirst>(7);
+    GrowingCrashCPPExceptionStats stats = getStats();
+    XCTAssertEqual(stats.throws, 7ULL);
+    XCTAssertEqual(stats.captures, 3ULL);
+
+    // Types are counted separately, so a new type's first throw is captured.
+    throwAndCatch<EveryNthSecond>(1);
+    stats = getStats();
+    XCTAssertEqual(stats.throws, 8ULL);
+    XCTAssertEqual(stats.captures, 4ULL);
+
+    // The first type carries on from where it was: its 8th and 9th throws
+    // are skipped, and its 10th is captured.
+    throwAndCatch<EveryNthFirst>(2);
+    stats = getStats();
+    XCTAssertEqual(stats.throws, 10ULL);
+    XCTAssertEqual(stats.captures, 4ULL);
+    throwAndCatch<EveryNthFirst>(1);
+    stats = getStats();
+    XCTAssertEqual(stats.throws, 11ULL);
+    XCTAssertEqual(stats.captures, 5ULL);
+}
+
+- (void)testZeroIntervalCapturesOnlyFirstThrow
+{
+    growingcrashcm_setCPPExceptionCaptureInterval(0);
+    throwAndCatch<FirstOnly>(5);
+    GrowingCrashCPPExceptionStats stats = getStats();
+    XCTAssertEqual(stats.throws, 5ULL);
+    XCTAssertEqual(stats.captures, 1ULL);
+}
+
+- (void)testIntervalOfOneCapturesEveryThrow
+{
+    growingcrashcm_setCPPExceptionCaptureInterval(1);
+    throwAndCatch<EveryThrow>(5);
+    GrowingCrashCPPExceptionStats stats = getStats();
+    XCTAssertEqual(stats.throws, 5ULL);
+    XCTAssertEqual(stats.captures, 5ULL);
+}
+
+- (void)testDisabledMonitorCountsNothing
+{
+    growingcrashcm_cppexception_getAPI()->setEnabled(false);
+    throwAndCatch<EveryThrow>(5);
+    GrowingCrashCPPExceptionStats stats = getStats();
+    XCTAssertEqual(stats.throws, 0ULL);
+    XCTAssertEqual(stats.captures, 0ULL);
+}
+
+- (void)testConcurrentThrowsKeepTheirOwnTraces
+{
+    pthread_t threads[kConcurrentThreadCount];
+    ConcurrentThrow work[kConcurrentThreadCount];
+    int arrivedCount = 0;
+    for(int i = 0; i < kConcurrentThreadCount; i++)
+    {
+        work[i] = (ConcurrentThrow){5 + i, &arrivedCount, 0, 0, 0};
+        XCTAssertEqual(pthread_create(&threads[i], NULL, throwOnThread, &work[i]), 0);
+    }
+    for(int i = 0; i < kConcurrentThreadCount; i++)
+    {
+        pthread_join(threads[i], NULL);
+        XCTAssertEqual(work[i].run, work[i].depth, @"thread %d", i);
+        XCTAssertEqual(work[i].innerRun, work[i].depth + 10, @"thread %d", i);
+        XCTAssertEqual(work[i].runAfterInner, work[i].depth, @"thread %d", i);
+    }
+}
+
+- (void)testUnrecordedThrowGetsNoTrace
+{
+    try
+    {
+        throwAtDepth<RecordedException>(5);
+    }
+    catch(const RecordedException&)
+    {
+        XCTAssertEqual(currentExceptionRun(), 5);
+
+        // Thrown while the monitor is off, so it must not get the trace of
+        // the recorded throw that is still being handled.
+        growingcrashcm_cppexception_getAPI()->setEnabled(false);
+        try
+        {
+            throwAtDepth<UnrecordedException>(7);
+        }
+        catch(const UnrecordedException&)
+        {
+            XCTAssertEqual(currentExceptionRun(), -1);
+        }
+    }
+}
+
+- (void)testUncapturedThrowFallsBackToCurrentStack
+{
+    growingcrashcm_setCPPExceptionCaptureInterval(0);
+    bool isThrowTrace = false;
+    XCTAssertEqual(catchAtDepth(3, &isThrowTrace), 3);
+    XCTAssertTrue(isThrowTrace);
+
+    // Recorded but not sampled.
+    XCTAssertEqual(catchAtDepth(6, &isThrowTrace), 6);
+    XCTAssertFalse(isThrowTrace);
+
+    // Not recorded at all.
+    growingcrashcm_cppexception_getAPI()->setEnabled(false);
+    XCTAssertEqual(catchAtDepth(8, &isThrowTrace), 8);
+    XCTAssertFalse(isThrowTrace);
+}
+
+- (void)testThrowLatencyWithoutHookPerformance
+{
+    growingcrashcm_cppexception_getAPI()->setEnabled(false);
+    [self measureBlock:^{
+        throwAndCatch<BenchmarkException>(kBenchmarkThrowCount);
+    }];
+}
+
+- (void)testThrowLatencyCapturingEveryThrowPerformance
+{
+    growingcrashcm_setCPPExceptionCaptureInterval(1);
+    [self measureBlock:^{
+        throwAndCatch<BenchmarkException>(kBenchmarkThrowCount);
+    }];
+}
+
+- (void)testThrowLatencyCapturingEvery100thThrowPerformance
+{
+    growingcrashcm_setCPPExceptionCaptureInterval(100);
+    [self measureBlock:^{
+        throwAndCatch<BenchmarkException>(kBenchmarkThrowCount);
+    }];
+}
+
+@end
@@ -0,0 +1,257 @@
+//
+//  GrowingCrashDemangleCPPTests.m
+//  GrowingAPMCrashMonitorTests
+//
+//  Created by YoloMao on 2022/10/8.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import "GrowingCrashDemangle_CPP.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define kThreadCount 4
+#define kDemanglesPerThread 1000
+
+/** Names nested depth times, demangling to "n::n::...::f()". */
+static void makeNestedSymbol(int depth, char* mangled, char* demangled)
+{
+    char* m = mangled + sprintf(mangled, "_ZN");
+    char* d = demangled;
+    for(int i = 0; i < depth; i++)
+    {
+        m += sprintf(m, "1n");
+        d += sprintf(d, "n::");
+    }
+    sprintf(m, "1fEv");
+    sprintf(d, "f()");
+}
+
+/** Compare a reused buffer result with a freshly allocated one. */
+static BOOL matchesDemangleCPP(const char* mangledSymbol, const char* reused)
+{
+    char* expected = growingcrashdm_demangleCPP(mangledSymbol);
+    BOOL matches = expected == NULL ? reused == NULL : reused != NULL && strcmp(expected, reused) == 0;
+    free(expected);
+    return matches;
+}
+
+typedef struct
+{
+    int index;
+    int mismatches;
+} ThreadDemangle;
+
+static void* demangleOnThread(void* userData)
+{
+    ThreadDemangle* work = (ThreadDemangle*)userData;
+    char mangled[64];
+    char expected[64];
+    // Every thread alternates between a long and a short symbol of its own.
+    sprintf(mangled, "_ZN7thread%dIiE6methodEv", work->index);
+    sprintf(expected, "thread%d<int>::method()", work->index);
+    for(int i = 0; i < kDemanglesPerThread; i++)
+    {
+        const char* demangled = growingcrashdm_demangleCPPReusingBuffer(i % 2 == 0 ? mangled : "_Z1fv");
+        if(demangled == NULL || strcmp(demangled, i % 2 == 0 ? expected : "f()") != 0)
+        {
+            work->mismatches++;
+        }
+    }
+    return NULL;
+}
+
+@interface GrowingCrashDemangleCPPTests : XCTestCase
+@end
+
+@implementation GrowingCrashDemangleCPPTests
+
+- (void)setUp
+{
+    [super setUp];
+    growingcrashdm_resetCPPStats();
+}
+
+- (void)testDemanglesItaniumNames
+{
+    char* demangled = growingcrashdm_demangleCPP("_ZN5outer5inner6methodEi");
+    XCTAssertTrue(demangled != NULL && strcmp(demangled, "outer::inner::method(int)") == 0, @"%s", demangled);
+    free(demangled);
+    const char* reused = growingcrashdm_demangleCPPReusingBuffer("_ZN5outer5inner6methodEi");
+    XCTAssertTrue(reused != NULL && strcmp(reused, "outer::inner::method(int)") == 0, @"%s", reused);
+}
+
+- (void)testLeadingUnderscores
+{
+    // dladdr() strips one underscore from Mach-O symbols, so the same
+    // function can show up with one or two, and a block inside it with three
+    // or four.
+    const char* const functions[] = {"_Z3fooi", "__Z3fooi"};
+    for(size_t i = 0; i < sizeof(functions) / sizeof(*functions); i++)
+    {
+        const char* demangled = growingcrashdm_demangleCPPReusingBuffer(functions[i]);
+        XCTAssertTrue(demangled != NULL && strcmp(demangled, "foo(int)") == 0, @"%s: %s", functions[i], demangled);
+        XCTAssertTrue(matchesDemangleCPP(functions[i], demangled), @"%s", functions[i]);
+    }
+    const char* const blocks[] = {"___Z3foov_block_invoke", "___Z3foov_block_invoke_2", "____Z3foov_block_invoke"};
+    for(size_t i = 0; i < sizeof(blocks) / sizeof(*blocks); i++)
+    {
+        const char* demangled = growingcrashdm_demangleCPPReusingBuffer(blocks[i]);
+        XCTAssertTrue(demangled != NULL && strcmp(demangled, "invocation function for block in foo()") == 0, @"%s: %s", blocks[i], demangled);
+        XCTAssertTrue(matchesDemangleCPP(blocks[i], demangled), @"%s", blocks[i]);
+    }
+
+    GrowingCrashDemangleCPPStats stats;
+    growingcrashdm_getCPPStats(&stats);
+    XCTAssertEqual(stats.skipped, 0ull);
+
+    // Five underscores is not a mangling.
+    XCTAssertTrue(growingcrashdm_demangleCPPReusingBuffer("_____Z3foov_block_invoke") == NULL);
+    growingcrashdm_getCPPStats(&stats);
+    XCTAssertEqual(stats.skipped, 1ull);
+}
+
+- (void)testSkipsNamesThatAreNotItaniumManglings
+{
+    // __cxa_demangle() would happily demangle some of these as types, such
+    // as "i" to "int".
+    const char* const symbols[] =
+    {
+        "i",
+        "v",
+        "Pc",
+        "main",
+        "_main",
+        "Z3fooi",
+        "_z3fooi",
+        "-[NSObject description]",
+        "$s4main3FooC3baryyF",
+        "_",
+        "____",
+        "",
+        NULL,
+    };
+    int count = (int)(sizeof(symbols) / sizeof(*symbols));
+    for(int i = 0; i < count; i++)
+    {
+        XCTAssertTrue(growingcrashdm_demangleCPP(symbols[i]) == NULL, @"%s", symbols[i]);
+        XCTAssertTrue(growingcrashdm_demangleCPPReusingBuffer(symbols[i]) == NULL, @"%s", symbols[i]);
+    }
+
+    GrowingCrashDemangleCPPStats stats;
+    growingcrashdm_getCPPStats(&stats);
+    XCTAssertEqual(stats.calls, (uint64_t)count * 2);
+    XCTAssertEqual(stats.skipped, (uint64_t)count * 2);
+    XCTAssertEqual(stats.failures, 0ull);
+}
+
+- (void)testCountsCallsSkipsAndFailures
+{
+    free(growingcrashdm_demangleCPP("_Z3fooi"));
+    growingcrashdm_demangleCPPReusingBuffer("_Z3fooi");
+    growingcrashdm_demangleCPPReusingBuffer("_ZN5outer5inner6methodEi");
+    free(growingcrashdm_demangleCPP("main"));
+    growingcrashdm_demangleCPPReusingBuffer("i");
+    growingcrashdm_demangleCPPReusingBuffer(NULL);
+    // Manglings that __cxa_demangle() rejects.
+    free(growingcrashdm_demangleCPP("_Z"));
+    growingcrashdm_demangleCPPReusingBuffer("_ZN3foo");
+    growingcrashdm_demangleCPPReusingBuffer("_Z3fooi!");
+
+    GrowingCrashDemangleCPPStats stats;
+    growingcrashdm_getCPPStats(&stats);
+    XCTAssertEqual(stats.calls, 9ull);
+    XCTAssertEqual(stats.skipped, 3ull);
+    XCTAssertEqual(stats.failures, 3ull);
+
+    growingcrashdm_resetCPPStats();
+    growingcrashdm_getCPPStats(&stats);
+    XCTAssertEqual(stats.calls, 0ull);
+    XCTAssertEqual(stats.skipped, 0ull);
+    XCTAssertEqual(stats.failures, 0ull);
+}
+
+- (void)testBufferGrowsAndIsReused
+{
+    static char mangled[2000];
+    static char expected[4000];
+    for(int depth = 1; depth <= 400; depth *= 2)
+    {
+        makeNestedSymbol(depth, mangled, expected);
+        const char* demangled = growingcrashdm_demangleCPPReusingBuffer(mangled);
+        XCTAssertTrue(demangled != NULL && strcmp(demangled, expected) == 0, @"depth %d: %s", depth, demangled);
+    }
+
+    // Once grown, shorter names are demangled into the same buffer.
+    const char* first = growingcrashdm_demangleCPPReusingBuffer("_Z1fv");
+    XCTAssertTrue(first != NULL && strcmp(first, "f()") == 0, @"%s", first);
+    for(int depth = 1; depth <= 100; depth++)
+    {
+        makeNestedSymbol(depth, mangled, expected);
+        const char* demangled = growingcrashdm_demangleCPPReusingBuffer(mangled);
+        XCTAssertTrue(demangled == first, @"depth %d", depth);
+        XCTAssertTrue(demangled != NULL && strcmp(demangled, expected) == 0, @"depth %d: %s", depth, demangled);
+    }
+
+    // A failure leaves the buffer in place for the next name.
+    XCTAssertTrue(growingcrashdm_demangleCPPReusingBuffer("_ZN3foo") == NULL);
+    XCTAssertTrue(growingcrashdm_demangleCPPReusingBuffer("_Z1fv") == first);
+}
+
+- (void)testThreadsHaveTheirOwnBuffers
+{
+    const char* mine = growingcrashdm_demangleCPPReusingBuffer("_ZN4main6threadEv");
+    XCTAssertTrue(mine != NULL && strcmp(mine, "main::thread()") == 0, @"%s", mine);
+
+    pthread_t threads[kThreadCount];
+    ThreadDemangle work[kThreadCount];
+    for(int i = 0; i < kThreadCount; i++)
+    {
+        work[i] = (ThreadDemangle){i, 0};
+        XCTAssertEqual(pthread_create(&threads[i], NULL, demangleOnThread, &work[i]), 0);
+    }
+    for(int i = 0; i < kThreadCount; i++)
+    {
+        pthread_join(threads[i], NULL);
+        XCTAssertEqual(work[i].mismatches, 0, @"thread %d", i);
+    }
+    XCTAssertTrue(strcmp(mine, "main::thread()") == 0, @"%s", mine);
+}
+
+- (void)testDemangleCPPPerformance
+{
+    [self measureBlock:^{
+        for(int i = 0; i < 20000; i++)
+        {
+            free(growingcrashdm_demangleCPP("_ZN5outer5inner6methodEi"));
+        }
+    }];
+}
+
+- (void)testDemangleCPPReusingBufferPerformance
+{
+    [self measureBlock:^{
+        for(int i = 0; i < 20000; i++)
+        {
+            growingcrashdm_demangleCPPReusingBuffer("_ZN5outer5inner6methodEi");
+        }
+    }];
+}
+
+@end
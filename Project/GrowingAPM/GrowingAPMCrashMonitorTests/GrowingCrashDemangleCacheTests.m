@@ -0,0 +1,239 @@
+//
+//  GrowingCrashDemangleCacheTests.m
+//  GrowingAPMCrashMonitorTests
+//
+//  Created by YoloMao on 2022/10/8.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import "GrowingCrashDemangleCache.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define kConcurrentThreadCount 8
+
+/** Like a report: a few hundred symbols, each seen many times. */
+#define kWorkingSetSize 500
+#define kLookupsPerSymbol 20
+
+/** Demangle a symbol and report whether the cache answered it. */
+static BOOL demangleWasHit(const char* mangledSymbol, const char* expected)
+{
+    GrowingCrashDemangleCacheStats before;
+    GrowingCrashDemangleCacheStats after;
+    growingcrashdmc_getStats(&before);
+    char* demangled = growingcrashdmc_demangle(mangledSymbol);
+    growingcrashdmc_getStats(&after);
+
+    BOOL matches = demangled != NULL && strcmp(demangled, expected) == 0;
+    free(demangled);
+    if(!matches)
+    {
+        return NO;
+    }
+    return after.hits == before.hits + 1;
+}
+
+/** A C++ function name that demangles to "ns::functionN()". */
+static void makeSymbol(int index, char* mangled, char* demangled)
+{
+    char name[32];
+    int nameLength = sprintf(name, "function%d", index);
+    sprintf(mangled, "_ZN2ns%d%sEv", nameLength, name);
+    sprintf(demangled, "ns::%s()", name);
+}
+
+typedef struct
+{
+    int* startFlag;
+    char* result;
+} ConcurrentLookup;
+
+static void* demangleWhenStarted(void* userData)
+{
+    ConcurrentLookup* lookup = (ConcurrentLookup*)userData;
+    while(!__atomic_load_n(lookup->startFlag, __ATOMIC_ACQUIRE))
+    {
+    }
+    lookup->result = growingcrashdmc_demangle("_ZN5outer5inner6methodEi");
+    return NULL;
+}
+
+static void demangleWorkingSet(void)
+{
+    char mangled[64];
+    char demangled[64];
+    for(int pass = 0; pass < kLookupsPerSymbol; pass++)
+    {
+        for(int i = 0; i < kWorkingSetSize; i++)
+        {
+            makeSymbol(i, mangled, demangled);
+            free(growingcrashdmc_demangle(mangled));
+        }
+    }
+}
+
+@interface GrowingCrashDemangleCacheTests : XCTestCase
+
+@end
+
+@implementation GrowingCrashDemangleCacheTests
+
+- (void)setUp
+{
+    [super setUp];
+    growingcrashdmc_setCapacity(GrowingCrashDMC_DEFAULT_CAPACITY);
+    growingcrashdmc_resetStats();
+}
+
+- (void)tearDown
+{
+    growingcrashdmc_setCapacity(GrowingCrashDMC_DEFAULT_CAPACITY);
+    growingcrashdmc_resetStats();
+    [super tearDown];
+}
+
+- (void)testEvictsLeastRecentlyUsed
+{
+    growingcrashdmc_setCapacity(3);
+    XCTAssertFalse(demangleWasHit("_ZN1a1fEv", "a::f()"));
+    XCTAssertFalse(demangleWasHit("_ZN1b1fEv", "b::f()"));
+    XCTAssertFalse(demangleWasHit("_ZN1c1fEv", "c::f()"));
+
+    // a is now newer than b, so b is the one to go.
+    XCTAssertTrue(demangleWasHit("_ZN1a1fEv", "a::f()"));
+    XCTAssertFalse(demangleWasHit("_ZN1d1fEv", "d::f()"));
+
+    GrowingCrashDemangleCacheStats stats;
+    growingcrashdmc_getStats(&stats);
+    XCTAssertEqual(stats.count, 3);
+    XCTAssertEqual(stats.evictions, 1ULL);
+
+    XCTAssertTrue(demangleWasHit("_ZN1c1fEv", "c::f()"));
+    XCTAssertTrue(demangleWasHit("_ZN1a1fEv", "a::f()"));
+    XCTAssertTrue(demangleWasHit("_ZN1d1fEv", "d::f()"));
+    XCTAssertFalse(demangleWasHit("_ZN1b1fEv", "b::f()"));
+
+    // Bringing b back pushed out c, the oldest after the lookups above.
+    XCTAssertFalse(demangleWasHit("_ZN1c1fEv", "c::f()"));
+    growingcrashdmc_getStats(&stats);
+    XCTAssertEqual(stats.evictions, 3ULL);
+}
+
+- (void)testRemembersFailures
+{
+    char* demangled = growingcrashdmc_demangle("not_a_mangled_symbol");
+    XCTAssertNil(demangled);
+    demangled = growingcrashdmc_demangle("not_a_mangled_symbol");
+    XCTAssertNil(demangled);
+
+    GrowingCrashDemangleCacheStats stats;
+    growingcrashdmc_getStats(&stats);
+    XCTAssertEqual(stats.misses, 1ULL);
+    XCTAssertEqual(stats.hits, 1ULL);
+}
+
+- (void)testZeroCapacityDisablesCaching
+{
+    growingcrashdmc_setCapacity(0);
+    for(int i = 0; i < 3; i++)
+    {
+        XCTAssertFalse(demangleWasHit("_ZN1a1fEv", "a::f()"));
+    }
+
+    GrowingCrashDemangleCacheStats stats;
+    growingcrashdmc_getStats(&stats);
+    XCTAssertEqual(stats.count, 0);
+    XCTAssertEqual(stats.capacity, 0);
+    XCTAssertEqual(stats.misses, 3ULL);
+    XCTAssertEqual(stats.evictions, 0ULL);
+}
+
+- (void)testNegativeCapacityDisablesCaching
+{
+    growingcrashdmc_setCapacity(-1);
+    XCTAssertFalse(demangleWasHit("_ZN1a1fEv", "a::f()"));
+
+    GrowingCrashDemangleCacheStats stats;
+    growingcrashdmc_getStats(&stats);
+    XCTAssertEqual(stats.count, 0);
+    XCTAssertEqual(stats.capacity, 0);
+}
+
+- (void)testConcurrentMissesOnSameSymbol
+{
+    int startFlag = 0;
+    pthread_t threads[kConcurrentThreadCount];
+    ConcurrentLookup lookups[kConcurrentThreadCount];
+    for(int i = 0; i < kConcurrentThreadCount; i++)
+    {
+        lookups[i].startFlag = &startFlag;
+        lookups[i].result = NULL;
+        XCTAssertEqual(pthread_create(&threads[i], NULL, demangleWhenStarted, &lookups[i]), 0);
+    }
+    __atomic_store_n(&startFlag, 1, __ATOMIC_RELEASE);
+    for(int i = 0; i < kConcurrentThreadCount; i++)
+    {
+        pthread_join(threads[i], NULL);
+        XCTAssertNotNil(lookups[i].result);
+        if(lookups[i].result != NULL)
+        {
+            XCTAssertEqual(strcmp(lookups[i].result, "outer::inner::method(int)"), 0, @"%s", lookups[i].result);
+        }
+        free(lookups[i].result);
+    }
+
+    // Threads that missed together all demangle, but only one entry is kept.
+    GrowingCrashDemangleCacheStats stats;
+    growingcrashdmc_getStats(&stats);
+    XCTAssertEqual(stats.count, 1);
+    XCTAssertEqual(stats.hits + stats.misses, (uint64_t)kConcurrentThreadCount);
+    XCTAssertGreaterThanOrEqual(stats.misses, 1ULL);
+    XCTAssertTrue(demangleWasHit("_ZN5outer5inner6methodEi", "outer::inner::method(int)"));
+}
+
+- (void)testClearKeepsStats
+{
+    XCTAssertFalse(demangleWasHit("_ZN1a1fEv", "a::f()"));
+    growingcrashdmc_clear();
+
+    GrowingCrashDemangleCacheStats stats;
+    growingcrashdmc_getStats(&stats);
+    XCTAssertEqual(stats.count, 0);
+    XCTAssertEqual(stats.misses, 1ULL);
+    XCTAssertFalse(demangleWasHit("_ZN1a1fEv", "a::f()"));
+}
+
+- (void)testDemangleWorkingSetPerformance
+{
+    [self measureBlock:^{
+        growingcrashdmc_clear();
+        demangleWorkingSet();
+    }];
+}
+
+- (void)testDemangleWorkingSetWithoutCachePerformance
+{
+    growingcrashdmc_setCapacity(0);
+    [self measureBlock:^{
+        demangleWorkingSet();
+    }];
+}
+
+@end
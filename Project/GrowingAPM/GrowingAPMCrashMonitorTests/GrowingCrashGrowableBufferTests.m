@@ -0,0 +1,94 @@
+//
+//  GrowingCrashGrowableBufferTests.m
+//  GrowingAPMCrashMonitorTests
+//
+//  Created by YoloMao on 2022/10/8.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import "GrowingCrashGrowableBuffer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+@interface GrowingCrashGrowableBufferTests : XCTestCase
+
+@end
+
+@implementation GrowingCrashGrowableBufferTests
+
+- (void)testTerminateEmptyBuffer
+{
+    GrowingCrashGrowableBuffer buffer = {NULL, 0, 0};
+    XCTAssertTrue(growingcrashgb_terminate(&buffer));
+    XCTAssertNotNil(buffer.data);
+    XCTAssertEqual(buffer.length, 0);
+    XCTAssertEqual(strcmp(buffer.data, ""), 0);
+    free(buffer.data);
+}
+
+- (void)testAppendGrowsAndKeepsContents
+{
+    GrowingCrashGrowableBuffer buffer = {NULL, 0, 0};
+    char chunk[1000];
+    for(int i = 0; i < 1000; i++)
+    {
+        memset(chunk, 'a' + i % 26, sizeof(chunk));
+        XCTAssertTrue(growingcrashgb_append(&buffer, chunk, (int)sizeof(chunk)));
+    }
+    XCTAssertEqual(buffer.length, 1000 * 1000);
+    XCTAssertGreaterThan(buffer.capacity, buffer.length);
+    for(int i = 0; i < 1000; i++)
+    {
+        XCTAssertEqual(buffer.data[i * 1000], 'a' + i % 26);
+        XCTAssertEqual(buffer.data[i * 1000 + 999], 'a' + i % 26);
+    }
+    free(buffer.data);
+}
+
+- (void)testTerminateIsNotCountedInLength
+{
+    GrowingCrashGrowableBuffer buffer = {NULL, 0, 0};
+    XCTAssertTrue(growingcrashgb_append(&buffer, "abc", 3));
+    XCTAssertTrue(growingcrashgb_terminate(&buffer));
+    XCTAssertEqual(buffer.length, 3);
+    XCTAssertTrue(growingcrashgb_append(&buffer, "def", 3));
+    XCTAssertTrue(growingcrashgb_terminate(&buffer));
+    XCTAssertEqual(strcmp(buffer.data, "abcdef"), 0);
+    free(buffer.data);
+}
+
+- (void)testTerminateExactlyFullReservation
+{
+    GrowingCrashGrowableBuffer buffer = {NULL, 0, 0};
+    XCTAssertTrue(growingcrashgb_reserve(&buffer, 4));
+    XCTAssertEqual(buffer.capacity, 4);
+    XCTAssertTrue(growingcrashgb_append(&buffer, "abcd", 4));
+    XCTAssertTrue(growingcrashgb_terminate(&buffer));
+    XCTAssertEqual(strcmp(buffer.data, "abcd"), 0);
+    free(buffer.data);
+}
+
+- (void)testReserveNeverShrinks
+{
+    GrowingCrashGrowableBuffer buffer = {NULL, 0, 0};
+    XCTAssertTrue(growingcrashgb_reserve(&buffer, 100));
+    XCTAssertTrue(growingcrashgb_reserve(&buffer, 10));
+    XCTAssertEqual(buffer.capacity, 100);
+    free(buffer.data);
+}
+
+@end
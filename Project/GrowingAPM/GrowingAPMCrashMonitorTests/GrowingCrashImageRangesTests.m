@@ -0,0 +1,366 @@
+//
+//  GrowingCrashImageRangesTests.m
+//  GrowingAPMCrashMonitorTests
+//
+//  Created by YoloMao on 2022/10/8.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import "GrowingCrashImageRanges.h"
+
+#include <mach-o/loader.h>
+#include <string.h>
+
+#define SEGMENT_64(NAME, VMADDR, VMSIZE) \
+    {LC_SEGMENT_64, sizeof(struct segment_command_64), NAME, VMADDR, VMSIZE, 0, VMSIZE, 5, 5, 0, 0}
+#define SEGMENT(NAME, VMADDR, VMSIZE) \
+    {LC_SEGMENT, sizeof(struct segment_command), NAME, VMADDR, VMSIZE, 0, VMSIZE, 5, 5, 0, 0}
+#define HEADER_64(TYPE, FIXTURE) \
+    {MH_MAGIC_64, 0, 0, TYPE, (sizeof(FIXTURE) - sizeof(struct mach_header_64)) / sizeof(struct segment_command_64), \
+     sizeof(FIXTURE) - sizeof(struct mach_header_64), 0, 0}
+
+// ============================================================================
+#pragma mark - Fixtures -
+// ============================================================================
+
+/** An executable, as dyld maps its header and load commands. */
+typedef struct
+{
+    struct mach_header_64 header;
+    struct segment_command_64 pageZero;
+    struct segment_command_64 text;
+    struct uuid_command uuid;
+    struct segment_command_64 data;
+    struct segment_command_64 linkedit;
+} Executable64;
+
+/** A library from the dyld shared cache. The shared cache images' __LINKEDIT
+ * segments all map the same range.
+ */
+typedef struct
+{
+    struct mach_header_64 header;
+    struct segment_command_64 text;
+    struct segment_command_64 empty;
+    struct segment_command_64 data;
+    struct segment_command_64 linkedit;
+} Library64;
+
+typedef struct
+{
+    struct mach_header header;
+    struct segment_command text;
+    struct segment_command data;
+} Library32;
+
+#define kExecutableSlide ((uintptr_t)0x4000)
+#define kLibrarySlide ((uintptr_t)0x10000)
+#define kLibrary32Slide ((uintptr_t)0x200000000)
+#define kSharedLinkeditStart ((uintptr_t)0x1f0000000)
+#define kSharedLinkeditSize ((uintptr_t)0x8000)
+
+static Executable64 g_executable = {
+    {MH_MAGIC_64, 0, 0, MH_EXECUTE, 5, sizeof(Executable64) - sizeof(struct mach_header_64), 0, 0},
+    SEGMENT_64("__PAGEZERO", 0, 0x100000000),
+    SEGMENT_64("__TEXT", 0x100000000, 0x8000),
+    {LC_UUID, sizeof(struct uuid_command), {0}},
+    SEGMENT_64("__DATA", 0x100008000, 0x4000),
+    SEGMENT_64("__LINKEDIT", 0x10000c000, 0x4000),
+};
+
+static Library64 g_library = {
+    HEADER_64(MH_DYLIB, Library64),
+    SEGMENT_64("__TEXT", 0x180000000, 0x10000),
+    SEGMENT_64("__EMPTY", 0x180010000, 0),
+    SEGMENT_64("__DATA", 0x180010000, 0x4000),
+    SEGMENT_64("__LINKEDIT", kSharedLinkeditStart - kLibrarySlide, kSharedLinkeditSize),
+};
+
+static Library64 g_otherLibrary = {
+    HEADER_64(MH_DYLIB, Library64),
+    SEGMENT_64("__TEXT", 0x181000000, 0x20000),
+    SEGMENT_64("__EMPTY", 0x181020000, 0),
+    SEGMENT_64("__DATA", 0x181020000, 0x4000),
+    SEGMENT_64("__LINKEDIT", kSharedLinkeditStart - kLibrarySlide, kSharedLinkeditSize),
+};
+
+static Library32 g_library32 = {
+    {MH_MAGIC, 0, 0, MH_DYLIB, 2, sizeof(Library32) - sizeof(struct mach_header), 0},
+    SEGMENT("__TEXT", 0x1000, 0x2000),
+    SEGMENT("__DATA", 0x3000, 0x1000),
+};
+
+static struct mach_header_64 g_corruptHeader = {0, 0, 0, MH_DYLIB, 1, sizeof(struct segment_command_64), 0, 0};
+
+static const struct mach_header* const kExecutable = (const struct mach_header*)&g_executable;
+static const struct mach_header* const kLibrary = (const struct mach_header*)&g_library;
+static const struct mach_header* const kOtherLibrary = (const struct mach_header*)&g_otherLibrary;
+static const struct mach_header* const kLibrary32 = (const struct mach_header*)&g_library32;
+static const struct mach_header* const kCorruptHeader = (const struct mach_header*)&g_corruptHeader;
+
+/** Append an image's ranges. Returns the number added. */
+static int appendImageRanges(const struct mach_header* header,
+                             uintptr_t slide,
+                             uint32_t imageIndex,
+                             GrowingCrashImageRange* ranges,
+                             int count)
+{
+    int added = growingcrashir_getImageRanges(header, slide, imageIndex, NULL, 0);
+    growingcrashir_getImageRanges(header, slide, imageIndex, ranges + count, added);
+    return added;
+}
+
+static const struct mach_header* headerContaining(const GrowingCrashImageRange* ranges, int count, uintptr_t address)
+{
+    const GrowingCrashImageRange* range;
+    growingcrashir_findImageRange(ranges, count, address, &range);
+    return range == NULL ? NULL : range->header;
+}
+
+@interface GrowingCrashImageRangesTests : XCTestCase
+
+@end
+
+@implementation GrowingCrashImageRangesTests
+
+// ============================================================================
+#pragma mark - Getting Ranges -
+// ============================================================================
+
+- (void)testExecutableRanges
+{
+    GrowingCrashImageRange ranges[4];
+    int count = growingcrashir_getImageRanges(kExecutable, kExecutableSlide, 3, ranges, 4);
+    XCTAssertEqual(count, 4);
+
+    // In load command order, skipping the UUID.
+    XCTAssertEqual(ranges[0].start, kExecutableSlide);
+    XCTAssertEqual(ranges[0].end, kExecutableSlide + 0x100000000);
+    XCTAssertEqual(ranges[1].start, kExecutableSlide + 0x100000000);
+    XCTAssertEqual(ranges[1].end, kExecutableSlide + 0x100008000);
+    XCTAssertEqual(ranges[2].start, kExecutableSlide + 0x100008000);
+    XCTAssertEqual(ranges[3].end, kExecutableSlide + 0x100010000);
+    for(int i = 0; i < count; i++)
+    {
+        XCTAssertEqual(ranges[i].header, kExecutable);
+        XCTAssertEqual(ranges[i].slide, kExecutableSlide);
+        XCTAssertEqual(ranges[i].maxEnd, ranges[i].end);
+        XCTAssertTrue(ranges[i].symbolTable == NULL);
+        XCTAssertEqual(ranges[i].imageIndexHint, 3);
+    }
+}
+
+- (void)testSegmentsWithoutAddressSpaceAreLeftOut
+{
+    GrowingCrashImageRange ranges[4];
+    int count = growingcrashir_getImageRanges(kLibrary, kLibrarySlide, 0, ranges, 4);
+    XCTAssertEqual(count, 3);
+    XCTAssertEqual(ranges[0].end, kLibrarySlide + 0x180010000);
+    XCTAssertEqual(ranges[1].start, kLibrarySlide + 0x180010000);
+    XCTAssertEqual(ranges[1].end, kLibrarySlide + 0x180014000);
+    XCTAssertEqual(ranges[2].start, kSharedLinkeditStart);
+}
+
+- (void)test32BitImageRanges
+{
+    GrowingCrashImageRange ranges[2];
+    int count = growingcrashir_getImageRanges(kLibrary32, kLibrary32Slide, 1, ranges, 2);
+    XCTAssertEqual(count, 2);
+    XCTAssertEqual(ranges[0].start, kLibrary32Slide + 0x1000);
+    XCTAssertEqual(ranges[0].end, kLibrary32Slide + 0x3000);
+    XCTAssertEqual(ranges[1].start, kLibrary32Slide + 0x3000);
+    XCTAssertEqual(ranges[1].end, kLibrary32Slide + 0x4000);
+}
+
+- (void)testCorruptHeaderHasNoRanges
+{
+    XCTAssertEqual(growingcrashir_getImageRanges(kCorruptHeader, 0, 0, NULL, 0), 0);
+}
+
+- (void)testCountsRangesThatDoNotFit
+{
+    GrowingCrashImageRange ranges[3];
+    memset(ranges, 0xa5, sizeof(ranges));
+    XCTAssertEqual(growingcrashir_getImageRanges(kExecutable, kExecutableSlide, 0, ranges, 2), 4);
+    XCTAssertEqual(ranges[1].start, kExecutableSlide + 0x100000000);
+    XCTAssertEqual(ranges[2].start, (uintptr_t)0xa5a5a5a5a5a5a5a5ULL);
+    XCTAssertEqual(growingcrashir_getImageRanges(kExecutable, kExecutableSlide, 0, NULL, 0), 4);
+}
+
+// ============================================================================
+#pragma mark - Building and Finding -
+// ============================================================================
+
+- (void)testBuiltRangesAreSorted
+{
+    GrowingCrashImageRange added[16];
+    int addedCount = 0;
+    addedCount += appendImageRanges(kLibrary, kLibrarySlide, 1, added, addedCount);
+    addedCount += appendImageRanges(kLibrary32, kLibrary32Slide, 2, added, addedCount);
+    addedCount += appendImageRanges(kExecutable, kExecutableSlide, 0, added, addedCount);
+    XCTAssertEqual(addedCount, 9);
+
+    GrowingCrashImageRange ranges[16];
+    int count = growingcrashir_buildImageRanges(NULL, 0, NULL, added, addedCount, ranges);
+    XCTAssertEqual(count, addedCount);
+    uintptr_t maxEnd = 0;
+    for(int i = 0; i < count; i++)
+    {
+        if(i > 0)
+        {
+            XCTAssertLessThanOrEqual(ranges[i - 1].start, ranges[i].start);
+        }
+        maxEnd = ranges[i].end > maxEnd ? ranges[i].end : maxEnd;
+        XCTAssertEqual(ranges[i].maxEnd, maxEnd);
+    }
+    XCTAssertEqual(ranges[0].start, kExecutableSlide);
+    XCTAssertTrue(ranges[0].header == kExecutable);
+    XCTAssertEqual(ranges[count - 1].start, kLibrary32Slide + 0x3000);
+    XCTAssertTrue(ranges[count - 1].header == kLibrary32);
+
+    // The shared __LINKEDIT comes after the library's __DATA, but ends before
+    // the 32-bit library starts.
+    XCTAssertEqual(ranges[count - 3].start, kSharedLinkeditStart);
+    XCTAssertEqual(ranges[count - 3].maxEnd, kSharedLinkeditStart + kSharedLinkeditSize);
+}
+
+- (void)testFindsTheImageContainingAnAddress
+{
+    GrowingCrashImageRange added[16];
+    int addedCount = 0;
+    addedCount += appendImageRanges(kExecutable, kExecutableSlide, 0, added, addedCount);
+    addedCount += appendImageRanges(kLibrary, kLibrarySlide, 1, added, addedCount);
+    addedCount += appendImageRanges(kLibrary32, kLibrary32Slide, 2, added, addedCount);
+    GrowingCrashImageRange ranges[16];
+    int count = growingcrashir_buildImageRanges(NULL, 0, NULL, added, addedCount, ranges);
+
+    XCTAssertEqual(headerContaining(ranges, count, kExecutableSlide + 0x100000000), kExecutable);
+    XCTAssertEqual(headerContaining(ranges, count, kExecutableSlide + 0x100007ffc), kExecutable);
+    XCTAssertEqual(headerContaining(ranges, count, kExecutableSlide + 0x10000fff0), kExecutable);
+    XCTAssertEqual(headerContaining(ranges, count, kLibrarySlide + 0x180000010), kLibrary);
+    XCTAssertEqual(headerContaining(ranges, count, kLibrarySlide + 0x180013ff0), kLibrary);
+    XCTAssertEqual(headerContaining(ranges, count, kSharedLinkeditStart + 0x10), kLibrary);
+    XCTAssertEqual(headerContaining(ranges, count, kLibrary32Slide + 0x1000), kLibrary32);
+    XCTAssertEqual(headerContaining(ranges, count, kLibrary32Slide + 0x3fff), kLibrary32);
+
+    // Inside __PAGEZERO, which is mapped like any other segment.
+    XCTAssertEqual(headerContaining(ranges, count, kExecutableSlide + 0x1000), kExecutable);
+
+    // Before the first range, between ranges, and past the last one.
+    XCTAssertTrue(headerContaining(ranges, count, kExecutableSlide - 1) == NULL);
+    XCTAssertTrue(headerContaining(ranges, count, kExecutableSlide + 0x100010000) == NULL);
+    XCTAssertTrue(headerContaining(ranges, count, kLibrarySlide + 0x180014000) == NULL);
+    XCTAssertTrue(headerContaining(ranges, count, kSharedLinkeditStart + kSharedLinkeditSize) == NULL);
+    XCTAssertTrue(headerContaining(ranges, count, kLibrary32Slide + 0x4000) == NULL);
+    XCTAssertTrue(headerContaining(ranges, count, UINTPTR_MAX) == NULL);
+    XCTAssertTrue(headerContaining(ranges, 0, kExecutableSlide) == NULL);
+}
+
+- (void)testOverlappingRangesAreAmbiguous
+{
+    GrowingCrashImageRange added[16];
+    int addedCount = 0;
+    addedCount += appendImageRanges(kLibrary, kLibrarySlide, 0, added, addedCount);
+    addedCount += appendImageRanges(kOtherLibrary, kLibrarySlide, 1, added, addedCount);
+    GrowingCrashImageRange ranges[16];
+    int count = growingcrashir_buildImageRanges(NULL, 0, NULL, added, addedCount, ranges);
+
+    const GrowingCrashImageRange* range;
+    XCTAssertFalse(growingcrashir_findImageRange(ranges, count, kSharedLinkeditStart + 0x100, &range));
+    XCTAssertTrue(range == NULL);
+
+    XCTAssertTrue(growingcrashir_findImageRange(ranges, count, kLibrarySlide + 0x181000100, &range));
+    XCTAssertTrue(range != NULL && range->header == kOtherLibrary);
+    XCTAssertTrue(growingcrashir_findImageRange(ranges, count, kSharedLinkeditStart + kSharedLinkeditSize, &range));
+    XCTAssertTrue(range == NULL);
+}
+
+- (void)testRangesInsideALargerRange
+{
+    // Slid into the executable's __PAGEZERO.
+    const uintptr_t slide = kExecutableSlide + 0x10000000;
+    GrowingCrashImageRange added[16];
+    int addedCount = 0;
+    addedCount += appendImageRanges(kExecutable, kExecutableSlide, 0, added, addedCount);
+    addedCount += appendImageRanges(kLibrary32, slide, 1, added, addedCount);
+    GrowingCrashImageRange ranges[16];
+    int count = growingcrashir_buildImageRanges(NULL, 0, NULL, added, addedCount, ranges);
+
+    const GrowingCrashImageRange* range;
+    XCTAssertFalse(growingcrashir_findImageRange(ranges, count, slide + 0x2000, &range));
+    XCTAssertTrue(range == NULL);
+
+    // Past the library, the search has to reach back to __PAGEZERO.
+    XCTAssertEqual(headerContaining(ranges, count, slide + 0x4000), kExecutable);
+    XCTAssertEqual(headerContaining(ranges, count, slide + 0x1000 - 1), kExecutable);
+    XCTAssertEqual(headerContaining(ranges, count, kExecutableSlide + 0x100000000 - 1), kExecutable);
+}
+
+- (void)testAddingToExistingRanges
+{
+    GrowingCrashImageRange added[16];
+    int addedCount = appendImageRanges(kExecutable, kExecutableSlide, 0, added, 0);
+    GrowingCrashImageRange oldRanges[16];
+    int oldCount = growingcrashir_buildImageRanges(NULL, 0, NULL, added, addedCount, oldRanges);
+
+    addedCount = appendImageRanges(kLibrary32, kLibrary32Slide, 1, added, 0);
+    addedCount += appendImageRanges(kLibrary, kLibrarySlide, 2, added, addedCount);
+    GrowingCrashImageRange ranges[16];
+    int count = growingcrashir_buildImageRanges(oldRanges, oldCount, NULL, added, addedCount, ranges);
+
+    // The same as adding them all at once.
+    GrowingCrashImageRange all[16];
+    int allCount = appendImageRanges(kExecutable, kExecutableSlide, 0, all, 0);
+    allCount += appendImageRanges(kLibrary32, kLibrary32Slide, 1, all, allCount);
+    allCount += appendImageRanges(kLibrary, kLibrarySlide, 2, all, allCount);
+    GrowingCrashImageRange expected[16];
+    int expectedCount = growingcrashir_buildImageRanges(NULL, 0, NULL, all, allCount, expected);
+
+    XCTAssertEqual(count, expectedCount);
+    for(int i = 0; i < count; i++)
+    {
+        XCTAssertEqual(ranges[i].start, expected[i].start);
+        XCTAssertEqual(ranges[i].end, expected[i].end);
+        XCTAssertEqual(ranges[i].maxEnd, expected[i].maxEnd);
+        XCTAssertEqual(ranges[i].header, expected[i].header);
+    }
+}
+
+- (void)testRemovingAnImage
+{
+    GrowingCrashImageRange added[16];
+    int addedCount = 0;
+    addedCount += appendImageRanges(kExecutable, kExecutableSlide, 0, added, addedCount);
+    addedCount += appendImageRanges(kLibrary, kLibrarySlide, 1, added, addedCount);
+    addedCount += appendImageRanges(kOtherLibrary, kLibrarySlide, 2, added, addedCount);
+    GrowingCrashImageRange oldRanges[16];
+    int oldCount = growingcrashir_buildImageRanges(NULL, 0, NULL, added, addedCount, oldRanges);
+
+    GrowingCrashImageRange ranges[16];
+    int count = growingcrashir_buildImageRanges(oldRanges, oldCount, kLibrary, NULL, 0, ranges);
+    XCTAssertEqual(count, oldCount - 3);
+    for(int i = 0; i < count; i++)
+    {
+        XCTAssertTrue(ranges[i].header != kLibrary);
+    }
+    XCTAssertTrue(headerContaining(ranges, count, kLibrarySlide + 0x180000010) == NULL);
+
+    // With only one image mapping it, the shared __LINKEDIT is no longer ambiguous.
+    XCTAssertEqual(headerContaining(ranges, count, kSharedLinkeditStart), kOtherLibrary);
+    XCTAssertEqual(headerContaining(ranges, count, kExecutableSlide + 0x100000000), kExecutable);
+}
+
+@end
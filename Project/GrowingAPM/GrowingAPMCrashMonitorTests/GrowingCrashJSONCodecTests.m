@@ -0,0 +1,1056 @@
+//
+//  GrowingCrashJSONCodecTests.m
+//  GrowingAPMCrashMonitorTests
+//
+//  Created by YoloMao on 2022/10/8.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import "GrowingCrashJSONCodec.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Numbers that are easy to get wrong: exact and inexact mantissas, both
+ * sides of the fast path's limits, subnormals, overflow and underflow.
+ */
+static const char* g_numberCorpus[] =
+{
+    "0.0", "0.1", "0.2", "0.3", "1.5", "3.14159", "2.718281828459045",
+    "1e0", "1e1", "1e22", "1e23", "1e-22", "1e-23", "1E5", "1e+5",
+    "9007199254740992.0", "9007199254740993.0", "9007199254740994.0",
+    "9007199254740991e22", "9007199254740993e-22",
+    "123456789012345678901234567890.5",
+    "0.000000000000000000000000000001",
+    "1.7976931348623157e308", "1.7976931348623159e308", "1e309",
+    "2.2250738585072014e-308", "2.2250738585072011e-308",
+    "4.9406564584124654e-324", "2.4703282292062327e-324", "1e-400",
+    "0.30000000000000004", "1234.5678e-2", "100000000000000000000000.0",
+    "7.038531e-26", "8.98846567431158e307", "1.00000000000000011102230246251565e0",
+    "18446744073709551616", "18446744073709551615.0",
+    "36893488147419103232", "99999999999999999999999999",
+};
+
+typedef struct
+{
+    int count;
+    int floatCount;
+    double floats[8];
+    int integerCount;
+    int64_t integers[8];
+    int uintegerCount;
+    uint64_t uintegers[8];
+} DecodedNumbers;
+
+static int onBooleanElement(__unused const GrowingCrashJSONStringView* name, __unused bool value, __unused void* userData)
+{
+    return GrowingCrashJSON_OK;
+}
+
+static int onFloatingPointElement(__unused const GrowingCrashJSONStringView* name, double value, void* userData)
+{
+    DecodedNumbers* numbers = userData;
+    numbers->count++;
+    if(numbers->floatCount < 8)
+    {
+        numbers->floats[numbers->floatCount++] = value;
+    }
+    return GrowingCrashJSON_OK;
+}
+
+static int onIntegerElement(__unused const GrowingCrashJSONStringView* name, int64_t value, void* userData)
+{
+    DecodedNumbers* numbers = userData;
+    numbers->count++;
+    if(numbers->integerCount < 8)
+    {
+        numbers->integers[numbers->integerCount++] = value;
+    }
+    return GrowingCrashJSON_OK;
+}
+
+static int onUIntegerElement(__unused const GrowingCrashJSONStringView* name, uint64_t value, void* userData)
+{
+    DecodedNumbers* numbers = userData;
+    numbers->count++;
+    if(numbers->uintegerCount < 8)
+    {
+        numbers->uintegers[numbers->uintegerCount++] = value;
+    }
+    return GrowingCrashJSON_OK;
+}
+
+static int onNullElement(__unused const GrowingCrashJSONStringView* name, __unused void* userData)
+{
+    return GrowingCrashJSON_OK;
+}
+
+static int onStringElement(__unused const GrowingCrashJSONStringView* name,
+                           __unused const GrowingCrashJSONStringView* value,
+                           __unused void* userData)
+{
+    return GrowingCrashJSON_OK;
+}
+
+static int onBeginContainer(__unused const GrowingCrashJSONStringView* name, __unused void* userData)
+{
+    return GrowingCrashJSON_OK;
+}
+
+static int onEndContainer(__unused void* userData)
+{
+    return GrowingCrashJSON_OK;
+}
+
+static int onEndData(__unused void* userData)
+{
+    return GrowingCrashJSON_OK;
+}
+
+static int decodeNumbers(const char* json, DecodedNumbers* numbers)
+{
+    GrowingCrashJSONDecodeStringViewCallbacks callbacks =
+    {
+        .onBooleanElement = onBooleanElement,
+        .onFloatingPointElement = onFloatingPointElement,
+        .onIntegerElement = onIntegerElement,
+        .onUIntegerElement = onUIntegerElement,
+        .onNullElement = onNullElement,
+        .onStringElement = onStringElement,
+        .onBeginObject = onBeginContainer,
+        .onBeginArray = onBeginContainer,
+        .onEndContainer = onEndContainer,
+        .onEndData = onEndData,
+    };
+    memset(numbers, 0, sizeof(*numbers));
+    int errorOffset = 0;
+    return growingcrashjson_decodeStringViews(json, (int)strlen(json), &callbacks, numbers, &errorOffset);
+}
+
+/** Decode a single number inside an array, the way it appears in a report. */
+static int decodeFloat(const char* number, double* value)
+{
+    char json[512];
+    snprintf(json, sizeof(json), "[%s]", number);
+    DecodedNumbers numbers;
+    int result = decodeNumbers(json, &numbers);
+    if(result == GrowingCrashJSON_OK && numbers.floatCount == 1 && numbers.count == 1)
+    {
+        *value = numbers.floats[0];
+        return GrowingCrashJSON_OK;
+    }
+    return result == GrowingCrashJSON_OK ? GrowingCrashJSON_ERROR_INVALID_DATA : result;
+}
+
+typedef struct
+{
+    char data[256];
+    int length;
+} EncodeBuffer;
+
+static int addToBuffer(const char* data, int length, void* userData)
+{
+    EncodeBuffer* buffer = userData;
+    if(buffer->length + length >= (int)sizeof(buffer->data))
+    {
+        return GrowingCrashJSON_ERROR_DATA_TOO_LONG;
+    }
+    memcpy(buffer->data + buffer->length, data, (size_t)length);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+    return GrowingCrashJSON_OK;
+}
+
+static bool isSameDouble(double a, double b)
+{
+    return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+/** Encode a number as the only element of an array. */
+static void encodeDouble(double value, EncodeBuffer* json)
+{
+    memset(json, 0, sizeof(*json));
+    GrowingCrashJSONEncodeContext encodeContext;
+    growingcrashjson_beginEncode(&encodeContext, false, addToBuffer, json);
+    growingcrashjson_beginArray(&encodeContext, NULL);
+    growingcrashjson_addFloatingPointElement(&encodeContext, NULL, value);
+    growingcrashjson_endContainer(&encodeContext);
+    growingcrashjson_endEncode(&encodeContext);
+}
+
+static void encodeInteger(int64_t value, EncodeBuffer* json)
+{
+    memset(json, 0, sizeof(*json));
+    GrowingCrashJSONEncodeContext encodeContext;
+    growingcrashjson_beginEncode(&encodeContext, false, addToBuffer, json);
+    growingcrashjson_beginArray(&encodeContext, NULL);
+    growingcrashjson_addIntegerElement(&encodeContext, NULL, value);
+    growingcrashjson_endContainer(&encodeContext);
+    growingcrashjson_endEncode(&encodeContext);
+}
+
+static void encodeUInteger(uint64_t value, EncodeBuffer* json)
+{
+    memset(json, 0, sizeof(*json));
+    GrowingCrashJSONEncodeContext encodeContext;
+    growingcrashjson_beginEncode(&encodeContext, false, addToBuffer, json);
+    growingcrashjson_beginArray(&encodeContext, NULL);
+    growingcrashjson_addUIntegerElement(&encodeContext, NULL, value);
+    growingcrashjson_endContainer(&encodeContext);
+    growingcrashjson_endEncode(&encodeContext);
+}
+
+/** Whether a double is written as the expected text, without the brackets. */
+static bool encodesDoubleAs(double value, const char* expected)
+{
+    EncodeBuffer json;
+    encodeDouble(value, &json);
+    return json.length == (int)strlen(expected) + 2 && strncmp(json.data + 1, expected, strlen(expected)) == 0;
+}
+
+/** Whether a double is written as text that strtod and the decoder both read
+ * back as exactly the same double.
+ */
+static bool doubleRoundTrips(double value)
+{
+    EncodeBuffer json;
+    encodeDouble(value, &json);
+    char text[64];
+    snprintf(text, sizeof(text), "%.*s", json.length - 2, json.data + 1);
+    if(!isSameDouble(strtod(text, NULL), value))
+    {
+        return false;
+    }
+    if(strchr(text, '.') == NULL && strchr(text, 'e') == NULL)
+    {
+        // Whole numbers read back as integers.
+        DecodedNumbers numbers;
+        return decodeNumbers(json.data, &numbers) == GrowingCrashJSON_OK && numbers.count == 1;
+    }
+    double decoded = 0;
+    return decodeFloat(text, &decoded) == GrowingCrashJSON_OK && isSameDouble(decoded, value);
+}
+
+/** Deterministic generator, so that a failing number can be reproduced. */
+static uint64_t nextRandom(uint64_t* state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/** Write a random number with up to 25 significant digits and an exponent
+ * anywhere in the double range.
+ */
+static void makeRandomNumber(uint64_t* state, char* buffer)
+{
+    char* ptr = buffer;
+    if(nextRandom(state) % 2)
+    {
+        *ptr++ = '-';
+    }
+    int digitCount = 1 + (int)(nextRandom(state) % 25);
+    int pointPosition = (int)(nextRandom(state) % (uint64_t)(digitCount + 1));
+    *ptr++ = (char)('1' + nextRandom(state) % 9);
+    for(int i = 1; i < digitCount; i++)
+    {
+        if(i == pointPosition)
+        {
+            *ptr++ = '.';
+        }
+        *ptr++ = (char)('0' + nextRandom(state) % 10);
+    }
+    if(pointPosition == 0 || pointPosition == digitCount)
+    {
+        *ptr++ = '.';
+        *ptr++ = '0';
+    }
+    switch(nextRandom(state) % 3)
+    {
+        case 0:
+            break;
+        case 1:
+            ptr += sprintf(ptr, "e%d", (int)(nextRandom(state) % 40) - 20);
+            break;
+        default:
+            ptr += sprintf(ptr, "e%d", (int)(nextRandom(state) % 660) - 330);
+            break;
+    }
+    *ptr = '\0';
+}
+
+#define kMaxRecordedViews 8
+
+/** The names and string values that a string view decode passed on. */
+typedef struct
+{
+    int stringCount;
+    GrowingCrashJSONStringView names[kMaxRecordedViews];
+    GrowingCrashJSONStringView values[kMaxRecordedViews];
+    int containerCount;
+    GrowingCrashJSONStringView containerNames[kMaxRecordedViews];
+} RecordedViews;
+
+static int recordStringElement(const GrowingCrashJSONStringView* name,
+                               const GrowingCrashJSONStringView* value,
+                               void* userData)
+{
+    RecordedViews* views = userData;
+    if(views->stringCount < kMaxRecordedViews)
+    {
+        GrowingCrashJSONStringView noName = {0};
+        views->names[views->stringCount] = name != NULL ? *name : noName;
+        views->values[views->stringCount] = *value;
+        views->stringCount++;
+    }
+    return GrowingCrashJSON_OK;
+}
+
+static int recordBeginContainer(const GrowingCrashJSONStringView* name, void* userData)
+{
+    RecordedViews* views = userData;
+    if(views->containerCount < kMaxRecordedViews)
+    {
+        GrowingCrashJSONStringView noName = {0};
+        views->containerNames[views->containerCount++] = name != NULL ? *name : noName;
+    }
+    return GrowingCrashJSON_OK;
+}
+
+static int decodeViews(const char* json, int length, RecordedViews* views, int* errorOffset)
+{
+    GrowingCrashJSONDecodeStringViewCallbacks callbacks =
+    {
+        .onBooleanElement = onBooleanElement,
+        .onFloatingPointElement = onFloatingPointElement,
+        .onIntegerElement = onIntegerElement,
+        .onUIntegerElement = onUIntegerElement,
+        .onNullElement = onNullElement,
+        .onStringElement = recordStringElement,
+        .onBeginObject = recordBeginContainer,
+        .onBeginArray = recordBeginContainer,
+        .onEndContainer = onEndContainer,
+        .onEndData = onEndData,
+    };
+    memset(views, 0, sizeof(*views));
+    *errorOffset = -1;
+    return growingcrashjson_decodeStringViews(json, length, &callbacks, views, errorOffset);
+}
+
+/** Decode a single string inside an array, and unescape it. */
+static int decodeAndUnescape(const char* json, char* buffer, int bufferLength, int* length)
+{
+    RecordedViews views;
+    int errorOffset;
+    int result = decodeViews(json, (int)strlen(json), &views, &errorOffset);
+    if(result != GrowingCrashJSON_OK)
+    {
+        return result;
+    }
+    if(views.stringCount != 1)
+    {
+        return GrowingCrashJSON_ERROR_INVALID_DATA;
+    }
+    return growingcrashjson_unescapeString(&views.values[0], buffer, bufferLength, length);
+}
+
+/** Characters the encoder escapes with a short sequence. */
+static const char g_escapedChars[] = {'\"', '\\', '\b', '\f', '\n', '\r', '\t'};
+
+typedef struct
+{
+    char data[4096];
+    int length;
+} EscapeBuffer;
+
+static int addToEscapeBuffer(const char* data, int length, void* userData)
+{
+    EscapeBuffer* buffer = userData;
+    if(buffer->length + length >= (int)sizeof(buffer->data))
+    {
+        return GrowingCrashJSON_ERROR_DATA_TOO_LONG;
+    }
+    memcpy(buffer->data + buffer->length, data, (size_t)length);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+    return GrowingCrashJSON_OK;
+}
+
+static int addToByteCount(__unused const char* data, int length, void* userData)
+{
+    *(long*)userData += length;
+    return GrowingCrashJSON_OK;
+}
+
+/** Encode a string on its own, the way the encoder writes a string value. */
+static int encodeString(const char* string, int length, EscapeBuffer* buffer)
+{
+    memset(buffer, 0, sizeof(*buffer));
+    GrowingCrashJSONEncodeContext encodeContext;
+    growingcrashjson_beginEncode(&encodeContext, false, addToEscapeBuffer, buffer);
+    int result = growingcrashjson_addStringElement(&encodeContext, NULL, string, length);
+    growingcrashjson_endEncode(&encodeContext);
+    return result;
+}
+
+/** Quote and escape a string one byte at a time, independently of the
+ * encoder.
+ */
+static void escapeReference(const char* string, int length, EscapeBuffer* buffer)
+{
+    char* dst = buffer->data;
+    *dst++ = '\"';
+    for(int i = 0; i < length; i++)
+    {
+        switch(string[i])
+        {
+            case '\"': *dst++ = '\\'; *dst++ = '\"'; break;
+            case '\\': *dst++ = '\\'; *dst++ = '\\'; break;
+            case '\b': *dst++ = '\\'; *dst++ = 'b'; break;
+            case '\f': *dst++ = '\\'; *dst++ = 'f'; break;
+            case '\n': *dst++ = '\\'; *dst++ = 'n'; break;
+            case '\r': *dst++ = '\\'; *dst++ = 'r'; break;
+            case '\t': *dst++ = '\\'; *dst++ = 't'; break;
+            default: *dst++ = string[i]; break;
+        }
+    }
+    *dst++ = '\"';
+    *dst = '\0';
+    buffer->length = (int)(dst - buffer->data);
+}
+
+/** Check a string against the reference, with the vectorized scan and
+ * without it.
+ */
+static bool encodesLikeReference(const char* string, int length)
+{
+    EscapeBuffer expected;
+    escapeReference(string, length, &expected);
+    EscapeBuffer vectorized;
+    EscapeBuffer byteByByte;
+    growingcrashjson_setUseVectorizedEscapeScan(true);
+    int vectorizedResult = encodeString(string, length, &vectorized);
+    growingcrashjson_setUseVectorizedEscapeScan(false);
+    int byteByByteResult = encodeString(string, length, &byteByByte);
+    growingcrashjson_setUseVectorizedEscapeScan(true);
+    return vectorizedResult == GrowingCrashJSON_OK && byteByByteResult == GrowingCrashJSON_OK &&
+           vectorized.length == expected.length && byteByByte.length == expected.length &&
+           memcmp(vectorized.data, expected.data, (size_t)expected.length) == 0 &&
+           memcmp(byteByByte.data, expected.data, (size_t)expected.length) == 0;
+}
+
+/** Strings like those a report holds: symbols, paths, queue names, and the
+ * odd exception reason with quotes and line breaks.
+ */
+static char** makeReportStrings(int count)
+{
+    static const char* const kTemplates[] =
+    {
+        "-[UIApplication _handleDelegateCallbacksWithOptions:isSuspended:restoreState:]",
+        "/private/var/containers/Bundle/Application/6A3B0C1D-2E4F-4A5B-8C7D-9E0F1A2B3C4D/Demo.app/Demo",
+        "$s4Demo14ViewControllerC11viewDidLoadyyF",
+        "com.apple.main-thread",
+        "std::__1::basic_string<char, std::__1::char_traits<char>, std::__1::allocator<char> >::append(char const*)",
+        "*** -[__NSArrayM objectAtIndex:]: index 5 beyond bounds [0 .. 4]",
+        "Unexpectedly found nil while unwrapping an Optional value\n\tat \"ViewController.swift\":42",
+        "/usr/lib/system/libsystem_kernel.dylib",
+    };
+    const int templateCount = (int)(sizeof(kTemplates) / sizeof(*kTemplates));
+    char** strings = malloc(sizeof(*strings) * (size_t)count);
+    for(int i = 0; i < count; i++)
+    {
+        strings[i] = strdup(kTemplates[i % templateCount]);
+    }
+    return strings;
+}
+
+static void freeStrings(char** strings, int count)
+{
+    for(int i = 0; i < count; i++)
+    {
+        free(strings[i]);
+    }
+    free(strings);
+}
+
+static long encodeStrings(char** strings, int count)
+{
+    long byteCount = 0;
+    GrowingCrashJSONEncodeContext encodeContext;
+    growingcrashjson_beginEncode(&encodeContext, false, addToByteCount, &byteCount);
+    growingcrashjson_beginArray(&encodeContext, NULL);
+    for(int i = 0; i < count; i++)
+    {
+        growingcrashjson_addStringElement(&encodeContext, NULL, strings[i], GrowingCrashJSON_SIZE_AUTOMATIC);
+    }
+    growingcrashjson_endContainer(&encodeContext);
+    growingcrashjson_endEncode(&encodeContext);
+    return byteCount;
+}
+
+@interface GrowingCrashJSONCodecTests : XCTestCase
+
+@end
+
+@implementation GrowingCrashJSONCodecTests
+
+- (void)testDecodeNumberCorpusMatchesStrtod
+{
+    for(size_t i = 0; i < sizeof(g_numberCorpus) / sizeof(*g_numberCorpus); i++)
+    {
+        const char* number = g_numberCorpus[i];
+        double value = 0;
+        XCTAssertEqual(decodeFloat(number, &value), GrowingCrashJSON_OK, @"%s", number);
+        XCTAssertTrue(isSameDouble(value, strtod(number, NULL)), @"%s decoded as %.17g", number, value);
+
+        char negative[512];
+        snprintf(negative, sizeof(negative), "-%s", number);
+        XCTAssertEqual(decodeFloat(negative, &value), GrowingCrashJSON_OK, @"%s", negative);
+        XCTAssertTrue(isSameDouble(value, strtod(negative, NULL)), @"%s decoded as %.17g", negative, value);
+    }
+}
+
+- (void)testDecodeRandomNumbersMatchStrtod
+{
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    char number[64];
+    int mismatches = 0;
+    for(int i = 0; i < 200000; i++)
+    {
+        makeRandomNumber(&state, number);
+        double value = 0;
+        if(decodeFloat(number, &value) != GrowingCrashJSON_OK || !isSameDouble(value, strtod(number, NULL)))
+        {
+            if(mismatches++ < 10)
+            {
+                XCTFail(@"%s decoded as %.17g, expected %.17g", number, value, strtod(number, NULL));
+            }
+        }
+    }
+    XCTAssertEqual(mismatches, 0);
+}
+
+- (void)testDecodeIntegers
+{
+    DecodedNumbers numbers;
+    XCTAssertEqual(decodeNumbers("[0,-0,42,-42,9223372036854775807,-9223372036854775808]", &numbers), GrowingCrashJSON_OK);
+    XCTAssertEqual(numbers.integerCount, 6);
+    XCTAssertEqual(numbers.integers[0], 0);
+    XCTAssertEqual(numbers.integers[1], 0);
+    XCTAssertEqual(numbers.integers[2], 42);
+    XCTAssertEqual(numbers.integers[3], -42);
+    XCTAssertEqual(numbers.integers[4], INT64_MAX);
+    XCTAssertEqual(numbers.integers[5], INT64_MIN);
+    XCTAssertEqual(numbers.floatCount, 0);
+}
+
+- (void)testDecodeIntegersAboveInt64Max
+{
+    DecodedNumbers numbers;
+    XCTAssertEqual(decodeNumbers("[9223372036854775808,18446744073709551615]", &numbers), GrowingCrashJSON_OK);
+    XCTAssertEqual(numbers.uintegerCount, 2);
+    XCTAssertEqual(numbers.uintegers[0], 9223372036854775808ULL);
+    XCTAssertEqual(numbers.uintegers[1], UINT64_MAX);
+    XCTAssertEqual(numbers.integerCount, 0);
+}
+
+- (void)testDecodeIntegerOverflowBecomesFloat
+{
+    DecodedNumbers numbers;
+    XCTAssertEqual(decodeNumbers("[18446744073709551616,-9223372036854775809]", &numbers), GrowingCrashJSON_OK);
+    XCTAssertEqual(numbers.floatCount, 2);
+    XCTAssertTrue(isSameDouble(numbers.floats[0], 18446744073709551616.0));
+    XCTAssertTrue(isSameDouble(numbers.floats[1], -9223372036854775809.0));
+}
+
+- (void)testDecodeMalformedNumbers
+{
+    const char* malformed[] = {"[-]", "[-a]", "[1.]", "[1.e5]", "[1e]", "[1e+]", "[.5]", "[1.5e-x]"};
+    for(size_t i = 0; i < sizeof(malformed) / sizeof(*malformed); i++)
+    {
+        DecodedNumbers numbers;
+        XCTAssertNotEqual(decodeNumbers(malformed[i], &numbers), GrowingCrashJSON_OK, @"%s", malformed[i]);
+    }
+}
+
+- (void)testDecodeTruncatedNumbers
+{
+    // The number runs into the end of the data, which must not be read past.
+    const char* truncated[] = {"[-", "[12", "[1.5", "[1.5e", "[1.5e-", "[1.5e10"};
+    for(size_t i = 0; i < sizeof(truncated) / sizeof(*truncated); i++)
+    {
+        DecodedNumbers numbers;
+        XCTAssertEqual(decodeNumbers(truncated[i], &numbers), GrowingCrashJSON_ERROR_INCOMPLETE, @"%s", truncated[i]);
+    }
+}
+
+- (void)testEncodeDecodeRoundTrip
+{
+    uint64_t state = 0xD1B54A32D192ED03ULL;
+    for(int i = 0; i < 20000; i++)
+    {
+        double original;
+        uint64_t bits = nextRandom(&state);
+        memcpy(&original, &bits, sizeof(original));
+        if(!isfinite(original) || original == 0)
+        {
+            continue;
+        }
+        int64_t integer = (int64_t)nextRandom(&state);
+        uint64_t uinteger = nextRandom(&state) | (1ULL << 63);
+
+        EncodeBuffer json = {0};
+        GrowingCrashJSONEncodeContext encodeContext;
+        growingcrashjson_beginEncode(&encodeContext, false, addToBuffer, &json);
+        growingcrashjson_beginArray(&encodeContext, NULL);
+        growingcrashjson_addFloatingPointElement(&encodeContext, NULL, original);
+        growingcrashjson_addIntegerElement(&encodeContext, NULL, integer);
+        growingcrashjson_addUIntegerElement(&encodeContext, NULL, uinteger);
+        growingcrashjson_endContainer(&encodeContext);
+        growingcrashjson_endEncode(&encodeContext);
+
+        DecodedNumbers numbers;
+        XCTAssertEqual(decodeNumbers(json.data, &numbers), GrowingCrashJSON_OK, @"%s", json.data);
+        XCTAssertEqual(numbers.count, 3, @"%s", json.data);
+        // A whole number is written without a decimal point, and reads back
+        // as an integer.
+        double decoded = numbers.floatCount == 1 ? numbers.floats[0] : (double)numbers.integers[0];
+        XCTAssertTrue(isSameDouble(decoded, original), @"%.17g written as %s", original, json.data);
+        XCTAssertEqual(numbers.integers[numbers.integerCount - 1], integer, @"%s", json.data);
+        XCTAssertEqual(numbers.uintegerCount, 1, @"%s", json.data);
+        XCTAssertEqual(numbers.uintegers[0], uinteger, @"%s", json.data);
+    }
+}
+
+- (void)testStringViewsPointIntoTheInput
+{
+    const char* json = "{\"name\":\"value\",\"list\":[\"a\",\"\"]}";
+    RecordedViews views;
+    int errorOffset;
+    XCTAssertEqual(decodeViews(json, (int)strlen(json), &views, &errorOffset), GrowingCrashJSON_OK);
+
+    XCTAssertEqual(views.stringCount, 3);
+    XCTAssertTrue(views.names[0].ptr == json + 2);
+    XCTAssertEqual(views.names[0].length, 4);
+    XCTAssertFalse(views.names[0].needsUnescape);
+    XCTAssertTrue(views.values[0].ptr == json + 9);
+    XCTAssertEqual(views.values[0].length, 5);
+    XCTAssertFalse(views.values[0].needsUnescape);
+    // Array elements have no name.
+    XCTAssertTrue(views.names[1].ptr == NULL);
+    XCTAssertTrue(views.values[1].ptr == json + 25);
+    XCTAssertEqual(views.values[1].length, 1);
+    XCTAssertTrue(views.values[2].ptr == json + 29);
+    XCTAssertEqual(views.values[2].length, 0);
+
+    XCTAssertEqual(views.containerCount, 2);
+    XCTAssertTrue(views.containerNames[0].ptr == NULL);
+    XCTAssertTrue(views.containerNames[1].ptr == json + 17);
+    XCTAssertEqual(views.containerNames[1].length, 4);
+
+    char buffer[16];
+    int length = -1;
+    XCTAssertEqual(growingcrashjson_unescapeString(&views.values[0], buffer, sizeof(buffer), &length), GrowingCrashJSON_OK);
+    XCTAssertEqual(length, 5);
+    XCTAssertEqual(strcmp(buffer, "value"), 0);
+}
+
+- (void)testUnescapesEscapeSequences
+{
+    char buffer[64];
+    int length = -1;
+    XCTAssertEqual(decodeAndUnescape("[\"a\\\"b\\\\c\\/d\\b\\f\\n\\r\\t\\u0041\\u00e9\\u20ac\"]",
+                                     buffer, sizeof(buffer), &length),
+                   GrowingCrashJSON_OK);
+    const char* expected = "a\"b\\c/d\b\f\n\r\tA\xc3\xa9\xe2\x82\xac";
+    XCTAssertEqual(length, (int)strlen(expected));
+    XCTAssertEqual(strcmp(buffer, expected), 0, @"%s", buffer);
+}
+
+- (void)testUnescapesSurrogatePairs
+{
+    char buffer[32];
+    int length = -1;
+    XCTAssertEqual(decodeAndUnescape("[\"\\ud83d\\ude00\"]", buffer, sizeof(buffer), &length), GrowingCrashJSON_OK);
+    XCTAssertEqual(length, 4);
+    XCTAssertEqual(strcmp(buffer, "\xf0\x9f\x98\x80"), 0);
+
+    // The lowest and highest code points a pair can hold.
+    XCTAssertEqual(decodeAndUnescape("[\"\\ud800\\udc00|\\udbff\\udfff\"]", buffer, sizeof(buffer), &length), GrowingCrashJSON_OK);
+    XCTAssertEqual(strcmp(buffer, "\xf0\x90\x80\x80|\xf4\x8f\xbf\xbf"), 0);
+
+    XCTAssertEqual(decodeAndUnescape("[\"\\ude00\"]", buffer, sizeof(buffer), &length), GrowingCrashJSON_ERROR_INVALID_CHARACTER);
+    XCTAssertEqual(decodeAndUnescape("[\"\\ud83d\\u0041\"]", buffer, sizeof(buffer), &length), GrowingCrashJSON_ERROR_INVALID_CHARACTER);
+    XCTAssertEqual(decodeAndUnescape("[\"\\ud83dabcdef\"]", buffer, sizeof(buffer), &length), GrowingCrashJSON_ERROR_INVALID_CHARACTER);
+    XCTAssertEqual(decodeAndUnescape("[\"\\ud83d\"]", buffer, sizeof(buffer), &length), GrowingCrashJSON_ERROR_INCOMPLETE);
+}
+
+- (void)testNamesWithEscapes
+{
+    const char* json = "{\"a\\\"b\\u0063\":{\"tab\\there\":\"x\"}}";
+    RecordedViews views;
+    int errorOffset;
+    XCTAssertEqual(decodeViews(json, (int)strlen(json), &views, &errorOffset), GrowingCrashJSON_OK);
+
+    char buffer[32];
+    XCTAssertEqual(views.containerCount, 2);
+    XCTAssertTrue(views.containerNames[1].needsUnescape);
+    XCTAssertEqual(growingcrashjson_unescapeString(&views.containerNames[1], buffer, sizeof(buffer), NULL), GrowingCrashJSON_OK);
+    XCTAssertEqual(strcmp(buffer, "a\"bc"), 0, @"%s", buffer);
+
+    XCTAssertEqual(views.stringCount, 1);
+    XCTAssertTrue(views.names[0].needsUnescape);
+    XCTAssertEqual(growingcrashjson_unescapeString(&views.names[0], buffer, sizeof(buffer), NULL), GrowingCrashJSON_OK);
+    XCTAssertEqual(strcmp(buffer, "tab\there"), 0, @"%s", buffer);
+    XCTAssertFalse(views.values[0].needsUnescape);
+}
+
+- (void)testStringsLongerThanTheOldStringBuffer
+{
+    // The copying decoder used a 10 KB string buffer.
+    enum { kLength = 30000 };
+    char* json = malloc(kLength + 16);
+    char* ptr = json;
+    *ptr++ = '[';
+    *ptr++ = '\"';
+    for(int i = 0; i < kLength; i++)
+    {
+        *ptr++ = (char)('a' + i % 26);
+    }
+    memcpy(ptr, "\\n\"]", 5);
+
+    RecordedViews views;
+    int errorOffset;
+    XCTAssertEqual(decodeViews(json, (int)strlen(json), &views, &errorOffset), GrowingCrashJSON_OK);
+    XCTAssertEqual(views.stringCount, 1);
+    XCTAssertTrue(views.values[0].ptr == json + 2);
+    XCTAssertEqual(views.values[0].length, kLength + 2);
+
+    char* buffer = malloc(kLength + 3);
+    int length = -1;
+    XCTAssertEqual(growingcrashjson_unescapeString(&views.values[0], buffer, kLength + 3, &length), GrowingCrashJSON_OK);
+    XCTAssertEqual(length, kLength + 1);
+    XCTAssertEqual(buffer[kLength - 1], (char)('a' + (kLength - 1) % 26));
+    XCTAssertEqual(buffer[kLength], '\n');
+    XCTAssertEqual(buffer[kLength + 1], '\0');
+
+    // The buffer must hold the escaped length and a terminator.
+    XCTAssertEqual(growingcrashjson_unescapeString(&views.values[0], buffer, kLength + 2, &length), GrowingCrashJSON_ERROR_DATA_TOO_LONG);
+    free(buffer);
+    free(json);
+}
+
+- (void)testErrorOffsetOnTruncatedEscape
+{
+    // The data ends inside an escape sequence. The offset is where the
+    // unfinished string starts.
+    const char* truncatedValue = "{\"key\":\"abc\\";
+    RecordedViews views;
+    int errorOffset;
+    XCTAssertEqual(decodeViews(truncatedValue, (int)strlen(truncatedValue), &views, &errorOffset), GrowingCrashJSON_ERROR_INCOMPLETE);
+    XCTAssertEqual(errorOffset, 7);
+    XCTAssertEqual(views.stringCount, 0);
+
+    // An escaped quote doesn't end the string.
+    const char* escapedQuote = "{\"key\":\"abc\\\"";
+    XCTAssertEqual(decodeViews(escapedQuote, (int)strlen(escapedQuote), &views, &errorOffset), GrowingCrashJSON_ERROR_INCOMPLETE);
+    XCTAssertEqual(errorOffset, 7);
+
+    const char* truncatedName = "{\"ke\\";
+    XCTAssertEqual(decodeViews(truncatedName, (int)strlen(truncatedName), &views, &errorOffset), GrowingCrashJSON_ERROR_INCOMPLETE);
+    XCTAssertEqual(errorOffset, 1);
+
+    // A complete string whose \u escape is cut short only fails to unescape.
+    char buffer[16];
+    XCTAssertEqual(decodeAndUnescape("[\"\\u12\"]", buffer, sizeof(buffer), NULL), GrowingCrashJSON_ERROR_INCOMPLETE);
+    XCTAssertEqual(decodeAndUnescape("[\"\\x\"]", buffer, sizeof(buffer), NULL), GrowingCrashJSON_ERROR_INVALID_CHARACTER);
+}
+
+- (void)testEscapesAroundChunkBoundaries
+{
+    // Specials just before, at and just after each 16 byte chunk boundary.
+    const int lengths[] = {1, 15, 16, 17, 31, 32, 33, 47, 48, 49, 64};
+    char string[80];
+    for(size_t c = 0; c < sizeof(g_escapedChars); c++)
+    {
+        for(size_t l = 0; l < sizeof(lengths) / sizeof(*lengths); l++)
+        {
+            int length = lengths[l];
+            for(int position = 0; position < length; position++)
+            {
+                memset(string, 'a', sizeof(string));
+                string[position] = g_escapedChars[c];
+                XCTAssertTrue(encodesLikeReference(string, length),
+                              @"0x%02x at %d of %d", g_escapedChars[c], position, length);
+
+                // A run of specials that straddles the boundary.
+                for(int i = position; i < length && i < position + 3; i++)
+                {
+                    string[i] = g_escapedChars[(c + (size_t)i) % sizeof(g_escapedChars)];
+                }
+                XCTAssertTrue(encodesLikeReference(string, length),
+                              @"run at %d of %d", position, length);
+            }
+        }
+    }
+}
+
+- (void)testRejectsOtherControlCharactersAtEveryOffset
+{
+    char string[40];
+    for(int position = 0; position < (int)sizeof(string); position++)
+    {
+        memset(string, 'a', sizeof(string));
+        string[position] = 0x01;
+        EscapeBuffer buffer;
+        growingcrashjson_setUseVectorizedEscapeScan(true);
+        XCTAssertEqual(encodeString(string, sizeof(string), &buffer), GrowingCrashJSON_ERROR_INVALID_CHARACTER, @"%d", position);
+        growingcrashjson_setUseVectorizedEscapeScan(false);
+        XCTAssertEqual(encodeString(string, sizeof(string), &buffer), GrowingCrashJSON_ERROR_INVALID_CHARACTER, @"%d", position);
+    }
+    growingcrashjson_setUseVectorizedEscapeScan(true);
+}
+
+- (void)testVectorizedAndByteScansMatch
+{
+    uint64_t state = 0x853C49E6748FEA9BULL;
+    char string[200];
+    for(int i = 0; i < 20000; i++)
+    {
+        int length = (int)(nextRandom(&state) % sizeof(string));
+        for(int j = 0; j < length; j++)
+        {
+            uint64_t pick = nextRandom(&state) % 16;
+            if(pick == 0)
+            {
+                string[j] = g_escapedChars[nextRandom(&state) % sizeof(g_escapedChars)];
+            }
+            else if(pick < 4)
+            {
+                // UTF-8 lead and continuation bytes are above any signed
+                // comparison's range, and must pass through untouched.
+                string[j] = (char)(0x80 + nextRandom(&state) % 0x80);
+            }
+            else
+            {
+                string[j] = (char)(' ' + nextRandom(&state) % 95);
+            }
+        }
+        XCTAssertTrue(encodesLikeReference(string, length), @"string %d", i);
+    }
+}
+
+- (void)testEscapeStringsPerformance
+{
+    enum { kStringCount = 20000 };
+    char** strings = makeReportStrings(kStringCount);
+    [self measureBlock:^{
+        XCTAssertGreaterThan(encodeStrings(strings, kStringCount), 0);
+    }];
+    freeStrings(strings, kStringCount);
+}
+
+- (void)testEscapeStringsByteScanPerformance
+{
+    enum { kStringCount = 20000 };
+    char** strings = makeReportStrings(kStringCount);
+    growingcrashjson_setUseVectorizedEscapeScan(false);
+    [self measureBlock:^{
+        XCTAssertGreaterThan(encodeStrings(strings, kStringCount), 0);
+    }];
+    growingcrashjson_setUseVectorizedEscapeScan(true);
+    freeStrings(strings, kStringCount);
+}
+
+- (void)testFormatsIntegerExtremes
+{
+    EncodeBuffer json;
+    encodeInteger(INT64_MIN, &json);
+    XCTAssertEqual(strcmp(json.data, "[-9223372036854775808]"), 0, @"%s", json.data);
+    encodeInteger(INT64_MAX, &json);
+    XCTAssertEqual(strcmp(json.data, "[9223372036854775807]"), 0, @"%s", json.data);
+    encodeInteger(-1, &json);
+    XCTAssertEqual(strcmp(json.data, "[-1]"), 0, @"%s", json.data);
+    encodeUInteger(UINT64_MAX, &json);
+    XCTAssertEqual(strcmp(json.data, "[18446744073709551615]"), 0, @"%s", json.data);
+    encodeUInteger(0, &json);
+    XCTAssertEqual(strcmp(json.data, "[0]"), 0, @"%s", json.data);
+
+    // Both sides of each digit count, which the formatter writes in pairs.
+    uint64_t power = 1;
+    for(int digits = 1; digits < 20; digits++, power *= 10)
+    {
+        char expected[32];
+        uint64_t values[] = {power - 1, power, power + 1};
+        for(int i = 0; i < 3; i++)
+        {
+            snprintf(expected, sizeof(expected), "[%llu]", (unsigned long long)values[i]);
+            encodeUInteger(values[i], &json);
+            XCTAssertEqual(strcmp(json.data, expected), 0, @"%s", json.data);
+            snprintf(expected, sizeof(expected), "[-%llu]", (unsigned long long)values[i]);
+            if(values[i] != 0)
+            {
+                encodeInteger(-(int64_t)values[i], &json);
+                XCTAssertEqual(strcmp(json.data, expected), 0, @"%s", json.data);
+            }
+        }
+    }
+}
+
+- (void)testFormatsZeroAndExtremeDoubles
+{
+    XCTAssertTrue(encodesDoubleAs(0.0, "0"));
+    XCTAssertTrue(encodesDoubleAs(-0.0, "-0"));
+    XCTAssertTrue(encodesDoubleAs(DBL_MAX, "1.7976931348623157e+308"));
+    XCTAssertTrue(encodesDoubleAs(-DBL_MAX, "-1.7976931348623157e+308"));
+    XCTAssertTrue(encodesDoubleAs(DBL_MIN, "2.2250738585072014e-308"));
+    XCTAssertTrue(encodesDoubleAs(5e-324, "5e-324"));
+
+    const double extremes[] =
+    {
+        DBL_MAX, DBL_MIN, 5e-324, 1e-323, nextafter(DBL_MIN, 0), DBL_MIN / 3,
+        nextafter(DBL_MAX, 0), nextafter(1.0, 2.0), nextafter(1.0, 0.0), DBL_EPSILON,
+    };
+    for(size_t i = 0; i < sizeof(extremes) / sizeof(*extremes); i++)
+    {
+        XCTAssertTrue(doubleRoundTrips(extremes[i]), @"%.17g", extremes[i]);
+        XCTAssertTrue(doubleRoundTrips(-extremes[i]), @"%.17g", -extremes[i]);
+    }
+}
+
+- (void)testFormatsWholeNumbersWithoutDecimalPoint
+{
+    XCTAssertTrue(encodesDoubleAs(1.0, "1"));
+    XCTAssertTrue(encodesDoubleAs(-42.0, "-42"));
+    XCTAssertTrue(encodesDoubleAs(100.0, "100"));
+    XCTAssertTrue(encodesDoubleAs(1234567.0, "1234567"));
+    XCTAssertTrue(encodesDoubleAs(1665123456789.0, "1665123456789"));
+    XCTAssertTrue(encodesDoubleAs(9007199254740992.0, "9007199254740992"));
+}
+
+- (void)testFormatsAroundExponentThresholds
+{
+    // Up to 17 integer digits are written out in full.
+    XCTAssertTrue(encodesDoubleAs(1e16, "10000000000000000"));
+    XCTAssertTrue(encodesDoubleAs(12345678901234568.0, "12345678901234568"));
+    XCTAssertTrue(encodesDoubleAs(1e17, "1e+17"));
+    XCTAssertTrue(encodesDoubleAs(123456789012345680.0, "1.2345678901234568e+17"));
+    XCTAssertTrue(encodesDoubleAs(1e21, "1e+21"));
+    XCTAssertTrue(encodesDoubleAs(1234.5, "1234.5"));
+    XCTAssertTrue(encodesDoubleAs(12345.678, "12345.678"));
+    XCTAssertTrue(encodesDoubleAs(0.1, "0.1"));
+    // Down to four zeros after the decimal point.
+    XCTAssertTrue(encodesDoubleAs(0.5, "0.5"));
+    XCTAssertTrue(encodesDoubleAs(0.0001, "0.0001"));
+    XCTAssertTrue(encodesDoubleAs(0.00001, "0.00001"));
+    XCTAssertTrue(encodesDoubleAs(0.000015, "0.000015"));
+    XCTAssertTrue(encodesDoubleAs(0.000001, "1e-6"));
+    XCTAssertTrue(encodesDoubleAs(0.0000015, "1.5e-6"));
+    XCTAssertTrue(encodesDoubleAs(1.5e-300, "1.5e-300"));
+}
+
+- (void)testFormattedDoublesRoundTripBitExact
+{
+    // Every power of two, including the denormals, and its neighbours.
+    for(int exponent = -1074; exponent <= 1023; exponent++)
+    {
+        double value = ldexp(1.0, exponent);
+        XCTAssertTrue(doubleRoundTrips(value), @"2^%d", exponent);
+        XCTAssertTrue(doubleRoundTrips(nextafter(value, 0)), @"below 2^%d", exponent);
+        XCTAssertTrue(doubleRoundTrips(nextafter(value, INFINITY)), @"above 2^%d", exponent);
+    }
+    // Every power of ten.
+    for(int exponent = -323; exponent <= 308; exponent++)
+    {
+        char text[16];
+        snprintf(text, sizeof(text), "1e%d", exponent);
+        double value = strtod(text, NULL);
+        XCTAssertTrue(doubleRoundTrips(value), @"%s", text);
+    }
+    // Random denormals.
+    uint64_t state = 0x61C8864680B583EBULL;
+    for(int i = 0; i < 20000; i++)
+    {
+        uint64_t bits = nextRandom(&state) & 0x000FFFFFFFFFFFFFULL;
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        XCTAssertTrue(doubleRoundTrips(value), @"%.17g", value);
+    }
+}
+
+- (void)testDecodeFloatsPerformance
+{
+    enum { kNumberCount = 100000 };
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+    size_t capacity = kNumberCount * 40;
+    char* json = malloc(capacity);
+    char* ptr = json;
+    *ptr++ = '[';
+    for(int i = 0; i < kNumberCount; i++)
+    {
+        // Mostly the kind of numbers a report holds, like timestamps and
+        // memory sizes.
+        ptr += sprintf(ptr, "%s%llu.%03llu", i == 0 ? "" : ",",
+                       (unsigned long long)(nextRandom(&state) % 10000000000ULL),
+                       (unsigned long long)(nextRandom(&state) % 1000));
+    }
+    *ptr++ = ']';
+    *ptr = '\0';
+
+    [self measureBlock:^{
+        DecodedNumbers numbers;
+        XCTAssertEqual(decodeNumbers(json, &numbers), GrowingCrashJSON_OK);
+        XCTAssertEqual(numbers.count, kNumberCount);
+    }];
+    free(json);
+}
+
+
+- (void)testEncodeNumbersPerformance
+{
+    enum { kNumberCount = 100000 };
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+    double* floats = malloc(sizeof(*floats) * kNumberCount);
+    int64_t* integers = malloc(sizeof(*integers) * kNumberCount);
+    for(int i = 0; i < kNumberCount; i++)
+    {
+        // Timestamps, durations and addresses, like a report holds.
+        floats[i] = (double)(nextRandom(&state) % 10000000000ULL) + (double)(nextRandom(&state) % 1000) / 1000;
+        integers[i] = (int64_t)(nextRandom(&state) >> 20);
+    }
+
+    [self measureBlock:^{
+        long byteCount = 0;
+        GrowingCrashJSONEncodeContext encodeContext;
+        growingcrashjson_beginEncode(&encodeContext, false, addToByteCount, &byteCount);
+        growingcrashjson_beginArray(&encodeContext, NULL);
+        for(int i = 0; i < kNumberCount; i++)
+        {
+            growingcrashjson_addFloatingPointElement(&encodeContext, NULL, floats[i]);
+            growingcrashjson_addIntegerElement(&encodeContext, NULL, integers[i]);
+        }
+        growingcrashjson_endContainer(&encodeContext);
+        growingcrashjson_endEncode(&encodeContext);
+        XCTAssertGreaterThan(byteCount, kNumberCount * 2);
+    }];
+    free(floats);
+    free(integers);
+}
+
+@end
@@ -0,0 +1,170 @@
+//
+//  GrowingCrashPunycodeTests.mm
+//  GrowingAPMCrashMonitorTests
+//
+//  Created by YoloMao on 2022/10/8.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#include "Punycode.h"
+
+#include <string>
+#include <vector>
+
+using namespace swift;
+
+/** Identifiers as they appear in Swift symbols, most of them non-ASCII. */
+static const char* const g_identifiers[] =
+{
+    "café",
+    "naïveViewController",
+    "日本語",
+    "ビューコントローラー",
+    "Grüße_an_alle",
+    "😀emoji😀",
+    "Проверка",
+    "مرحبا",
+    "中文标识符很长很长很长很长很长",
+    "a",
+};
+
+#define kIdentifierCount ((int)(sizeof(g_identifiers) / sizeof(*g_identifiers)))
+
+static std::string encode(const char* identifier)
+{
+    std::string punycode;
+    Punycode::encodePunycodeUTF8(identifier, punycode);
+    return punycode;
+}
+
+/** Decode into a buffer of a given size. Returns false on failure. */
+static bool decode(const std::string& punycode, size_t capacity, std::string& decoded)
+{
+    std::vector<char> buffer(capacity + 1);
+    std::vector<uint32_t> scratch(punycode.size() + 1);
+    size_t length = capacity;
+    bool result = Punycode::decodePunycodeUTF8(punycode, buffer.data(), length, scratch.data());
+    decoded.assign(buffer.data(), length);
+    return result;
+}
+
+@interface GrowingCrashPunycodeTests : XCTestCase
+
+@end
+
+@implementation GrowingCrashPunycodeTests
+
+- (void)testDecodeRoundTrips
+{
+    for(int i = 0; i < kIdentifierCount; i++)
+    {
+        std::string punycode = encode(g_identifiers[i]);
+        std::string decoded;
+        XCTAssertTrue(decode(punycode, Punycode::getMaxDecodedUTF8Length(punycode), decoded), @"%s", g_identifiers[i]);
+        XCTAssertTrue(decoded == g_identifiers[i], @"%s decoded as %s", g_identifiers[i], decoded.c_str());
+
+        std::string allocated;
+        XCTAssertTrue(Punycode::decodePunycodeUTF8(punycode, allocated));
+        XCTAssertTrue(allocated == g_identifiers[i], @"%s decoded as %s", g_identifiers[i], allocated.c_str());
+    }
+}
+
+- (void)testDecodeIntoExactlySizedBuffer
+{
+    for(int i = 0; i < kIdentifierCount; i++)
+    {
+        std::string punycode = encode(g_identifiers[i]);
+        size_t length = strlen(g_identifiers[i]);
+        std::string decoded;
+        XCTAssertTrue(decode(punycode, length, decoded), @"%s", g_identifiers[i]);
+        XCTAssertTrue(decoded == g_identifiers[i], @"%s decoded as %s", g_identifiers[i], decoded.c_str());
+    }
+}
+
+- (void)testRejectsTooSmallBuffer
+{
+    for(int i = 0; i < kIdentifierCount; i++)
+    {
+        std::string punycode = encode(g_identifiers[i]);
+        size_t length = strlen(g_identifiers[i]);
+        std::string decoded;
+        XCTAssertFalse(decode(punycode, length - 1, decoded), @"%s", g_identifiers[i]);
+        XCTAssertEqual(decoded.size(), (size_t)0, @"%s", g_identifiers[i]);
+        XCTAssertFalse(decode(punycode, 0, decoded), @"%s", g_identifiers[i]);
+        XCTAssertEqual(decoded.size(), (size_t)0, @"%s", g_identifiers[i]);
+    }
+}
+
+- (void)testRejectsOverflow
+{
+    // 'J' is the largest digit, so each one multiplies the weight until it
+    // overflows.
+    const char* const overflowing[] =
+    {
+        "JJJJJJJJJJJJ",
+        "abc_JJJJJJJJJJJJ",
+        "JJJJJJJJJJJJJJJJJJJJJJJJJJJJJJJJJJJJJJJJ",
+    };
+    for(size_t i = 0; i < sizeof(overflowing) / sizeof(*overflowing); i++)
+    {
+        std::string decoded;
+        XCTAssertFalse(decode(overflowing[i], Punycode::getMaxDecodedUTF8Length(overflowing[i]), decoded), @"%s", overflowing[i]);
+        XCTAssertEqual(decoded.size(), (size_t)0, @"%s", overflowing[i]);
+
+        std::vector<uint32_t> codePoints;
+        XCTAssertFalse(Punycode::decodePunycode(overflowing[i], codePoints), @"%s", overflowing[i]);
+    }
+}
+
+- (void)testRejectsScalarsOutsideUnicode
+{
+    // Decodes without overflowing, to 0x200000.
+    const char* const invalid = "IDFCo";
+    std::vector<uint32_t> codePoints;
+    XCTAssertTrue(Punycode::decodePunycode(invalid, codePoints));
+    XCTAssertEqual(codePoints.size(), (size_t)1);
+    XCTAssertEqual(codePoints.empty() ? 0 : codePoints[0], 0x200000u);
+
+    std::string decoded;
+    XCTAssertFalse(decode(invalid, Punycode::getMaxDecodedUTF8Length(invalid), decoded));
+    XCTAssertEqual(decoded.size(), (size_t)0);
+}
+
+- (void)testDecodeNonASCIIPerformance
+{
+    std::vector<std::string> punycodes;
+    for(int i = 0; i < kIdentifierCount; i++)
+    {
+        punycodes.push_back(encode(g_identifiers[i]));
+    }
+    [self measureBlock:^{
+        char buffer[256];
+        uint32_t scratch[256];
+        size_t total = 0;
+        for(int pass = 0; pass < 10000; pass++)
+        {
+            for(const std::string& punycode : punycodes)
+            {
+                size_t length = sizeof(buffer);
+                Punycode::decodePunycodeUTF8(punycode, buffer, length, scratch);
+                total += length;
+            }
+        }
+        XCTAssertGreaterThan(total, (size_t)0);
+    }];
+}
+
+@end
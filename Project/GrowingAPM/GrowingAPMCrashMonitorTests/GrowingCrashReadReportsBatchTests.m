@@ -0,0 +1,253 @@
+//
+//  GrowingCrashReadReportsBatchTests.m
+//  GrowingAPMCrashMonitorTests
+//
+//  Created by YoloMao on 2022/10/8.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import "GrowingCrashC.h"
+#import "GrowingCrashReportStore.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define APP_NAME "BatchTests"
+
+#define kReportCount 40
+
+static char g_directory[500];
+static int64_t g_reportIDs[kReportCount];
+
+static void removeDirectory(const char* path)
+{
+    DIR* dir = opendir(path);
+    if(dir == NULL)
+    {
+        return;
+    }
+    struct dirent* ent;
+    while((ent = readdir(dir)) != NULL)
+    {
+        if(strcmp(ent->d_name, ".") != 0 && strcmp(ent->d_name, "..") != 0)
+        {
+            char entryPath[1000];
+            snprintf(entryPath, sizeof(entryPath), "%s/%s", path, ent->d_name);
+            unlink(entryPath);
+        }
+    }
+    closedir(dir);
+    rmdir(path);
+}
+
+/** Add a report whose size grows and shrinks with its index, so that
+ * workers see reports both bigger and smaller than the last one they read.
+ */
+static int64_t addReport(int index)
+{
+    int padding = (index % 7) * 3000 + (index % 3) * 50;
+    char* report = malloc((unsigned)padding + 100);
+    int length = sprintf(report, "{\"index\":%d,\"padding\":\"", index);
+    memset(report + length, 'a' + index % 26, (unsigned)padding);
+    length += padding;
+    length += sprintf(report + length, "\"}");
+    int64_t reportID = growingcrs_addUserReport(report, length);
+    free(report);
+    return reportID;
+}
+
+/** Read reportIDs one at a time and in a batch, and check that each batch
+ * slot holds the same report as the one read on its own.
+ *
+ * @return The number of slots that didn't match.
+ */
+static int countMismatches(const int64_t* reportIDs, int count, int maxThreads, int* readCount)
+{
+    char** reports = malloc(sizeof(*reports) * (unsigned)count);
+    for(int i = 0; i < count; i++)
+    {
+        reports[i] = (char*)"unset";
+    }
+    *readCount = growingcrash_readReportsBatch(reportIDs, count, reports, maxThreads);
+    int mismatches = 0;
+    for(int i = 0; i < count; i++)
+    {
+        char* expected = growingcrash_readReport(reportIDs[i]);
+        if(expected == NULL ? reports[i] != NULL : reports[i] == NULL || strcmp(expected, reports[i]) != 0)
+        {
+            mismatches++;
+        }
+        free(expected);
+        free(reports[i]);
+    }
+    free(reports);
+    return mismatches;
+}
+
+@interface GrowingCrashReadReportsBatchTests : XCTestCase
+@end
+
+@implementation GrowingCrashReadReportsBatchTests
+
+- (void)setUp
+{
+    [super setUp];
+    const char* tmpDir = getenv("TMPDIR");
+    snprintf(g_directory, sizeof(g_directory), "%s/GrowingCrashReadReportsBatchTests.XXXXXX", tmpDir != NULL ? tmpDir : "/tmp");
+    XCTAssertTrue(mkdtemp(g_directory) != NULL);
+    growingcrs_setMaxReportCount(kReportCount * 2);
+    growingcrs_initialize(APP_NAME, g_directory);
+    for(int i = 0; i < kReportCount; i++)
+    {
+        g_reportIDs[i] = addReport(i);
+    }
+}
+
+- (void)tearDown
+{
+    removeDirectory(g_directory);
+    growingcrs_setMaxReportCount(5);
+    [super tearDown];
+}
+
+- (void)testReportsAreInOrder
+{
+    char* reports[kReportCount];
+    XCTAssertEqual(growingcrash_readReportsBatch(g_reportIDs, kReportCount, reports, 3), kReportCount);
+    for(int i = 0; i < kReportCount; i++)
+    {
+        char expected[32];
+        snprintf(expected, sizeof(expected), "\"index\": %d,", i);
+        XCTAssertTrue(reports[i] != NULL && strstr(reports[i], expected) != NULL, @"report %d", i);
+        free(reports[i]);
+    }
+}
+
+- (void)testMatchesReadingOneByOne
+{
+    int readCount = 0;
+    XCTAssertEqual(countMismatches(g_reportIDs, kReportCount, 0, &readCount), 0);
+    XCTAssertEqual(readCount, kReportCount);
+}
+
+- (void)testBadIDsGetNullSlots
+{
+    int64_t missingID = g_reportIDs[kReportCount - 1] + 1000;
+    int64_t reportIDs[] = {g_reportIDs[0], 0, g_reportIDs[1], -1, missingID, g_reportIDs[2], missingID};
+    int count = (int)(sizeof(reportIDs) / sizeof(*reportIDs));
+    char* reports[sizeof(reportIDs) / sizeof(*reportIDs)];
+    XCTAssertEqual(growingcrash_readReportsBatch(reportIDs, count, reports, 2), 3);
+    XCTAssertTrue(reports[0] != NULL && strstr(reports[0], "\"index\": 0,") != NULL);
+    XCTAssertTrue(reports[1] == NULL);
+    XCTAssertTrue(reports[2] != NULL && strstr(reports[2], "\"index\": 1,") != NULL);
+    XCTAssertTrue(reports[3] == NULL);
+    XCTAssertTrue(reports[4] == NULL);
+    XCTAssertTrue(reports[5] != NULL && strstr(reports[5], "\"index\": 2,") != NULL);
+    XCTAssertTrue(reports[6] == NULL);
+    for(int i = 0; i < count; i++)
+    {
+        free(reports[i]);
+    }
+}
+
+- (void)testCorruptReportGetsNullSlot
+{
+    // Big enough that part of it is fixed up before the error is found.
+    int padding = 100000;
+    char* corrupt = malloc((unsigned)padding + 100);
+    int length = sprintf(corrupt, "{\"index\":-1,\"padding\":\"");
+    memset(corrupt + length, 'z', (unsigned)padding);
+    length += padding;
+    length += sprintf(corrupt + length, "\",]]]");
+    int64_t corruptID = growingcrs_addUserReport(corrupt, length);
+    free(corrupt);
+    // One thread, so that the next report reuses the buffer the corrupt one
+    // was partly read into.
+    int64_t reportIDs[] = {corruptID, g_reportIDs[0]};
+    char* reports[2];
+    XCTAssertEqual(growingcrash_readReportsBatch(reportIDs, 2, reports, 1), 1);
+    XCTAssertTrue(reports[0] == NULL);
+    char* expected = growingcrash_readReport(g_reportIDs[0]);
+    XCTAssertTrue(expected != NULL && reports[1] != NULL && strcmp(reports[1], expected) == 0, @"%s", reports[1]);
+    free(expected);
+    free(reports[1]);
+}
+
+- (void)testOnlyBadIDs
+{
+    int64_t reportIDs[] = {0, -5, g_reportIDs[kReportCount - 1] + 1000};
+    char* reports[3] = {(char*)"unset", (char*)"unset", (char*)"unset"};
+    XCTAssertEqual(growingcrash_readReportsBatch(reportIDs, 3, reports, 0), 0);
+    XCTAssertTrue(reports[0] == NULL && reports[1] == NULL && reports[2] == NULL);
+}
+
+- (void)testEmptyBatch
+{
+    char* reports[1] = {(char*)"unset"};
+    XCTAssertEqual(growingcrash_readReportsBatch(g_reportIDs, 0, reports, 0), 0);
+    XCTAssertEqual(growingcrash_readReportsBatch(g_reportIDs, -1, reports, 0), 0);
+    XCTAssertTrue(strcmp(reports[0], "unset") == 0);
+}
+
+- (void)testMaxThreadsIsClamped
+{
+    // Zero and negative mean "decide", and anything above the number of
+    // reports or the internal limit must be clamped rather than overrun it.
+    const int maxThreads[] = {-3, 0, 1, 2, 4, 5, 64, 100000};
+    const int counts[] = {1, 2, 5, kReportCount};
+    for(size_t i = 0; i < sizeof(maxThreads) / sizeof(*maxThreads); i++)
+    {
+        for(size_t j = 0; j < sizeof(counts) / sizeof(*counts); j++)
+        {
+            int readCount = 0;
+            XCTAssertEqual(countMismatches(g_reportIDs, counts[j], maxThreads[i], &readCount), 0, @"%d threads, %d reports", maxThreads[i], counts[j]);
+            XCTAssertEqual(readCount, counts[j], @"%d threads, %d reports", maxThreads[i], counts[j]);
+        }
+    }
+}
+
+- (void)testReadReportsBatchPerformance
+{
+    [self measureBlock:^{
+        char* reports[kReportCount];
+        for(int pass = 0; pass < 20; pass++)
+        {
+            XCTAssertEqual(growingcrash_readReportsBatch(g_reportIDs, kReportCount, reports, 0), kReportCount);
+            for(int i = 0; i < kReportCount; i++)
+            {
+                free(reports[i]);
+            }
+        }
+    }];
+}
+
+- (void)testReadReportsOneByOnePerformance
+{
+    [self measureBlock:^{
+        for(int pass = 0; pass < 20; pass++)
+        {
+            for(int i = 0; i < kReportCount; i++)
+            {
+                free(growingcrash_readReport(g_reportIDs[i]));
+            }
+        }
+    }];
+}
+
+@end
@@ -0,0 +1,433 @@
+//
+//  GrowingCrashReportBacktraceTests.m
+//  GrowingAPMCrashMonitorTests
+//
+//  Created by YoloMao on 2022/10/8.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import "GrowingCrashReportBacktrace.h"
+#import "GrowingCrashReportFields.h"
+#import "GrowingCrashStackCursor_Backtrace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define kMaxRecordedFrames 16
+
+/** The arena that the report uses. */
+#define kDefaultArenaSize (64 * 1024)
+
+/** Too small for any Swift symbol's nodes. */
+#define kTinyArenaSize 64
+
+static const char* const kSwiftSymbol = "$s4main3FooC3baryyF";
+static const char* const kSwiftSymbolDemangled = "Foo.bar()";
+static const char* const kCSymbol = "objc_msgSend";
+
+/** Shape of the report write benchmark. Each thread has its own inner frames,
+ * and one of a few outer stacks shared with other threads.
+ */
+#define kBenchmarkThreadCount 100
+#define kBenchmarkInnerFrameCount 40
+#define kBenchmarkOuterFrameCount 60
+#define kBenchmarkOuterStackCount 5
+#define kBenchmarkFrameCount (kBenchmarkInnerFrameCount + kBenchmarkOuterFrameCount)
+
+typedef struct
+{
+    uintptr_t address;
+    const char* symbolName;
+} MockFrame;
+
+/** A stack cursor over a fixed list of frames. */
+typedef struct
+{
+    const MockFrame* frames;
+    int frameCount;
+    int nextFrame;
+    int symbolicateCount;
+} MockStack;
+
+/** What a backtrace wrote, frame by frame. */
+typedef struct
+{
+    int frameCount;
+    const char* imageNames[kMaxRecordedFrames];
+    char symbolNames[kMaxRecordedFrames][256];
+    uintptr_t instructionAddresses[kMaxRecordedFrames];
+    int depth;
+} RecordedBacktrace;
+
+static bool mockAdvanceCursor(GrowingCrashStackCursor* cursor)
+{
+    MockStack* stack = (MockStack*)cursor->context[0];
+    if(stack->nextFrame >= stack->frameCount)
+    {
+        return false;
+    }
+    cursor->stackEntry.address = stack->frames[stack->nextFrame++].address;
+    cursor->stackEntry.imageName = NULL;
+    cursor->stackEntry.symbolName = NULL;
+    return true;
+}
+
+static bool mockSymbolicate(GrowingCrashStackCursor* cursor)
+{
+    MockStack* stack = (MockStack*)cursor->context[0];
+    stack->symbolicateCount++;
+    cursor->stackEntry.imageName = "/usr/lib/libtest.dylib";
+    cursor->stackEntry.imageAddress = 0x100000;
+    cursor->stackEntry.symbolName = stack->frames[stack->nextFrame - 1].symbolName;
+    cursor->stackEntry.symbolAddress = cursor->stackEntry.address & ~(uintptr_t)0xff;
+    return true;
+}
+
+static void initMockCursor(GrowingCrashStackCursor* cursor, MockStack* stack)
+{
+    memset(cursor, 0, sizeof(*cursor));
+    cursor->advanceCursor = mockAdvanceCursor;
+    cursor->symbolicate = mockSymbolicate;
+    cursor->context[0] = stack;
+}
+
+static RecordedBacktrace* recording(const GrowingCrashReportWriter* writer)
+{
+    return (RecordedBacktrace*)writer->context;
+}
+
+static void recordBeginObject(const GrowingCrashReportWriter* writer, __unused const char* key)
+{
+    RecordedBacktrace* backtrace = recording(writer);
+    // Frames are the objects inside the contents array.
+    if(backtrace->depth++ == 2)
+    {
+        backtrace->frameCount++;
+    }
+}
+
+static void recordBeginArray(const GrowingCrashReportWriter* writer, __unused const char* key)
+{
+    recording(writer)->depth++;
+}
+
+static void recordEndContainer(const GrowingCrashReportWriter* writer)
+{
+    recording(writer)->depth--;
+}
+
+static void recordStringElement(const GrowingCrashReportWriter* writer, const char* key, const char* value)
+{
+    RecordedBacktrace* backtrace = recording(writer);
+    int frame = backtrace->frameCount - 1;
+    if(frame < 0 || frame >= kMaxRecordedFrames)
+    {
+        return;
+    }
+    if(strcmp(key, GrowingCrashField_ObjectName) == 0)
+    {
+        backtrace->imageNames[frame] = value;
+    }
+    else if(strcmp(key, GrowingCrashField_SymbolName) == 0)
+    {
+        strncpy(backtrace->symbolNames[frame], value, sizeof(backtrace->symbolNames[frame]) - 1);
+    }
+}
+
+static void recordUIntegerElement(const GrowingCrashReportWriter* writer, const char* key, uint64_t value)
+{
+    RecordedBacktrace* backtrace = recording(writer);
+    int frame = backtrace->frameCount - 1;
+    if(frame >= 0 && frame < kMaxRecordedFrames && strcmp(key, GrowingCrashField_InstructionAddr) == 0)
+    {
+        backtrace->instructionAddresses[frame] = (uintptr_t)value;
+    }
+}
+
+static void recordIntegerElement(__unused const GrowingCrashReportWriter* writer,
+                                 __unused const char* key,
+                                 __unused int64_t value)
+{
+}
+
+static void writeMockBacktrace(const MockFrame* frames,
+                               int frameCount,
+                               RecordedBacktrace* backtrace,
+                               MockStack* stack,
+                               uint32_t symbolCache)
+{
+    memset(backtrace, 0, sizeof(*backtrace));
+    GrowingCrashReportWriter writer;
+    memset(&writer, 0, sizeof(writer));
+    writer.beginObject = recordBeginObject;
+    writer.beginArray = recordBeginArray;
+    writer.endContainer = recordEndContainer;
+    writer.addStringElement = recordStringElement;
+    writer.addUIntegerElement = recordUIntegerElement;
+    writer.addIntegerElement = recordIntegerElement;
+    writer.context = backtrace;
+
+    memset(stack, 0, sizeof(*stack));
+    stack->frames = frames;
+    stack->frameCount = frameCount;
+    GrowingCrashStackCursor cursor;
+    initMockCursor(&cursor, stack);
+    growingcrbt_writeBacktrace(&writer, GrowingCrashField_Backtrace, &cursor, symbolCache);
+}
+
+static void ignoreContainer(__unused const GrowingCrashReportWriter* writer, __unused const char* key)
+{
+}
+
+static void ignoreEndContainer(__unused const GrowingCrashReportWriter* writer)
+{
+}
+
+static void ignoreStringElement(__unused const GrowingCrashReportWriter* writer,
+                                __unused const char* key,
+                                __unused const char* value)
+{
+}
+
+static void ignoreUIntegerElement(__unused const GrowingCrashReportWriter* writer,
+                                  __unused const char* key,
+                                  __unused uint64_t value)
+{
+}
+
+/** Fill in return addresses inside real functions, so that the stack cursor
+ * symbolicates them the way it does in a report.
+ */
+static void makeBenchmarkBacktraces(uintptr_t backtraces[kBenchmarkThreadCount][kBenchmarkFrameCount])
+{
+    const uintptr_t functions[] = {
+        (uintptr_t)malloc, (uintptr_t)calloc, (uintptr_t)realloc, (uintptr_t)free,
+        (uintptr_t)strlen, (uintptr_t)strcmp, (uintptr_t)strncmp, (uintptr_t)strchr,
+        (uintptr_t)strrchr, (uintptr_t)strstr, (uintptr_t)strncpy, (uintptr_t)memcpy,
+        (uintptr_t)memmove, (uintptr_t)memset, (uintptr_t)memcmp, (uintptr_t)memchr,
+        (uintptr_t)qsort, (uintptr_t)bsearch, (uintptr_t)atoi, (uintptr_t)strtol,
+        (uintptr_t)strtoul, (uintptr_t)strtod, (uintptr_t)abs, (uintptr_t)rand,
+    };
+    const int functionCount = sizeof(functions) / sizeof(*functions);
+    uintptr_t outerStacks[kBenchmarkOuterStackCount][kBenchmarkOuterFrameCount];
+
+    srand(21);
+    for(int stack = 0; stack < kBenchmarkOuterStackCount; stack++)
+    {
+        for(int frame = 0; frame < kBenchmarkOuterFrameCount; frame++)
+        {
+            outerStacks[stack][frame] = functions[rand() % functionCount] + 4 * (1 + rand() % 32);
+        }
+    }
+    for(int thread = 0; thread < kBenchmarkThreadCount; thread++)
+    {
+        for(int frame = 0; frame < kBenchmarkInnerFrameCount; frame++)
+        {
+            backtraces[thread][frame] = functions[rand() % functionCount] + 4 * (1 + rand() % 32);
+        }
+        memcpy(&backtraces[thread][kBenchmarkInnerFrameCount],
+               outerStacks[thread % kBenchmarkOuterStackCount],
+               sizeof(outerStacks[0]));
+    }
+}
+
+/** Write every thread's backtrace, the way a report does. */
+static void writeBenchmarkBacktraces(uintptr_t backtraces[kBenchmarkThreadCount][kBenchmarkFrameCount],
+                                     bool useSymbolCache)
+{
+    GrowingCrashReportWriter writer;
+    memset(&writer, 0, sizeof(writer));
+    writer.beginObject = ignoreContainer;
+    writer.beginArray = ignoreContainer;
+    writer.endContainer = ignoreEndContainer;
+    writer.addStringElement = ignoreStringElement;
+    writer.addUIntegerElement = ignoreUIntegerElement;
+    writer.addIntegerElement = recordIntegerElement;
+
+    const uint32_t symbolCache = useSymbolCache ? growingcrbt_beginSymbolCache() : 0;
+    for(int thread = 0; thread < kBenchmarkThreadCount; thread++)
+    {
+        GrowingCrashStackCursor cursor;
+        growingcrashsc_initWithBacktrace(&cursor, backtraces[thread], kBenchmarkFrameCount, 0);
+        growingcrbt_writeBacktrace(&writer, GrowingCrashField_Backtrace, &cursor, symbolCache);
+    }
+    growingcrbt_endSymbolCache(symbolCache);
+}
+
+@interface GrowingCrashReportBacktraceTests : XCTestCase
+
+@end
+
+@implementation GrowingCrashReportBacktraceTests
+
+- (void)tearDown
+{
+    growingcrbt_setDemangleSwiftSymbols(false, kDefaultArenaSize);
+    [super tearDown];
+}
+
+- (void)testWritesEveryFrame
+{
+    MockFrame frames[] = {{0x1010, kSwiftSymbol}, {0x2020, kCSymbol}, {0x3030, NULL}};
+    RecordedBacktrace backtrace;
+    MockStack stack;
+    writeMockBacktrace(frames, 3, &backtrace, &stack, 0);
+
+    XCTAssertEqual(backtrace.depth, 0);
+    XCTAssertEqual(backtrace.frameCount, 3);
+    XCTAssertEqual(stack.symbolicateCount, 3);
+    XCTAssertEqual(strcmp(backtrace.imageNames[0], "libtest.dylib"), 0);
+    XCTAssertEqual(strcmp(backtrace.symbolNames[0], kSwiftSymbol), 0, @"%s", backtrace.symbolNames[0]);
+    XCTAssertEqual(strcmp(backtrace.symbolNames[1], kCSymbol), 0, @"%s", backtrace.symbolNames[1]);
+    XCTAssertEqual(strcmp(backtrace.symbolNames[2], ""), 0);
+    XCTAssertEqual(backtrace.instructionAddresses[2], (uintptr_t)0x3030);
+}
+
+- (void)testDemanglesSwiftSymbols
+{
+    growingcrbt_setDemangleSwiftSymbols(true, kDefaultArenaSize);
+    MockFrame frames[] = {{0x1010, kSwiftSymbol}, {0x2020, kCSymbol}, {0x3030, kSwiftSymbol}};
+    RecordedBacktrace backtrace;
+    MockStack stack;
+    writeMockBacktrace(frames, 3, &backtrace, &stack, 0);
+
+    XCTAssertEqual(backtrace.frameCount, 3);
+    XCTAssertEqual(strcmp(backtrace.symbolNames[0], kSwiftSymbolDemangled), 0, @"%s", backtrace.symbolNames[0]);
+    XCTAssertEqual(strcmp(backtrace.symbolNames[1], kCSymbol), 0, @"%s", backtrace.symbolNames[1]);
+    // The demangler was given back after the first symbol.
+    XCTAssertEqual(strcmp(backtrace.symbolNames[2], kSwiftSymbolDemangled), 0, @"%s", backtrace.symbolNames[2]);
+}
+
+- (void)testFallsBackToMangledNameWhenArenaRunsOut
+{
+    growingcrbt_setDemangleSwiftSymbols(true, kTinyArenaSize);
+    MockFrame frames[] = {{0x1010, kSwiftSymbol}, {0x2020, kCSymbol}};
+    RecordedBacktrace backtrace;
+    MockStack stack;
+    writeMockBacktrace(frames, 2, &backtrace, &stack, 0);
+
+    XCTAssertEqual(backtrace.frameCount, 2);
+    XCTAssertEqual(strcmp(backtrace.symbolNames[0], kSwiftSymbol), 0, @"%s", backtrace.symbolNames[0]);
+    XCTAssertEqual(strcmp(backtrace.symbolNames[1], kCSymbol), 0, @"%s", backtrace.symbolNames[1]);
+
+    // A bigger arena replaces the demangler.
+    growingcrbt_setDemangleSwiftSymbols(true, kDefaultArenaSize);
+    writeMockBacktrace(frames, 2, &backtrace, &stack, 0);
+    XCTAssertEqual(strcmp(backtrace.symbolNames[0], kSwiftSymbolDemangled), 0, @"%s", backtrace.symbolNames[0]);
+}
+
+- (void)testDisablingDemanglingWritesMangledNames
+{
+    growingcrbt_setDemangleSwiftSymbols(true, kDefaultArenaSize);
+    growingcrbt_setDemangleSwiftSymbols(false, kDefaultArenaSize);
+    MockFrame frames[] = {{0x1010, kSwiftSymbol}};
+    RecordedBacktrace backtrace;
+    MockStack stack;
+    writeMockBacktrace(frames, 1, &backtrace, &stack, 0);
+    XCTAssertEqual(strcmp(backtrace.symbolNames[0], kSwiftSymbol), 0, @"%s", backtrace.symbolNames[0]);
+}
+
+- (void)testSymbolCacheSymbolicatesEachAddressOnce
+{
+    MockFrame inner1[] = {{0x1010, "inner1"}, {0x9090, "shared"}, {0xa0a0, "main"}};
+    MockFrame inner2[] = {{0x2020, "inner2"}, {0x9090, "shared"}, {0xa0a0, "main"}};
+    RecordedBacktrace backtrace;
+    MockStack stack;
+
+    const uint32_t symbolCache = growingcrbt_beginSymbolCache();
+    XCTAssertNotEqual(symbolCache, 0);
+    writeMockBacktrace(inner1, 3, &backtrace, &stack, symbolCache);
+    XCTAssertEqual(stack.symbolicateCount, 3);
+    writeMockBacktrace(inner2, 3, &backtrace, &stack, symbolCache);
+    XCTAssertEqual(stack.symbolicateCount, 1);
+    growingcrbt_endSymbolCache(symbolCache);
+
+    // Cached frames are written the same as symbolicated ones.
+    XCTAssertEqual(backtrace.frameCount, 3);
+    XCTAssertEqual(strcmp(backtrace.imageNames[1], "libtest.dylib"), 0);
+    XCTAssertEqual(strcmp(backtrace.symbolNames[0], "inner2"), 0, @"%s", backtrace.symbolNames[0]);
+    XCTAssertEqual(strcmp(backtrace.symbolNames[1], "shared"), 0, @"%s", backtrace.symbolNames[1]);
+    XCTAssertEqual(strcmp(backtrace.symbolNames[2], "main"), 0, @"%s", backtrace.symbolNames[2]);
+    XCTAssertEqual(backtrace.instructionAddresses[2], (uintptr_t)0xa0a0);
+}
+
+- (void)testOnlyOneReportUsesTheSymbolCache
+{
+    MockFrame frames[] = {{0x1010, "inner"}, {0x9090, "main"}};
+    RecordedBacktrace backtrace;
+    MockStack stack;
+
+    const uint32_t symbolCache = growingcrbt_beginSymbolCache();
+    XCTAssertNotEqual(symbolCache, 0);
+    XCTAssertEqual(growingcrbt_beginSymbolCache(), 0);
+    writeMockBacktrace(frames, 2, &backtrace, &stack, symbolCache);
+
+    // A report without the cache symbolicates every frame.
+    writeMockBacktrace(frames, 2, &backtrace, &stack, 0);
+    XCTAssertEqual(stack.symbolicateCount, 2);
+    growingcrbt_endSymbolCache(0);
+    writeMockBacktrace(frames, 2, &backtrace, &stack, symbolCache);
+    XCTAssertEqual(stack.symbolicateCount, 0);
+    growingcrbt_endSymbolCache(symbolCache);
+}
+
+- (void)testEndedSymbolCacheIsNotReused
+{
+    MockFrame frames[] = {{0x1010, "inner"}, {0x9090, "main"}};
+    RecordedBacktrace backtrace;
+    MockStack stack;
+
+    const uint32_t oldSymbolCache = growingcrbt_beginSymbolCache();
+    writeMockBacktrace(frames, 2, &backtrace, &stack, oldSymbolCache);
+    growingcrbt_endSymbolCache(oldSymbolCache);
+    writeMockBacktrace(frames, 2, &backtrace, &stack, oldSymbolCache);
+    XCTAssertEqual(stack.symbolicateCount, 2);
+
+    // The next report gets a new generation and an empty cache, even though
+    // its writer may live at the same address as the last one's.
+    const uint32_t symbolCache = growingcrbt_beginSymbolCache();
+    XCTAssertNotEqual(symbolCache, 0);
+    XCTAssertNotEqual(symbolCache, oldSymbolCache);
+    writeMockBacktrace(frames, 2, &backtrace, &stack, oldSymbolCache);
+    XCTAssertEqual(stack.symbolicateCount, 2);
+    writeMockBacktrace(frames, 2, &backtrace, &stack, symbolCache);
+    XCTAssertEqual(stack.symbolicateCount, 2);
+
+    // Ending a stale generation doesn't release the current one.
+    growingcrbt_endSymbolCache(oldSymbolCache);
+    XCTAssertEqual(growingcrbt_beginSymbolCache(), 0);
+    growingcrbt_endSymbolCache(symbolCache);
+}
+
+- (void)testWriteBacktracesPerformance
+{
+    static uintptr_t backtraces[kBenchmarkThreadCount][kBenchmarkFrameCount];
+    makeBenchmarkBacktraces(backtraces);
+    [self measureBlock:^{
+        writeBenchmarkBacktraces(backtraces, false);
+    }];
+}
+
+- (void)testWriteBacktracesWithSymbolCachePerformance
+{
+    static uintptr_t backtraces[kBenchmarkThreadCount][kBenchmarkFrameCount];
+    makeBenchmarkBacktraces(backtraces);
+    [self measureBlock:^{
+        writeBenchmarkBacktraces(backtraces, true);
+    }];
+}
+
+@end
@@ -0,0 +1,317 @@
+//
+//  GrowingCrashReportBinaryImagesTests.m
+//  GrowingAPMCrashMonitorTests
+//
+//  Created by YoloMao on 2022/10/8.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import "GrowingCrashReportBinaryImages.h"
+#import "GrowingCrashReportFields.h"
+#import "GrowingCrashCPU.h"
+#import "GrowingCrashDynamicLinker.h"
+#import "GrowingCrashStackCursor_Backtrace.h"
+
+#include <dlfcn.h>
+#include <mach-o/dyld.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define kMaxRecordedImages 4096
+
+/** The image addresses a report listed, section by section. */
+typedef struct
+{
+    const char* currentArray;
+    int depth;
+    int binaryImageCount;
+    uintptr_t binaryImages[kMaxRecordedImages];
+    int loadedImageCount;
+    uintptr_t loadedImages[kMaxRecordedImages];
+    int uuidCount;
+} RecordedImages;
+
+static RecordedImages g_recorded;
+
+static void recordBeginObject(__unused const GrowingCrashReportWriter* writer, __unused const char* key)
+{
+    g_recorded.depth++;
+}
+
+static void recordBeginArray(__unused const GrowingCrashReportWriter* writer, const char* key)
+{
+    g_recorded.depth++;
+    g_recorded.currentArray = key;
+}
+
+static void recordEndContainer(__unused const GrowingCrashReportWriter* writer)
+{
+    g_recorded.depth--;
+}
+
+static void recordUIntegerElement(__unused const GrowingCrashReportWriter* writer, const char* key, uint64_t value)
+{
+    if(strcmp(key, GrowingCrashField_ImageAddress) != 0)
+    {
+        return;
+    }
+    if(strcmp(g_recorded.currentArray, GrowingCrashField_BinaryImages) == 0 &&
+       g_recorded.binaryImageCount < kMaxRecordedImages)
+    {
+        g_recorded.binaryImages[g_recorded.binaryImageCount++] = (uintptr_t)value;
+    }
+    else if(strcmp(g_recorded.currentArray, GrowingCrashField_LoadedImages) == 0 &&
+            g_recorded.loadedImageCount < kMaxRecordedImages)
+    {
+        g_recorded.loadedImages[g_recorded.loadedImageCount++] = (uintptr_t)value;
+    }
+}
+
+static void recordUUIDElement(__unused const GrowingCrashReportWriter* writer,
+                              __unused const char* key,
+                              __unused const unsigned char* value)
+{
+    g_recorded.uuidCount++;
+}
+
+static void ignoreIntegerElement(__unused const GrowingCrashReportWriter* writer,
+                                 __unused const char* key,
+                                 __unused int64_t value)
+{
+}
+
+static void ignoreStringElement(__unused const GrowingCrashReportWriter* writer,
+                                __unused const char* key,
+                                __unused const char* value)
+{
+}
+
+static void initRecordingWriter(GrowingCrashReportWriter* writer)
+{
+    memset(&g_recorded, 0, sizeof(g_recorded));
+    memset(writer, 0, sizeof(*writer));
+    writer->beginObject = recordBeginObject;
+    writer->beginArray = recordBeginArray;
+    writer->endContainer = recordEndContainer;
+    writer->addUIntegerElement = recordUIntegerElement;
+    writer->addUUIDElement = recordUUIDElement;
+    writer->addIntegerElement = ignoreIntegerElement;
+    writer->addStringElement = ignoreStringElement;
+}
+
+/** The index of the image whose header is at an address, found through dyld
+ * rather than the image index that the report uses.
+ */
+static int imageIndexWithHeader(uintptr_t header)
+{
+    for(uint32_t i = 0; i < _dyld_image_count(); i++)
+    {
+        if((uintptr_t)_dyld_get_image_header(i) == header)
+        {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static int imageIndexContainingFunction(uintptr_t function)
+{
+    Dl_info info;
+    if(dladdr((const void*)function, &info) == 0)
+    {
+        return -1;
+    }
+    return imageIndexWithHeader((uintptr_t)info.dli_fbase);
+}
+
+/** The functions that the synthetic backtrace returns into. They live in a
+ * handful of different images.
+ */
+static void getReferencedFunctions(uintptr_t* functions, int* count)
+{
+    int i = 0;
+    functions[i++] = (uintptr_t)malloc;
+    functions[i++] = (uintptr_t)strlen;
+    functions[i++] = (uintptr_t)sin;
+    functions[i++] = (uintptr_t)pthread_create;
+    functions[i++] = (uintptr_t)dlopen;
+    functions[i++] = (uintptr_t)initRecordingWriter;
+    *count = i;
+    // Drop any pointer authentication bits.
+    for(i = 0; i < *count; i++)
+    {
+        functions[i] = growingcrashcpu_normaliseInstructionPointer(functions[i]);
+    }
+}
+
+/** Find the images that a backtrace through the referenced functions points into. */
+static void findSyntheticReferencedImages(GrowingCrashReferencedImages* referencedImages)
+{
+    uintptr_t functions[16];
+    int functionCount;
+    getReferencedFunctions(functions, &functionCount);
+
+    // Return addresses, each a little way into a function.
+    uintptr_t backtrace[32];
+    int frameCount = 0;
+    for(int i = 0; i < functionCount; i++)
+    {
+        backtrace[frameCount++] = functions[i] + 8;
+        backtrace[frameCount++] = functions[i] + 16;
+    }
+    GrowingCrashStackCursor stackCursor;
+    growingcrashsc_initWithBacktrace(&stackCursor, backtrace, frameCount, 0);
+
+    growingcrbi_resetReferencedImages(referencedImages);
+    growingcrbi_addBacktrace(referencedImages, &stackCursor);
+}
+
+/** Get which images a report should describe in full: the main executable,
+ * the referenced functions' images, and any image with a crash info message.
+ */
+static int getExpectedImages(bool* isExpected, int imageCount)
+{
+    memset(isExpected, 0, sizeof(*isExpected) * (size_t)imageCount);
+    isExpected[0] = true;
+
+    uintptr_t functions[16];
+    int functionCount;
+    getReferencedFunctions(functions, &functionCount);
+    for(int i = 0; i < functionCount; i++)
+    {
+        int index = imageIndexContainingFunction(functions[i]);
+        if(index >= 0)
+        {
+            isExpected[index] = true;
+        }
+    }
+    for(int i = 0; i < imageCount; i++)
+    {
+        GrowingCrashBinaryImage image = {0};
+        if(growingcrashdl_getBinaryImage(i, &image) &&
+           (image.crashInfoMessage != NULL || image.crashInfoMessage2 != NULL))
+        {
+            isExpected[i] = true;
+        }
+    }
+    int expectedCount = 0;
+    for(int i = 0; i < imageCount; i++)
+    {
+        expectedCount += isExpected[i];
+    }
+    return expectedCount;
+}
+
+@interface GrowingCrashReportBinaryImagesTests : XCTestCase
+
+@end
+
+@implementation GrowingCrashReportBinaryImagesTests
+
+- (void)setUp
+{
+    [super setUp];
+    growingcrashdl_initialize();
+}
+
+- (void)testReferencedImagesOnly
+{
+    static bool isExpected[kMaxRecordedImages];
+    const int imageCount = (int)_dyld_image_count();
+    XCTAssertLessThan(imageCount, GROWINGCRBI_MAX_TRACKED_IMAGES);
+    const int expectedCount = getExpectedImages(isExpected, imageCount);
+    // Several images, but far fewer than are loaded.
+    XCTAssertGreaterThan(expectedCount, 2);
+    XCTAssertLessThan(expectedCount, imageCount);
+
+    GrowingCrashReferencedImages referencedImages;
+    findSyntheticReferencedImages(&referencedImages);
+
+    GrowingCrashReportWriter writer;
+    initRecordingWriter(&writer);
+    writer.beginObject(&writer, GrowingCrashField_Report);
+    {
+        growingcrbi_writeBinaryImages(&writer, GrowingCrashField_BinaryImages, &referencedImages);
+        growingcrbi_writeCompactImageList(&writer, GrowingCrashField_LoadedImages);
+    }
+    writer.endContainer(&writer);
+    XCTAssertEqual(g_recorded.depth, 0);
+
+    // Full entries for exactly the expected images, in image order.
+    XCTAssertEqual(g_recorded.binaryImageCount, expectedCount);
+    int next = 0;
+    for(int i = 0; i < imageCount && next < g_recorded.binaryImageCount; i++)
+    {
+        if(isExpected[i])
+        {
+            XCTAssertEqual(g_recorded.binaryImages[next], (uintptr_t)_dyld_get_image_header((uint32_t)i),
+                           @"image %d (%s)", i, _dyld_get_image_name((uint32_t)i));
+            next++;
+        }
+    }
+
+    // The compact list covers every image, so that any address can still
+    // be symbolicated.
+    XCTAssertEqual(g_recorded.loadedImageCount, imageCount);
+    for(int i = 0; i < imageCount && i < g_recorded.loadedImageCount; i++)
+    {
+        XCTAssertEqual(g_recorded.loadedImages[i], (uintptr_t)_dyld_get_image_header((uint32_t)i));
+    }
+    XCTAssertEqual(g_recorded.uuidCount, expectedCount + imageCount);
+}
+
+- (void)testAllImagesWithoutReferences
+{
+    const int imageCount = (int)_dyld_image_count();
+    GrowingCrashReportWriter writer;
+    initRecordingWriter(&writer);
+    growingcrbi_writeBinaryImages(&writer, GrowingCrashField_BinaryImages, NULL);
+
+    XCTAssertEqual(g_recorded.binaryImageCount, imageCount);
+    for(int i = 0; i < imageCount && i < g_recorded.binaryImageCount; i++)
+    {
+        XCTAssertEqual(g_recorded.binaryImages[i], (uintptr_t)_dyld_get_image_header((uint32_t)i));
+    }
+    XCTAssertEqual(g_recorded.loadedImageCount, 0);
+}
+
+- (void)testEmptyBacktraceReferencesOnlyTheMainExecutable
+{
+    GrowingCrashReferencedImages referencedImages;
+    growingcrbi_resetReferencedImages(&referencedImages);
+    GrowingCrashStackCursor stackCursor;
+    growingcrashsc_initWithBacktrace(&stackCursor, NULL, 0, 0);
+    growingcrbi_addBacktrace(&referencedImages, &stackCursor);
+
+    GrowingCrashReportWriter writer;
+    initRecordingWriter(&writer);
+    growingcrbi_writeBinaryImages(&writer, GrowingCrashField_BinaryImages, &referencedImages);
+
+    XCTAssertGreaterThanOrEqual(g_recorded.binaryImageCount, 1);
+    XCTAssertEqual(g_recorded.binaryImages[0], (uintptr_t)_dyld_get_image_header(0));
+    for(int i = 1; i < g_recorded.binaryImageCount; i++)
+    {
+        // Anything else must have a crash info message.
+        int index = imageIndexWithHeader(g_recorded.binaryImages[i]);
+        GrowingCrashBinaryImage image = {0};
+        XCTAssertTrue(growingcrashdl_getBinaryImage(index, &image));
+        XCTAssertTrue(image.crashInfoMessage != NULL || image.crashInfoMessage2 != NULL);
+    }
+}
+
+@end
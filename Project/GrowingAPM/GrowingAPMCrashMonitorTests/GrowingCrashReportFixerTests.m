@@ -0,0 +1,84 @@
+//
+//  GrowingCrashReportFixerTests.m
+//  GrowingAPMCrashMonitorTests
+//
+//  Created by YoloMao on 2022/10/8.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import "GrowingCrashReportFixer.h"
+#import "GrowingCrashJSONCodec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Big enough that the fixer hands output to its sink before the end. */
+#define kPaddingCount 10000
+
+typedef struct
+{
+    int callCount;
+    bool addedPath;
+} RegisteringSink;
+
+static int addDataRegisteringPath(__unused const char* data, __unused int length, void* userData)
+{
+    RegisteringSink* sink = (RegisteringSink*)userData;
+    if(sink->callCount++ == 0)
+    {
+        sink->addedPath = growingcrf_addFixupPath("/user/sink_launch_time", GrowingCrashFixupActionFixDate);
+    }
+    return GrowingCrashJSON_OK;
+}
+
+static char* makePaddedReport(void)
+{
+    char* report = malloc(kPaddingCount * 20 + 100);
+    char* ptr = report;
+    ptr += sprintf(ptr, "{\"padding\":[");
+    for(int i = 0; i < kPaddingCount; i++)
+    {
+        ptr += sprintf(ptr, "%s\"padding%d\"", i == 0 ? "" : ",", i);
+    }
+    sprintf(ptr, "],\"user\":{\"sink_launch_time\":1700000000}}");
+    return report;
+}
+
+@interface GrowingCrashReportFixerTests : XCTestCase
+
+@end
+
+@implementation GrowingCrashReportFixerTests
+
+- (void)testSinkCanRegisterFixupPath
+{
+    char* report = makePaddedReport();
+    RegisteringSink sink = {0};
+    XCTAssertEqual(growingcrf_fixupCrashReportToSink(report, (int)strlen(report), addDataRegisteringPath, &sink),
+                   GrowingCrashJSON_OK);
+    XCTAssertGreaterThan(sink.callCount, 1);
+    XCTAssertTrue(sink.addedPath);
+
+    // The path applies from the next fixup on.
+    char* fixed = growingcrf_fixupCrashReport(report);
+    XCTAssertNotNil(fixed);
+    XCTAssertTrue(strstr(fixed, "\"2023-11-14T22:13:20Z\"") != NULL);
+    free(fixed);
+    free(report);
+}
+
+@end
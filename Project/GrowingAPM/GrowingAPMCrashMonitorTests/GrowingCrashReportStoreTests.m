@@ -0,0 +1,413 @@
+//
+//  GrowingCrashReportStoreTests.m
+//  GrowingAPMCrashMonitorTests
+//
+//  Created by YoloMao on 2022/10/8.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import "GrowingCrashReportStore.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define APP_NAME "StoreTests"
+
+/** sizeof(ManifestRecord) in GrowingCrashReportStore.c. */
+#define MANIFEST_RECORD_SIZE 40
+
+static char g_directory[500];
+static char g_manifestPath[600];
+
+static void initializeStore(void)
+{
+    growingcrs_initialize(APP_NAME, g_directory);
+}
+
+static int64_t addReport(const char* contents)
+{
+    return growingcrs_addUserReport(contents, (int)strlen(contents));
+}
+
+static bool writeFile(const char* path, const char* data, int length)
+{
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0)
+    {
+        return false;
+    }
+    bool success = write(fd, data, (size_t)length) == length;
+    close(fd);
+    return success;
+}
+
+static bool appendToFile(const char* path, const char* data, int length)
+{
+    int fd = open(path, O_WRONLY | O_APPEND);
+    if(fd < 0)
+    {
+        return false;
+    }
+    bool success = write(fd, data, (size_t)length) == length;
+    close(fd);
+    return success;
+}
+
+static int64_t fileSize(const char* path)
+{
+    struct stat st;
+    return stat(path, &st) == 0 ? (int64_t)st.st_size : -1;
+}
+
+static int countReportFiles(void)
+{
+    DIR* dir = opendir(g_directory);
+    if(dir == NULL)
+    {
+        return -1;
+    }
+    int count = 0;
+    int64_t reportID;
+    struct dirent* ent;
+    while((ent = readdir(dir)) != NULL)
+    {
+        if(sscanf(ent->d_name, APP_NAME "-report-%" SCNx64 ".json", &reportID) == 1)
+        {
+            count++;
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+static void removeDirectory(const char* path)
+{
+    DIR* dir = opendir(path);
+    if(dir == NULL)
+    {
+        return;
+    }
+    struct dirent* ent;
+    while((ent = readdir(dir)) != NULL)
+    {
+        if(strcmp(ent->d_name, ".") != 0 && strcmp(ent->d_name, "..") != 0)
+        {
+            char entryPath[1000];
+            snprintf(entryPath, sizeof(entryPath), "%s/%s", path, ent->d_name);
+            unlink(entryPath);
+        }
+    }
+    closedir(dir);
+    rmdir(path);
+}
+
+static void addReports(int count)
+{
+    for(int i = 0; i < count; i++)
+    {
+        char report[64];
+        snprintf(report, sizeof(report), "{\"index\":%d}", i);
+        addReport(report);
+    }
+}
+
+@interface GrowingCrashReportStoreTests : XCTestCase
+@end
+
+@implementation GrowingCrashReportStoreTests
+
+- (void)setUp
+{
+    [super setUp];
+    const char* tmpDir = getenv("TMPDIR");
+    snprintf(g_directory, sizeof(g_directory), "%s/GrowingCrashReportStoreTests.XXXXXX", tmpDir != NULL ? tmpDir : "/tmp");
+    XCTAssertTrue(mkdtemp(g_directory) != NULL);
+    snprintf(g_manifestPath, sizeof(g_manifestPath), "%s/" APP_NAME "-reports.manifest", g_directory);
+    growingcrs_setMaxReportCount(20000);
+    initializeStore();
+}
+
+- (void)tearDown
+{
+    removeDirectory(g_directory);
+    growingcrs_setMaxReportCount(5);
+    [super tearDown];
+}
+
+- (void)testAddedReportsAreListedInOrder
+{
+    int64_t first = addReport("{\"a\":1}");
+    int64_t second = addReport("{\"b\":22}");
+    int64_t third = addReport("{\"c\":333}");
+
+    XCTAssertEqual(growingcrs_getReportCount(), 3);
+    int64_t reportIDs[4] = {0};
+    XCTAssertEqual(growingcrs_getReportIDs(reportIDs, 4), 3);
+    XCTAssertEqual(reportIDs[0], first);
+    XCTAssertEqual(reportIDs[1], second);
+    XCTAssertEqual(reportIDs[2], third);
+    XCTAssertEqual(growingcrs_getReportIDs(reportIDs, 2), 2);
+
+    GrowingCrashStoredReportInfo info;
+    XCTAssertTrue(growingcrs_getReportInfo(second, &info));
+    XCTAssertEqual(info.reportID, second);
+    XCTAssertEqual(info.size, 8);
+    XCTAssertEqual(info.type, GrowingCrashStoredReportTypeUser);
+    XCTAssertEqual(info.uploadState, GrowingCrashReportUploadStateNotUploaded);
+    XCTAssertGreaterThan(info.timestamp, 0);
+    XCTAssertFalse(growingcrs_getReportInfo(third + 1, &info));
+
+    XCTAssertEqual(fileSize(g_manifestPath), 3 * MANIFEST_RECORD_SIZE);
+}
+
+- (void)testIndexPicksUpRecordsAppendedByAnotherWriter
+{
+    addReport("{}");
+    XCTAssertEqual(growingcrs_getReportCount(), 1);
+
+    // The crash handler appends without syncing. Commit follows the same path.
+    char path[GROWINGCRS_MAX_PATH_LENGTH];
+    int64_t reportID = growingcrs_getNextCrashReport(path);
+    GrowingCrashStoredReportInfo info;
+    XCTAssertTrue(growingcrs_getReportInfo(reportID, &info));
+    XCTAssertEqual(info.size, 0);
+    XCTAssertEqual(info.type, GrowingCrashStoredReportTypeCrash);
+    int64_t timestamp = info.timestamp;
+    sleep(1);
+
+    XCTAssertTrue(writeFile(path, "{\"crash\":true}", 14));
+    growingcrs_commitCrashReport(reportID);
+    XCTAssertTrue(growingcrs_getReportInfo(reportID, &info));
+    XCTAssertEqual(info.size, 14);
+    XCTAssertEqual(info.timestamp, timestamp);
+    XCTAssertEqual(growingcrs_getReportCount(), 2);
+}
+
+- (void)testStateSurvivesReinitializing
+{
+    int64_t first = addReport("{\"a\":1}");
+    int64_t second = addReport("{\"b\":2}");
+    growingcrs_setReportUploadState(first, GrowingCrashReportUploadStateUploaded);
+    growingcrs_deleteReportWithID(second);
+
+    initializeStore();
+    XCTAssertEqual(growingcrs_getReportCount(), 1);
+    GrowingCrashStoredReportInfo info;
+    XCTAssertTrue(growingcrs_getReportInfo(first, &info));
+    XCTAssertEqual(info.uploadState, GrowingCrashReportUploadStateUploaded);
+    XCTAssertFalse(growingcrs_getReportInfo(second, &info));
+    XCTAssertEqual(countReportFiles(), 1);
+}
+
+- (void)testUploadState
+{
+    int64_t reportID = addReport("{}");
+    GrowingCrashStoredReportInfo info;
+    growingcrs_setReportUploadState(reportID, GrowingCrashReportUploadStateUploaded);
+    XCTAssertTrue(growingcrs_getReportInfo(reportID, &info));
+    XCTAssertEqual(info.uploadState, GrowingCrashReportUploadStateUploaded);
+    growingcrs_setReportUploadState(reportID, GrowingCrashReportUploadStateNotUploaded);
+    XCTAssertTrue(growingcrs_getReportInfo(reportID, &info));
+    XCTAssertEqual(info.uploadState, GrowingCrashReportUploadStateNotUploaded);
+
+    // Setting the state of a deleted report doesn't bring it back.
+    growingcrs_deleteReportWithID(reportID);
+    growingcrs_setReportUploadState(reportID, GrowingCrashReportUploadStateUploaded);
+    XCTAssertFalse(growingcrs_getReportInfo(reportID, &info));
+    XCTAssertEqual(growingcrs_getReportCount(), 0);
+}
+
+- (void)testTornTrailingRecordIsIgnored
+{
+    int64_t reportID = addReport("{}");
+    XCTAssertTrue(appendToFile(g_manifestPath, "\x47\x43\x52\x4d\x01\x01", 6));
+    XCTAssertEqual(growingcrs_getReportCount(), 1);
+
+    // Initializing drops the partial record, so that later appends line up.
+    initializeStore();
+    XCTAssertEqual(fileSize(g_manifestPath), MANIFEST_RECORD_SIZE);
+    growingcrs_setReportUploadState(reportID, GrowingCrashReportUploadStateUploaded);
+    XCTAssertEqual(fileSize(g_manifestPath), 2 * MANIFEST_RECORD_SIZE);
+    initializeStore();
+    GrowingCrashStoredReportInfo info;
+    XCTAssertTrue(growingcrs_getReportInfo(reportID, &info));
+    XCTAssertEqual(info.uploadState, GrowingCrashReportUploadStateUploaded);
+    XCTAssertEqual(growingcrs_getReportCount(), 1);
+}
+
+- (void)testUncommittedReportWithoutFileIsDroppedAtInitialize
+{
+    int64_t written = addReport("{}");
+    char path[GROWINGCRS_MAX_PATH_LENGTH];
+    int64_t neverWritten = growingcrs_getNextCrashReport(path);
+    int64_t empty = growingcrs_getNextCrashReport(path);
+    XCTAssertTrue(writeFile(path, "", 0));
+    int64_t notCommitted = growingcrs_getNextCrashReport(path);
+    XCTAssertTrue(writeFile(path, "{\"crash\":1}", 11));
+    XCTAssertEqual(growingcrs_getReportCount(), 4);
+
+    initializeStore();
+    GrowingCrashStoredReportInfo info;
+    XCTAssertEqual(growingcrs_getReportCount(), 2);
+    XCTAssertTrue(growingcrs_getReportInfo(written, &info));
+    XCTAssertFalse(growingcrs_getReportInfo(neverWritten, &info));
+    XCTAssertFalse(growingcrs_getReportInfo(empty, &info));
+    XCTAssertTrue(growingcrs_getReportInfo(notCommitted, &info));
+    XCTAssertEqual(info.size, 11);
+    XCTAssertEqual(countReportFiles(), 2);
+
+    // The settled state is written back, so it isn't redone on every launch.
+    XCTAssertEqual(fileSize(g_manifestPath), 2 * MANIFEST_RECORD_SIZE);
+}
+
+- (void)testCommittingUnwrittenReportDropsIt
+{
+    char path[GROWINGCRS_MAX_PATH_LENGTH];
+    int64_t reportID = growingcrs_getNextCrashReport(path);
+    growingcrs_commitCrashReport(reportID);
+    GrowingCrashStoredReportInfo info;
+    XCTAssertFalse(growingcrs_getReportInfo(reportID, &info));
+    XCTAssertEqual(growingcrs_getReportCount(), 0);
+}
+
+- (void)testCompactsManifestWithTooManyRecords
+{
+    int64_t reportID = addReport("{}");
+    addReport("{}");
+    for(int i = 0; i < 100; i++)
+    {
+        growingcrs_setReportUploadState(reportID, (GrowingCrashReportUploadState)(i % 2));
+    }
+    XCTAssertEqual(fileSize(g_manifestPath), 102 * MANIFEST_RECORD_SIZE);
+
+    initializeStore();
+    XCTAssertEqual(fileSize(g_manifestPath), 2 * MANIFEST_RECORD_SIZE);
+    GrowingCrashStoredReportInfo info;
+    XCTAssertTrue(growingcrs_getReportInfo(reportID, &info));
+    XCTAssertEqual(info.uploadState, GrowingCrashReportUploadStateUploaded);
+    XCTAssertEqual(growingcrs_getReportCount(), 2);
+}
+
+- (void)testRebuildsMissingManifestFromDirectory
+{
+    int64_t first = addReport("{\"a\":1}");
+    int64_t second = addReport("{\"b\":2}");
+    XCTAssertEqual(unlink(g_manifestPath), 0);
+
+    initializeStore();
+    XCTAssertEqual(growingcrs_getReportCount(), 2);
+    int64_t reportIDs[2] = {0};
+    XCTAssertEqual(growingcrs_getReportIDs(reportIDs, 2), 2);
+    XCTAssertEqual(reportIDs[0], first);
+    XCTAssertEqual(reportIDs[1], second);
+    GrowingCrashStoredReportInfo info;
+    XCTAssertTrue(growingcrs_getReportInfo(first, &info));
+    XCTAssertEqual(info.size, 7);
+    XCTAssertEqual(fileSize(g_manifestPath), 2 * MANIFEST_RECORD_SIZE);
+
+    // A manifest removed while running is rebuilt on the next sync.
+    XCTAssertEqual(unlink(g_manifestPath), 0);
+    XCTAssertEqual(growingcrs_getReportCount(), 2);
+    XCTAssertEqual(fileSize(g_manifestPath), 2 * MANIFEST_RECORD_SIZE);
+}
+
+- (void)testRebuildsDamagedManifestFromDirectory
+{
+    addReport("{}");
+    addReport("{}");
+    addReport("{}");
+    int fd = open(g_manifestPath, O_WRONLY);
+    XCTAssertTrue(fd >= 0);
+    XCTAssertEqual(pwrite(fd, "garbage", 7, MANIFEST_RECORD_SIZE + 10), 7);
+    close(fd);
+
+    initializeStore();
+    XCTAssertEqual(growingcrs_getReportCount(), 3);
+
+    // Damage found while syncing also falls back to the directory.
+    XCTAssertTrue(appendToFile(g_manifestPath, "0123456789012345678901234567890123456789", MANIFEST_RECORD_SIZE));
+    XCTAssertEqual(growingcrs_getReportCount(), 3);
+    XCTAssertEqual(fileSize(g_manifestPath), 3 * MANIFEST_RECORD_SIZE);
+}
+
+- (void)testDeleteAllReports
+{
+    addReports(3);
+    growingcrs_deleteAllReports();
+    XCTAssertEqual(growingcrs_getReportCount(), 0);
+    XCTAssertEqual(countReportFiles(), 0);
+    addReport("{}");
+    XCTAssertEqual(growingcrs_getReportCount(), 1);
+}
+
+- (void)testPrunesOldestReportsAtInitialize
+{
+    addReports(8);
+    int64_t reportIDs[8] = {0};
+    XCTAssertEqual(growingcrs_getReportIDs(reportIDs, 8), 8);
+
+    growingcrs_setMaxReportCount(3);
+    initializeStore();
+    int64_t remaining[8] = {0};
+    XCTAssertEqual(growingcrs_getReportIDs(remaining, 8), 3);
+    XCTAssertEqual(remaining[0], reportIDs[5]);
+    XCTAssertEqual(remaining[2], reportIDs[7]);
+    XCTAssertEqual(countReportFiles(), 3);
+    XCTAssertEqual(fileSize(g_manifestPath), 3 * MANIFEST_RECORD_SIZE);
+}
+
+- (void)testListTenThousandReportsPerformance
+{
+    addReports(10000);
+    int64_t* reportIDs = malloc(sizeof(*reportIDs) * 10000);
+    [self measureBlock:^{
+        for(int i = 0; i < 100; i++)
+        {
+            XCTAssertEqual(growingcrs_getReportCount(), 10000);
+            XCTAssertEqual(growingcrs_getReportIDs(reportIDs, 10000), 10000);
+        }
+    }];
+    free(reportIDs);
+}
+
+- (void)testScanTenThousandReportFilesPerformance
+{
+    // The directory scan that listing used to do on every call, for comparison.
+    addReports(10000);
+    [self measureBlock:^{
+        for(int i = 0; i < 100; i++)
+        {
+            XCTAssertEqual(countReportFiles(), 10000);
+        }
+    }];
+}
+
+- (void)testInitializeWithTenThousandReportsPerformance
+{
+    addReports(10000);
+    [self measureBlock:^{
+        initializeStore();
+    }];
+    XCTAssertEqual(growingcrs_getReportCount(), 10000);
+}
+
+@end
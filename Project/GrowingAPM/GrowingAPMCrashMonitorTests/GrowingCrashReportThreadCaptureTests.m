@@ -0,0 +1,300 @@
+//
+//  GrowingCrashReportThreadCaptureTests.m
+//  GrowingAPMCrashMonitorTests
+//
+//  Created by YoloMao on 2022/10/8.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import "GrowingCrashReportThreadCapture.h"
+#import "GrowingCrashMachineContext.h"
+#import "GrowingCrashStackCursor_Backtrace.h"
+#import "GrowingCrashStackCursor_MachineContext.h"
+#import "GrowingCrashThread.h"
+
+#include <mach/mach.h>
+#include <pthread.h>
+#include <string.h>
+
+#define kWorkerThreadCount 8
+
+/** Each worker waits this many frames deeper than the one before it. */
+#define kWorkerDepthStep 7
+
+typedef struct
+{
+    pthread_t pthread;
+    GrowingCrashThread thread;
+    int depth;
+} Worker;
+
+/** What a capture found, recorded while every other thread was suspended and
+ * checked once they were resumed.
+ */
+typedef struct
+{
+    bool wasCaptured;
+    int threadCount;
+    int comparedCount;
+    int mismatchCount;
+    int workerFrameCounts[kWorkerThreadCount];
+} CaptureResult;
+
+static Worker g_workers[kWorkerThreadCount];
+static pthread_mutex_t g_workerMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_workerCondition = PTHREAD_COND_INITIALIZER;
+static int g_readyWorkerCount;
+static bool g_shouldStopWorkers;
+
+static int waitAtDepth(int depth);
+
+/** Called through a pointer so that the recursion stays real calls. */
+static int (*volatile g_waitAtDepth)(int) = waitAtDepth;
+
+static int waitAtDepth(int depth)
+{
+    if(depth > 0)
+    {
+        return g_waitAtDepth(depth - 1) + 1;
+    }
+    pthread_mutex_lock(&g_workerMutex);
+    g_readyWorkerCount++;
+    pthread_cond_broadcast(&g_workerCondition);
+    while(!g_shouldStopWorkers)
+    {
+        pthread_cond_wait(&g_workerCondition, &g_workerMutex);
+    }
+    pthread_mutex_unlock(&g_workerMutex);
+    return 0;
+}
+
+static void* runWorker(void* context)
+{
+    Worker* worker = (Worker*)context;
+    g_waitAtDepth(worker->depth);
+    return NULL;
+}
+
+static void startWorkers(void)
+{
+    g_readyWorkerCount = 0;
+    g_shouldStopWorkers = false;
+    for(int i = 0; i < kWorkerThreadCount; i++)
+    {
+        g_workers[i].depth = (i + 1) * kWorkerDepthStep;
+        pthread_create(&g_workers[i].pthread, NULL, runWorker, &g_workers[i]);
+        g_workers[i].thread = (GrowingCrashThread)pthread_mach_thread_np(g_workers[i].pthread);
+    }
+    pthread_mutex_lock(&g_workerMutex);
+    while(g_readyWorkerCount < kWorkerThreadCount)
+    {
+        pthread_cond_wait(&g_workerCondition, &g_workerMutex);
+    }
+    pthread_mutex_unlock(&g_workerMutex);
+}
+
+static void stopWorkers(void)
+{
+    pthread_mutex_lock(&g_workerMutex);
+    g_shouldStopWorkers = true;
+    pthread_cond_broadcast(&g_workerCondition);
+    pthread_mutex_unlock(&g_workerMutex);
+    for(int i = 0; i < kWorkerThreadCount; i++)
+    {
+        pthread_join(g_workers[i].pthread, NULL);
+    }
+}
+
+static void initCrash(GrowingCrash_MonitorContext* crash, struct GrowingCrashMachineContext* offendingContext)
+{
+    memset(crash, 0, sizeof(*crash));
+    growingcrashmc_getContextForThread(growingcrashthread_self(), offendingContext, true);
+    crash->offendingMachineContext = offendingContext;
+}
+
+/** Whether two cursors give the same addresses at the same depths. */
+static bool cursorsMatch(GrowingCrashStackCursor* live, GrowingCrashStackCursor* replay)
+{
+    for(;;)
+    {
+        bool liveAdvanced = live->advanceCursor(live);
+        bool replayAdvanced = replay->advanceCursor(replay);
+        if(liveAdvanced != replayAdvanced)
+        {
+            return false;
+        }
+        if(!liveAdvanced)
+        {
+            return true;
+        }
+        if(live->stackEntry.address != replay->stackEntry.address ||
+           live->state.currentDepth != replay->state.currentDepth)
+        {
+            return false;
+        }
+    }
+}
+
+/** Capture every thread, then walk each one again and compare. The other
+ * threads stay suspended throughout, so nothing here may allocate or log.
+ */
+static void captureAndCompare(CaptureResult* result)
+{
+    memset(result, 0, sizeof(*result));
+    thread_act_array_t suspendedThreads = NULL;
+    mach_msg_type_number_t suspendedThreadsCount = 0;
+    growingcrashmc_suspendEnvironment(&suspendedThreads, &suspendedThreadsCount);
+
+    GROWINGCRASHMC_NEW_CONTEXT(offendingContext);
+    GROWINGCRASHMC_NEW_CONTEXT(machineContext);
+    GrowingCrash_MonitorContext crash;
+    initCrash(&crash, offendingContext);
+    GrowingCrashThread offendingThread = growingcrashmc_getThreadFromContext(offendingContext);
+
+    const GrowingCrashCapturedThread* capturedThreads = growingcrtc_beginThreadCapture(&crash);
+    if(capturedThreads != NULL)
+    {
+        result->wasCaptured = true;
+        result->threadCount = growingcrashmc_getThreadCount(offendingContext);
+        for(int i = 0; i < result->threadCount; i++)
+        {
+            GrowingCrashThread thread = growingcrashmc_getThreadAtIndex(offendingContext, i);
+            if(thread == offendingThread)
+            {
+                continue;
+            }
+            growingcrashmc_getContextForThread(thread, machineContext, false);
+            GrowingCrashStackCursor live;
+            growingcrashsc_initWithMachineContext(&live, GROWINGCRASHSC_STACK_OVERFLOW_THRESHOLD, machineContext);
+            GrowingCrashStackCursor replay;
+            growingcrashsc_initWithBacktrace(&replay, capturedThreads[i].backtrace, capturedThreads[i].backtraceLength, 0);
+            result->comparedCount++;
+            if(!cursorsMatch(&live, &replay))
+            {
+                result->mismatchCount++;
+            }
+            for(int w = 0; w < kWorkerThreadCount; w++)
+            {
+                if(g_workers[w].thread == thread)
+                {
+                    result->workerFrameCounts[w] = capturedThreads[i].backtraceLength;
+                }
+            }
+        }
+        growingcrtc_endThreadCapture(&crash);
+    }
+
+    growingcrashmc_resumeEnvironment(suspendedThreads, suspendedThreadsCount);
+}
+
+@interface GrowingCrashReportThreadCaptureTests : XCTestCase
+
+@end
+
+@implementation GrowingCrashReportThreadCaptureTests
+
+- (void)setUp
+{
+    [super setUp];
+    growingcrtc_setCaptureThreadsBeforeWriting(true);
+    startWorkers();
+}
+
+- (void)tearDown
+{
+    stopWorkers();
+    growingcrtc_setCaptureThreadsBeforeWriting(false);
+    [super tearDown];
+}
+
+- (void)testReplayedBacktracesMatchLiveWalks
+{
+    CaptureResult result;
+    captureAndCompare(&result);
+
+    XCTAssertTrue(result.wasCaptured);
+    XCTAssertGreaterThan(result.threadCount, kWorkerThreadCount);
+    XCTAssertEqual(result.comparedCount, result.threadCount - 1);
+    XCTAssertEqual(result.mismatchCount, 0);
+    for(int i = 0; i < kWorkerThreadCount; i++)
+    {
+        XCTAssertGreaterThan(result.workerFrameCounts[i], g_workers[i].depth);
+        if(i > 0)
+        {
+            // The workers' stacks differ only in how deep they recursed.
+            XCTAssertEqual(result.workerFrameCounts[i] - result.workerFrameCounts[i - 1], kWorkerDepthStep);
+        }
+    }
+}
+
+- (void)testDisabledCaptureCapturesNothing
+{
+    growingcrtc_setCaptureThreadsBeforeWriting(false);
+    CaptureResult result;
+    captureAndCompare(&result);
+    XCTAssertFalse(result.wasCaptured);
+}
+
+- (void)testOnlyOneReportCapturesAtATime
+{
+    bool firstCaptured = false;
+    bool secondCapturedWhileHeld = false;
+    bool secondCapturedAfterRelease = false;
+
+    thread_act_array_t suspendedThreads = NULL;
+    mach_msg_type_number_t suspendedThreadsCount = 0;
+    growingcrashmc_suspendEnvironment(&suspendedThreads, &suspendedThreadsCount);
+    {
+        GROWINGCRASHMC_NEW_CONTEXT(offendingContext);
+        GrowingCrash_MonitorContext first;
+        GrowingCrash_MonitorContext second;
+        initCrash(&first, offendingContext);
+        initCrash(&second, offendingContext);
+
+        firstCaptured = growingcrtc_beginThreadCapture(&first) != NULL;
+        secondCapturedWhileHeld = growingcrtc_beginThreadCapture(&second) != NULL;
+        // Only the report that holds the capture can release it.
+        growingcrtc_endThreadCapture(&second);
+        secondCapturedWhileHeld |= growingcrtc_beginThreadCapture(&second) != NULL;
+        growingcrtc_endThreadCapture(&first);
+        secondCapturedAfterRelease = growingcrtc_beginThreadCapture(&second) != NULL;
+        growingcrtc_endThreadCapture(&second);
+    }
+    growingcrashmc_resumeEnvironment(suspendedThreads, suspendedThreadsCount);
+
+    XCTAssertTrue(firstCaptured);
+    XCTAssertFalse(secondCapturedWhileHeld);
+    XCTAssertTrue(secondCapturedAfterRelease);
+}
+
+- (void)testCaptureThreadsPerformance
+{
+    [self measureBlock:^{
+        thread_act_array_t suspendedThreads = NULL;
+        mach_msg_type_number_t suspendedThreadsCount = 0;
+        growingcrashmc_suspendEnvironment(&suspendedThreads, &suspendedThreadsCount);
+        {
+            GROWINGCRASHMC_NEW_CONTEXT(offendingContext);
+            GrowingCrash_MonitorContext crash;
+            initCrash(&crash, offendingContext);
+            growingcrtc_beginThreadCapture(&crash);
+            growingcrtc_endThreadCapture(&crash);
+        }
+        growingcrashmc_resumeEnvironment(suspendedThreads, suspendedThreadsCount);
+    }];
+}
+
+@end
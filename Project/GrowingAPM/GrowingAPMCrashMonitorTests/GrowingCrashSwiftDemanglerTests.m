@@ -0,0 +1,250 @@
+//
+//  GrowingCrashSwiftDemanglerTests.m
+//  GrowingAPMCrashMonitorTests
+//
+//  Created by YoloMao on 2022/10/8.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import "GrowingCrashDemangle_Swift.h"
+
+#include <malloc/malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Symbols as they show up in backtraces, including ones that don't demangle. */
+static const char* const g_symbols[] =
+{
+    "$s4main3FooC3baryyF",
+    "$s4main3FooC3baryySiF",
+    "_$s4main11AppDelegateC11application_29didFinishLaunchingWithOptionsSbSo13UIApplicationC_SDySo0j6LaunchI3KeyaypGSgtF",
+    "$sSa6appendyyxnF",
+    "$s10Foundation4DataV6appendyyACF",
+    "$s4main6ParserV5parse_7optionsSayAA4NodeVGSS_AA7OptionsVtKF",
+    "$sSS5countSivg",
+    "$s4main4TreeC6insert_2atyx_SaySiGtFSi_Tg5",
+    "$sSo8NSStringC10FoundationE12stringFromIDAByXlSg_tcfCTf4nd_n",
+    "$s4main3FooC3baryyFyycfU_yycfU0_",
+    "$s4main3FooCACycfC",
+    "$s4main3FooCfD",
+    "$s4main3FooC3bar33_0123456789ABCDEF0123456789ABCDEFLLyyF",
+    "$s4main1SVAA1PA2aDP1fyyFTW",
+    "$s4main3FooC3baryyFTo",
+    "_TFC4main3Foo3barfT_T_",
+    "notaswiftsymbol",
+    "-[NSObject description]",
+    "",
+};
+
+#define kSymbolCount ((int)(sizeof(g_symbols) / sizeof(*g_symbols)))
+
+/** Longer than any of the symbols demangles to. */
+#define kBufferLength 1024
+
+static size_t memoryInUse(void)
+{
+    malloc_statistics_t stats;
+    malloc_zone_statistics(NULL, &stats);
+    return stats.size_in_use;
+}
+
+@interface GrowingCrashSwiftDemanglerTests : XCTestCase
+
+@end
+
+@implementation GrowingCrashSwiftDemanglerTests
+
+- (void)testReusedDemanglerMatchesDemangleSwift
+{
+    GrowingCrashSwiftDemangler* demangler = growingcrashdm_createSwiftDemangler();
+    XCTAssertTrue(demangler != NULL);
+    char buffer[kBufferLength];
+    // Several rounds, so that each symbol follows a different one.
+    for(int round = 0; round < 3; round++)
+    {
+        for(int i = 0; i < kSymbolCount; i++)
+        {
+            const char* symbol = g_symbols[(i * (round + 1)) % kSymbolCount];
+            char* expected = growingcrashdm_demangleSwift(symbol);
+            int length = growingcrashdm_demangleSwiftWith(demangler, symbol, buffer, sizeof(buffer));
+            // growingcrashdm_demangleSwift() gives back symbols that don't demangle.
+            if(expected == NULL || strcmp(expected, symbol) == 0)
+            {
+                XCTAssertEqual(length, 0, @"%s", symbol);
+                XCTAssertEqual(buffer[0], '\0', @"%s", symbol);
+            }
+            else
+            {
+                XCTAssertEqual(length, (int)strlen(expected), @"%s", symbol);
+                XCTAssertTrue(strcmp(buffer, expected) == 0, @"%s: %s != %s", symbol, buffer, expected);
+            }
+            free(expected);
+        }
+    }
+    growingcrashdm_destroySwiftDemangler(demangler);
+}
+
+- (void)testTruncatesToBuffer
+{
+    GrowingCrashSwiftDemangler* demangler = growingcrashdm_createSwiftDemangler();
+    const char* symbol = g_symbols[2];
+    char* expected = growingcrashdm_demangleSwift(symbol);
+    int expectedLength = (int)strlen(expected);
+
+    // A zero length buffer only measures, and isn't written to.
+    char untouched = 'x';
+    XCTAssertEqual(growingcrashdm_demangleSwiftWith(demangler, symbol, &untouched, 0), expectedLength);
+    XCTAssertEqual(untouched, 'x');
+    XCTAssertEqual(growingcrashdm_demangleSwiftWith(demangler, symbol, NULL, 0), expectedLength);
+
+    for(int bufferLength = 1; bufferLength <= expectedLength + 2; bufferLength++)
+    {
+        char buffer[kBufferLength];
+        memset(buffer, 'x', sizeof(buffer));
+        int length = growingcrashdm_demangleSwiftWith(demangler, symbol, buffer, bufferLength);
+        XCTAssertEqual(length, expectedLength, @"%d", bufferLength);
+        int written = bufferLength - 1 < expectedLength ? bufferLength - 1 : expectedLength;
+        XCTAssertEqual(buffer[written], '\0', @"%d", bufferLength);
+        XCTAssertEqual(buffer[bufferLength], 'x', @"%d", bufferLength);
+        XCTAssertTrue(strncmp(buffer, expected, (size_t)written) == 0, @"%d: %s", bufferLength, buffer);
+    }
+    free(expected);
+    growingcrashdm_destroySwiftDemangler(demangler);
+}
+
+- (void)testFailedDemangleEmptiesBuffer
+{
+    GrowingCrashSwiftDemangler* demangler = growingcrashdm_createSwiftDemangler();
+    char buffer[kBufferLength] = "stale";
+    XCTAssertEqual(growingcrashdm_demangleSwiftWith(demangler, "notaswiftsymbol", buffer, sizeof(buffer)), 0);
+    XCTAssertEqual(buffer[0], '\0');
+    strcpy(buffer, "stale");
+    XCTAssertEqual(growingcrashdm_demangleSwiftWith(demangler, "$s4mai", buffer, sizeof(buffer)), 0);
+    XCTAssertEqual(buffer[0], '\0');
+    growingcrashdm_destroySwiftDemangler(demangler);
+}
+
+- (void)testClearingBetweenSymbolsKeepsMemoryFlat
+{
+    GrowingCrashSwiftDemangler* demangler = growingcrashdm_createSwiftDemangler();
+    char buffer[kBufferLength];
+    // Let the node memory grow to its largest slab first.
+    for(int i = 0; i < kSymbolCount; i++)
+    {
+        growingcrashdm_demangleSwiftWith(demangler, g_symbols[i], buffer, sizeof(buffer));
+    }
+    size_t before = memoryInUse();
+    for(int round = 0; round < 2000; round++)
+    {
+        for(int i = 0; i < kSymbolCount; i++)
+        {
+            growingcrashdm_demangleSwiftWith(demangler, g_symbols[i], buffer, sizeof(buffer));
+        }
+    }
+    size_t after = memoryInUse();
+    // Keeping the nodes of every symbol would take tens of megabytes.
+    XCTAssertLessThan(after, before + 64 * 1024, @"%zu -> %zu", before, after);
+    growingcrashdm_destroySwiftDemangler(demangler);
+}
+
+- (void)testArenaDemanglerMatchesHeapDemangler
+{
+    GrowingCrashSwiftDemangler* heap = growingcrashdm_createSwiftDemangler();
+    GrowingCrashSwiftDemangler* arena = growingcrashdm_createSwiftArenaDemangler(32 * 1024);
+    XCTAssertTrue(arena != NULL);
+    char expected[kBufferLength];
+    char buffer[kBufferLength];
+    for(int i = 0; i < kSymbolCount; i++)
+    {
+        int expectedLength = growingcrashdm_demangleSwiftWith(heap, g_symbols[i], expected, sizeof(expected));
+        int length = growingcrashdm_demangleSwiftWith(arena, g_symbols[i], buffer, sizeof(buffer));
+        if(g_symbols[i][0] == '_' && g_symbols[i][1] == 'T')
+        {
+            // Old style manglings need the heap.
+            XCTAssertEqual(length, 0, @"%s", g_symbols[i]);
+            continue;
+        }
+        XCTAssertEqual(length, expectedLength, @"%s", g_symbols[i]);
+        XCTAssertTrue(strcmp(buffer, expected) == 0, @"%s: %s != %s", g_symbols[i], buffer, expected);
+    }
+    growingcrashdm_destroySwiftDemangler(arena);
+    growingcrashdm_destroySwiftDemangler(heap);
+}
+
+- (void)testArenaIsReusedBetweenSymbols
+{
+    // Room for any one symbol, but nowhere near enough for all of them at once.
+    GrowingCrashSwiftDemangler* arena = growingcrashdm_createSwiftArenaDemangler(8 * 1024);
+    char buffer[kBufferLength];
+    for(int round = 0; round < 1000; round++)
+    {
+        int length = growingcrashdm_demangleSwiftWith(arena, g_symbols[2], buffer, sizeof(buffer));
+        XCTAssertGreaterThan(length, 0, @"round %d", round);
+        if(length == 0)
+        {
+            break;
+        }
+    }
+    growingcrashdm_destroySwiftDemangler(arena);
+}
+
+- (void)testExhaustedArenaFailsAndRecovers
+{
+    // Too small for the long selector symbol, big enough for a short one.
+    GrowingCrashSwiftDemangler* arena = growingcrashdm_createSwiftArenaDemangler(2 * 1024);
+    char buffer[kBufferLength] = "stale";
+    XCTAssertEqual(growingcrashdm_demangleSwiftWith(arena, g_symbols[2], buffer, sizeof(buffer)), 0);
+    XCTAssertEqual(buffer[0], '\0');
+    // The arena is empty again for the next symbol.
+    XCTAssertEqual(growingcrashdm_demangleSwiftWith(arena, "$s4main3fooyyF", buffer, sizeof(buffer)), 5);
+    XCTAssertTrue(strcmp(buffer, "foo()") == 0, @"%s", buffer);
+    growingcrashdm_destroySwiftDemangler(arena);
+
+    XCTAssertTrue(growingcrashdm_createSwiftArenaDemangler(0) == NULL);
+    growingcrashdm_destroySwiftDemangler(NULL);
+}
+
+- (void)testDemangleSwiftPerformance
+{
+    [self measureBlock:^{
+        for(int round = 0; round < 200; round++)
+        {
+            for(int i = 0; i < kSymbolCount; i++)
+            {
+                free(growingcrashdm_demangleSwift(g_symbols[i]));
+            }
+        }
+    }];
+}
+
+- (void)testReusedDemanglerPerformance
+{
+    GrowingCrashSwiftDemangler* demangler = growingcrashdm_createSwiftDemangler();
+    [self measureBlock:^{
+        char buffer[kBufferLength];
+        for(int round = 0; round < 200; round++)
+        {
+            for(int i = 0; i < kSymbolCount; i++)
+            {
+                growingcrashdm_demangleSwiftWith(demangler, g_symbols[i], buffer, sizeof(buffer));
+            }
+        }
+    }];
+    growingcrashdm_destroySwiftDemangler(demangler);
+}
+
+@end
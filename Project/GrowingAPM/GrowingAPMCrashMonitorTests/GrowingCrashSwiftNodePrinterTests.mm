@@ -0,0 +1,219 @@
+//
+//  GrowingCrashSwiftNodePrinterTests.mm
+//  GrowingAPMCrashMonitorTests
+//
+//  Created by YoloMao on 2022/10/8.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#include "Demangle.h"
+
+#include <string>
+#include <vector>
+
+using namespace swift::Demangle;
+
+/** Symbols as they show up in backtraces. */
+static const char* const g_symbols[] =
+{
+    "$s4main3FooC3baryyF",
+    "$s4main3FooC3baryySiF",
+    "$s4main11AppDelegateC11application_29didFinishLaunchingWithOptionsSbSo13UIApplicationC_SDySo0j6LaunchI3KeyaypGSgtF",
+    "$sSa6appendyyxnF",
+    "$s10Foundation4DataV6appendyyACF",
+    "$s4main6ParserV5parse_7optionsSayAA4NodeVGSS_AA7OptionsVtKF",
+    "$sSS5countSivg",
+    "$s4main4TreeC6insert_2atyx_SaySiGtFSi_Tg5",
+    "$sSo8NSStringC10FoundationE12stringFromIDAByXlSg_tcfCTf4nd_n",
+    "$s4main3FooC3baryyFyycfU_yycfU0_",
+    "$s4main3FooCACycfC",
+    "$s4main3FooCfD",
+    "$s4main3FooC3bar33_0123456789ABCDEF0123456789ABCDEFLLyyF",
+    "$s4main1SVAA1PA2aDP1fyyFTW",
+    "$s4main3FooC3baryyFTo",
+    "$s4main3FooCMa",
+    "$s4main3FooC5countSivM",
+    "$s4main3FooV1poiyA2C_ACtFZ",
+    "_TFC4main3Foo3barfT_T_",
+};
+
+#define kSymbolCount ((int)(sizeof(g_symbols) / sizeof(*g_symbols)))
+
+static const DemangleOptions g_options[] =
+{
+    DemangleOptions(),
+    DemangleOptions::SimplifiedUIDemangleOptions(),
+};
+
+#define kOptionsCount ((int)(sizeof(g_options) / sizeof(*g_options)))
+
+/** Canary byte for checking that nothing is written past the buffer. */
+#define kGuard ((char)0x5a)
+
+/** Print into a buffer of exactly bufferSize bytes, followed by guard bytes.
+ * isIntact is set to false if the result isn't terminated inside the buffer,
+ * or if anything was written past it.
+ */
+static size_t printToBuffer(NodePointer root, size_t bufferSize, const DemangleOptions& options, std::string& printed, bool& isIntact)
+{
+    std::vector<char> buffer(bufferSize + 8, kGuard);
+    size_t length = nodeToBuffer(root, buffer.data(), bufferSize, options);
+    isIntact = true;
+    for(size_t i = bufferSize; i < buffer.size(); i++)
+    {
+        isIntact = isIntact && buffer[i] == kGuard;
+    }
+    printed.assign(buffer.data(), bufferSize > 0 ? strnlen(buffer.data(), bufferSize) : 0);
+    if(bufferSize > 0 && printed.size() == bufferSize)
+    {
+        isIntact = false;
+    }
+    return length;
+}
+
+@interface GrowingCrashSwiftNodePrinterTests : XCTestCase
+
+@end
+
+@implementation GrowingCrashSwiftNodePrinterTests
+
+- (void)testMatchesNodeToString
+{
+    Context context;
+    for(int i = 0; i < kSymbolCount; i++)
+    {
+        NodePointer root = context.demangleSymbolAsNode(g_symbols[i]);
+        XCTAssertTrue(root != NULL, @"%s", g_symbols[i]);
+        for(int j = 0; j < kOptionsCount; j++)
+        {
+            std::string expected = nodeToString(root, g_options[j]);
+            std::string printed;
+            bool isIntact;
+            size_t length = printToBuffer(root, 4096, g_options[j], printed, isIntact);
+            XCTAssertTrue(isIntact, @"%s", g_symbols[i]);
+            XCTAssertEqual(length, expected.size(), @"%s", g_symbols[i]);
+            XCTAssertTrue(printed == expected, @"%s: %s != %s", g_symbols[i], printed.c_str(), expected.c_str());
+        }
+    }
+}
+
+- (void)testExactlySizedBuffer
+{
+    Context context;
+    for(int i = 0; i < kSymbolCount; i++)
+    {
+        NodePointer root = context.demangleSymbolAsNode(g_symbols[i]);
+        std::string expected = nodeToString(root);
+        std::string printed;
+        bool isIntact;
+        size_t length = printToBuffer(root, expected.size() + 1, DemangleOptions(), printed, isIntact);
+        XCTAssertTrue(isIntact, @"%s", g_symbols[i]);
+        XCTAssertEqual(length, expected.size(), @"%s", g_symbols[i]);
+        XCTAssertTrue(printed == expected, @"%s: %s != %s", g_symbols[i], printed.c_str(), expected.c_str());
+    }
+}
+
+- (void)testTruncatesTooSmallBuffer
+{
+    Context context;
+    for(int i = 0; i < kSymbolCount; i++)
+    {
+        NodePointer root = context.demangleSymbolAsNode(g_symbols[i]);
+        std::string expected = nodeToString(root);
+        // One byte short, down to a buffer with only room for the terminator.
+        for(size_t bufferSize = expected.size(); bufferSize > 0; bufferSize--)
+        {
+            std::string printed;
+            bool isIntact;
+            size_t length = printToBuffer(root, bufferSize, DemangleOptions(), printed, isIntact);
+            XCTAssertTrue(isIntact, @"%s in %zu bytes", g_symbols[i], bufferSize);
+            XCTAssertEqual(length, expected.size(), @"%s in %zu bytes", g_symbols[i], bufferSize);
+            XCTAssertTrue(printed == expected.substr(0, bufferSize - 1), @"%s in %zu bytes: %s", g_symbols[i], bufferSize, printed.c_str());
+        }
+    }
+}
+
+- (void)testZeroSizedBufferMeasures
+{
+    Context context;
+    for(int i = 0; i < kSymbolCount; i++)
+    {
+        NodePointer root = context.demangleSymbolAsNode(g_symbols[i]);
+        std::string expected = nodeToString(root);
+        std::string printed;
+        bool isIntact;
+        XCTAssertEqual(printToBuffer(root, 0, DemangleOptions(), printed, isIntact), expected.size(), @"%s", g_symbols[i]);
+        XCTAssertTrue(isIntact, @"%s", g_symbols[i]);
+        XCTAssertEqual(nodeToBuffer(root, NULL, 0), expected.size(), @"%s", g_symbols[i]);
+    }
+}
+
+- (void)testNullRootEmptiesBuffer
+{
+    std::string printed = "stale";
+    bool isIntact;
+    XCTAssertEqual(printToBuffer(NULL, 16, DemangleOptions(), printed, isIntact), (size_t)0);
+    XCTAssertTrue(isIntact);
+    XCTAssertEqual(printed.size(), (size_t)0);
+    XCTAssertEqual(printToBuffer(NULL, 0, DemangleOptions(), printed, isIntact), (size_t)0);
+    XCTAssertTrue(isIntact);
+    XCTAssertEqual(nodeToBuffer(NULL, NULL, 0), (size_t)0);
+}
+
+- (void)testNodeToBufferPerformance
+{
+    Context context;
+    std::vector<NodePointer> roots;
+    for(int i = 0; i < kSymbolCount; i++)
+    {
+        roots.push_back(context.demangleSymbolAsNode(g_symbols[i]));
+    }
+    [self measureBlock:^{
+        char buffer[1024];
+        size_t total = 0;
+        for(int pass = 0; pass < 1000; pass++)
+        {
+            for(NodePointer root : roots)
+            {
+                total += nodeToBuffer(root, buffer, sizeof(buffer));
+            }
+        }
+        XCTAssertGreaterThan(total, (size_t)0);
+    }];
+}
+
+- (void)testNodeToStringPerformance
+{
+    Context context;
+    std::vector<NodePointer> roots;
+    for(int i = 0; i < kSymbolCount; i++)
+    {
+        roots.push_back(context.demangleSymbolAsNode(g_symbols[i]));
+    }
+    [self measureBlock:^{
+        size_t total = 0;
+        for(int pass = 0; pass < 1000; pass++)
+        {
+            for(NodePointer root : roots)
+            {
+                total += nodeToString(root).size();
+            }
+        }
+        XCTAssertGreaterThan(total, (size_t)0);
+    }];
+}
+
+@end
@@ -0,0 +1,174 @@
+//
+//  GrowingCrashSwiftSignatureKeyTests.mm
+//  GrowingAPMCrashMonitorTests
+//
+//  Created by YoloMao on 2022/10/8.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#include "Demangle.h"
+#include "Demangler.h"
+
+#include <string>
+
+using namespace swift::Demangle;
+
+typedef struct
+{
+    const char* symbol;
+    /** NULL if the symbol has no entity to make a key for. */
+    const char* key;
+} SymbolKey;
+
+static const SymbolKey g_keys[] =
+{
+    // Functions and methods.
+    {"$s4main3fooyyF", "main.foo"},
+    {"$s4main3FooC3baryyF", "main.Foo.bar"},
+    {"$s4main3FooC3baryySiF", "main.Foo.bar"},
+    {"$s4main3FooV1poiyA2C_ACtFZ", "main.Foo.+"},
+    {"$s4main1PPAAE3baryyF", "main.P.bar"},
+    {"$sSo8NSObjectC4mainE3fooyyF", "__C.NSObject.foo"},
+    {"$s4main3FooC3bar33_0123456789ABCDEF0123456789ABCDEFLLyyF", "main.Foo.bar"},
+    // Accessors.
+    {"$s4main5countSivg", "main.count.getter"},
+    {"$sSS5countSivg", "Swift.String.count.getter"},
+    {"$s4main3FooC5countSivs", "main.Foo.count.setter"},
+    {"$s4main3FooC5countSivw", "main.Foo.count.willset"},
+    {"$s4main3FooC5countSivW", "main.Foo.count.didset"},
+    {"$s4main3FooC5countSivr", "main.Foo.count.read"},
+    {"$s4main3FooC5countSivM", "main.Foo.count.modify"},
+    {"$s4main3FooCyS2icig", "main.Foo.subscript.getter"},
+    // Initializers and deinitializers.
+    {"$s4main3FooCACycfC", "main.Foo.init"},
+    {"$s4main3FooCACycfc", "main.Foo.init"},
+    {"$s4main3FooCfD", "main.Foo.deinit"},
+    {"$s4main3FooCfd", "main.Foo.deinit"},
+    // Closures and local functions.
+    {"$s4main3FooC3baryyFyycfU_", "main.Foo.bar.closure"},
+    {"$s4main3FooC3baryyFyycfU_yycfU0_", "main.Foo.bar.closure.closure"},
+    {"$s4main3FooC3baryyF6helperL_yyF", "main.Foo.bar.helper"},
+    // Specializations.
+    {"$s4main4TreeC6insert_2atyx_SaySiGtFSi_Tg5", "main.Tree.insert"},
+    {"$sSa6appendyyxnFSi_Tg5", "Swift.Array.append"},
+    {"$s4main3FooV3baryyFTf4n_n", "main.Foo.bar"},
+    // Protocol witnesses.
+    {"$s4main1SVAA1PA2aDP1fyyFTW", "main.P.f"},
+    {"$s4main3FooCAA1PA2aDP5countSivgTW", "main.P.count.getter"},
+    // Thunks.
+    {"$s4main3FooC3baryyFTo", "main.Foo.bar"},
+    {"$s4main3FooC3baryyFTj", "main.Foo.bar"},
+    {"$s4main3FooC3baryyFTc", "main.Foo.bar"},
+    // No entity.
+    {"$s4main3FooCMa", NULL},
+    {"$s4main3FooCN", NULL},
+    {"$sSiN", NULL},
+    {"$s4main3FooC3baryyFTq", NULL},
+    {"notaswiftsymbol", NULL},
+    {"", NULL},
+};
+
+#define kKeyCount ((int)(sizeof(g_keys) / sizeof(*g_keys)))
+
+@interface GrowingCrashSwiftSignatureKeyTests : XCTestCase
+
+@end
+
+@implementation GrowingCrashSwiftSignatureKeyTests
+
+- (void)testKeys
+{
+    Context context;
+    for(int i = 0; i < kKeyCount; i++)
+    {
+        char buffer[256] = "stale";
+        size_t length = context.demangleSymbolAsSignatureKey(g_keys[i].symbol, buffer, sizeof(buffer));
+        const char* expected = g_keys[i].key != NULL ? g_keys[i].key : "";
+        XCTAssertEqual(length, strlen(expected), @"%s", g_keys[i].symbol);
+        XCTAssertTrue(strcmp(buffer, expected) == 0, @"%s: %s != %s", g_keys[i].symbol, buffer, expected);
+        context.clear();
+    }
+}
+
+- (void)testKeyMatchesNodeKey
+{
+    Context context;
+    for(int i = 0; i < kKeyCount; i++)
+    {
+        char expected[256];
+        char buffer[256];
+        size_t expectedLength = context.demangleSymbolAsSignatureKey(g_keys[i].symbol, expected, sizeof(expected));
+        NodePointer root = context.demangleSymbolAsNode(g_keys[i].symbol);
+        XCTAssertEqual(nodeToSignatureKey(root, buffer, sizeof(buffer)), expectedLength, @"%s", g_keys[i].symbol);
+        XCTAssertTrue(strcmp(buffer, expected) == 0, @"%s: %s != %s", g_keys[i].symbol, buffer, expected);
+        context.clear();
+    }
+}
+
+- (void)testTruncatesTooSmallBuffer
+{
+    Context context;
+    for(int i = 0; i < kKeyCount; i++)
+    {
+        if(g_keys[i].key == NULL)
+        {
+            continue;
+        }
+        std::string expected = g_keys[i].key;
+        for(size_t bufferSize = expected.size() + 1; bufferSize > 0; bufferSize--)
+        {
+            char buffer[256];
+            memset(buffer, 'x', sizeof(buffer));
+            size_t length = context.demangleSymbolAsSignatureKey(g_keys[i].symbol, buffer, bufferSize);
+            XCTAssertEqual(length, expected.size(), @"%s in %zu bytes", g_keys[i].symbol, bufferSize);
+            XCTAssertTrue(expected.compare(0, bufferSize - 1, buffer) == 0, @"%s in %zu bytes: %s", g_keys[i].symbol, bufferSize, buffer);
+            XCTAssertEqual(buffer[bufferSize], 'x', @"%s in %zu bytes", g_keys[i].symbol, bufferSize);
+            context.clear();
+        }
+        XCTAssertEqual(context.demangleSymbolAsSignatureKey(g_keys[i].symbol, NULL, 0), expected.size(), @"%s", g_keys[i].symbol);
+        context.clear();
+    }
+}
+
+- (void)testSkipsPartlyPrintedEntity
+{
+    // The first function's context prints before its name turns out to be
+    // unusable, so the key has to start over for the second one.
+    NodeFactory factory;
+    NodePointer root = factory.createNode(Node::Kind::Global);
+    NodePointer unnamed = factory.createNode(Node::Kind::Function);
+    unnamed->addChild(factory.createNode(Node::Kind::Module, "main"), factory);
+    unnamed->addChild(factory.createNode(Node::Kind::Number, (Node::IndexType)3), factory);
+    root->addChild(unnamed, factory);
+    NodePointer named = factory.createNode(Node::Kind::Function);
+    named->addChild(factory.createNode(Node::Kind::Module, "main"), factory);
+    named->addChild(factory.createNode(Node::Kind::Identifier, "foo"), factory);
+    root->addChild(named, factory);
+
+    char buffer[64];
+    XCTAssertEqual(nodeToSignatureKey(root, buffer, sizeof(buffer)), strlen("main.foo"));
+    XCTAssertTrue(strcmp(buffer, "main.foo") == 0, @"%s", buffer);
+}
+
+- (void)testNullRootHasNoKey
+{
+    char buffer[16] = "stale";
+    XCTAssertEqual(nodeToSignatureKey(NULL, buffer, sizeof(buffer)), (size_t)0);
+    XCTAssertEqual(buffer[0], '\0');
+    XCTAssertEqual(nodeToSignatureKey(NULL, NULL, 0), (size_t)0);
+}
+
+@end
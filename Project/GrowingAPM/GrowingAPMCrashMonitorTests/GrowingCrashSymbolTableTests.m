@@ -0,0 +1,355 @@
+//
+//  GrowingCrashSymbolTableTests.m
+//  GrowingAPMCrashMonitorTests
+//
+//  Created by YoloMao on 2022/10/8.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+#import <XCTest/XCTest.h>
+
+#import "GrowingCrashSymbolTable.h"
+#import "GrowingCrashPlatformSpecificDefines.h"
+
+#include <mach-o/nlist.h>
+#include <mach-o/stab.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __LP64__
+#define kMagic MH_MAGIC_64
+#else
+#define kMagic MH_MAGIC
+#endif
+
+#define kTextStart ((uintptr_t)0x10000)
+#define kTextSize ((uintptr_t)0x8000)
+
+#define kGeneratedSymbolCount 2000
+
+#define SEGMENT(NAME, VMADDR, VMSIZE) \
+    {LC_SEGMENT_ARCH_DEPENDENT, sizeof(segment_command_t), NAME, VMADDR, VMSIZE, 0, VMSIZE, 5, 5, 0, 0}
+#define SYMTAB(FIXTURE, SYMBOL_COUNT) \
+    {LC_SYMTAB, sizeof(struct symtab_command), offsetof(FIXTURE, symbols), SYMBOL_COUNT, \
+     offsetof(FIXTURE, strings), sizeof(((FIXTURE*)0)->strings)}
+#define NAME(FIELD) offsetof(SymbolNames, FIELD)
+#define SYMBOL(NAME_OFFSET, TYPE, DESC, VALUE) {{NAME_OFFSET}, TYPE, 1, DESC, VALUE}
+
+// ============================================================================
+#pragma mark - Fixtures -
+// ============================================================================
+
+/** A string table, laid out field by field so that symbols can refer to
+ * names by offset.
+ */
+typedef struct
+{
+    char empty[1];
+    char start[7];
+    char helper[8];
+    char debugHelper[13];
+    char aliasFirst[13];
+    char aliasLast[12];
+    char printf[8];
+    char localLabel[6];
+    char last[6];
+} SymbolNames;
+
+static const SymbolNames kSymbolNames = {
+    "", "_start", "_helper", "_helper.cold", "_alias_first", "_alias_last", "_printf", "ltmp0", "_last",
+};
+
+#define kFixtureSymbolCount 8
+
+/** A Mach-O file as it is laid out on disk, with its symbol and string
+ * tables following the load commands.
+ */
+typedef struct
+{
+    mach_header_t header;
+    segment_command_t text;
+    segment_command_t linkedit;
+    struct symtab_command symtab;
+    nlist_t symbols[kFixtureSymbolCount];
+    SymbolNames strings;
+} SymbolImage;
+
+#define SYMBOL_IMAGE(DESC) { \
+    {kMagic, 0, 0, MH_EXECUTE, 3, offsetof(SymbolImage, symbols) - sizeof(mach_header_t)}, \
+    SEGMENT("__TEXT", kTextStart, kTextSize), \
+    SEGMENT("__LINKEDIT", kTextStart + kTextSize, sizeof(SymbolImage)), \
+    SYMTAB(SymbolImage, kFixtureSymbolCount), \
+    { \
+        SYMBOL(NAME(start), N_SECT | N_EXT, DESC, kTextStart + 0x1000), \
+        SYMBOL(NAME(helper), N_SECT | N_EXT, DESC, kTextStart + 0x1100), \
+        SYMBOL(NAME(debugHelper), N_FUN, 0, kTextStart + 0x1180), \
+        SYMBOL(NAME(aliasFirst), N_SECT | N_EXT, DESC, kTextStart + 0x1200), \
+        SYMBOL(NAME(printf), N_UNDF | N_EXT, 0, 0), \
+        SYMBOL(NAME(aliasLast), N_SECT | N_EXT, DESC, kTextStart + 0x1200), \
+        SYMBOL(NAME(localLabel), N_SECT, DESC, kTextStart + 0x1300), \
+        SYMBOL(NAME(last), N_SECT | N_EXT, DESC, kTextStart + 0x1400), \
+    }, \
+    kSymbolNames, \
+}
+
+static SymbolImage g_image = SYMBOL_IMAGE(0);
+
+/** The same image with its symbols stripped. */
+static SymbolImage g_strippedImage = SYMBOL_IMAGE(16);
+
+/** An image that has two symbol tables, which a scan would search in order. */
+typedef struct
+{
+    mach_header_t header;
+    struct symtab_command symtab;
+    struct symtab_command otherSymtab;
+    nlist_t symbols[1];
+    SymbolNames strings;
+} TwoSymtabImage;
+
+static TwoSymtabImage g_twoSymtabImage = {
+    {kMagic, 0, 0, MH_EXECUTE, 2, 2 * sizeof(struct symtab_command)},
+    SYMTAB(TwoSymtabImage, 1),
+    SYMTAB(TwoSymtabImage, 1),
+    {SYMBOL(NAME(start), N_SECT | N_EXT, 0, kTextStart)},
+    kSymbolNames,
+};
+
+/** An image whose only symbols are undefined. */
+typedef struct
+{
+    mach_header_t header;
+    struct symtab_command symtab;
+    nlist_t symbols[1];
+    SymbolNames strings;
+} UndefinedImage;
+
+static UndefinedImage g_undefinedImage = {
+    {kMagic, 0, 0, MH_EXECUTE, 1, sizeof(struct symtab_command)},
+    SYMTAB(UndefinedImage, 1),
+    {SYMBOL(NAME(printf), N_UNDF | N_EXT, 0, 0)},
+    kSymbolNames,
+};
+
+typedef struct
+{
+    mach_header_t header;
+    segment_command_t text;
+} NoSymtabImage;
+
+static NoSymtabImage g_noSymtabImage = {
+    {kMagic, 0, 0, MH_EXECUTE, 1, sizeof(segment_command_t)},
+    SEGMENT("__TEXT", kTextStart, kTextSize),
+};
+
+static GrowingCrashSymbolTable* createTable(const void* image)
+{
+    return growingcrashst_create((const struct mach_header*)image, (uintptr_t)image);
+}
+
+/** Look up an address, returning the symbol name or "" if there is none. */
+static const char* symbolNameAt(const GrowingCrashSymbolTable* table, uintptr_t address, uintptr_t* symbolAddress)
+{
+    const char* symbolName = NULL;
+    *symbolAddress = 0;
+    if(!growingcrashst_lookup(table, address, symbolAddress, &symbolName))
+    {
+        return NULL;
+    }
+    return symbolName == NULL ? "" : symbolName;
+}
+
+/** Find the nearest symbol the way growingcrashdl_dladdr() does without a
+ * table: the last of the closest symbols at or before the address.
+ */
+static const nlist_t* scanForSymbol(const nlist_t* symbols, uint32_t count, uintptr_t address)
+{
+    const nlist_t* best = NULL;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        const nlist_t* symbol = &symbols[i];
+        if((symbol->n_type & N_STAB) == 0 && symbol->n_value != 0 && symbol->n_value <= address &&
+           (best == NULL || symbol->n_value >= best->n_value))
+        {
+            best = symbol;
+        }
+    }
+    return best;
+}
+
+@interface GrowingCrashSymbolTableTests : XCTestCase
+
+@end
+
+@implementation GrowingCrashSymbolTableTests
+
+- (void)testCountsDistinctAddresses
+{
+    GrowingCrashSymbolTable* table = createTable(&g_image);
+    XCTAssertTrue(table != NULL);
+    // The debug and undefined symbols are left out, and the aliases share one.
+    XCTAssertEqual(growingcrashst_count(table), 5);
+    growingcrashst_destroy(table);
+}
+
+- (void)testLookupAtSymbols
+{
+    GrowingCrashSymbolTable* table = createTable(&g_image);
+    uintptr_t symbolAddress;
+    XCTAssertEqual(strcmp(symbolNameAt(table, kTextStart + 0x1000, &symbolAddress), "start"), 0);
+    XCTAssertEqual(symbolAddress, kTextStart + 0x1000);
+    XCTAssertEqual(strcmp(symbolNameAt(table, kTextStart + 0x1100, &symbolAddress), "helper"), 0);
+    XCTAssertEqual(symbolAddress, kTextStart + 0x1100);
+    XCTAssertEqual(strcmp(symbolNameAt(table, kTextStart + 0x1400, &symbolAddress), "last"), 0);
+    XCTAssertEqual(symbolAddress, kTextStart + 0x1400);
+    growingcrashst_destroy(table);
+}
+
+- (void)testLookupBetweenSymbols
+{
+    GrowingCrashSymbolTable* table = createTable(&g_image);
+    uintptr_t symbolAddress;
+    XCTAssertEqual(strcmp(symbolNameAt(table, kTextStart + 0x1001, &symbolAddress), "start"), 0);
+    XCTAssertEqual(symbolAddress, kTextStart + 0x1000);
+    XCTAssertEqual(strcmp(symbolNameAt(table, kTextStart + 0x10ff, &symbolAddress), "start"), 0);
+    XCTAssertEqual(symbolAddress, kTextStart + 0x1000);
+
+    // The debug symbol at +0x1180 doesn't count.
+    XCTAssertEqual(strcmp(symbolNameAt(table, kTextStart + 0x1190, &symbolAddress), "helper"), 0);
+    XCTAssertEqual(symbolAddress, kTextStart + 0x1100);
+    growingcrashst_destroy(table);
+}
+
+- (void)testLookupPastTheLastSymbol
+{
+    GrowingCrashSymbolTable* table = createTable(&g_image);
+    uintptr_t symbolAddress;
+    XCTAssertEqual(strcmp(symbolNameAt(table, kTextStart + 0x1401, &symbolAddress), "last"), 0);
+    XCTAssertEqual(symbolAddress, kTextStart + 0x1400);
+    XCTAssertEqual(strcmp(symbolNameAt(table, kTextStart + kTextSize, &symbolAddress), "last"), 0);
+    XCTAssertEqual(symbolAddress, kTextStart + 0x1400);
+    growingcrashst_destroy(table);
+}
+
+- (void)testLookupBeforeTheFirstSymbol
+{
+    GrowingCrashSymbolTable* table = createTable(&g_image);
+    uintptr_t symbolAddress;
+    XCTAssertTrue(symbolNameAt(table, kTextStart + 0xfff, &symbolAddress) == NULL);
+    XCTAssertTrue(symbolNameAt(table, 0, &symbolAddress) == NULL);
+    growingcrashst_destroy(table);
+}
+
+- (void)testLastAliasWins
+{
+    GrowingCrashSymbolTable* table = createTable(&g_image);
+    uintptr_t symbolAddress;
+    XCTAssertEqual(strcmp(symbolNameAt(table, kTextStart + 0x1200, &symbolAddress), "alias_last"), 0);
+    XCTAssertEqual(strcmp(symbolNameAt(table, kTextStart + 0x12ff, &symbolAddress), "alias_last"), 0);
+    growingcrashst_destroy(table);
+}
+
+- (void)testOnlyLeadingUnderscoreIsRemoved
+{
+    GrowingCrashSymbolTable* table = createTable(&g_image);
+    uintptr_t symbolAddress;
+    XCTAssertEqual(strcmp(symbolNameAt(table, kTextStart + 0x1300, &symbolAddress), "ltmp0"), 0);
+    growingcrashst_destroy(table);
+}
+
+- (void)testStrippedImageHasNoNames
+{
+    GrowingCrashSymbolTable* table = createTable(&g_strippedImage);
+    XCTAssertTrue(table != NULL);
+    uintptr_t symbolAddress;
+    XCTAssertEqual(strcmp(symbolNameAt(table, kTextStart + 0x1150, &symbolAddress), ""), 0);
+    XCTAssertEqual(symbolAddress, kTextStart + 0x1100);
+    growingcrashst_destroy(table);
+}
+
+- (void)testUnusableImagesHaveNoTable
+{
+    XCTAssertTrue(createTable(&g_twoSymtabImage) == NULL);
+    XCTAssertTrue(createTable(&g_undefinedImage) == NULL);
+    XCTAssertTrue(createTable(&g_noSymtabImage) == NULL);
+}
+
+- (void)testMatchesScanOfGeneratedImage
+{
+    // A symbol table with nearby, aliased, debug and undefined symbols, in
+    // no particular order.
+    const uint32_t stringsSize = 16 * kGeneratedSymbolCount;
+    const size_t symbolsOffset = sizeof(mach_header_t) + sizeof(struct symtab_command);
+    const size_t stringsOffset = symbolsOffset + sizeof(nlist_t) * kGeneratedSymbolCount;
+    uint8_t* image = calloc(1, stringsOffset + stringsSize);
+    mach_header_t* header = (mach_header_t*)image;
+    header->magic = kMagic;
+    header->filetype = MH_EXECUTE;
+    header->ncmds = 1;
+    header->sizeofcmds = sizeof(struct symtab_command);
+    struct symtab_command* symtab = (struct symtab_command*)(header + 1);
+    *symtab = (struct symtab_command) {LC_SYMTAB, sizeof(*symtab), (uint32_t)symbolsOffset,
+                                       kGeneratedSymbolCount, (uint32_t)stringsOffset, stringsSize};
+    nlist_t* symbols = (nlist_t*)(image + symbolsOffset);
+    char* strings = (char*)(image + stringsOffset);
+
+    srand(23);
+    uint32_t stringOffset = 1;
+    for(uint32_t i = 0; i < kGeneratedSymbolCount; i++)
+    {
+        nlist_t* symbol = &symbols[i];
+        symbol->n_un.n_strx = stringOffset;
+        stringOffset += (uint32_t)sprintf(strings + stringOffset, "_func%u", i) + 1;
+        symbol->n_type = N_SECT | N_EXT;
+        symbol->n_value = kTextStart + (uintptr_t)(rand() % (int)kTextSize);
+        int kind = rand() % 10;
+        if(kind == 0)
+        {
+            symbol->n_type = N_FUN;
+        }
+        else if(kind == 1)
+        {
+            symbol->n_type = N_UNDF | N_EXT;
+            symbol->n_value = 0;
+        }
+        else if(kind == 2 && i > 0)
+        {
+            symbol->n_value = symbols[rand() % (int)i].n_value;
+        }
+    }
+
+    GrowingCrashSymbolTable* table = createTable(image);
+    XCTAssertTrue(table != NULL);
+    int mismatches = 0;
+    for(uintptr_t address = kTextStart - 4; address < kTextStart + kTextSize + 4; address++)
+    {
+        const nlist_t* expected = scanForSymbol(symbols, kGeneratedSymbolCount, address);
+        uintptr_t symbolAddress = 0;
+        const char* symbolName = NULL;
+        bool found = growingcrashst_lookup(table, address, &symbolAddress, &symbolName);
+        if(found != (expected != NULL) ||
+           (expected != NULL && (symbolAddress != expected->n_value ||
+                                 symbolName != strings + expected->n_un.n_strx + 1)))
+        {
+            mismatches++;
+        }
+    }
+    XCTAssertEqual(mismatches, 0);
+    growingcrashst_destroy(table);
+    free(image);
+}
+
+@end
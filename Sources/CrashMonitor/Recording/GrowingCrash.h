@@ -140,6 +140,52 @@ typedef enum
  */
 @property(nonatomic,readwrite,assign) BOOL introspectMemory;
 
+/** If YES, write crash reports in a compact binary encoding rather than JSON.
+ * Reports are transcoded back to JSON when they are read.
+ *
+ * Default: NO
+ */
+@property(nonatomic,readwrite,assign) BOOL useBinaryReportFormat;
+
+/** If YES, demangle Swift symbols in backtraces while the crash report is
+ * being written. Symbols that can't be demangled then are demangled when the
+ * report is read.
+ *
+ * Default: NO
+ */
+@property(nonatomic,readwrite,assign) BOOL demangleSwiftAtCrashTime;
+
+/** If YES, build sorted copies of the loaded images' symbol tables in the
+ * background, which makes symbolicating backtraces at crash time faster at
+ * the cost of some memory.
+ *
+ * Default: NO
+ */
+@property(nonatomic,readwrite,assign) BOOL precomputeSymbolTables;
+
+/** If YES, only describe the binary images that a backtrace points into (plus
+ * the main executable and images with a crash info message), rather than
+ * every loaded image.
+ *
+ * Default: NO
+ */
+@property(nonatomic,readwrite,assign) BOOL referencedBinaryImagesOnly;
+
+/** If YES, and referencedBinaryImagesOnly is YES, also list the address and
+ * UUID of every loaded image.
+ *
+ * Default: NO
+ */
+@property(nonatomic,readwrite,assign) BOOL compactImageList;
+
+/** If YES, walk every thread's stack into memory reserved up front before
+ * encoding the report, and resume threads suspended for a non-fatal user
+ * reported exception as soon as that is done.
+ *
+ * Default: NO
+ */
+@property(nonatomic,readwrite,assign) BOOL captureThreadsBeforeWriting;
+
 /** If YES, monitor all Objective-C/Swift deallocations and keep track of any
  * accesses after deallocation.
  *
@@ -43,6 +43,8 @@
 
 #import "GrowingCrashC.h"
 #import "GrowingCrashDoctor.h"
+#import "GrowingCrashDemangleCache.h"
+#import "GrowingCrashDemangle_CPP.h"
 #import "GrowingCrashReportFields.h"
 #import "GrowingCrashMonitor_AppState.h"
 #import "GrowingCrashJSONCodecObjC.h"
@@ -102,6 +104,12 @@ static NSString* getBasePath()
     return [cachePath stringByAppendingPathComponent:pathEnd];
 }
 
+static bool appendReportData(const char* data, int length, void* userData)
+{
+    [(__bridge NSMutableData*)userData appendBytes:data length:(NSUInteger)length];
+    return true;
+}
+
 
 @implementation GrowingCrash
 
@@ -119,6 +127,12 @@ static NSString* getBasePath()
 @synthesize bundleName = _bundleName;
 @synthesize basePath = _basePath;
 @synthesize introspectMemory = _introspectMemory;
+@synthesize useBinaryReportFormat = _useBinaryReportFormat;
+@synthesize demangleSwiftAtCrashTime = _demangleSwiftAtCrashTime;
+@synthesize precomputeSymbolTables = _precomputeSymbolTables;
+@synthesize referencedBinaryImagesOnly = _referencedBinaryImagesOnly;
+@synthesize compactImageList = _compactImageList;
+@synthesize captureThreadsBeforeWriting = _captureThreadsBeforeWriting;
 @synthesize doNotIntrospectClasses = _doNotIntrospectClasses;
 @synthesize demangleLanguages = _demangleLanguages;
 @synthesize addConsoleLogToReport = _addConsoleLogToReport;
@@ -242,6 +256,42 @@ static NSString* getBasePath()
     growingcrash_setIntrospectMemory(introspectMemory);
 }
 
+- (void) setUseBinaryReportFormat:(BOOL) useBinaryReportFormat
+{
+    _useBinaryReportFormat = useBinaryReportFormat;
+    growingcrash_setUseBinaryReportFormat(useBinaryReportFormat);
+}
+
+- (void) setDemangleSwiftAtCrashTime:(BOOL) demangleSwiftAtCrashTime
+{
+    _demangleSwiftAtCrashTime = demangleSwiftAtCrashTime;
+    growingcrash_setDemangleSwiftAtCrashTime(demangleSwiftAtCrashTime);
+}
+
+- (void) setPrecomputeSymbolTables:(BOOL) precomputeSymbolTables
+{
+    _precomputeSymbolTables = precomputeSymbolTables;
+    growingcrash_setPrecomputeSymbolTables(precomputeSymbolTables);
+}
+
+- (void) setReferencedBinaryImagesOnly:(BOOL) referencedBinaryImagesOnly
+{
+    _referencedBinaryImagesOnly = referencedBinaryImagesOnly;
+    growingcrash_setReferencedBinaryImagesOnly(referencedBinaryImagesOnly);
+}
+
+- (void) setCompactImageList:(BOOL) compactImageList
+{
+    _compactImageList = compactImageList;
+    growingcrash_setCompactImageList(compactImageList);
+}
+
+- (void) setCaptureThreadsBeforeWriting:(BOOL) captureThreadsBeforeWriting
+{
+    _captureThreadsBeforeWriting = captureThreadsBeforeWriting;
+    growingcrash_setCaptureThreadsBeforeWriting(captureThreadsBeforeWriting);
+}
+
 - (BOOL) catchZombies
 {
     return (self.monitoring & GrowingCrashMonitorTypeZombie) != 0;
@@ -464,10 +514,10 @@ SYNTHESIZE_CRASH_STATE_PROPERTY(BOOL, crashedLastLaunch)
 
 - (NSData*) loadCrashReportJSONWithID:(int64_t) reportID
 {
-    char* report = growingcrash_readReport(reportID);
-    if(report != NULL)
+    NSMutableData* report = [NSMutableData data];
+    if(growingcrash_readReportToSink(reportID, appendReportData, (__bridge void*)report))
     {
-        return [NSData dataWithBytesNoCopy:report length:strlen(report) freeWhenDone:YES];
+        return report;
     }
     return nil;
 }
@@ -511,7 +561,11 @@ SYNTHESIZE_CRASH_STATE_PROPERTY(BOOL, crashedLastLaunch)
     {
         return nil;
     }
+    return [self reportWithJSONData:jsonData reportID:reportID];
+}
 
+- (NSDictionary*) reportWithJSONData:(NSData*) jsonData reportID:(int64_t) reportID
+{
     NSError* error = nil;
     NSMutableDictionary* crashReport = [GrowingCrashJSONCodec decode:jsonData
                                                    options:GrowingCrashJSONDecodeOptionIgnoreNullInArray |
@@ -537,15 +591,57 @@ SYNTHESIZE_CRASH_STATE_PROPERTY(BOOL, crashedLastLaunch)
     int reportCount = growingcrash_getReportCount();
     int64_t reportIDs[reportCount];
     reportCount = growingcrash_getReportIDs(reportIDs, reportCount);
-    NSMutableArray* reports = [NSMutableArray arrayWithCapacity:(NSUInteger)reportCount];
+    char* rawReports[reportCount];
+    growingcrash_readReportsBatch(reportIDs, reportCount, rawReports, 0);
+
+    // Decoding and doctoring take longer than reading, so spread them over
+    // the CPUs as well, keeping the reports in order.
+    NSMutableArray* decodedReports = [NSMutableArray arrayWithCapacity:(NSUInteger)reportCount];
     for(int i = 0; i < reportCount; i++)
     {
-        NSDictionary* report = [self reportWithIntID:reportIDs[i]];
-        if(report != nil)
+        [decodedReports addObject:[NSNull null]];
+    }
+    char** rawReportsPtr = rawReports;
+    int64_t* reportIDsPtr = reportIDs;
+    dispatch_apply((size_t)reportCount, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t i) {
+        if(rawReportsPtr[i] == NULL)
+        {
+            return;
+        }
+        @autoreleasepool
+        {
+            NSData* jsonData = [NSData dataWithBytesNoCopy:rawReportsPtr[i]
+                                                    length:strlen(rawReportsPtr[i])
+                                              freeWhenDone:YES];
+            NSDictionary* report = [self reportWithJSONData:jsonData reportID:reportIDsPtr[i]];
+            if(report != nil)
+            {
+                @synchronized(decodedReports)
+                {
+                    decodedReports[i] = report;
+                }
+            }
+        }
+    });
+
+    NSMutableArray* reports = [NSMutableArray arrayWithCapacity:(NSUInteger)reportCount];
+    for(id report in decodedReports)
+    {
+        if(report != [NSNull null])
         {
             [reports addObject:report];
         }
     }
+
+    GrowingCrashDemangleCacheStats stats;
+    growingcrashdmc_getStats(&stats);
+    GrowingCrashLOG_DEBUG(@"Demangle cache: %llu hits, %llu misses, %llu evictions",
+                          stats.hits, stats.misses, stats.evictions);
+    GrowingCrashDemangleCPPStats cppStats;
+    growingcrashdm_getCPPStats(&cppStats);
+    GrowingCrashLOG_DEBUG(@"C++ demangling: %llu symbols, %llu not C++, %llu failed",
+                          cppStats.calls, cppStats.skipped, cppStats.failures);
+    growingcrashdmc_clear();
     
     return reports;
 }
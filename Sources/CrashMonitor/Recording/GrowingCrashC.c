@@ -48,7 +48,10 @@
 #include "GrowingCrashMonitor_CPPException.h"
 #include "GrowingCrashMonitor_Deadlock.h"
 #include "GrowingCrashMonitor_User.h"
+#include "GrowingCrashDynamicLinker.h"
 #include "GrowingCrashFileUtils.h"
+#include "GrowingCrashGrowableBuffer.h"
+#include "GrowingCrashJSONCodec.h"
 #include "GrowingCrashObjC.h"
 #include "GrowingCrashString.h"
 #include "GrowingCrashMonitor_System.h"
@@ -61,9 +64,16 @@
 #include "GrowingCrashLogger.h"
 
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+/** The most threads to read reports on at once. Fixing up a report is mostly
+ * CPU bound, and there are rarely more than a few cores worth using.
+ */
+#define kMaxReadReportsThreads 4
 
 typedef enum
 {
@@ -84,9 +94,11 @@ static volatile bool g_installed = 0;
 
 static bool g_shouldAddConsoleLogToReport = false;
 static bool g_shouldPrintPreviousLog = false;
+static bool g_shouldPrecomputeSymbolTables = false;
 static char g_consoleLogPath[GROWINGCRASHFU_MAX_PATH_LENGTH];
 static GrowingCrashMonitorType g_monitoring = GrowingCrashMonitorTypeProductionSafeMinimal;
 static char g_lastCrashReportFilePath[GROWINGCRASHFU_MAX_PATH_LENGTH];
+static int64_t g_lastCrashReportID;
 static GrowingCrashReportWrittenCallback g_reportWrittenCallback;
 static GrowingCrashApplicationState g_lastApplicationState = GrowingCrashApplicationStateNone;
 
@@ -147,13 +159,16 @@ static void onCrash(struct GrowingCrash_MonitorContext* monitorContext)
     if(monitorContext->crashedDuringCrashHandling)
     {
         growingcrashreport_writeRecrashReport(monitorContext, g_lastCrashReportFilePath);
+        growingcrs_commitCrashReport(g_lastCrashReportID);
     }
     else
     {
         char crashReportFilePath[GROWINGCRASHFU_MAX_PATH_LENGTH];
         int64_t reportID = growingcrs_getNextCrashReport(crashReportFilePath);
         strncpy(g_lastCrashReportFilePath, crashReportFilePath, sizeof(g_lastCrashReportFilePath));
+        g_lastCrashReportID = reportID;
         growingcrashreport_writeStandardReport(monitorContext, crashReportFilePath);
+        growingcrs_commitCrashReport(reportID);
 
         if(g_reportWrittenCallback)
         {
@@ -196,6 +211,11 @@ GrowingCrashMonitorType growingcrash_install(const char* appName, const char* co
     growingcrashlog_setLogFilename(g_consoleLogPath, true);
     
     growingccd_init(60);
+    growingcrashdl_initialize();
+    if(g_shouldPrecomputeSymbolTables)
+    {
+        growingcrashdl_buildSymbolTablesInBackground();
+    }
 
     growingcrashcm_setEventCallback(onCrash);
     GrowingCrashMonitorType monitors = growingcrash_setMonitoring(g_monitoring);
@@ -242,6 +262,50 @@ void growingcrash_setIntrospectMemory(bool introspectMemory)
     growingcrashreport_setIntrospectMemory(introspectMemory);
 }
 
+void growingcrash_setUseBinaryReportFormat(bool useBinaryReportFormat)
+{
+    growingcrashreport_setUseBinaryFormat(useBinaryReportFormat);
+}
+
+void growingcrash_setDemangleSwiftAtCrashTime(bool demangleSwiftAtCrashTime)
+{
+    growingcrashreport_setDemangleSwiftSymbols(demangleSwiftAtCrashTime);
+}
+
+void growingcrash_setPrecomputeSymbolTables(bool precomputeSymbolTables)
+{
+    g_shouldPrecomputeSymbolTables = precomputeSymbolTables;
+    if(precomputeSymbolTables && g_installed)
+    {
+        growingcrashdl_buildSymbolTablesInBackground();
+    }
+}
+
+void growingcrash_setReferencedBinaryImagesOnly(bool referencedBinaryImagesOnly)
+{
+    growingcrashreport_setWriteReferencedImagesOnly(referencedBinaryImagesOnly);
+}
+
+void growingcrash_setCompactImageList(bool compactImageList)
+{
+    growingcrashreport_setWriteCompactImageList(compactImageList);
+}
+
+void growingcrash_setCaptureThreadsBeforeWriting(bool captureThreadsBeforeWriting)
+{
+    growingcrashreport_setCaptureThreadsBeforeWriting(captureThreadsBeforeWriting);
+}
+
+void growingcrash_setCPPExceptionCaptureInterval(int interval)
+{
+    growingcrashcm_setCPPExceptionCaptureInterval(interval);
+}
+
+void growingcrash_getCPPExceptionStats(GrowingCrashCPPExceptionStats* stats)
+{
+    growingcrashcm_getCPPExceptionStats(stats);
+}
+
 void growingcrash_setDoNotIntrospectClasses(const char** doNotIntrospectClasses, int length)
 {
     growingcrashreport_setDoNotIntrospectClasses(doNotIntrospectClasses, length);
@@ -349,29 +413,152 @@ int growingcrash_getReportIDs(int64_t* reportIDs, int count)
     return growingcrs_getReportIDs(reportIDs, count);
 }
 
-char* growingcrash_readReport(int64_t reportID)
+typedef struct
+{
+    GrowingCrashReportSinkFunc sink;
+    void* userData;
+} ReportSinkContext;
+
+static int addToReportSink(const char* const data, const int length, void* const userData)
+{
+    ReportSinkContext* context = (ReportSinkContext*)userData;
+    return context->sink(data, length, context->userData) ? GrowingCrashJSON_OK : GrowingCrashJSON_ERROR_CANNOT_ADD_DATA;
+}
+
+static bool addToReportBuffer(const char* const data, const int length, void* const userData)
+{
+    return growingcrashgb_append((GrowingCrashGrowableBuffer*)userData, data, length);
+}
+
+bool growingcrash_readReportToSink(int64_t reportID, GrowingCrashReportSinkFunc sink, void* userData)
 {
     if(reportID <= 0)
     {
         GrowingCrashLOG_ERROR("Report ID was %" PRIx64, reportID);
-        return NULL;
+        return false;
     }
 
-    char* rawReport = growingcrs_readReport(reportID);
-    if(rawReport == NULL)
+    const char* rawReport;
+    int rawReportLength;
+    if(!growingcrs_mapReport(reportID, &rawReport, &rawReportLength))
     {
         GrowingCrashLOG_ERROR("Failed to load report ID %" PRIx64, reportID);
-        return NULL;
+        return false;
     }
 
-    char* fixedReport = growingcrf_fixupCrashReport(rawReport);
-    if(fixedReport == NULL)
+    ReportSinkContext context = {sink, userData};
+    int result = growingcrf_fixupCrashReportToSink(rawReport, rawReportLength, addToReportSink, &context);
+    if(result != GrowingCrashJSON_OK)
     {
         GrowingCrashLOG_ERROR("Failed to fixup report ID %" PRIx64, reportID);
     }
 
-    free(rawReport);
-    return fixedReport;
+    growingcrs_unmapReport(rawReport, rawReportLength);
+    return result == GrowingCrashJSON_OK;
+}
+
+char* growingcrash_readReport(int64_t reportID)
+{
+    GrowingCrashGrowableBuffer buffer = {NULL, 0, 0};
+    if(!growingcrash_readReportToSink(reportID, addToReportBuffer, &buffer) ||
+       !growingcrashgb_terminate(&buffer))
+    {
+        free(buffer.data);
+        return NULL;
+    }
+    return buffer.data;
+}
+
+typedef struct
+{
+    const int64_t* reportIDs;
+    char** reports;
+    int count;
+    int nextIndex;
+    int readCount;
+} ReportBatch;
+
+static void* readReportsWorker(void* userData)
+{
+    ReportBatch* batch = (ReportBatch*)userData;
+    // Each report is handed over in the buffer it was read into. The next
+    // buffer starts out as big as the last report, so that it rarely has to
+    // grow.
+    GrowingCrashGrowableBuffer buffer = {NULL, 0, 0};
+    int lastLength = 0;
+    int readCount = 0;
+
+    for(;;)
+    {
+        int index = __atomic_fetch_add(&batch->nextIndex, 1, __ATOMIC_RELAXED);
+        if(index >= batch->count)
+        {
+            break;
+        }
+        batch->reports[index] = NULL;
+        if(lastLength > 0)
+        {
+            growingcrashgb_reserve(&buffer, lastLength + 1);
+        }
+        if(!growingcrash_readReportToSink(batch->reportIDs[index], addToReportBuffer, &buffer) ||
+           !growingcrashgb_terminate(&buffer))
+        {
+            // Keep the buffer for the next report.
+            buffer.length = 0;
+            continue;
+        }
+        batch->reports[index] = buffer.data;
+        lastLength = buffer.length;
+        buffer = (GrowingCrashGrowableBuffer){NULL, 0, 0};
+        readCount++;
+    }
+
+    free(buffer.data);
+    __atomic_fetch_add(&batch->readCount, readCount, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+int growingcrash_readReportsBatch(const int64_t* reportIDs, int count, char** reports, int maxThreads)
+{
+    if(count <= 0)
+    {
+        return 0;
+    }
+    if(maxThreads <= 0)
+    {
+        long cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+        maxThreads = cpuCount > 0 ? (int)cpuCount : 1;
+    }
+    if(maxThreads > kMaxReadReportsThreads)
+    {
+        maxThreads = kMaxReadReportsThreads;
+    }
+    if(maxThreads > count)
+    {
+        maxThreads = count;
+    }
+
+    ReportBatch batch = {reportIDs, reports, count, 0, 0};
+
+    // The calling thread is one of the workers.
+    pthread_t threads[kMaxReadReportsThreads];
+    int threadCount = 0;
+    for(int i = 1; i < maxThreads; i++)
+    {
+        if(pthread_create(&threads[threadCount], NULL, readReportsWorker, &batch) != 0)
+        {
+            GrowingCrashLOG_ERROR("Could not create a thread to read reports");
+            break;
+        }
+        threadCount++;
+    }
+    readReportsWorker(&batch);
+    for(int i = 0; i < threadCount; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    return batch.readCount;
 }
 
 int64_t growingcrash_addUserReport(const char* report, int reportLength)
@@ -52,6 +52,7 @@ extern "C" {
 
 
 #include "GrowingCrashMonitorType.h"
+#include "GrowingCrashMonitor_CPPException.h"
 #include "GrowingCrashReportWriter.h"
 
 #include <stdbool.h>
@@ -122,6 +123,79 @@ void growingcrash_setSearchQueueNames(bool searchQueueNames);
  */
 void growingcrash_setIntrospectMemory(bool introspectMemory);
 
+/** If true, write crash reports in a compact binary encoding rather than JSON.
+ * This writes fewer bytes and spends less time formatting at crash time.
+ * Reports are transcoded back to JSON when they are read, so readers are
+ * unaffected.
+ *
+ * Default: false
+ */
+void growingcrash_setUseBinaryReportFormat(bool useBinaryReportFormat);
+
+/** If true, demangle Swift symbols in backtraces while the crash report is
+ * being written, so that reports don't need demangling when they are read.
+ * Memory for the demangler is reserved when this is set. Symbols that can't
+ * be demangled without more memory are written mangled, as before.
+ *
+ * Default: false
+ */
+void growingcrash_setDemangleSwiftAtCrashTime(bool demangleSwiftAtCrashTime);
+
+/** If true, build sorted copies of the symbol tables of the loaded images on
+ * a background thread after installation, so that symbolicating a backtrace
+ * at crash time is a binary search per frame rather than a scan of every
+ * symbol in the image. Costs memory for every symbol of every image loaded
+ * at the time. Setting this again after installation also covers images
+ * loaded since.
+ *
+ * Default: false
+ */
+void growingcrash_setPrecomputeSymbolTables(bool precomputeSymbolTables);
+
+/** If true, the binary images section of a crash report only describes the
+ * images that some thread's backtrace points into, the main executable, and
+ * images with a crash info message, instead of every loaded image. This
+ * makes reports much smaller.
+ *
+ * Default: false
+ */
+void growingcrash_setReferencedBinaryImagesOnly(bool referencedBinaryImagesOnly);
+
+/** If true, reports that only describe referenced binary images also list
+ * the address and UUID of every loaded image, which is enough to symbolicate
+ * any address later.
+ *
+ * Default: false
+ */
+void growingcrash_setCompactImageList(bool compactImageList);
+
+/** If true, a crash report walks every thread's stack into memory reserved up
+ * front before encoding anything. Threads suspended for a user reported
+ * exception that doesn't terminate the program are then resumed right away,
+ * instead of staying frozen until the whole report has been written.
+ *
+ * Default: false
+ */
+void growingcrash_setCaptureThreadsBeforeWriting(bool captureThreadsBeforeWriting);
+
+/** How often to capture the backtrace of a thrown C++ exception. The first
+ * throw of each exception type is always captured, then one in every
+ * interval throws of that type. Raise this if code that uses exceptions for
+ * control flow spends too long capturing backtraces. An uncaught exception
+ * whose throw wasn't sampled is reported without a backtrace.
+ *
+ * 0 = only capture the first throw of each type.
+ *
+ * Default: 1
+ */
+void growingcrash_setCPPExceptionCaptureInterval(int interval);
+
+/** Get the number of C++ throws seen and backtraces captured.
+ *
+ * @param stats Receives the counters.
+ */
+void growingcrash_getCPPExceptionStats(GrowingCrashCPPExceptionStats* stats);
+
 /** List of Objective-C classes that should never be introspected.
  * Whenever a class in this list is encountered, only the class name will be recorded.
  * This can be useful for information security concerns.
@@ -264,6 +338,44 @@ int growingcrash_getReportIDs(int64_t* reportIDs, int count);
  */
 char* growingcrash_readReport(int64_t reportID);
 
+/** Receives a fixed up report in chunks.
+ *
+ * @param data The next chunk of the report.
+ * @param length The length of the chunk.
+ * @param userData The user data passed to growingcrash_readReportToSink().
+ *
+ * @return true to continue reading, false to stop.
+ */
+typedef bool (*GrowingCrashReportSinkFunc)(const char* data, int length, void* userData);
+
+/** Read a report, passing it to a sink in chunks as it is fixed up.
+ * The stored report is mapped rather than loaded, and is never held in memory
+ * as a whole, so memory use doesn't grow with the size of the report.
+ *
+ * @param reportID The report's ID.
+ * @param sink The function to pass the report to.
+ * @param userData User-specified data which gets passed to the sink.
+ *
+ * @return true if the whole report was read.
+ */
+bool growingcrash_readReportToSink(int64_t reportID, GrowingCrashReportSinkFunc sink, void* userData);
+
+/** Read several reports, fixing them up on a few threads at once.
+ * This is much faster than reading them one by one when there are many
+ * reports to send, for example after a crash loop.
+ *
+ * @param reportIDs The IDs of the reports to read.
+ * @param count The number of report IDs.
+ * @param reports Receives the NULL terminated reports, in the same order as
+ *                reportIDs. Reports that couldn't be read are set to NULL.
+ *                MEMORY MANAGEMENT WARNING: User is responsible for calling free() on each report.
+ * @param maxThreads The most threads to use, or 0 to decide based on the
+ *                   number of CPUs.
+ *
+ * @return The number of reports that were read.
+ */
+int growingcrash_readReportsBatch(const int64_t* reportIDs, int count, char** reports, int maxThreads);
+
 /** Add a custom report to the store.
  *
  * @param report The report's contents (must be JSON encoded).
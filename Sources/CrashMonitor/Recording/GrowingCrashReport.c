@@ -41,11 +41,15 @@
 
 #include "GrowingCrashReport.h"
 
+#include "GrowingCrashReportBacktrace.h"
+#include "GrowingCrashReportBinaryImages.h"
 #include "GrowingCrashReportFields.h"
+#include "GrowingCrashReportThreadCapture.h"
 #include "GrowingCrashReportWriter.h"
 #include "GrowingCrashDynamicLinker.h"
 #include "GrowingCrashFileUtils.h"
 #include "GrowingCrashJSONCodec.h"
+#include "GrowingCrashBinaryCodec.h"
 #include "GrowingCrashCPU.h"
 #include "GrowingCrashMemory.h"
 #include "GrowingCrashMach.h"
@@ -57,6 +61,7 @@
 #include "GrowingCrashReportVersion.h"
 #include "GrowingCrashStackCursor_Backtrace.h"
 #include "GrowingCrashStackCursor_MachineContext.h"
+#include "GrowingCrashSymbolicator.h"
 #include "GrowingCrashSystemCapabilities.h"
 #include "GrowingCrashCachedData.h"
 
@@ -91,19 +96,16 @@
 /** The minimum length for a valid string. */
 #define kMinStringLength 4
 
+/** Node memory reserved for demangling Swift symbols at crash time. */
+#define kSwiftDemangleArenaSize (64 * 1024)
+
 
 // ============================================================================
 #pragma mark - JSON Encoding -
 // ============================================================================
 
 #define getJsonContext(REPORT_WRITER) ((GrowingCrashJSONEncodeContext*)((REPORT_WRITER)->context))
-
-/** Used for writing hex string values. */
-static const char g_hexNybbles[] =
-{
-    '0', '1', '2', '3', '4', '5', '6', '7',
-    '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
-};
+#define getBinaryContext(REPORT_WRITER) ((GrowingCrashBinaryEncodeContext*)((REPORT_WRITER)->context))
 
 // ============================================================================
 #pragma mark - Runtime Config -
@@ -128,6 +130,9 @@ typedef struct
 static const char* g_userInfoJSON;
 static GrowingCrash_IntrospectionRules g_introspectionRules;
 static GrowingCrashReportWriteCallback g_userSectionWriteCallback;
+static bool g_useBinaryFormat;
+static bool g_writeReferencedImagesOnly;
+static bool g_writeCompactImageList;
 
 
 #pragma mark Callbacks
@@ -221,43 +226,42 @@ static void addUUIDElement(const GrowingCrashReportWriter* const writer, const c
     }
     else
     {
+        static const int groupLengths[] = {4, 2, 2, 2, 6};
         char uuidBuffer[37];
         const unsigned char* src = value;
         char* dst = uuidBuffer;
-        for(int i = 0; i < 4; i++)
-        {
-            *dst++ = g_hexNybbles[(*src>>4)&15];
-            *dst++ = g_hexNybbles[(*src++)&15];
-        }
-        *dst++ = '-';
-        for(int i = 0; i < 2; i++)
-        {
-            *dst++ = g_hexNybbles[(*src>>4)&15];
-            *dst++ = g_hexNybbles[(*src++)&15];
-        }
-        *dst++ = '-';
-        for(int i = 0; i < 2; i++)
-        {
-            *dst++ = g_hexNybbles[(*src>>4)&15];
-            *dst++ = g_hexNybbles[(*src++)&15];
-        }
-        *dst++ = '-';
-        for(int i = 0; i < 2; i++)
-        {
-            *dst++ = g_hexNybbles[(*src>>4)&15];
-            *dst++ = g_hexNybbles[(*src++)&15];
-        }
-        *dst++ = '-';
-        for(int i = 0; i < 6; i++)
+        for(int i = 0; i < 5; i++)
         {
-            *dst++ = g_hexNybbles[(*src>>4)&15];
-            *dst++ = g_hexNybbles[(*src++)&15];
+            if(i > 0)
+            {
+                *dst++ = '-';
+            }
+            growingcrashjson_encodeHex(src, groupLengths[i], dst);
+            src += groupLengths[i];
+            dst += groupLengths[i] * 2;
         }
 
         growingcrashjson_addStringElement(getJsonContext(writer), key, uuidBuffer, (int)(dst - uuidBuffer));
     }
 }
 
+/** Record a JSON element that failed to decode as a string, along with the reason. */
+static void addInvalidJSONElement(const GrowingCrashReportWriter* const writer,
+                                  const char* const key,
+                                  const char* const jsonElement,
+                                  const int jsonResult)
+{
+    char errorBuff[100];
+    snprintf(errorBuff,
+             sizeof(errorBuff),
+             "Invalid JSON data: %s",
+             growingcrashjson_stringForError(jsonResult));
+    writer->beginObject(writer, key);
+    writer->addStringElement(writer, GrowingCrashField_Error, errorBuff);
+    writer->addStringElement(writer, GrowingCrashField_JSONData, jsonElement);
+    writer->endContainer(writer);
+}
+
 static void addJSONElement(const GrowingCrashReportWriter* const writer,
                            const char* const key,
                            const char* const jsonElement,
@@ -270,21 +274,7 @@ static void addJSONElement(const GrowingCrashReportWriter* const writer,
                                            closeLastContainer);
     if(jsonResult != GrowingCrashJSON_OK)
     {
-        char errorBuff[100];
-        snprintf(errorBuff,
-                 sizeof(errorBuff),
-                 "Invalid JSON data: %s",
-                 growingcrashjson_stringForError(jsonResult));
-        growingcrashjson_beginObject(getJsonContext(writer), key);
-        growingcrashjson_addStringElement(getJsonContext(writer),
-                                GrowingCrashField_Error,
-                                errorBuff,
-                                GrowingCrashJSON_SIZE_AUTOMATIC);
-        growingcrashjson_addStringElement(getJsonContext(writer),
-                                GrowingCrashField_JSONData,
-                                jsonElement,
-                                GrowingCrashJSON_SIZE_AUTOMATIC);
-        growingcrashjson_endContainer(getJsonContext(writer));
+        addInvalidJSONElement(writer, key, jsonElement, jsonResult);
     }
 }
 
@@ -321,7 +311,7 @@ static void addTextLinesFromFile(const GrowingCrashReportWriter* const writer, c
         return;
     }
     char buffer[1024];
-    beginArray(writer, key);
+    writer->beginArray(writer, key);
     {
         for(;;)
         {
@@ -332,10 +322,10 @@ static void addTextLinesFromFile(const GrowingCrashReportWriter* const writer, c
                 break;
             }
             buffer[length - 1] = '\0';
-            growingcrashjson_addStringElement(getJsonContext(writer), NULL, buffer, GrowingCrashJSON_SIZE_AUTOMATIC);
+            writer->addStringElement(writer, NULL, buffer);
         }
     }
-    endContainer(writer);
+    writer->endContainer(writer);
     growingcrashfu_closeBufferedReader(&reader);
 }
 
@@ -347,6 +337,134 @@ static int addJSONData(const char* restrict const data, const int length, void*
 }
 
 
+#pragma mark Binary Callbacks
+
+static void binary_addBooleanElement(const GrowingCrashReportWriter* const writer, const char* const key, const bool value)
+{
+    growingcrashbin_addBooleanElement(getBinaryContext(writer), key, value);
+}
+
+static void binary_addFloatingPointElement(const GrowingCrashReportWriter* const writer, const char* const key, const double value)
+{
+    growingcrashbin_addFloatingPointElement(getBinaryContext(writer), key, value);
+}
+
+static void binary_addIntegerElement(const GrowingCrashReportWriter* const writer, const char* const key, const int64_t value)
+{
+    growingcrashbin_addIntegerElement(getBinaryContext(writer), key, value);
+}
+
+static void binary_addUIntegerElement(const GrowingCrashReportWriter* const writer, const char* const key, const uint64_t value)
+{
+    growingcrashbin_addUIntegerElement(getBinaryContext(writer), key, value);
+}
+
+static void binary_addStringElement(const GrowingCrashReportWriter* const writer, const char* const key, const char* const value)
+{
+    growingcrashbin_addStringElement(getBinaryContext(writer), key, value, GrowingCrashJSON_SIZE_AUTOMATIC);
+}
+
+static void binary_addTextFileElement(const GrowingCrashReportWriter* const writer, const char* const key, const char* const filePath)
+{
+    const int fd = open(filePath, O_RDONLY);
+    if(fd < 0)
+    {
+        GrowingCrashLOG_ERROR("Could not open file %s: %s", filePath, strerror(errno));
+        return;
+    }
+
+    if(growingcrashbin_beginStringElement(getBinaryContext(writer), key) != GrowingCrashJSON_OK)
+    {
+        GrowingCrashLOG_ERROR("Could not start string element");
+        goto done;
+    }
+
+    char buffer[512];
+    int bytesRead;
+    for(bytesRead = (int)read(fd, buffer, sizeof(buffer));
+        bytesRead > 0;
+        bytesRead = (int)read(fd, buffer, sizeof(buffer)))
+    {
+        if(growingcrashbin_appendStringElement(getBinaryContext(writer), buffer, bytesRead) != GrowingCrashJSON_OK)
+        {
+            GrowingCrashLOG_ERROR("Could not append string element");
+            goto done;
+        }
+    }
+
+done:
+    growingcrashbin_endStringElement(getBinaryContext(writer));
+    close(fd);
+}
+
+static void binary_addDataElement(const GrowingCrashReportWriter* const writer,
+                                  const char* const key,
+                                  const char* const value,
+                                  const int length)
+{
+    growingcrashbin_addDataElement(getBinaryContext(writer), key, value, length);
+}
+
+static void binary_beginDataElement(const GrowingCrashReportWriter* const writer, const char* const key)
+{
+    growingcrashbin_beginDataElement(getBinaryContext(writer), key);
+}
+
+static void binary_appendDataElement(const GrowingCrashReportWriter* const writer, const char* const value, const int length)
+{
+    growingcrashbin_appendDataElement(getBinaryContext(writer), value, length);
+}
+
+static void binary_endDataElement(const GrowingCrashReportWriter* const writer)
+{
+    growingcrashbin_endDataElement(getBinaryContext(writer));
+}
+
+static void binary_addUUIDElement(const GrowingCrashReportWriter* const writer, const char* const key, const unsigned char* const value)
+{
+    growingcrashbin_addUUIDElement(getBinaryContext(writer), key, value);
+}
+
+static void binary_addJSONElement(const GrowingCrashReportWriter* const writer,
+                                  const char* const key,
+                                  const char* const jsonElement,
+                                  bool closeLastContainer)
+{
+    int jsonResult = growingcrashbin_addJSONElement(getBinaryContext(writer),
+                                                    key,
+                                                    jsonElement,
+                                                    (int)strlen(jsonElement),
+                                                    closeLastContainer);
+    if(jsonResult != GrowingCrashJSON_OK)
+    {
+        addInvalidJSONElement(writer, key, jsonElement, jsonResult);
+    }
+}
+
+static void binary_addJSONElementFromFile(const GrowingCrashReportWriter* const writer,
+                                          const char* const key,
+                                          const char* const filePath,
+                                          bool closeLastContainer)
+{
+    growingcrashbin_addJSONFromFile(getBinaryContext(writer), key, filePath, closeLastContainer);
+}
+
+static void binary_beginObject(const GrowingCrashReportWriter* const writer, const char* const key)
+{
+    growingcrashbin_beginObject(getBinaryContext(writer), key);
+}
+
+static void binary_beginArray(const GrowingCrashReportWriter* const writer, const char* const key)
+{
+    growingcrashbin_beginArray(getBinaryContext(writer), key);
+}
+
+static void binary_endContainer(const GrowingCrashReportWriter* const writer)
+{
+    growingcrashbin_endContainer(getBinaryContext(writer));
+}
+
+
 // ============================================================================
 #pragma mark - Utility -
 // ============================================================================
@@ -407,6 +525,27 @@ static bool getStackCursor(const GrowingCrash_MonitorContext* const crash,
 }
 
 
+// ============================================================================
+#pragma mark - Thread Capture -
+// ============================================================================
+
+/** Resume the threads that were suspended for an event the process survives.
+ * Once every thread has been captured, the rest of the report doesn't need
+ * them to stay suspended.
+ *
+ * @param crash The crash handler context.
+ */
+static void resumeSuspendedThreads(const GrowingCrash_MonitorContext* const crash)
+{
+    if(crash->suspendedThreads != NULL && *crash->suspendedThreads != NULL)
+    {
+        GrowingCrashLOG_DEBUG("Resuming %d threads after capturing them.", crash->suspendedThreadsCount);
+        growingcrashmc_resumeEnvironment(*crash->suspendedThreads, crash->suspendedThreadsCount);
+        *crash->suspendedThreads = NULL;
+    }
+}
+
+
 // ============================================================================
 #pragma mark - Report Writing -
 // ============================================================================
@@ -889,53 +1028,6 @@ static void writeAddressReferencedByString(const GrowingCrashReportWriter* const
     writeMemoryContents(writer, key, (uintptr_t)address, &limit);
 }
 
-#pragma mark Backtrace
-
-/** Write a backtrace to the report.
- *
- * @param writer The writer to write the backtrace to.
- *
- * @param key The object key, if needed.
- *
- * @param stackCursor The stack cursor to read from.
- */
-static void writeBacktrace(const GrowingCrashReportWriter* const writer,
-                           const char* const key,
-                           GrowingCrashStackCursor* stackCursor)
-{
-    writer->beginObject(writer, key);
-    {
-        writer->beginArray(writer, GrowingCrashField_Contents);
-        {
-            while(stackCursor->advanceCursor(stackCursor))
-            {
-                writer->beginObject(writer, NULL);
-                {
-                    if(stackCursor->symbolicate(stackCursor))
-                    {
-                        if(stackCursor->stackEntry.imageName != NULL)
-                        {
-                            writer->addStringElement(writer, GrowingCrashField_ObjectName, growingcrashfu_lastPathEntry(stackCursor->stackEntry.imageName));
-                        }
-                        writer->addUIntegerElement(writer, GrowingCrashField_ObjectAddr, stackCursor->stackEntry.imageAddress);
-                        if(stackCursor->stackEntry.symbolName != NULL)
-                        {
-                            writer->addStringElement(writer, GrowingCrashField_SymbolName, stackCursor->stackEntry.symbolName);
-                        }
-                        writer->addUIntegerElement(writer, GrowingCrashField_SymbolAddr, stackCursor->stackEntry.symbolAddress);
-                    }
-                    writer->addUIntegerElement(writer, GrowingCrashField_InstructionAddr, stackCursor->stackEntry.address);
-                }
-                writer->endContainer(writer);
-            }
-        }
-        writer->endContainer(writer);
-        writer->addIntegerElement(writer, GrowingCrashField_Skipped, 0);
-    }
-    writer->endContainer(writer);
-}
-                              
-
 #pragma mark Stack
 
 /** Write a dump of the stack contents to the report.
@@ -1180,27 +1272,42 @@ static void writeNotableAddresses(const GrowingCrashReportWriter* const writer,
  *
  * @param machineContext The context whose thread to write about.
  *
+ * @param capturedThread The thread's captured backtrace, or NULL to walk its
+ *                       stack now.
+ *
  * @param shouldWriteNotableAddresses If true, write any notable addresses found.
+ *
+ * @param symbolCache The report's symbol cache generation, or 0.
  */
 static void writeThread(const GrowingCrashReportWriter* const writer,
                         const char* const key,
                         const GrowingCrash_MonitorContext* const crash,
                         const struct GrowingCrashMachineContext* const machineContext,
+                        const GrowingCrashCapturedThread* const capturedThread,
                         const int threadIndex,
-                        const bool shouldWriteNotableAddresses)
+                        const bool shouldWriteNotableAddresses,
+                        const uint32_t symbolCache)
 {
     bool isCrashedThread = growingcrashmc_isCrashedContext(machineContext);
     GrowingCrashThread thread = growingcrashmc_getThreadFromContext(machineContext);
     GrowingCrashLOG_DEBUG("Writing thread %x (index %d). is crashed: %d", thread, threadIndex, isCrashedThread);
 
     GrowingCrashStackCursor stackCursor;
-    bool hasBacktrace = getStackCursor(crash, machineContext, &stackCursor);
+    bool hasBacktrace = true;
+    if(capturedThread != NULL)
+    {
+        growingcrashsc_initWithBacktrace(&stackCursor, capturedThread->backtrace, capturedThread->backtraceLength, 0);
+    }
+    else
+    {
+        hasBacktrace = getStackCursor(crash, machineContext, &stackCursor);
+    }
 
     writer->beginObject(writer, key);
     {
         if(hasBacktrace)
         {
-            writeBacktrace(writer, GrowingCrashField_Backtrace, &stackCursor);
+            growingcrbt_writeBacktrace(writer, GrowingCrashField_Backtrace, &stackCursor, symbolCache);
         }
         if(growingcrashmc_canHaveCPUState(machineContext))
         {
@@ -1238,11 +1345,18 @@ static void writeThread(const GrowingCrashReportWriter* const writer,
  * @param key The object key, if needed.
  *
  * @param crash The crash handler context.
+ *
+ * @param capturedThreads The captured threads, or NULL to walk each stack as
+ *                        it is written.
+ *
+ * @param symbolCache The report's symbol cache generation, or 0.
  */
 static void writeAllThreads(const GrowingCrashReportWriter* const writer,
                             const char* const key,
                             const GrowingCrash_MonitorContext* const crash,
-                            bool writeNotableAddresses)
+                            const GrowingCrashCapturedThread* const capturedThreads,
+                            bool writeNotableAddresses,
+                            const uint32_t symbolCache)
 {
     const struct GrowingCrashMachineContext* const context = crash->offendingMachineContext;
     GrowingCrashThread offendingThread = growingcrashmc_getThreadFromContext(context);
@@ -1258,12 +1372,17 @@ static void writeAllThreads(const GrowingCrashReportWriter* const writer,
             GrowingCrashThread thread = growingcrashmc_getThreadAtIndex(context, i);
             if(thread == offendingThread)
             {
-                writeThread(writer, NULL, crash, context, i, writeNotableAddresses);
+                writeThread(writer, NULL, crash, context, NULL, i, writeNotableAddresses, symbolCache);
+            }
+            else if(capturedThreads != NULL)
+            {
+                const GrowingCrashCapturedThread* capturedThread = &capturedThreads[i];
+                writeThread(writer, NULL, crash, capturedThread->machineContext, capturedThread, i, writeNotableAddresses, symbolCache);
             }
             else
             {
                 growingcrashmc_getContextForThread(thread, machineContext, false);
-                writeThread(writer, NULL, crash, machineContext, i, writeNotableAddresses);
+                writeThread(writer, NULL, crash, machineContext, NULL, i, writeNotableAddresses, symbolCache);
             }
         }
     }
@@ -1272,66 +1391,48 @@ static void writeAllThreads(const GrowingCrashReportWriter* const writer,
 
 #pragma mark Global Report Data
 
-/** Write information about a binary image to the report.
+/** Find the images that the backtraces of all threads point into.
  *
- * @param writer The writer.
+ * @param crash The crash handler context.
  *
- * @param key The object key, if needed.
+ * @param capturedThreads The captured threads, or NULL to walk each stack.
  *
- * @param index Which image to write about.
+ * @param referencedImages Receives the images.
  */
-static void writeBinaryImage(const GrowingCrashReportWriter* const writer,
-                             const char* const key,
-                             const int index)
+static void findReferencedImages(const GrowingCrash_MonitorContext* const crash,
+                                 const GrowingCrashCapturedThread* const capturedThreads,
+                                 GrowingCrashReferencedImages* const referencedImages)
 {
-    GrowingCrashBinaryImage image = {0};
-    if(!growingcrashdl_getBinaryImage(index, &image))
-    {
-        return;
-    }
+    growingcrbi_resetReferencedImages(referencedImages);
 
-    writer->beginObject(writer, key);
+    const struct GrowingCrashMachineContext* const context = crash->offendingMachineContext;
+    GrowingCrashThread offendingThread = growingcrashmc_getThreadFromContext(context);
+    int threadCount = growingcrashmc_getThreadCount(context);
+    GROWINGCRASHMC_NEW_CONTEXT(machineContext);
+
+    for(int i = 0; i < threadCount; i++)
     {
-        writer->addUIntegerElement(writer, GrowingCrashField_ImageAddress, image.address);
-        writer->addUIntegerElement(writer, GrowingCrashField_ImageVmAddress, image.vmAddress);
-        writer->addUIntegerElement(writer, GrowingCrashField_ImageSize, image.size);
-        writer->addStringElement(writer, GrowingCrashField_Name, image.name);
-        writer->addUUIDElement(writer, GrowingCrashField_UUID, image.uuid);
-        writer->addIntegerElement(writer, GrowingCrashField_CPUType, image.cpuType);
-        writer->addIntegerElement(writer, GrowingCrashField_CPUSubType, image.cpuSubType);
-        writer->addUIntegerElement(writer, GrowingCrashField_ImageMajorVersion, image.majorVersion);
-        writer->addUIntegerElement(writer, GrowingCrashField_ImageMinorVersion, image.minorVersion);
-        writer->addUIntegerElement(writer, GrowingCrashField_ImageRevisionVersion, image.revisionVersion);
-        if(image.crashInfoMessage != NULL)
+        GrowingCrashThread thread = growingcrashmc_getThreadAtIndex(context, i);
+        GrowingCrashStackCursor stackCursor;
+        bool hasBacktrace = true;
+        if(thread == offendingThread)
         {
-            writer->addStringElement(writer, GrowingCrashField_ImageCrashInfoMessage, image.crashInfoMessage);
+            hasBacktrace = getStackCursor(crash, context, &stackCursor);
         }
-        if(image.crashInfoMessage2 != NULL)
+        else if(capturedThreads != NULL)
         {
-            writer->addStringElement(writer, GrowingCrashField_ImageCrashInfoMessage2, image.crashInfoMessage2);
+            growingcrashsc_initWithBacktrace(&stackCursor, capturedThreads[i].backtrace, capturedThreads[i].backtraceLength, 0);
         }
-    }
-    writer->endContainer(writer);
-}
-
-/** Write information about all images to the report.
- *
- * @param writer The writer.
- *
- * @param key The object key, if needed.
- */
-static void writeBinaryImages(const GrowingCrashReportWriter* const writer, const char* const key)
-{
-    const int imageCount = growingcrashdl_imageCount();
-
-    writer->beginArray(writer, key);
-    {
-        for(int iImg = 0; iImg < imageCount; iImg++)
+        else
+        {
+            growingcrashmc_getContextForThread(thread, machineContext, false);
+            hasBacktrace = getStackCursor(crash, machineContext, &stackCursor);
+        }
+        if(hasBacktrace)
         {
-            writeBinaryImage(writer, NULL, iImg);
+            growingcrbi_addBacktrace(referencedImages, &stackCursor);
         }
     }
-    writer->endContainer(writer);
 }
 
 /** Write information about system memory to the report.
@@ -1603,6 +1704,82 @@ static void prepareReportWriter(GrowingCrashReportWriter* const writer, GrowingC
     writer->context = context;
 }
 
+/** Prepare a report writer for use with the binary encoding.
+ *
+ * @oaram writer The writer to prepare.
+ *
+ * @param context Binary writer contextual information.
+ */
+static void prepareBinaryReportWriter(GrowingCrashReportWriter* const writer, GrowingCrashBinaryEncodeContext* const context)
+{
+    writer->addBooleanElement = binary_addBooleanElement;
+    writer->addFloatingPointElement = binary_addFloatingPointElement;
+    writer->addIntegerElement = binary_addIntegerElement;
+    writer->addUIntegerElement = binary_addUIntegerElement;
+    writer->addStringElement = binary_addStringElement;
+    writer->addTextFileElement = binary_addTextFileElement;
+    writer->addTextFileLinesElement = addTextLinesFromFile;
+    writer->addJSONFileElement = binary_addJSONElementFromFile;
+    writer->addDataElement = binary_addDataElement;
+    writer->beginDataElement = binary_beginDataElement;
+    writer->appendDataElement = binary_appendDataElement;
+    writer->endDataElement = binary_endDataElement;
+    writer->addUUIDElement = binary_addUUIDElement;
+    writer->addJSONElement = binary_addJSONElement;
+    writer->beginObject = binary_beginObject;
+    writer->beginArray = binary_beginArray;
+    writer->endContainer = binary_endContainer;
+    writer->context = context;
+}
+
+/** Encoder state for whichever format the report is being written in. */
+typedef struct
+{
+    bool isBinary;
+    union
+    {
+        GrowingCrashJSONEncodeContext json;
+        GrowingCrashBinaryEncodeContext binary;
+    } format;
+} ReportEncodeContext;
+
+/** Prepare a report writer for the configured format and begin encoding.
+ *
+ * @param writer The writer to prepare.
+ *
+ * @param context Storage for the encoder state.
+ *
+ * @param bufferedWriter The file to write to.
+ */
+static void beginReportEncode(GrowingCrashReportWriter* const writer,
+                              ReportEncodeContext* const context,
+                              GrowingCrashBufferedWriter* const bufferedWriter)
+{
+    context->isBinary = g_useBinaryFormat;
+    if(context->isBinary)
+    {
+        prepareBinaryReportWriter(writer, &context->format.binary);
+        growingcrashbin_beginEncode(&context->format.binary, addJSONData, bufferedWriter);
+    }
+    else
+    {
+        prepareReportWriter(writer, &context->format.json);
+        growingcrashjson_beginEncode(&context->format.json, true, addJSONData, bufferedWriter);
+    }
+}
+
+static void endReportEncode(ReportEncodeContext* const context)
+{
+    if(context->isBinary)
+    {
+        growingcrashbin_endEncode(&context->format.binary);
+    }
+    else
+    {
+        growingcrashjson_endEncode(&context->format.json);
+    }
+}
+
 
 // ============================================================================
 #pragma mark - Main API -
@@ -1628,13 +1805,10 @@ void growingcrashreport_writeRecrashReport(const GrowingCrash_MonitorContext* co
 
     growingccd_freeze();
 
-    GrowingCrashJSONEncodeContext jsonContext;
-    jsonContext.userData = &bufferedWriter;
+    ReportEncodeContext encodeContext;
     GrowingCrashReportWriter concreteWriter;
     GrowingCrashReportWriter* writer = &concreteWriter;
-    prepareReportWriter(writer, &jsonContext);
-
-    growingcrashjson_beginEncode(getJsonContext(writer), true, addJSONData, &bufferedWriter);
+    beginReportEncode(writer, &encodeContext, &bufferedWriter);
 
     writer->beginObject(writer, GrowingCrashField_Report);
     {
@@ -1661,15 +1835,17 @@ void growingcrashreport_writeRecrashReport(const GrowingCrash_MonitorContext* co
                         GrowingCrashField_CrashedThread,
                         monitorContext,
                         monitorContext->offendingMachineContext,
+                        NULL,
                         threadIndex,
-                        false);
+                        false,
+                        0);
             growingcrashfu_flushBufferedWriter(&bufferedWriter);
         }
         writer->endContainer(writer);
     }
     writer->endContainer(writer);
 
-    growingcrashjson_endEncode(getJsonContext(writer));
+    endReportEncode(&encodeContext);
     growingcrashfu_closeBufferedWriter(&bufferedWriter);
     growingccd_unfreeze();
 }
@@ -1743,14 +1919,18 @@ void growingcrashreport_writeStandardReport(const GrowingCrash_MonitorContext* c
     }
 
     growingccd_freeze();
+
+    const GrowingCrashCapturedThread* capturedThreads = growingcrtc_beginThreadCapture(monitorContext);
+    if(capturedThreads != NULL)
+    {
+        resumeSuspendedThreads(monitorContext);
+    }
     
-    GrowingCrashJSONEncodeContext jsonContext;
-    jsonContext.userData = &bufferedWriter;
+    ReportEncodeContext encodeContext;
     GrowingCrashReportWriter concreteWriter;
     GrowingCrashReportWriter* writer = &concreteWriter;
-    prepareReportWriter(writer, &jsonContext);
-
-    growingcrashjson_beginEncode(getJsonContext(writer), true, addJSONData, &bufferedWriter);
+    beginReportEncode(writer, &encodeContext, &bufferedWriter);
+    const uint32_t symbolCache = growingcrbt_beginSymbolCache();
 
     writer->beginObject(writer, GrowingCrashField_Report);
     {
@@ -1761,7 +1941,20 @@ void growingcrashreport_writeStandardReport(const GrowingCrash_MonitorContext* c
                         monitorContext->System.processName);
         growingcrashfu_flushBufferedWriter(&bufferedWriter);
 
-        writeBinaryImages(writer, GrowingCrashField_BinaryImages);
+        if(g_writeReferencedImagesOnly)
+        {
+            GrowingCrashReferencedImages referencedImages;
+            findReferencedImages(monitorContext, capturedThreads, &referencedImages);
+            growingcrbi_writeBinaryImages(writer, GrowingCrashField_BinaryImages, &referencedImages);
+            if(g_writeCompactImageList)
+            {
+                growingcrbi_writeCompactImageList(writer, GrowingCrashField_LoadedImages);
+            }
+        }
+        else
+        {
+            growingcrbi_writeBinaryImages(writer, GrowingCrashField_BinaryImages, NULL);
+        }
         growingcrashfu_flushBufferedWriter(&bufferedWriter);
 
         writeProcessState(writer, GrowingCrashField_ProcessState, monitorContext);
@@ -1777,7 +1970,9 @@ void growingcrashreport_writeStandardReport(const GrowingCrash_MonitorContext* c
             writeAllThreads(writer,
                             GrowingCrashField_Threads,
                             monitorContext,
-                            g_introspectionRules.enabled);
+                            capturedThreads,
+                            g_introspectionRules.enabled,
+                            symbolCache);
             growingcrashfu_flushBufferedWriter(&bufferedWriter);
         }
         writer->endContainer(writer);
@@ -1805,7 +2000,9 @@ void growingcrashreport_writeStandardReport(const GrowingCrash_MonitorContext* c
     }
     writer->endContainer(writer);
     
-    growingcrashjson_endEncode(getJsonContext(writer));
+    growingcrbt_endSymbolCache(symbolCache);
+    growingcrtc_endThreadCapture(monitorContext);
+    endReportEncode(&encodeContext);
     growingcrashfu_closeBufferedWriter(&bufferedWriter);
     growingccd_unfreeze();
 }
@@ -1838,6 +2035,31 @@ void growingcrashreport_setIntrospectMemory(bool shouldIntrospectMemory)
     g_introspectionRules.enabled = shouldIntrospectMemory;
 }
 
+void growingcrashreport_setUseBinaryFormat(bool useBinaryFormat)
+{
+    g_useBinaryFormat = useBinaryFormat;
+}
+
+void growingcrashreport_setWriteReferencedImagesOnly(bool writeReferencedImagesOnly)
+{
+    g_writeReferencedImagesOnly = writeReferencedImagesOnly;
+}
+
+void growingcrashreport_setWriteCompactImageList(bool writeCompactImageList)
+{
+    g_writeCompactImageList = writeCompactImageList;
+}
+
+void growingcrashreport_setCaptureThreadsBeforeWriting(bool captureThreadsBeforeWriting)
+{
+    growingcrtc_setCaptureThreadsBeforeWriting(captureThreadsBeforeWriting);
+}
+
+void growingcrashreport_setDemangleSwiftSymbols(bool demangleSwiftSymbols)
+{
+    growingcrbt_setDemangleSwiftSymbols(demangleSwiftSymbols, kSwiftDemangleArenaSize);
+}
+
 void growingcrashreport_setDoNotIntrospectClasses(const char** doNotIntrospectClasses, int length)
 {
     const char** oldClasses = g_introspectionRules.restrictedClasses;
@@ -73,6 +73,46 @@ void growingcrashreport_setUserInfoJSON(const char* const userInfoJSON);
  */
 void growingcrashreport_setIntrospectMemory(bool shouldIntrospectMemory);
 
+/** Configure whether reports are written in the compact binary encoding
+ *  instead of JSON. Binary reports are transcoded to JSON when read back.
+ *
+ * @param useBinaryFormat If true, write binary reports.
+ */
+void growingcrashreport_setUseBinaryFormat(bool useBinaryFormat);
+
+/** Configure whether the binary images section describes every loaded image,
+ *  or only the images that a thread's backtrace points into (plus the main
+ *  executable and any image with a crash info message).
+ *
+ * @param writeReferencedImagesOnly If true, only describe referenced images.
+ */
+void growingcrashreport_setWriteReferencedImagesOnly(bool writeReferencedImagesOnly);
+
+/** Configure whether reports that only describe referenced images also list
+ *  the address and UUID of every loaded image, under "loaded_images".
+ *
+ * @param writeCompactImageList If true, list every loaded image.
+ */
+void growingcrashreport_setWriteCompactImageList(bool writeCompactImageList);
+
+/** Configure whether every thread's stack is walked into a preallocated
+ *  arena before any of the report is encoded. Threads suspended for an event
+ *  that the process survives are resumed as soon as that is done, rather than
+ *  after the whole report has been written.
+ *
+ * @param captureThreadsBeforeWriting If true, capture threads first.
+ */
+void growingcrashreport_setCaptureThreadsBeforeWriting(bool captureThreadsBeforeWriting);
+
+/** Configure whether Swift symbols in backtraces are demangled while the
+ *  report is written. The memory for this is reserved up front, so no memory
+ *  is allocated at crash time. Symbols that can't be demangled that way are
+ *  written mangled, and are demangled when the report is read.
+ *
+ * @param demangleSwiftSymbols If true, demangle Swift symbols at crash time.
+ */
+void growingcrashreport_setDemangleSwiftSymbols(bool demangleSwiftSymbols);
+
 /** Specify which objective-c classes should not be introspected.
  *
  * @param doNotIntrospectClasses Array of class names.
@@ -0,0 +1,249 @@
+//
+//  GrowingCrashReportBacktrace.c
+//  GrowingAnalytics
+//
+//  Created by YoloMao on 2022/9/19.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#include "GrowingCrashReportBacktrace.h"
+
+#include "GrowingCrashReportFields.h"
+#include "GrowingCrashFileUtils.h"
+#include "GrowingCrashSystemCapabilities.h"
+#if GROWINGCRASH_HAS_SWIFT
+#include "GrowingCrashDemangle_Swift.h"
+#endif
+
+//#define GrowingCrashLogger_LocalLevel TRACE
+#include "GrowingCrashLogger.h"
+
+#include <string.h>
+
+
+// ============================================================================
+#pragma mark - Constants -
+// ============================================================================
+
+/** Longest demangled Swift symbol to write. Longer ones are left mangled. */
+#define kMaxDemangledSymbolLength 1024
+
+/** Number of symbolicated addresses remembered while writing a report.
+ * Must be a power of 2.
+ */
+#define kSymbolCacheSize 1024
+
+
+// ============================================================================
+#pragma mark - Globals -
+// ============================================================================
+
+#if GROWINGCRASH_HAS_SWIFT
+/** The demangler, or NULL while a backtrace is using it. Whoever takes it out
+ * puts it back when done, so a crash in the demangler leaves it out, and the
+ * recrash report doesn't crash in it again.
+ */
+static GrowingCrashSwiftDemangler* g_swiftDemangler;
+static int g_swiftDemanglerArenaSize;
+static bool g_demangleSwiftSymbols;
+#endif
+
+/** A symbolicated stack entry. Threads share most of their outer frames, so
+ * the same addresses get symbolicated over and over in one report.
+ */
+typedef struct
+{
+    uintptr_t address;
+    bool isSymbolicated;
+    uintptr_t imageAddress;
+    const char* imageName;
+    uintptr_t symbolAddress;
+    const char* symbolName;
+} SymbolCacheEntry;
+
+static SymbolCacheEntry g_symbolCache[kSymbolCacheSize];
+
+/** The last symbol cache generation handed out. */
+static uint32_t g_symbolCacheGeneration;
+
+/** The generation of the report currently using g_symbolCache, or 0. */
+static uint32_t g_symbolCacheOwner;
+
+
+// ============================================================================
+#pragma mark - Utility -
+// ============================================================================
+
+/** Write a symbol name, demangling it first if it is a Swift symbol and
+ * demangling at crash time is enabled. Falls back to the mangled name.
+ *
+ * @param writer The writer.
+ *
+ * @param key The object key.
+ *
+ * @param symbolName The symbol name to write.
+ */
+static void writeSymbolName(const GrowingCrashReportWriter* const writer,
+                            const char* const key,
+                            const char* const symbolName)
+{
+#if GROWINGCRASH_HAS_SWIFT
+    GrowingCrashSwiftDemangler* demangler = __atomic_load_n(&g_swiftDemangler, __ATOMIC_RELAXED);
+    if(g_demangleSwiftSymbols && demangler != NULL &&
+       __atomic_compare_exchange_n(&g_swiftDemangler, &demangler, NULL, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    {
+        char demangled[kMaxDemangledSymbolLength];
+        int length = growingcrashdm_demangleSwiftWith(demangler, symbolName, demangled, sizeof(demangled));
+        __atomic_store_n(&g_swiftDemangler, demangler, __ATOMIC_RELEASE);
+        if(length > 0 && length < (int)sizeof(demangled))
+        {
+            writer->addStringElement(writer, key, demangled);
+            return;
+        }
+    }
+#endif
+    writer->addStringElement(writer, key, symbolName);
+}
+
+/** Symbolicate the cursor's current entry, using the symbol cache if the
+ * report still owns it.
+ *
+ * @param symbolCache The report's symbol cache generation, or 0.
+ *
+ * @return True if successful.
+ */
+static bool symbolicate(const uint32_t symbolCache, GrowingCrashStackCursor* const stackCursor)
+{
+    SymbolCacheEntry* entry = NULL;
+    const uintptr_t address = stackCursor->stackEntry.address;
+    if(address != 0 && symbolCache != 0 && __atomic_load_n(&g_symbolCacheOwner, __ATOMIC_ACQUIRE) == symbolCache)
+    {
+        uintptr_t hash = (address >> 2) * 2654435761u;
+        entry = &g_symbolCache[(hash >> 8) & (kSymbolCacheSize - 1)];
+        if(__atomic_load_n(&entry->address, __ATOMIC_ACQUIRE) == address)
+        {
+            stackCursor->stackEntry.imageAddress = entry->imageAddress;
+            stackCursor->stackEntry.imageName = entry->imageName;
+            stackCursor->stackEntry.symbolAddress = entry->symbolAddress;
+            stackCursor->stackEntry.symbolName = entry->symbolName;
+            return entry->isSymbolicated;
+        }
+    }
+
+    bool isSymbolicated = stackCursor->symbolicate(stackCursor);
+    if(entry != NULL)
+    {
+        __atomic_store_n(&entry->address, 0, __ATOMIC_RELAXED);
+        entry->isSymbolicated = isSymbolicated;
+        entry->imageAddress = stackCursor->stackEntry.imageAddress;
+        entry->imageName = stackCursor->stackEntry.imageName;
+        entry->symbolAddress = stackCursor->stackEntry.symbolAddress;
+        entry->symbolName = stackCursor->stackEntry.symbolName;
+        // Publish the address last, so a half-written entry never matches.
+        __atomic_store_n(&entry->address, address, __ATOMIC_RELEASE);
+    }
+    return isSymbolicated;
+}
+
+
+// ============================================================================
+#pragma mark - API -
+// ============================================================================
+
+void growingcrbt_writeBacktrace(const GrowingCrashReportWriter* const writer,
+                                const char* const key,
+                                GrowingCrashStackCursor* stackCursor,
+                                uint32_t symbolCache)
+{
+    writer->beginObject(writer, key);
+    {
+        writer->beginArray(writer, GrowingCrashField_Contents);
+        {
+            while(stackCursor->advanceCursor(stackCursor))
+            {
+                writer->beginObject(writer, NULL);
+                {
+                    if(symbolicate(symbolCache, stackCursor))
+                    {
+                        if(stackCursor->stackEntry.imageName != NULL)
+                        {
+                            writer->addStringElement(writer, GrowingCrashField_ObjectName, growingcrashfu_lastPathEntry(stackCursor->stackEntry.imageName));
+                        }
+                        writer->addUIntegerElement(writer, GrowingCrashField_ObjectAddr, stackCursor->stackEntry.imageAddress);
+                        if(stackCursor->stackEntry.symbolName != NULL)
+                        {
+                            writeSymbolName(writer, GrowingCrashField_SymbolName, stackCursor->stackEntry.symbolName);
+                        }
+                        writer->addUIntegerElement(writer, GrowingCrashField_SymbolAddr, stackCursor->stackEntry.symbolAddress);
+                    }
+                    writer->addUIntegerElement(writer, GrowingCrashField_InstructionAddr, stackCursor->stackEntry.address);
+                }
+                writer->endContainer(writer);
+            }
+        }
+        writer->endContainer(writer);
+        writer->addIntegerElement(writer, GrowingCrashField_Skipped, 0);
+    }
+    writer->endContainer(writer);
+}
+
+uint32_t growingcrbt_beginSymbolCache(void)
+{
+    uint32_t generation = __atomic_add_fetch(&g_symbolCacheGeneration, 1, __ATOMIC_RELAXED);
+    if(generation == 0)
+    {
+        generation = __atomic_add_fetch(&g_symbolCacheGeneration, 1, __ATOMIC_RELAXED);
+    }
+    uint32_t expected = 0;
+    if(!__atomic_compare_exchange_n(&g_symbolCacheOwner, &expected, generation, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    {
+        return 0;
+    }
+    // Images may have been loaded or unloaded since the last report.
+    memset(g_symbolCache, 0, sizeof(g_symbolCache));
+    return generation;
+}
+
+void growingcrbt_endSymbolCache(uint32_t symbolCache)
+{
+    uint32_t expected = symbolCache;
+    if(symbolCache != 0)
+    {
+        __atomic_compare_exchange_n(&g_symbolCacheOwner, &expected, 0, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+    }
+}
+
+void growingcrbt_setDemangleSwiftSymbols(bool demangleSwiftSymbols, int arenaSize)
+{
+#if GROWINGCRASH_HAS_SWIFT
+    if(demangleSwiftSymbols && (g_swiftDemangler == NULL || arenaSize != g_swiftDemanglerArenaSize))
+    {
+        GrowingCrashSwiftDemangler* demangler = growingcrashdm_createSwiftArenaDemangler(arenaSize);
+        if(demangler == NULL)
+        {
+            GrowingCrashLOG_ERROR("Could not allocate the Swift demangler");
+        }
+        else
+        {
+            growingcrashdm_destroySwiftDemangler(__atomic_exchange_n(&g_swiftDemangler, demangler, __ATOMIC_ACQ_REL));
+            g_swiftDemanglerArenaSize = arenaSize;
+        }
+    }
+    g_demangleSwiftSymbols = demangleSwiftSymbols;
+#else
+    (void)demangleSwiftSymbols;
+    (void)arenaSize;
+#endif
+}
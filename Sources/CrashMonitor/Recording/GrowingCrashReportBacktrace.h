@@ -0,0 +1,92 @@
+//
+//  GrowingCrashReportBacktrace.h
+//  GrowingAnalytics
+//
+//  Created by YoloMao on 2022/9/19.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+/* Writes backtraces into a crash report.
+ *
+ * Symbolicated addresses are remembered for the rest of the report, and Swift
+ * symbols can be demangled as they are written. Writing a backtrace is
+ * async-safe. The setters are not.
+ */
+
+
+#ifndef HDR_GrowingCrashReportBacktrace_h
+#define HDR_GrowingCrashReportBacktrace_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "GrowingCrashReportWriter.h"
+#include "GrowingCrashStackCursor.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Write a backtrace to a report.
+ *
+ * @param writer The writer to write the backtrace to.
+ *
+ * @param key The object key, if needed.
+ *
+ * @param stackCursor The stack cursor to read from.
+ *
+ * @param symbolCache The report's symbol cache generation, or 0 to
+ *                    symbolicate every address.
+ */
+void growingcrbt_writeBacktrace(const GrowingCrashReportWriter* writer,
+                                const char* key,
+                                GrowingCrashStackCursor* stackCursor,
+                                uint32_t symbolCache);
+
+/** Start caching symbolicated addresses for a report. Only one report can
+ * use the cache at a time. Others, or a recrash report written while this
+ * report's cache was being updated, symbolicate every address.
+ *
+ * Each call hands out a new generation, so a report that never ended its
+ * cache can't be mistaken for a later one.
+ *
+ * @return The generation to pass to growingcrbt_writeBacktrace(), or 0 if
+ *         another report is using the cache.
+ */
+uint32_t growingcrbt_beginSymbolCache(void);
+
+/** Stop caching symbolicated addresses for a report.
+ *
+ * @param symbolCache The generation returned by growingcrbt_beginSymbolCache().
+ */
+void growingcrbt_endSymbolCache(uint32_t symbolCache);
+
+/** Demangle Swift symbols as they are written. Symbols that can't be
+ * demangled within the arena are written mangled.
+ *
+ * @param demangleSwiftSymbols If true, demangle Swift symbols.
+ *
+ * @param arenaSize The node memory to set aside for demangling, in bytes.
+ *                  Changing it replaces the demangler.
+ */
+void growingcrbt_setDemangleSwiftSymbols(bool demangleSwiftSymbols, int arenaSize);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HDR_GrowingCrashReportBacktrace_h
@@ -0,0 +1,157 @@
+//
+//  GrowingCrashReportBinaryImages.c
+//  GrowingAnalytics
+//
+//  Created by YoloMao on 2022/9/19.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#include "GrowingCrashReportBinaryImages.h"
+
+#include "GrowingCrashReportFields.h"
+#include "GrowingCrashDynamicLinker.h"
+#include "GrowingCrashSymbolicator.h"
+
+#include <string.h>
+
+
+// ============================================================================
+#pragma mark - Utility -
+// ============================================================================
+
+/** Write information about a binary image to the report.
+ *
+ * @param writer The writer.
+ *
+ * @param key The object key, if needed.
+ *
+ * @param index Which image to write about.
+ */
+static void writeBinaryImage(const GrowingCrashReportWriter* const writer,
+                             const char* const key,
+                             const int index)
+{
+    GrowingCrashBinaryImage image = {0};
+    if(!growingcrashdl_getBinaryImage(index, &image))
+    {
+        return;
+    }
+
+    writer->beginObject(writer, key);
+    {
+        writer->addUIntegerElement(writer, GrowingCrashField_ImageAddress, image.address);
+        writer->addUIntegerElement(writer, GrowingCrashField_ImageVmAddress, image.vmAddress);
+        writer->addUIntegerElement(writer, GrowingCrashField_ImageSize, image.size);
+        writer->addStringElement(writer, GrowingCrashField_Name, image.name);
+        writer->addUUIDElement(writer, GrowingCrashField_UUID, image.uuid);
+        writer->addIntegerElement(writer, GrowingCrashField_CPUType, image.cpuType);
+        writer->addIntegerElement(writer, GrowingCrashField_CPUSubType, image.cpuSubType);
+        writer->addUIntegerElement(writer, GrowingCrashField_ImageMajorVersion, image.majorVersion);
+        writer->addUIntegerElement(writer, GrowingCrashField_ImageMinorVersion, image.minorVersion);
+        writer->addUIntegerElement(writer, GrowingCrashField_ImageRevisionVersion, image.revisionVersion);
+        if(image.crashInfoMessage != NULL)
+        {
+            writer->addStringElement(writer, GrowingCrashField_ImageCrashInfoMessage, image.crashInfoMessage);
+        }
+        if(image.crashInfoMessage2 != NULL)
+        {
+            writer->addStringElement(writer, GrowingCrashField_ImageCrashInfoMessage2, image.crashInfoMessage2);
+        }
+    }
+    writer->endContainer(writer);
+}
+
+static void markReferencedImage(GrowingCrashReferencedImages* const referencedImages, const uint32_t index)
+{
+    if(index < GROWINGCRBI_MAX_TRACKED_IMAGES)
+    {
+        referencedImages->bits[index / 8] |= (uint8_t)(1 << (index % 8));
+    }
+}
+
+static bool isImageReferenced(const GrowingCrashReferencedImages* const referencedImages, const int index)
+{
+    return index >= GROWINGCRBI_MAX_TRACKED_IMAGES || (referencedImages->bits[index / 8] & (1 << (index % 8))) != 0;
+}
+
+
+// ============================================================================
+#pragma mark - API -
+// ============================================================================
+
+void growingcrbi_resetReferencedImages(GrowingCrashReferencedImages* const referencedImages)
+{
+    memset(referencedImages, 0, sizeof(*referencedImages));
+    // The main executable.
+    markReferencedImage(referencedImages, 0);
+}
+
+void growingcrbi_addBacktrace(GrowingCrashReferencedImages* const referencedImages, GrowingCrashStackCursor* const stackCursor)
+{
+    while(stackCursor->advanceCursor(stackCursor))
+    {
+        uintptr_t address = growingcrashsymbolicator_callInstructionAddress(stackCursor->stackEntry.address);
+        markReferencedImage(referencedImages, growingcrashdl_imageIndexContainingAddress(address));
+    }
+}
+
+void growingcrbi_writeBinaryImages(const GrowingCrashReportWriter* const writer,
+                                   const char* const key,
+                                   const GrowingCrashReferencedImages* const referencedImages)
+{
+    const int imageCount = growingcrashdl_imageCount();
+
+    writer->beginArray(writer, key);
+    {
+        for(int iImg = 0; iImg < imageCount; iImg++)
+        {
+            if(referencedImages == NULL || isImageReferenced(referencedImages, iImg))
+            {
+                writeBinaryImage(writer, NULL, iImg);
+                continue;
+            }
+            GrowingCrashBinaryImage image = {0};
+            if(growingcrashdl_getBinaryImage(iImg, &image) &&
+               (image.crashInfoMessage != NULL || image.crashInfoMessage2 != NULL))
+            {
+                writeBinaryImage(writer, NULL, iImg);
+            }
+        }
+    }
+    writer->endContainer(writer);
+}
+
+void growingcrbi_writeCompactImageList(const GrowingCrashReportWriter* const writer, const char* const key)
+{
+    const int imageCount = growingcrashdl_imageCount();
+
+    writer->beginArray(writer, key);
+    {
+        for(int iImg = 0; iImg < imageCount; iImg++)
+        {
+            GrowingCrashBinaryImage image = {0};
+            if(growingcrashdl_getBinaryImage(iImg, &image))
+            {
+                writer->beginObject(writer, NULL);
+                {
+                    writer->addUIntegerElement(writer, GrowingCrashField_ImageAddress, image.address);
+                    writer->addUUIDElement(writer, GrowingCrashField_UUID, image.uuid);
+                }
+                writer->endContainer(writer);
+            }
+        }
+    }
+    writer->endContainer(writer);
+}
@@ -0,0 +1,92 @@
+//
+//  GrowingCrashReportBinaryImages.h
+//  GrowingAnalytics
+//
+//  Created by YoloMao on 2022/9/19.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+/* Writes the binary images section of a crash report.
+ *
+ * A report can describe every loaded image, or only those its backtraces
+ * point into. Writing is async-safe.
+ */
+
+
+#ifndef HDR_GrowingCrashReportBinaryImages_h
+#define HDR_GrowingCrashReportBinaryImages_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "GrowingCrashReportWriter.h"
+#include "GrowingCrashStackCursor.h"
+
+#include <stdint.h>
+
+/** Number of images whose references are tracked. Images past this are
+ * always described.
+ */
+#define GROWINGCRBI_MAX_TRACKED_IMAGES 2048
+
+/** The images that a report's backtraces point into, one bit per image index. */
+typedef struct
+{
+    uint8_t bits[GROWINGCRBI_MAX_TRACKED_IMAGES / 8];
+} GrowingCrashReferencedImages;
+
+/** Start finding referenced images. The main executable is always referenced.
+ *
+ * @param referencedImages The images to reset.
+ */
+void growingcrbi_resetReferencedImages(GrowingCrashReferencedImages* referencedImages);
+
+/** Mark the images that a backtrace points into.
+ *
+ * @param referencedImages The images to mark.
+ *
+ * @param stackCursor The stack cursor to read from. It is advanced to the end.
+ */
+void growingcrbi_addBacktrace(GrowingCrashReferencedImages* referencedImages, GrowingCrashStackCursor* stackCursor);
+
+/** Write information about images to a report.
+ *
+ * @param writer The writer.
+ *
+ * @param key The object key, if needed.
+ *
+ * @param referencedImages If not NULL, only describe these images, and images
+ *                         with a crash info message.
+ */
+void growingcrbi_writeBinaryImages(const GrowingCrashReportWriter* writer,
+                                   const char* key,
+                                   const GrowingCrashReferencedImages* referencedImages);
+
+/** Write the address and UUID of every image to a report.
+ *
+ * @param writer The writer.
+ *
+ * @param key The object key, if needed.
+ */
+void growingcrbi_writeCompactImageList(const GrowingCrashReportWriter* writer, const char* key);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HDR_GrowingCrashReportBinaryImages_h
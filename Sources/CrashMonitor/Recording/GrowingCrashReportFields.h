@@ -199,6 +199,7 @@
 #pragma mark Standard
 #define GrowingCrashField_AppStats              "application_stats"
 #define GrowingCrashField_BinaryImages          "binary_images"
+#define GrowingCrashField_LoadedImages          "loaded_images"
 #define GrowingCrashField_System                "system"
 #define GrowingCrashField_Memory                "memory"
 #define GrowingCrashField_Threads               "threads"
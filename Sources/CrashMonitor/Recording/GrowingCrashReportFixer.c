@@ -38,31 +38,36 @@
 //  See the License for the specific language governing permissions and
 //  limitations under the License.
 
+#include "GrowingCrashReportFixer.h"
 #include "GrowingCrashReportFields.h"
-#include "GrowingCrashSystemCapabilities.h"
 #include "GrowingCrashJSONCodec.h"
-#include "GrowingCrashDemangle_CPP.h"
-#if GROWINGCRASH_HAS_SWIFT
-#include "GrowingCrashDemangle_Swift.h"
-#endif
+#include "GrowingCrashBinaryCodec.h"
+#include "GrowingCrashDemangleCache.h"
 #include "GrowingCrashDate.h"
+#include "GrowingCrashGrowableBuffer.h"
 #include "GrowingCrashLogger.h"
 
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
 #define MAX_DEPTH 100
-#define MAX_NAME_LENGTH 100
+#define MAX_PATH_NODES 512
 #define REPORT_VERSION_COMPONENTS_COUNT 3
+#define STRING_BUFFER_LENGTH 10000
+#define OUTPUT_BUFFER_LENGTH 32768
 
-static char* datePaths[][MAX_DEPTH] =
+/** Internal action, only used for the report version fields. */
+#define ACTION_SAVE_VERSION (1 << 7)
+
+static const char* datePaths[][MAX_DEPTH] =
 {
     {"", GrowingCrashField_Report, GrowingCrashField_Timestamp},
     {"", GrowingCrashField_RecrashReport, GrowingCrashField_Report, GrowingCrashField_Timestamp},
 };
 static int datePathsCount = sizeof(datePaths) / sizeof(*datePaths);
 
-static char* demanglePaths[][MAX_DEPTH] =
+static const char* demanglePaths[][MAX_DEPTH] =
 {
     {"", GrowingCrashField_Crash, GrowingCrashField_Threads, "", GrowingCrashField_Backtrace, GrowingCrashField_Contents, "", GrowingCrashField_SymbolName},
     {"", GrowingCrashField_RecrashReport, GrowingCrashField_Crash, GrowingCrashField_Threads, "", GrowingCrashField_Backtrace, GrowingCrashField_Contents, "", GrowingCrashField_SymbolName},
@@ -71,82 +76,255 @@ static char* demanglePaths[][MAX_DEPTH] =
 };
 static int demanglePathsCount = sizeof(demanglePaths) / sizeof(*demanglePaths);
 
-static char* versionPaths[][MAX_DEPTH] =
+static const char* versionPaths[][MAX_DEPTH] =
 {
     {"", GrowingCrashField_Report, GrowingCrashField_Version},
     {"", GrowingCrashField_RecrashReport, GrowingCrashField_Report, GrowingCrashField_Version},
 };
 static int versionPathsCount = sizeof(versionPaths) / sizeof(*versionPaths);
 
+
+// ============================================================================
+#pragma mark - Path Trie -
+// ============================================================================
+
+/* All of the paths above are compiled into a trie. Node 0 is the position
+ * before the top level element, and an empty name stands for an array
+ * element. While fixing up, the fixer keeps the node for each open container,
+ * so deciding what to do with an element is a single child lookup. Containers
+ * that aren't on any path get NO_NODE, and so does everything inside them.
+ */
+
+#define ROOT_NODE 0
+#define NO_NODE -1
+
 typedef struct
 {
-    GrowingCrashJSONEncodeContext* encodeContext;
-    int reportVersionComponents[REPORT_VERSION_COMPONENTS_COUNT];
-    char objectPath[MAX_DEPTH][MAX_NAME_LENGTH];
-    int currentDepth;
-    char* outputPtr;
-    int outputBytesLeft;
-} FixupContext;
+    /** Name of the element. Must outlive the trie. */
+    const char* name;
+    int nameLength;
+    int firstChild;
+    int nextSibling;
+    /** GrowingCrashFixupAction flags for an element at this node. */
+    int actions;
+} PathNode;
 
-static bool increaseDepth(FixupContext* context, const char* name)
+static PathNode g_pathNodes[MAX_PATH_NODES] =
 {
-    if(context->currentDepth >= MAX_DEPTH)
+    {.name = "", .nameLength = 0, .firstChild = NO_NODE, .nextSibling = NO_NODE, .actions = 0},
+};
+static int g_pathNodeCount = 1;
+static pthread_rwlock_t g_pathLock = PTHREAD_RWLOCK_INITIALIZER;
+static pthread_once_t g_builtInPathsOnce = PTHREAD_ONCE_INIT;
+
+static int findChildNode(const PathNode* nodes, int node, const char* name, int nameLength)
+{
+    if(node == NO_NODE)
     {
-        return false;
+        return NO_NODE;
     }
-    if(name == NULL)
+    for(int child = nodes[node].firstChild; child != NO_NODE; child = nodes[child].nextSibling)
     {
-        *context->objectPath[context->currentDepth] = '\0';
+        if(nodes[child].nameLength == nameLength && memcmp(nodes[child].name, name, (size_t)nameLength) == 0)
+        {
+            return child;
+        }
     }
-    else
+    return NO_NODE;
+}
+
+/** Add a path to the trie. Call with g_pathLock held for writing.
+ * Nodes are only added once all of them are known to fit.
+ */
+static bool addPathNodes(const char* const* names, int namesCount, int actions)
+{
+    int node = ROOT_NODE;
+    int depth = 0;
+    for(; depth < namesCount; depth++)
     {
-        strncpy(context->objectPath[context->currentDepth], name, sizeof(context->objectPath[context->currentDepth]));
+        int child = findChildNode(g_pathNodes, node, names[depth], (int)strlen(names[depth]));
+        if(child == NO_NODE)
+        {
+            break;
+        }
+        node = child;
     }
-    context->currentDepth++;
+    if(g_pathNodeCount + namesCount - depth > MAX_PATH_NODES)
+    {
+        return false;
+    }
+    for(; depth < namesCount; depth++)
+    {
+        PathNode* child = &g_pathNodes[g_pathNodeCount];
+        child->name = names[depth];
+        child->nameLength = (int)strlen(names[depth]);
+        child->firstChild = NO_NODE;
+        child->nextSibling = g_pathNodes[node].firstChild;
+        child->actions = 0;
+        g_pathNodes[node].firstChild = g_pathNodeCount;
+        node = g_pathNodeCount++;
+    }
+    g_pathNodes[node].actions |= actions;
     return true;
 }
 
-static bool decreaseDepth(FixupContext* context)
+static void addBuiltInPaths(const char* paths[][MAX_DEPTH], int pathsCount, int actions)
 {
-    if(context->currentDepth <= 0)
+    for(int i = 0; i < pathsCount; i++)
     {
-        return false;
+        int namesCount = 0;
+        while(namesCount < MAX_DEPTH && paths[i][namesCount] != NULL)
+        {
+            namesCount++;
+        }
+        addPathNodes(paths[i], namesCount, actions);
     }
-    context->currentDepth--;
-    return true;
 }
 
-static bool matchesPath(FixupContext* context, char** path, const char* finalName)
+static void initBuiltInPaths(void)
 {
-    if(finalName == NULL)
+    pthread_rwlock_wrlock(&g_pathLock);
+    addBuiltInPaths(datePaths, datePathsCount, GrowingCrashFixupActionFixDate);
+    addBuiltInPaths(demanglePaths, demanglePathsCount, GrowingCrashFixupActionDemangle);
+    addBuiltInPaths(versionPaths, versionPathsCount, ACTION_SAVE_VERSION);
+    pthread_rwlock_unlock(&g_pathLock);
+}
+
+bool growingcrf_addFixupPath(const char* path, GrowingCrashFixupAction action)
+{
+    if(path == NULL || *path != '/' || (action & ~(GrowingCrashFixupActionFixDate | GrowingCrashFixupActionDemangle)) != 0)
     {
-        finalName = "";
+        GrowingCrashLOG_ERROR("Invalid fixup path %s", path == NULL ? "(null)" : path);
+        return false;
     }
 
-    for(int i = 0;i < context->currentDepth; i++)
+    // The names point into the copy, so it is kept for as long as the trie.
+    char* names = strdup(path + 1);
+    if(names == NULL)
+    {
+        return false;
+    }
+    const char* nameList[MAX_DEPTH] = {""};
+    int namesCount = 1;
+    for(char* name = names;; name++)
     {
-        if(strncmp(context->objectPath[i], path[i], MAX_NAME_LENGTH) != 0)
+        if(namesCount >= MAX_DEPTH)
         {
+            GrowingCrashLOG_ERROR("Fixup path %s is too deep", path);
+            free(names);
             return false;
         }
+        nameList[namesCount++] = name;
+        name = strchr(name, '/');
+        if(name == NULL)
+        {
+            break;
+        }
+        *name = '\0';
     }
-    if(strncmp(finalName, path[context->currentDepth], MAX_NAME_LENGTH) != 0)
+
+    pthread_once(&g_builtInPathsOnce, initBuiltInPaths);
+    pthread_rwlock_wrlock(&g_pathLock);
+    int nodeCount = g_pathNodeCount;
+    bool added = addPathNodes(nameList, namesCount, (int)action);
+    bool usesNames = g_pathNodeCount != nodeCount;
+    pthread_rwlock_unlock(&g_pathLock);
+
+    if(!added)
+    {
+        GrowingCrashLOG_ERROR("Too many fixup paths. Could not add %s", path);
+    }
+    if(!usesNames)
+    {
+        free(names);
+    }
+    return added;
+}
+
+
+/** Copy the trie for a fixup to use without holding g_pathLock, so that the
+ * sink it writes to may register more paths. Nodes are never removed, and
+ * the names they point to live for as long as the process does.
+ */
+static const PathNode* copyPathTrie(PathNode* nodes)
+{
+    pthread_once(&g_builtInPathsOnce, initBuiltInPaths);
+    pthread_rwlock_rdlock(&g_pathLock);
+    memcpy(nodes, g_pathNodes, sizeof(*nodes) * (size_t)g_pathNodeCount);
+    pthread_rwlock_unlock(&g_pathLock);
+    return nodes;
+}
+
+
+// ============================================================================
+#pragma mark - Fixup -
+// ============================================================================
+
+typedef struct
+{
+    GrowingCrashJSONEncodeContext* encodeContext;
+    int reportVersionComponents[REPORT_VERSION_COMPONENTS_COUNT];
+    /** Copy of the path trie, taken when the fixup starts. */
+    const PathNode* pathTrie;
+    /** Trie node of each open container. */
+    int pathNodes[MAX_DEPTH];
+    int currentDepth;
+    GrowingCrashJSONAddDataFunc addData;
+    void* addDataUserData;
+    char* outputBuffer;
+    int outputLength;
+    char* nameBuffer;
+    int nameBufferLength;
+    char* stringBuffer;
+    int stringBufferLength;
+} FixupContext;
+
+/** Copy an element name into the name buffer so it can be used as a C string.
+ * Names are short, so this is cheap compared to copying every string value.
+ */
+static int copyName(FixupContext* context, const GrowingCrashJSONStringView* nameView, const char** name, int* nameLength)
+{
+    if(nameView == NULL)
+    {
+        *name = NULL;
+        *nameLength = 0;
+        return GrowingCrashJSON_OK;
+    }
+    *name = context->nameBuffer;
+    return growingcrashjson_unescapeString(nameView, context->nameBuffer, context->nameBufferLength, nameLength);
+}
+
+static inline int currentPathNode(FixupContext* context)
+{
+    return context->currentDepth == 0 ? ROOT_NODE : context->pathNodes[context->currentDepth - 1];
+}
+
+static bool increaseDepth(FixupContext* context, const char* name, int nameLength)
+{
+    if(context->currentDepth >= MAX_DEPTH)
     {
         return false;
     }
+    int node = findChildNode(context->pathTrie, currentPathNode(context), name == NULL ? "" : name, nameLength);
+    context->pathNodes[context->currentDepth++] = node;
     return true;
 }
 
-static bool matchesAPath(FixupContext* context, const char* name, char* paths[][MAX_DEPTH], int pathsCount)
+static bool decreaseDepth(FixupContext* context)
 {
-    for(int i = 0; i < pathsCount; i++)
+    if(context->currentDepth <= 0)
     {
-        if(matchesPath(context, paths[i], name))
-        {
-            return true;
-        }
+        return false;
     }
-    return false;
+    context->currentDepth--;
+    return true;
+}
+
+/** Get the actions to apply to an element in the current container. */
+static int getActions(FixupContext* context, const char* name, int nameLength)
+{
+    int node = findChildNode(context->pathTrie, currentPathNode(context), name == NULL ? "" : name, nameLength);
+    return node == NO_NODE ? 0 : context->pathTrie[node].actions;
 }
 
 static bool matchesMinVersion(FixupContext* context, int major, int minor, int patch)
@@ -160,44 +338,49 @@ static bool matchesMinVersion(FixupContext* context, int major, int minor, int p
     return result;
 }
 
-static bool shouldDemangle(FixupContext* context, const char* name)
-{
-    return matchesAPath(context, name, demanglePaths, demanglePathsCount);
-}
-
-static bool shouldFixDate(FixupContext* context, const char* name)
-{
-    return matchesAPath(context, name, datePaths, datePathsCount);
-}
-
-static bool shouldSaveVersion(FixupContext* context, const char* name)
-{
-    return matchesAPath(context, name, versionPaths, versionPathsCount);
-}
-
-static int onBooleanElement(const char* const name,
+static int onBooleanElement(const GrowingCrashJSONStringView* const nameView,
                             const bool value,
                             void* const userData)
 {
     FixupContext* context = (FixupContext*)userData;
+    const char* name;
+    int nameLength;
+    int result = copyName(context, nameView, &name, &nameLength);
+    if(result != GrowingCrashJSON_OK)
+    {
+        return result;
+    }
     return growingcrashjson_addBooleanElement(context->encodeContext, name, value);
 }
 
-static int onFloatingPointElement(const char* const name,
+static int onFloatingPointElement(const GrowingCrashJSONStringView* const nameView,
                                   const double value,
                                   void* const userData)
 {
     FixupContext* context = (FixupContext*)userData;
+    const char* name;
+    int nameLength;
+    int result = copyName(context, nameView, &name, &nameLength);
+    if(result != GrowingCrashJSON_OK)
+    {
+        return result;
+    }
     return growingcrashjson_addFloatingPointElement(context->encodeContext, name, value);
 }
 
-static int onIntegerElement(const char* const name,
+static int onIntegerElement(const GrowingCrashJSONStringView* const nameView,
                             const int64_t value,
                             void* const userData)
 {
     FixupContext* context = (FixupContext*)userData;
-    int result = GrowingCrashJSON_OK;
-    if(shouldFixDate(context, name))
+    const char* name;
+    int nameLength;
+    int result = copyName(context, nameView, &name, &nameLength);
+    if(result != GrowingCrashJSON_OK)
+    {
+        return result;
+    }
+    if(getActions(context, name, nameLength) & GrowingCrashFixupActionFixDate)
     {
         char buffer[28];
 
@@ -219,40 +402,92 @@ static int onIntegerElement(const char* const name,
     return result;
 }
 
-static int onNullElement(const char* const name,
+static int onUIntegerElement(const GrowingCrashJSONStringView* const nameView,
+                             const uint64_t value,
+                             void* const userData)
+{
+    FixupContext* context = (FixupContext*)userData;
+    const char* name;
+    int nameLength;
+    int result = copyName(context, nameView, &name, &nameLength);
+    if(result != GrowingCrashJSON_OK)
+    {
+        return result;
+    }
+    return growingcrashjson_addUIntegerElement(context->encodeContext, name, value);
+}
+
+static int onNullElement(const GrowingCrashJSONStringView* const nameView,
                          void* const userData)
 {
     FixupContext* context = (FixupContext*)userData;
+    const char* name;
+    int nameLength;
+    int result = copyName(context, nameView, &name, &nameLength);
+    if(result != GrowingCrashJSON_OK)
+    {
+        return result;
+    }
     return growingcrashjson_addNullElement(context->encodeContext, name);
 }
 
-static int onStringElement(const char* const name,
-                           const char* const value,
+static int onStringElement(const GrowingCrashJSONStringView* const nameView,
+                           const GrowingCrashJSONStringView* const valueView,
                            void* const userData)
 {
     FixupContext* context = (FixupContext*)userData;
-    const char* stringValue = value;
-    char* demangled = NULL;
-    if(shouldDemangle(context, name))
+    const char* name;
+    int nameLength;
+    int result = copyName(context, nameView, &name, &nameLength);
+    if(result != GrowingCrashJSON_OK)
+    {
+        return result;
+    }
+
+    int actions = getActions(context, name, nameLength);
+    bool demangle = (actions & GrowingCrashFixupActionDemangle) != 0;
+    bool saveVersion = (actions & ACTION_SAVE_VERSION) != 0;
+    if(!demangle && !saveVersion)
     {
-        demangled = growingcrashdm_demangleCPP(value);
-#if GROWINGCRASH_HAS_SWIFT
-        if(demangled == NULL)
+        // Pass the value straight through without copying it.
+        if(!valueView->needsUnescape)
+        {
+            return growingcrashjson_addStringElement(context->encodeContext, name, valueView->ptr, valueView->length);
+        }
+        // Already escaped, so it can go out as-is.
+        if((result = growingcrashjson_beginStringElement(context->encodeContext, name)) != GrowingCrashJSON_OK)
         {
-            demangled = growingcrashdm_demangleSwift(value);
+            return result;
         }
-#endif
+        if((result = growingcrashjson_addRawJSONData(context->encodeContext, valueView->ptr, valueView->length)) != GrowingCrashJSON_OK)
+        {
+            return result;
+        }
+        return growingcrashjson_endStringElement(context->encodeContext);
+    }
+
+    const char* value = context->stringBuffer;
+    result = growingcrashjson_unescapeString(valueView, context->stringBuffer, context->stringBufferLength, NULL);
+    if(result != GrowingCrashJSON_OK)
+    {
+        return result;
+    }
+    const char* stringValue = value;
+    char* demangled = NULL;
+    if(demangle)
+    {
+        demangled = growingcrashdmc_demangle(value);
         if(demangled != NULL)
         {
             stringValue = demangled;
         }
     }
-    int result = growingcrashjson_addStringElement(context->encodeContext, name, stringValue, (int)strlen(stringValue));
+    result = growingcrashjson_addStringElement(context->encodeContext, name, stringValue, (int)strlen(stringValue));
     if(demangled != NULL)
     {
         free(demangled);
     }
-    if(shouldSaveVersion(context, name))
+    if(saveVersion)
     {
         memset(context->reportVersionComponents, 0, sizeof(context->reportVersionComponents));
         int versionPartsIndex = 0;
@@ -268,24 +503,38 @@ static int onStringElement(const char* const name,
     return result;
 }
 
-static int onBeginObject(const char* const name,
+static int onBeginObject(const GrowingCrashJSONStringView* const nameView,
                          void* const userData)
 {
     FixupContext* context = (FixupContext*)userData;
-    int result = growingcrashjson_beginObject(context->encodeContext, name);
-    if(!increaseDepth(context, name))
+    const char* name;
+    int nameLength;
+    int result = copyName(context, nameView, &name, &nameLength);
+    if(result != GrowingCrashJSON_OK)
+    {
+        return result;
+    }
+    result = growingcrashjson_beginObject(context->encodeContext, name);
+    if(!increaseDepth(context, name, nameLength))
     {
         return GrowingCrashJSON_ERROR_DATA_TOO_LONG;
     }
     return result;
 }
 
-static int onBeginArray(const char* const name,
+static int onBeginArray(const GrowingCrashJSONStringView* const nameView,
                         void* const userData)
 {
     FixupContext* context = (FixupContext*)userData;
-    int result = growingcrashjson_beginArray(context->encodeContext, name);
-    if(!increaseDepth(context, name))
+    const char* name;
+    int nameLength;
+    int result = copyName(context, nameView, &name, &nameLength);
+    if(result != GrowingCrashJSON_OK)
+    {
+        return result;
+    }
+    result = growingcrashjson_beginArray(context->encodeContext, name);
+    if(!increaseDepth(context, name, nameLength))
     {
         return GrowingCrashJSON_ERROR_DATA_TOO_LONG;
     }
@@ -309,28 +558,50 @@ static int onEndData(__unused void* const userData)
     return growingcrashjson_endEncode(context->encodeContext);
 }
 
+static int flushOutput(FixupContext* context)
+{
+    int result = GrowingCrashJSON_OK;
+    if(context->outputLength > 0)
+    {
+        result = context->addData(context->outputBuffer, context->outputLength, context->addDataUserData);
+        context->outputLength = 0;
+    }
+    return result;
+}
+
+/** Collect the encoder's many small writes into larger chunks for the sink. */
 static int addJSONData(const char* data, int length, void* userData)
 {
     FixupContext* context = (FixupContext*)userData;
-    if(length > context->outputBytesLeft)
+    if(length > OUTPUT_BUFFER_LENGTH - context->outputLength)
     {
-        return GrowingCrashJSON_ERROR_DATA_TOO_LONG;
+        int result = flushOutput(context);
+        if(result != GrowingCrashJSON_OK)
+        {
+            return result;
+        }
+        if(length >= OUTPUT_BUFFER_LENGTH)
+        {
+            return context->addData(data, length, context->addDataUserData);
+        }
     }
-    memcpy(context->outputPtr, data, length);
-    context->outputPtr += length;
-    context->outputBytesLeft -= length;
+    memcpy(context->outputBuffer + context->outputLength, data, (unsigned)length);
+    context->outputLength += length;
     
     return GrowingCrashJSON_OK;
 }
 
-char* growingcrf_fixupCrashReport(const char* crashReport)
+int growingcrf_fixupCrashReportToSink(const char* crashReport,
+                                      int crashReportLength,
+                                      GrowingCrashJSONAddDataFunc addData,
+                                      void* userData)
 {
     if(crashReport == NULL)
     {
-        return NULL;
+        return GrowingCrashJSON_ERROR_INVALID_DATA;
     }
 
-    GrowingCrashJSONDecodeCallbacks callbacks =
+    GrowingCrashJSONDecodeStringViewCallbacks callbacks =
     {
         .onBeginArray = onBeginArray,
         .onBeginObject = onBeginObject,
@@ -339,35 +610,89 @@ char* growingcrf_fixupCrashReport(const char* crashReport)
         .onEndData = onEndData,
         .onFloatingPointElement = onFloatingPointElement,
         .onIntegerElement = onIntegerElement,
+        .onUIntegerElement = onUIntegerElement,
         .onNullElement = onNullElement,
         .onStringElement = onStringElement,
     };
-    int stringBufferLength = 10000;
-    char* stringBuffer = malloc((unsigned)stringBufferLength);
-    int crashReportLength = (int)strlen(crashReport);
-    int fixedReportLength = (int)(crashReportLength * 1.5);
-    char* fixedReport = malloc((unsigned)fixedReportLength);
+    // The trie copy goes first, so that it is suitably aligned.
+    char* buffers = malloc(sizeof(g_pathNodes) + STRING_BUFFER_LENGTH + OUTPUT_BUFFER_LENGTH);
+    if(buffers == NULL)
+    {
+        GrowingCrashLOG_ERROR("Could not allocate fixup buffers");
+        return GrowingCrashJSON_ERROR_CANNOT_ADD_DATA;
+    }
+    char* stringBuffers = buffers + sizeof(g_pathNodes);
+    int nameBufferLength = STRING_BUFFER_LENGTH / 4;
     GrowingCrashJSONEncodeContext encodeContext;
     FixupContext fixupContext =
     {
         .encodeContext = &encodeContext,
         .reportVersionComponents = {0},
+        .pathTrie = copyPathTrie((PathNode*)buffers),
         .currentDepth = 0,
-        .outputPtr = fixedReport,
-        .outputBytesLeft = fixedReportLength,
+        .addData = addData,
+        .addDataUserData = userData,
+        .outputBuffer = stringBuffers + STRING_BUFFER_LENGTH,
+        .outputLength = 0,
+        .nameBuffer = stringBuffers,
+        .nameBufferLength = nameBufferLength,
+        .stringBuffer = stringBuffers + nameBufferLength,
+        .stringBufferLength = STRING_BUFFER_LENGTH - nameBufferLength,
     };
     
     growingcrashjson_beginEncode(&encodeContext, true, addJSONData, &fixupContext);
-    
-    int errorOffset = 0;
-    int result = growingcrashjson_decode(crashReport, (int)strlen(crashReport), stringBuffer, stringBufferLength, &callbacks, &fixupContext, &errorOffset);
-    *fixupContext.outputPtr = '\0';
-    free(stringBuffer);
+
+    int result;
+    if(growingcrashbin_isBinaryData(crashReport, crashReportLength))
+    {
+        result = growingcrashbin_decode(crashReport, crashReportLength, &callbacks, &fixupContext);
+        if(result == GrowingCrashJSON_ERROR_INCOMPLETE)
+        {
+            GrowingCrashLOG_WARN("Binary report is truncated. Keeping what was written.");
+            result = growingcrashjson_endEncode(&encodeContext);
+        }
+    }
+    else
+    {
+        int errorOffset = 0;
+        result = growingcrashjson_decodeStringViews(crashReport, crashReportLength, &callbacks, &fixupContext, &errorOffset);
+    }
+    if(result == GrowingCrashJSON_OK)
+    {
+        result = flushOutput(&fixupContext);
+    }
+    free(buffers);
     if(result != GrowingCrashJSON_OK)
     {
         GrowingCrashLOG_ERROR("Could not decode report: %s", growingcrashjson_stringForError(result));
-        free(fixedReport);
+    }
+    return result;
+}
+
+static int addToFixedReport(const char* data, int length, void* userData)
+{
+    return growingcrashgb_append((GrowingCrashGrowableBuffer*)userData, data, length)
+        ? GrowingCrashJSON_OK : GrowingCrashJSON_ERROR_CANNOT_ADD_DATA;
+}
+
+char* growingcrf_fixupCrashReport(const char* crashReport)
+{
+    if(crashReport == NULL)
+    {
+        return NULL;
+    }
+
+    int crashReportLength = (int)strlen(crashReport);
+    GrowingCrashGrowableBuffer buffer = {NULL, 0, 0};
+    if(!growingcrashgb_reserve(&buffer, crashReportLength + crashReportLength / 2 + 1))
+    {
+        return NULL;
+    }
+    if(growingcrf_fixupCrashReportToSink(crashReport, crashReportLength, addToFixedReport, &buffer) != GrowingCrashJSON_OK ||
+       !growingcrashgb_terminate(&buffer))
+    {
+        free(buffer.data);
         return NULL;
     }
-    return fixedReport;
+    return buffer.data;
 }
@@ -45,6 +45,22 @@
 extern "C" {
 #endif
 
+#include "GrowingCrashJSONCodec.h"
+
+#include <stdbool.h>
+
+/** What the fixer does to a field. */
+typedef enum
+{
+    /** Convert an integer timestamp into a date string, the same way as the
+     * report timestamp.
+     */
+    GrowingCrashFixupActionFixDate = 1 << 0,
+
+    /** Demangle a C++ or Swift symbol name string. */
+    GrowingCrashFixupActionDemangle = 1 << 1,
+} GrowingCrashFixupAction;
+
 
 /** Fixes up fields in a crash report that could not be fixed up at crash time.
  * Some fields, such a mangled fields and dates, cannot be fixed up at crash time
@@ -57,6 +73,42 @@ extern "C" {
  */
 char* growingcrf_fixupCrashReport(const char* crashReport);
 
+/** Fixes up a crash report, passing the result to a sink in chunks as it is
+ * produced rather than building it in memory. Accepts JSON or binary encoded
+ * reports, so binary reports don't need to be transcoded first.
+ *
+ * @param crashReport A raw report loaded or mapped from disk. It doesn't
+ *                    need to be null terminated.
+ *
+ * @param crashReportLength The length of the report in bytes.
+ *
+ * @param addData Receives the fixed up report in chunks. It may register
+ *                more paths, which apply from the next fixup on.
+ *
+ * @param userData User-specified data which gets passed to addData.
+ *
+ * @return GrowingCrashJSON_OK if the report was fixed up successfully.
+ */
+int growingcrf_fixupCrashReportToSink(const char* crashReport,
+                                      int crashReportLength,
+                                      GrowingCrashJSONAddDataFunc addData,
+                                      void* userData);
+
+
+/** Register an extra field for the fixer to rewrite, such as a timestamp or
+ * symbol name in a custom section of the report. Paths can't be removed once
+ * registered.
+ *
+ * @param path The names leading to the field from the top of the report,
+ *             each preceded by '/'. Array elements have an empty name.
+ *             For example "/user/launch_time" or "/user/frames//symbol".
+ *
+ * @param action What to do with the field.
+ *
+ * @return true if the path was registered.
+ */
+bool growingcrf_addFixupPath(const char* path, GrowingCrashFixupAction action);
+
 
 #ifdef __cplusplus
 }
@@ -41,15 +41,19 @@
 #include "GrowingCrashReportStore.h"
 #include "GrowingCrashLogger.h"
 #include "GrowingCrashFileUtils.h"
+#include "GrowingCrashBinaryCodec.h"
 
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
 #include <pthread.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 
@@ -61,29 +65,317 @@ static const char* g_appName;
 static const char* g_reportsPath;
 static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-static int compareInt64(const void* a, const void* b)
+// ============================================================================
+#pragma mark - Manifest -
+// ============================================================================
+
+/* The manifest is an append-only log of fixed size records. Appending a
+ * single record is one write() to an O_APPEND descriptor, which makes it
+ * safe to do from the crash handler without taking g_mutex. The in-memory
+ * index is brought up to date by reading any records appended since it was
+ * last synced, so listing reports costs one stat() instead of a directory
+ * scan.
+ */
+
+#define MANIFEST_MAGIC 0x4d524347 // "GCRM"
+#define MANIFEST_READ_RECORDS 256
+
+/** Compact the manifest when it holds this many more records than live reports. */
+#define MANIFEST_COMPACT_SLACK 64
+
+enum
+{
+    ManifestOpAdd = 1,
+    ManifestOpDelete,
+    ManifestOpSetUploadState,
+};
+
+typedef struct
+{
+    uint32_t magic;
+    uint8_t op;
+    uint8_t type;
+    uint8_t uploadState;
+    uint8_t reserved;
+    int64_t reportID;
+    int64_t size;
+    int64_t timestamp;
+    uint32_t checksum;
+    uint32_t padding;
+} ManifestRecord;
+
+static char g_manifestPath[GROWINGCRS_MAX_PATH_LENGTH];
+
+/** Reports on disk, sorted by ID. */
+static GrowingCrashStoredReportInfo* g_index;
+static int g_indexCount;
+static int g_indexCapacity;
+
+/** How far into the manifest the index has been synced, and how many records that is. */
+static off_t g_manifestOffset;
+static int g_manifestRecordCount;
+
+static uint32_t recordChecksum(const ManifestRecord* const record)
 {
-    int64_t diff = *(int64_t*)a - *(int64_t*)b;
-    if(diff < 0)
+    const uint8_t* bytes = (const uint8_t*)record;
+    uint32_t hash = 2166136261u;
+    for(size_t i = 0; i < offsetof(ManifestRecord, checksum); i++)
     {
-        return -1;
+        hash = (hash ^ bytes[i]) * 16777619u;
     }
-    else if(diff > 0)
+    return hash;
+}
+
+/** Append a record to the manifest.
+ *
+ * This function is async-safe.
+ */
+static void appendManifestRecord(const uint8_t op,
+                                 const int64_t reportID,
+                                 const GrowingCrashStoredReportType type,
+                                 const GrowingCrashReportUploadState uploadState,
+                                 const int64_t size)
+{
+    ManifestRecord record;
+    memset(&record, 0, sizeof(record));
+    record.magic = MANIFEST_MAGIC;
+    record.op = op;
+    record.type = (uint8_t)type;
+    record.uploadState = (uint8_t)uploadState;
+    record.reportID = reportID;
+    record.size = size;
+    record.timestamp = (int64_t)time(NULL);
+    record.checksum = recordChecksum(&record);
+
+    int fd = open(g_manifestPath, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if(fd < 0)
     {
-        return 1;
+        GrowingCrashLOG_ERROR("Could not open manifest %s: %s", g_manifestPath, strerror(errno));
+        return;
     }
-    return 0;
+    if(write(fd, &record, sizeof(record)) != (ssize_t)sizeof(record))
+    {
+        GrowingCrashLOG_ERROR("Could not append to manifest %s: %s", g_manifestPath, strerror(errno));
+    }
+    close(fd);
 }
 
-static inline int64_t getNextUniqueID()
+/** Find where a report ID is, or would be inserted, in the index. */
+static int findIndexPosition(const int64_t reportID)
 {
-    return g_nextUniqueIDHigh + g_nextUniqueIDLow++;
+    int low = 0;
+    int high = g_indexCount;
+    while(low < high)
+    {
+        int mid = low + (high - low) / 2;
+        if(g_index[mid].reportID < reportID)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low;
 }
 
-static void getCrashReportPathByID(int64_t id, char* pathBuffer)
+static GrowingCrashStoredReportInfo* findIndexEntry(const int64_t reportID)
 {
-    snprintf(pathBuffer, GROWINGCRS_MAX_PATH_LENGTH, "%s/%s-report-%016llx.json", g_reportsPath, g_appName, id);
-    
+    int position = findIndexPosition(reportID);
+    if(position < g_indexCount && g_index[position].reportID == reportID)
+    {
+        return &g_index[position];
+    }
+    return NULL;
+}
+
+static GrowingCrashStoredReportInfo* insertIndexEntry(const int64_t reportID)
+{
+    int position = findIndexPosition(reportID);
+    if(position < g_indexCount && g_index[position].reportID == reportID)
+    {
+        return &g_index[position];
+    }
+    if(g_indexCount == g_indexCapacity)
+    {
+        int newCapacity = g_indexCapacity == 0 ? 16 : g_indexCapacity * 2;
+        GrowingCrashStoredReportInfo* newIndex = realloc(g_index, sizeof(*g_index) * (unsigned)newCapacity);
+        if(newIndex == NULL)
+        {
+            GrowingCrashLOG_ERROR("Could not allocate report index of %d entries", newCapacity);
+            return NULL;
+        }
+        g_index = newIndex;
+        g_indexCapacity = newCapacity;
+    }
+    // IDs are time based, so new entries almost always go at the end.
+    memmove(&g_index[position + 1], &g_index[position], sizeof(*g_index) * (unsigned)(g_indexCount - position));
+    g_indexCount++;
+    GrowingCrashStoredReportInfo* entry = &g_index[position];
+    memset(entry, 0, sizeof(*entry));
+    entry->reportID = reportID;
+    return entry;
+}
+
+static void removeIndexEntry(const int64_t reportID)
+{
+    int position = findIndexPosition(reportID);
+    if(position < g_indexCount && g_index[position].reportID == reportID)
+    {
+        memmove(&g_index[position], &g_index[position + 1], sizeof(*g_index) * (unsigned)(g_indexCount - position - 1));
+        g_indexCount--;
+    }
+}
+
+static void clearIndex()
+{
+    g_indexCount = 0;
+    g_manifestOffset = 0;
+    g_manifestRecordCount = 0;
+}
+
+static bool applyManifestRecord(const ManifestRecord* const record)
+{
+    if(record->magic != MANIFEST_MAGIC || record->checksum != recordChecksum(record))
+    {
+        return false;
+    }
+    GrowingCrashStoredReportInfo* entry;
+    switch(record->op)
+    {
+        case ManifestOpAdd:
+            entry = insertIndexEntry(record->reportID);
+            if(entry != NULL)
+            {
+                // A pending crash report is committed by a second add, which keeps the original timestamp.
+                if(entry->timestamp == 0)
+                {
+                    entry->timestamp = record->timestamp;
+                }
+                entry->size = record->size;
+                entry->type = (GrowingCrashStoredReportType)record->type;
+                entry->uploadState = (GrowingCrashReportUploadState)record->uploadState;
+            }
+            return true;
+        case ManifestOpDelete:
+            removeIndexEntry(record->reportID);
+            return true;
+        case ManifestOpSetUploadState:
+            entry = findIndexEntry(record->reportID);
+            if(entry != NULL)
+            {
+                entry->uploadState = (GrowingCrashReportUploadState)record->uploadState;
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+/** Apply manifest records from g_manifestOffset onwards.
+ * A trailing partial record (from an interrupted write) is left for later.
+ *
+ * @return false if the manifest is damaged.
+ */
+static bool readManifest(const off_t manifestSize)
+{
+    int fd = open(g_manifestPath, O_RDONLY);
+    if(fd < 0)
+    {
+        GrowingCrashLOG_ERROR("Could not open manifest %s: %s", g_manifestPath, strerror(errno));
+        return false;
+    }
+
+    bool isSuccessful = true;
+    ManifestRecord records[MANIFEST_READ_RECORDS];
+    off_t wholeRecordsEnd = manifestSize - (manifestSize % (off_t)sizeof(ManifestRecord));
+    while(g_manifestOffset < wholeRecordsEnd)
+    {
+        size_t bytesToRead = sizeof(records);
+        if((off_t)bytesToRead > wholeRecordsEnd - g_manifestOffset)
+        {
+            bytesToRead = (size_t)(wholeRecordsEnd - g_manifestOffset);
+        }
+        ssize_t bytesRead = pread(fd, records, bytesToRead, g_manifestOffset);
+        if(bytesRead < (ssize_t)sizeof(ManifestRecord))
+        {
+            GrowingCrashLOG_ERROR("Could not read manifest %s: %s", g_manifestPath, strerror(errno));
+            isSuccessful = false;
+            break;
+        }
+        int recordCount = (int)(bytesRead / (ssize_t)sizeof(ManifestRecord));
+        for(int i = 0; i < recordCount; i++)
+        {
+            if(!applyManifestRecord(&records[i]))
+            {
+                GrowingCrashLOG_ERROR("Manifest %s is damaged at record %d", g_manifestPath, g_manifestRecordCount);
+                isSuccessful = false;
+                break;
+            }
+            g_manifestRecordCount++;
+            g_manifestOffset += (off_t)sizeof(ManifestRecord);
+        }
+        if(!isSuccessful)
+        {
+            break;
+        }
+    }
+
+    close(fd);
+    return isSuccessful;
+}
+
+/** Replace the manifest with one add record per live report.
+ * The new manifest is written to a temporary file and renamed into place.
+ */
+static void writeCompactManifest()
+{
+    char tempPath[GROWINGCRS_MAX_PATH_LENGTH];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", g_manifestPath);
+
+    int fd = open(tempPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0)
+    {
+        GrowingCrashLOG_ERROR("Could not open %s: %s", tempPath, strerror(errno));
+        return;
+    }
+
+    ManifestRecord records[MANIFEST_READ_RECORDS];
+    bool isSuccessful = true;
+    for(int start = 0; start < g_indexCount && isSuccessful; start += MANIFEST_READ_RECORDS)
+    {
+        int count = g_indexCount - start;
+        if(count > MANIFEST_READ_RECORDS)
+        {
+            count = MANIFEST_READ_RECORDS;
+        }
+        memset(records, 0, sizeof(records[0]) * (unsigned)count);
+        for(int i = 0; i < count; i++)
+        {
+            const GrowingCrashStoredReportInfo* entry = &g_index[start + i];
+            ManifestRecord* record = &records[i];
+            record->magic = MANIFEST_MAGIC;
+            record->op = ManifestOpAdd;
+            record->type = (uint8_t)entry->type;
+            record->uploadState = (uint8_t)entry->uploadState;
+            record->reportID = entry->reportID;
+            record->size = entry->size;
+            record->timestamp = entry->timestamp;
+            record->checksum = recordChecksum(record);
+        }
+        isSuccessful = growingcrashfu_writeBytesToFD(fd, (const char*)records, (int)(sizeof(records[0]) * (unsigned)count));
+    }
+    close(fd);
+
+    if(!isSuccessful || rename(tempPath, g_manifestPath) < 0)
+    {
+        GrowingCrashLOG_ERROR("Could not replace manifest %s: %s", g_manifestPath, strerror(errno));
+        unlink(tempPath);
+        return;
+    }
+    g_manifestOffset = (off_t)(sizeof(ManifestRecord) * (unsigned)g_indexCount);
+    g_manifestRecordCount = g_indexCount;
 }
 
 static int64_t getReportIDFromFilename(const char* filename)
@@ -96,77 +388,229 @@ static int64_t getReportIDFromFilename(const char* filename)
     return reportID;
 }
 
-static int getReportCount()
+/** Rebuild the index by scanning the reports directory, and write a fresh manifest.
+ * This is the recovery path for a missing or damaged manifest.
+ */
+static void rebuildIndexFromDirectory()
 {
-    int count = 0;
+    GrowingCrashLOG_INFO("Rebuilding report manifest from %s", g_reportsPath);
+    clearIndex();
+
     DIR* dir = opendir(g_reportsPath);
     if(dir == NULL)
     {
         GrowingCrashLOG_ERROR("Could not open directory %s", g_reportsPath);
-        goto done;
+        return;
     }
+
+    char path[GROWINGCRS_MAX_PATH_LENGTH];
     struct dirent* ent;
     while((ent = readdir(dir)) != NULL)
     {
-        if(getReportIDFromFilename(ent->d_name) > 0)
+        int64_t reportID = getReportIDFromFilename(ent->d_name);
+        if(reportID <= 0)
+        {
+            continue;
+        }
+        GrowingCrashStoredReportInfo* entry = insertIndexEntry(reportID);
+        if(entry == NULL)
         {
-            count++;
+            break;
+        }
+        snprintf(path, sizeof(path), "%s/%s", g_reportsPath, ent->d_name);
+        struct stat st;
+        if(stat(path, &st) == 0)
+        {
+            entry->size = (int64_t)st.st_size;
+            entry->timestamp = (int64_t)st.st_mtime;
         }
     }
+    closedir(dir);
 
-done:
-    if(dir != NULL)
-    {
-        closedir(dir);
-    }
-    return count;
+    writeCompactManifest();
 }
 
-static int getReportIDs(int64_t* reportIDs, int count)
+/** Bring the index up to date with records appended since the last sync,
+ * including any appended by the crash handler.
+ */
+static void syncIndex()
 {
-    int index = 0;
-    DIR* dir = opendir(g_reportsPath);
-    if(dir == NULL)
+    struct stat st;
+    if(stat(g_manifestPath, &st) < 0)
     {
-        GrowingCrashLOG_ERROR("Could not open directory %s", g_reportsPath);
-        goto done;
+        if(g_manifestOffset > 0)
+        {
+            rebuildIndexFromDirectory();
+        }
+        return;
+    }
+    if(st.st_size == g_manifestOffset)
+    {
+        return;
+    }
+    if(st.st_size < g_manifestOffset)
+    {
+        // Replaced underneath us. Start over.
+        clearIndex();
     }
+    if(!readManifest(st.st_size))
+    {
+        rebuildIndexFromDirectory();
+    }
+}
 
-    struct dirent* ent;
-    while((ent = readdir(dir)) != NULL && index < count)
+
+// ============================================================================
+#pragma mark - Utility -
+// ============================================================================
+
+static inline int64_t getNextUniqueID()
+{
+    return g_nextUniqueIDHigh + g_nextUniqueIDLow++;
+}
+
+static void getCrashReportPathByID(int64_t id, char* pathBuffer)
+{
+    snprintf(pathBuffer, GROWINGCRS_MAX_PATH_LENGTH, "%s/%s-report-%016llx.json", g_reportsPath, g_appName, id);
+    
+}
+
+static void deleteReportWithID(int64_t reportID)
+{
+    char path[GROWINGCRS_MAX_PATH_LENGTH];
+    getCrashReportPathByID(reportID, path);
+    growingcrashfu_removeFile(path, true);
+    appendManifestRecord(ManifestOpDelete, reportID, GrowingCrashStoredReportTypeUnknown, GrowingCrashReportUploadStateNotUploaded, 0);
+}
+
+typedef struct
+{
+    char* data;
+    int length;
+    int capacity;
+} TranscodeBuffer;
+
+static int addTranscodedData(const char* const data, const int length, void* const userData)
+{
+    TranscodeBuffer* buffer = (TranscodeBuffer*)userData;
+    if(buffer->length + length >= buffer->capacity)
     {
-        int64_t reportID = getReportIDFromFilename(ent->d_name);
-        if(reportID > 0)
+        int newCapacity = buffer->capacity * 2;
+        while(buffer->length + length >= newCapacity)
         {
-            reportIDs[index++] = reportID;
+            newCapacity *= 2;
         }
+        char* newData = realloc(buffer->data, (unsigned)newCapacity);
+        if(newData == NULL)
+        {
+            GrowingCrashLOG_ERROR("Could not allocate %d bytes", newCapacity);
+            return GrowingCrashJSON_ERROR_CANNOT_ADD_DATA;
+        }
+        buffer->data = newData;
+        buffer->capacity = newCapacity;
     }
+    memcpy(buffer->data + buffer->length, data, (unsigned)length);
+    buffer->length += length;
+    return GrowingCrashJSON_OK;
+}
 
-    qsort(reportIDs, (unsigned)count, sizeof(reportIDs[0]), compareInt64);
+/** Transcode a binary encoded report into a JSON string.
+ *
+ * @return The JSON report (caller must free), or NULL on failure.
+ */
+static char* transcodeBinaryReport(const char* const report, const int reportLength)
+{
+    TranscodeBuffer buffer =
+    {
+        .data = NULL,
+        .length = 0,
+        .capacity = reportLength * 4 + 1024,
+    };
+    buffer.data = malloc((unsigned)buffer.capacity);
+    if(buffer.data == NULL)
+    {
+        GrowingCrashLOG_ERROR("Could not allocate %d bytes", buffer.capacity);
+        return NULL;
+    }
 
-done:
-    if(dir != NULL)
+    GrowingCrashJSONEncodeContext encodeContext;
+    growingcrashjson_beginEncode(&encodeContext, true, addTranscodedData, &buffer);
+    int result = growingcrashbin_transcodeToJSON(&encodeContext, NULL, report, reportLength, true);
+    if(result == GrowingCrashJSON_ERROR_INCOMPLETE)
+    {
+        GrowingCrashLOG_WARN("Binary report is truncated. Keeping what was written.");
+        result = GrowingCrashJSON_OK;
+    }
+    if(result == GrowingCrashJSON_OK)
     {
-        closedir(dir);
+        result = growingcrashjson_endEncode(&encodeContext);
     }
-    return index;
+    if(result != GrowingCrashJSON_OK)
+    {
+        GrowingCrashLOG_ERROR("Could not transcode binary report: %s", growingcrashjson_stringForError(result));
+        free(buffer.data);
+        return NULL;
+    }
+    buffer.data[buffer.length] = '\0';
+    return buffer.data;
 }
 
+/** Delete the oldest reports beyond the maximum count.
+ * Only called before the crash handler is installed, so the manifest can
+ * be rewritten once rather than appending a record per deleted report.
+ */
 static void pruneReports()
 {
-    int reportCount = getReportCount();
-    if(reportCount > g_maxReportCount)
+    int excessCount = g_indexCount - g_maxReportCount;
+    if(excessCount > 0)
     {
-        int64_t reportIDs[reportCount];
-        reportCount = getReportIDs(reportIDs, reportCount);
-        
-        for(int i = 0; i < reportCount - g_maxReportCount; i++)
+        char path[GROWINGCRS_MAX_PATH_LENGTH];
+        for(int i = 0; i < excessCount; i++)
         {
-            growingcrs_deleteReportWithID(reportIDs[i]);
+            getCrashReportPathByID(g_index[i].reportID, path);
+            growingcrashfu_removeFile(path, true);
         }
+        g_indexCount -= excessCount;
+        memmove(&g_index[0], &g_index[excessCount], sizeof(*g_index) * (unsigned)g_indexCount);
+        writeCompactManifest();
     }
 }
 
+/** Settle crash reports that were never committed. A report with a file
+ * was written by a crash that didn't get as far as committing it, so it is
+ * kept with its size on disk. One with a missing or empty file was never
+ * written, and is dropped.
+ *
+ * @return true if the index changed.
+ */
+static bool reconcilePendingReports()
+{
+    bool isChanged = false;
+    char path[GROWINGCRS_MAX_PATH_LENGTH];
+    for(int i = g_indexCount - 1; i >= 0; i--)
+    {
+        GrowingCrashStoredReportInfo* entry = &g_index[i];
+        if(entry->size != 0)
+        {
+            continue;
+        }
+        getCrashReportPathByID(entry->reportID, path);
+        struct stat st;
+        if(stat(path, &st) == 0 && st.st_size > 0)
+        {
+            entry->size = (int64_t)st.st_size;
+        }
+        else
+        {
+            GrowingCrashLOG_INFO("Dropping report %" PRIx64 ", which was never written", entry->reportID);
+            growingcrashfu_removeFile(path, false);
+            removeIndexEntry(entry->reportID);
+        }
+        isChanged = true;
+    }
+    return isChanged;
+}
+
 static void initializeIDs()
 {
     time_t rawTime;
@@ -185,14 +629,32 @@ static void initializeIDs()
 }
 
 
-// Public API
+// ============================================================================
+#pragma mark - API -
+// ============================================================================
 
 void growingcrs_initialize(const char* appName, const char* reportsPath)
 {
     pthread_mutex_lock(&g_mutex);
+    free((void*)g_appName);
+    free((void*)g_reportsPath);
     g_appName = strdup(appName);
     g_reportsPath = strdup(reportsPath);
+    snprintf(g_manifestPath, sizeof(g_manifestPath), "%s/%s-reports.manifest", reportsPath, appName);
     growingcrashfu_makePath(reportsPath);
+    clearIndex();
+    struct stat st;
+    if(stat(g_manifestPath, &st) < 0 || !readManifest(st.st_size))
+    {
+        rebuildIndexFromDirectory();
+    }
+    else if(reconcilePendingReports() ||
+            g_manifestRecordCount > g_indexCount * 2 + MANIFEST_COMPACT_SLACK ||
+            g_manifestOffset != st.st_size)
+    {
+        // Also drops a partial record left by an interrupted write, so later appends stay aligned.
+        writeCompactManifest();
+    }
     pruneReports();
     initializeIDs();
     pthread_mutex_unlock(&g_mutex);
@@ -205,13 +667,29 @@ int64_t growingcrs_getNextCrashReport(char* crashReportPathBuffer)
     {
         getCrashReportPathByID(nextID, crashReportPathBuffer);
     }
+    appendManifestRecord(ManifestOpAdd, nextID, GrowingCrashStoredReportTypeCrash, GrowingCrashReportUploadStateNotUploaded, 0);
     return nextID;
 }
 
+void growingcrs_commitCrashReport(int64_t reportID)
+{
+    char path[GROWINGCRS_MAX_PATH_LENGTH];
+    getCrashReportPathByID(reportID, path);
+    struct stat st;
+    if(stat(path, &st) < 0)
+    {
+        GrowingCrashLOG_ERROR("Could not stat %s: %s", path, strerror(errno));
+        appendManifestRecord(ManifestOpDelete, reportID, GrowingCrashStoredReportTypeUnknown, GrowingCrashReportUploadStateNotUploaded, 0);
+        return;
+    }
+    appendManifestRecord(ManifestOpAdd, reportID, GrowingCrashStoredReportTypeCrash, GrowingCrashReportUploadStateNotUploaded, (int64_t)st.st_size);
+}
+
 int growingcrs_getReportCount()
 {
     pthread_mutex_lock(&g_mutex);
-    int count = getReportCount();
+    syncIndex();
+    int count = g_indexCount;
     pthread_mutex_unlock(&g_mutex);
     return count;
 }
@@ -219,22 +697,85 @@ int growingcrs_getReportCount()
 int growingcrs_getReportIDs(int64_t* reportIDs, int count)
 {
     pthread_mutex_lock(&g_mutex);
-    count = getReportIDs(reportIDs, count);
+    syncIndex();
+    if(count > g_indexCount)
+    {
+        count = g_indexCount;
+    }
+    for(int i = 0; i < count; i++)
+    {
+        reportIDs[i] = g_index[i].reportID;
+    }
     pthread_mutex_unlock(&g_mutex);
     return count;
 }
 
+bool growingcrs_getReportInfo(int64_t reportID, GrowingCrashStoredReportInfo* info)
+{
+    pthread_mutex_lock(&g_mutex);
+    syncIndex();
+    const GrowingCrashStoredReportInfo* entry = findIndexEntry(reportID);
+    if(entry != NULL && info != NULL)
+    {
+        *info = *entry;
+    }
+    pthread_mutex_unlock(&g_mutex);
+    return entry != NULL;
+}
+
+void growingcrs_setReportUploadState(int64_t reportID, GrowingCrashReportUploadState uploadState)
+{
+    pthread_mutex_lock(&g_mutex);
+    appendManifestRecord(ManifestOpSetUploadState, reportID, GrowingCrashStoredReportTypeUnknown, uploadState, 0);
+    syncIndex();
+    pthread_mutex_unlock(&g_mutex);
+}
+
 char* growingcrs_readReport(int64_t reportID)
+{
+    const char* report;
+    int length;
+    if(!growingcrs_mapReport(reportID, &report, &length))
+    {
+        return NULL;
+    }
+    char* result;
+    if(growingcrashbin_isBinaryData(report, length))
+    {
+        result = transcodeBinaryReport(report, length);
+    }
+    else
+    {
+        result = malloc((unsigned)length + 1);
+        if(result == NULL)
+        {
+            GrowingCrashLOG_ERROR("Could not allocate %d bytes", length + 1);
+        }
+        else
+        {
+            memcpy(result, report, (unsigned)length);
+            result[length] = '\0';
+        }
+    }
+    growingcrs_unmapReport(report, length);
+    return result;
+}
+
+bool growingcrs_mapReport(int64_t reportID, const char** data, int* length)
 {
     pthread_mutex_lock(&g_mutex);
     char path[GROWINGCRS_MAX_PATH_LENGTH];
     getCrashReportPathByID(reportID, path);
-    char* result;
-    growingcrashfu_readEntireFile(path, &result, NULL, 2000000);
+    bool result = growingcrashfu_mapFile(path, data, length);
     pthread_mutex_unlock(&g_mutex);
     return result;
 }
 
+void growingcrs_unmapReport(const char* data, int length)
+{
+    growingcrashfu_unmapFile(data, length);
+}
+
 int64_t growingcrs_addUserReport(const char* report, int reportLength)
 {
     pthread_mutex_lock(&g_mutex);
@@ -259,6 +800,8 @@ int64_t growingcrs_addUserReport(const char* report, int reportLength)
     {
         GrowingCrashLOG_ERROR("Expected to write %d bytes to file %s, but only wrote %d", crashReportPath, reportLength, bytesWritten);
     }
+    appendManifestRecord(ManifestOpAdd, currentID, GrowingCrashStoredReportTypeUser, GrowingCrashReportUploadStateNotUploaded, bytesWritten);
+    syncIndex();
 
 done:
     if(fd >= 0)
@@ -274,14 +817,16 @@ void growingcrs_deleteAllReports()
 {
     pthread_mutex_lock(&g_mutex);
     growingcrashfu_deleteContentsOfPath(g_reportsPath);
+    clearIndex();
     pthread_mutex_unlock(&g_mutex);
 }
 
 void growingcrs_deleteReportWithID(int64_t reportID)
 {
-    char path[GROWINGCRS_MAX_PATH_LENGTH];
-    getCrashReportPathByID(reportID, path);
-    growingcrashfu_removeFile(path, true);
+    pthread_mutex_lock(&g_mutex);
+    deleteReportWithID(reportID);
+    syncIndex();
+    pthread_mutex_unlock(&g_mutex);
 }
 
 void growingcrs_setMaxReportCount(int maxReportCount)
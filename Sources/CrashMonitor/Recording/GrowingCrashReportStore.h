@@ -46,11 +46,44 @@ extern "C" {
 #endif
 
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #define GROWINGCRS_MAX_PATH_LENGTH 500
 
+typedef enum
+{
+    GrowingCrashStoredReportTypeUnknown = 0,
+    GrowingCrashStoredReportTypeCrash,
+    GrowingCrashStoredReportTypeUser,
+} GrowingCrashStoredReportType;
+
+typedef enum
+{
+    GrowingCrashReportUploadStateNotUploaded = 0,
+    GrowingCrashReportUploadStateUploaded,
+} GrowingCrashReportUploadState;
+
+/** Manifest entry for a report on disk. */
+typedef struct
+{
+    int64_t reportID;
+
+    /** Size of the report file in bytes (0 if it was still being written). */
+    int64_t size;
+
+    /** When the report was added, in seconds since the epoch. */
+    int64_t timestamp;
+
+    GrowingCrashStoredReportType type;
+    GrowingCrashReportUploadState uploadState;
+} GrowingCrashStoredReportInfo;
+
 /** Initialize the report store.
+ *
+ * Reports are tracked in an append-only manifest file in the reports
+ * directory. The directory is only scanned if the manifest is missing or
+ * damaged.
  *
  * @param appName The application's name.
  * @param reportsPath Full path to directory where the reports are to be stored (path will be created if needed).
@@ -60,12 +93,28 @@ void growingcrs_initialize(const char* appName, const char* reportsPath);
 /** Get the next crash report to be generated.
  * Max length for paths is GROWINGCRS_MAX_PATH_LENGTH
  *
+ * The report is recorded in the manifest as pending until
+ * growingcrs_commitCrashReport() is called. If it is never committed,
+ * growingcrs_initialize() keeps it if its file was written, and drops it
+ * otherwise.
+ *
+ * This function is async-safe.
+ *
  * @param crashReportPathBuffer Buffer to store the crash report path.
  *
  * @return the report ID of the next report.
  */
 int64_t growingcrs_getNextCrashReport(char* crashReportPathBuffer);
 
+/** Record the final size of a crash report once it has been written.
+ * If the report's file doesn't exist, the report is dropped.
+ *
+ * This function is async-safe.
+ *
+ * @param reportID The report's ID.
+ */
+void growingcrs_commitCrashReport(int64_t reportID);
+
 /** Get the number of reports on disk.
  */
 int growingcrs_getReportCount(void);
@@ -79,7 +128,24 @@ int growingcrs_getReportCount(void);
  */
 int growingcrs_getReportIDs(int64_t* reportIDs, int count);
 
-/** Read a report.
+/** Get the manifest entry for a report.
+ *
+ * @param reportID The report's ID.
+ * @param info Filled in with the report's details.
+ *
+ * @return true if the report exists.
+ */
+bool growingcrs_getReportInfo(int64_t reportID, GrowingCrashStoredReportInfo* info);
+
+/** Record whether a report has been uploaded.
+ *
+ * @param reportID The report's ID.
+ * @param uploadState The new upload state.
+ */
+void growingcrs_setReportUploadState(int64_t reportID, GrowingCrashReportUploadState uploadState);
+
+/** Read a report. Reports written in the binary encoding are transcoded
+ * to JSON.
  *
  * @param reportID The report's ID.
  *
@@ -88,6 +154,24 @@ int growingcrs_getReportIDs(int64_t* reportIDs, int count);
  */
 char* growingcrs_readReport(int64_t reportID);
 
+/** Map a report's raw contents into memory without copying them onto the heap.
+ * The contents are either JSON or binary encoded (see growingcrashbin_isBinaryData()).
+ *
+ * @param reportID The report's ID.
+ * @param data Place to store a pointer to the contents (NOT null terminated).
+ * @param length Place to store the length of the contents.
+ *
+ * @return true if the report was mapped. Unmap it with growingcrs_unmapReport().
+ */
+bool growingcrs_mapReport(int64_t reportID, const char** data, int* length);
+
+/** Unmap a report mapped with growingcrs_mapReport().
+ *
+ * @param data The mapped contents.
+ * @param length The length of the contents.
+ */
+void growingcrs_unmapReport(const char* data, int length);
+
 /** Add a custom report to the store.
  *
  * @param report The report's contents (must be JSON encoded).
@@ -0,0 +1,168 @@
+//
+//  GrowingCrashReportThreadCapture.c
+//  GrowingAnalytics
+//
+//  Created by YoloMao on 2022/9/19.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#include "GrowingCrashReportThreadCapture.h"
+
+#include "GrowingCrashMachineContext.h"
+#include "GrowingCrashStackCursor_MachineContext.h"
+
+//#define GrowingCrashLogger_LocalLevel TRACE
+#include "GrowingCrashLogger.h"
+
+#include <stdlib.h>
+
+
+// ============================================================================
+#pragma mark - Globals -
+// ============================================================================
+
+static bool g_captureThreadsBeforeWriting;
+
+/** GROWINGCRTC_MAX_CAPTURED_THREADS captured threads, followed by their
+ * machine contexts and backtraces in the same allocation. NULL until
+ * capturing is enabled.
+ */
+static GrowingCrashCapturedThread* g_capturedThreads;
+
+/** The event whose report is currently using g_capturedThreads, or NULL. */
+static const GrowingCrash_MonitorContext* g_capturedThreadsOwner;
+
+
+// ============================================================================
+#pragma mark - Utility -
+// ============================================================================
+
+/** Allocate the captured threads, and the arena for their machine contexts
+ * and backtraces.
+ *
+ * @return The captured threads, or NULL if they couldn't be allocated.
+ */
+static GrowingCrashCapturedThread* allocateCapturedThreads(void)
+{
+    size_t threadsSize = (sizeof(GrowingCrashCapturedThread) * GROWINGCRTC_MAX_CAPTURED_THREADS + 15) & ~(size_t)15;
+    size_t contextSize = ((size_t)growingcrashmc_contextSize() + 15) & ~(size_t)15;
+    size_t framesSize = sizeof(uintptr_t) * GROWINGCRTC_MAX_CAPTURED_FRAMES;
+    char* arena = malloc(threadsSize + (contextSize + framesSize) * GROWINGCRTC_MAX_CAPTURED_THREADS);
+    if(arena == NULL)
+    {
+        return NULL;
+    }
+
+    GrowingCrashCapturedThread* capturedThreads = (GrowingCrashCapturedThread*)arena;
+    char* contexts = arena + threadsSize;
+    uintptr_t* frames = (uintptr_t*)(contexts + contextSize * GROWINGCRTC_MAX_CAPTURED_THREADS);
+    for(int i = 0; i < GROWINGCRTC_MAX_CAPTURED_THREADS; i++)
+    {
+        capturedThreads[i].machineContext = (struct GrowingCrashMachineContext*)(contexts + contextSize * (size_t)i);
+        capturedThreads[i].backtrace = frames + GROWINGCRTC_MAX_CAPTURED_FRAMES * i;
+        capturedThreads[i].backtraceLength = 0;
+    }
+    return capturedThreads;
+}
+
+/** Fetch the machine context and walk the stack of every thread but the
+ * offending one.
+ *
+ * @param crash The crash handler context.
+ *
+ * @param threadCount The number of threads in the offending machine context.
+ *
+ * @return False if a backtrace couldn't be captured as it would be walked.
+ */
+static bool captureThreads(const GrowingCrash_MonitorContext* const crash, const int threadCount)
+{
+    const struct GrowingCrashMachineContext* const context = crash->offendingMachineContext;
+    GrowingCrashThread offendingThread = growingcrashmc_getThreadFromContext(context);
+
+    for(int i = 0; i < threadCount; i++)
+    {
+        GrowingCrashThread thread = growingcrashmc_getThreadAtIndex(context, i);
+        if(thread == offendingThread)
+        {
+            continue;
+        }
+        GrowingCrashCapturedThread* capturedThread = &g_capturedThreads[i];
+        capturedThread->backtraceLength = 0;
+        growingcrashmc_getContextForThread(thread, capturedThread->machineContext, false);
+
+        GrowingCrashStackCursor stackCursor;
+        growingcrashsc_initWithMachineContext(&stackCursor, GROWINGCRASHSC_STACK_OVERFLOW_THRESHOLD, capturedThread->machineContext);
+        while(stackCursor.advanceCursor(&stackCursor))
+        {
+            // A backtrace cursor would stop at an address of 0 or 1.
+            if(stackCursor.stackEntry.address <= 1 || capturedThread->backtraceLength >= GROWINGCRTC_MAX_CAPTURED_FRAMES)
+            {
+                return false;
+            }
+            capturedThread->backtrace[capturedThread->backtraceLength++] = stackCursor.stackEntry.address;
+        }
+    }
+    return true;
+}
+
+
+// ============================================================================
+#pragma mark - API -
+// ============================================================================
+
+void growingcrtc_setCaptureThreadsBeforeWriting(bool captureThreadsBeforeWriting)
+{
+    if(captureThreadsBeforeWriting && g_capturedThreads == NULL)
+    {
+        g_capturedThreads = allocateCapturedThreads();
+        if(g_capturedThreads == NULL)
+        {
+            GrowingCrashLOG_ERROR("Could not allocate the thread capture arena");
+        }
+    }
+    g_captureThreadsBeforeWriting = captureThreadsBeforeWriting;
+}
+
+const GrowingCrashCapturedThread* growingcrtc_beginThreadCapture(const GrowingCrash_MonitorContext* const crash)
+{
+    if(!g_captureThreadsBeforeWriting || g_capturedThreads == NULL)
+    {
+        return NULL;
+    }
+    int threadCount = growingcrashmc_getThreadCount(crash->offendingMachineContext);
+    if(threadCount > GROWINGCRTC_MAX_CAPTURED_THREADS)
+    {
+        GrowingCrashLOG_DEBUG("Too many threads to capture (%d).", threadCount);
+        return NULL;
+    }
+    // Another report is being written at the same time.
+    const GrowingCrash_MonitorContext* expected = NULL;
+    if(!__atomic_compare_exchange_n(&g_capturedThreadsOwner, &expected, crash, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    {
+        return NULL;
+    }
+    if(!captureThreads(crash, threadCount))
+    {
+        __atomic_store_n(&g_capturedThreadsOwner, NULL, __ATOMIC_RELEASE);
+        return NULL;
+    }
+    return g_capturedThreads;
+}
+
+void growingcrtc_endThreadCapture(const GrowingCrash_MonitorContext* const crash)
+{
+    const GrowingCrash_MonitorContext* expected = crash;
+    __atomic_compare_exchange_n(&g_capturedThreadsOwner, &expected, NULL, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,94 @@
+//
+//  GrowingCrashReportThreadCapture.h
+//  GrowingAnalytics
+//
+//  Created by YoloMao on 2022/9/19.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+/* Captures the state of every thread before a report is encoded.
+ *
+ * Walking the stacks is the only part of a report that needs the other
+ * threads suspended. Capturing them into a preallocated arena first lets
+ * the rest of the report be encoded from the captured frames. Capturing is
+ * async-safe once enabled.
+ */
+
+
+#ifndef HDR_GrowingCrashReportThreadCapture_h
+#define HDR_GrowingCrashReportThreadCapture_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "GrowingCrashMonitorContext.h"
+#include "GrowingCrashStackCursor.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Number of threads whose stacks can be captured before the report is
+ * encoded. Reports with more threads walk each stack as they write it.
+ */
+#define GROWINGCRTC_MAX_CAPTURED_THREADS 100
+
+/** Number of frames captured per thread. A machine context stack cursor gives
+ * up at this depth.
+ */
+#define GROWINGCRTC_MAX_CAPTURED_FRAMES GROWINGCRASHSC_STACK_OVERFLOW_THRESHOLD
+
+/** A thread's state, captured before any of the report is encoded. */
+typedef struct
+{
+    /** The thread's machine context, in the capture arena. */
+    struct GrowingCrashMachineContext* machineContext;
+
+    /** The thread's backtrace, in the capture arena. */
+    uintptr_t* backtrace;
+    int backtraceLength;
+} GrowingCrashCapturedThread;
+
+/** Enable or disable capturing threads before a report is encoded.
+ * The capture arena is allocated the first time this is enabled.
+ * Not async-safe.
+ *
+ * @param captureThreadsBeforeWriting If true, capture threads.
+ */
+void growingcrtc_setCaptureThreadsBeforeWriting(bool captureThreadsBeforeWriting);
+
+/** Fetch the machine context and walk the stack of every thread but the
+ * offending one, if enabled. The other threads must be suspended.
+ *
+ * @param crash The crash handler context.
+ *
+ * @return The captured threads, by thread index, or NULL if they weren't
+ *         captured. The offending thread's entry is unused.
+ */
+const GrowingCrashCapturedThread* growingcrtc_beginThreadCapture(const GrowingCrash_MonitorContext* crash);
+
+/** Release the captured threads so that another report can use them.
+ *
+ * @param crash The crash handler context passed to growingcrtc_beginThreadCapture().
+ */
+void growingcrtc_endThreadCapture(const GrowingCrash_MonitorContext* crash);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HDR_GrowingCrashReportThreadCapture_h
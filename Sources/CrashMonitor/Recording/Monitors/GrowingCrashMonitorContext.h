@@ -101,6 +101,14 @@ typedef struct GrowingCrash_MonitorContext
      */
     void* stackCursor;
     
+    /** The threads suspended for an event that the process survives, or NULL.
+     * A report that captures every thread up front resumes them right away,
+     * and sets *suspendedThreads to NULL so that the monitor doesn't resume
+     * them again.
+     */
+    thread_act_array_t* suspendedThreads;
+    mach_msg_type_number_t suspendedThreadsCount;
+    
     struct
     {
         /** The mach exception type. */
@@ -234,6 +234,7 @@ static bool loadState(const char* const path)
     callbacks.onEndData = onEndData;
     callbacks.onFloatingPointElement = onFloatingPointElement;
     callbacks.onIntegerElement = onIntegerElement;
+    callbacks.onUIntegerElement = NULL;
     callbacks.onNullElement = onNullElement;
     callbacks.onStringElement = onStringElement;
 
@@ -41,6 +41,7 @@
 #include "GrowingCrashID.h"
 #include "GrowingCrashThread.h"
 #include "GrowingCrashMachineContext.h"
+#include "GrowingCrashStackCursor_Backtrace.h"
 #include "GrowingCrashStackCursor_SelfThread.h"
 
 //#define GrowingCrashLogger_LocalLevel TRACE
@@ -50,6 +51,8 @@
 
 #include <cxxabi.h>
 #include <dlfcn.h>
+#include <execinfo.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -60,12 +63,54 @@
 #define STACKTRACE_BUFFER_LENGTH 30
 #define DESCRIPTION_BUFFER_LENGTH 1000
 
+/** How many recent throws to remember per thread. */
+#define THROWS_PER_THREAD 4
+
+/** How many threads can record throws without allocating memory. */
+#define THROW_SLOT_COUNT 32
+
+/** How many thrown types to keep sampling counts for. Must be a power of 2. */
+#define THROWN_TYPE_COUNT 256
+
 
 // Compiler hints for "if" statements
 #define likely_if(x) if(__builtin_expect(x,1))
 #define unlikely_if(x) if(__builtin_expect(x,0))
 
 
+// ============================================================================
+#pragma mark - Types -
+// ============================================================================
+
+typedef struct
+{
+    /** The thrown object, used to tell which throw is being terminated on. */
+    void* exception;
+
+    /** 0 if the backtrace wasn't sampled. */
+    int backtraceLength;
+    uintptr_t backtrace[STACKTRACE_BUFFER_LENGTH];
+} ThrowTrace;
+
+/** The most recent throws on one thread. Only the owning thread reads or
+ * writes the traces, so they need no locking.
+ */
+typedef struct
+{
+    /** True while a thread owns this slot. Only used for slots in g_throwSlots. */
+    bool isClaimed;
+    bool isAllocated;
+    int nextTrace;
+    ThrowTrace traces[THROWS_PER_THREAD];
+} ThreadThrows;
+
+typedef struct
+{
+    const std::type_info* type;
+    uint32_t throwCount;
+} ThrownType;
+
+
 // ============================================================================
 #pragma mark - Globals -
 // ============================================================================
@@ -84,19 +129,199 @@ static char g_eventID[37];
 
 static GrowingCrash_MonitorContext g_monitorContext;
 
-// TODO: Thread local storage is not supported < ios 9.
-// Find some other way to do thread local. Maybe storage with lookup by tid?
 static GrowingCrashStackCursor g_stackCursor;
 
+/** Each thread's ThreadThrows. */
+static pthread_key_t g_threadThrowsKey;
+static bool g_threadThrowsKeyCreated = false;
+
+/** Threads claim one of these slots on their first throw, and only allocate
+ * memory if they are all taken.
+ */
+static ThreadThrows g_throwSlots[THROW_SLOT_COUNT];
+
+/** Capture one in every g_captureInterval throws of each type. */
+static int g_captureInterval = 1;
+
+/** Throw counts per type, used when g_captureInterval isn't 1. Types that
+ * don't fit share g_otherThrowCount.
+ */
+static ThrownType g_thrownTypes[THROWN_TYPE_COUNT];
+static uint32_t g_otherThrowCount;
+
+static uint64_t g_throws;
+static uint64_t g_captures;
+
+
+// ============================================================================
+#pragma mark - Thread Throws -
+// ============================================================================
+
+static void releaseThreadThrows(void* userData)
+{
+    ThreadThrows* throws = (ThreadThrows*)userData;
+    if(throws->isAllocated)
+    {
+        free(throws);
+    }
+    else
+    {
+        __atomic_store_n(&throws->isClaimed, false, __ATOMIC_RELEASE);
+    }
+}
+
+static ThreadThrows* claimThreadThrows(void)
+{
+    for(int i = 0; i < THROW_SLOT_COUNT; i++)
+    {
+        ThreadThrows* throws = &g_throwSlots[i];
+        bool expected = false;
+        if(!__atomic_load_n(&throws->isClaimed, __ATOMIC_RELAXED) &&
+           __atomic_compare_exchange_n(&throws->isClaimed, &expected, true, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        {
+            throws->nextTrace = 0;
+            memset(throws->traces, 0, sizeof(throws->traces));
+            return throws;
+        }
+    }
+    ThreadThrows* throws = (ThreadThrows*)calloc(1, sizeof(*throws));
+    if(throws != NULL)
+    {
+        throws->isAllocated = true;
+    }
+    return throws;
+}
+
+static ThreadThrows* getThreadThrows(bool create)
+{
+    if(!g_threadThrowsKeyCreated)
+    {
+        return NULL;
+    }
+    ThreadThrows* throws = (ThreadThrows*)pthread_getspecific(g_threadThrowsKey);
+    if(throws == NULL && create)
+    {
+        throws = claimThreadThrows();
+        if(throws != NULL && pthread_setspecific(g_threadThrowsKey, throws) != 0)
+        {
+            releaseThreadThrows(throws);
+            throws = NULL;
+        }
+    }
+    return throws;
+}
+
+/** Find the trace of the exception currently being handled on this thread.
+ * Falls back to the most recent throw only if the exception can't be
+ * identified (e.g. it was thrown by foreign code). An exception that can be
+ * identified but wasn't recorded gets no trace rather than someone else's.
+ */
+static ThrowTrace* findCurrentThrowTrace(void)
+{
+    ThreadThrows* throws = getThreadThrows(false);
+    if(throws == NULL)
+    {
+        return NULL;
+    }
+    void* exception = __cxxabiv1::__cxa_current_primary_exception();
+    if(exception != NULL)
+    {
+        __cxxabiv1::__cxa_decrement_exception_refcount(exception);
+    }
+    for(int i = 1; i <= THROWS_PER_THREAD; i++)
+    {
+        ThrowTrace* trace = &throws->traces[(throws->nextTrace - i + THROWS_PER_THREAD) % THROWS_PER_THREAD];
+        if(trace->exception == NULL)
+        {
+            break;
+        }
+        if(exception == NULL)
+        {
+            if(trace->backtraceLength > 0)
+            {
+                return trace;
+            }
+        }
+        else if(trace->exception == exception)
+        {
+            // An unsampled throw is better left without a trace than given
+            // someone else's.
+            return trace->backtraceLength > 0 ? trace : NULL;
+        }
+    }
+    return NULL;
+}
+
+
+// ============================================================================
+#pragma mark - Sampling -
+// ============================================================================
+
+/** Get the throw counter for a type, adding the type if it's new. */
+static uint32_t* getThrowCount(const std::type_info* type)
+{
+    uint32_t index = (uint32_t)(((uintptr_t)type >> 4) * 2654435761u) & (THROWN_TYPE_COUNT - 1);
+    for(int probe = 0; probe < THROWN_TYPE_COUNT; probe++)
+    {
+        ThrownType* entry = &g_thrownTypes[(index + probe) & (THROWN_TYPE_COUNT - 1)];
+        const std::type_info* entryType = __atomic_load_n(&entry->type, __ATOMIC_RELAXED);
+        if(entryType == NULL)
+        {
+            if(__atomic_compare_exchange_n(&entry->type, &entryType, type, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                return &entry->throwCount;
+            }
+        }
+        if(entryType == type)
+        {
+            return &entry->throwCount;
+        }
+    }
+    return &g_otherThrowCount;
+}
+
+/** Decide whether to capture a throw: always the first throw of a type, then
+ * one in every g_captureInterval.
+ */
+static bool shouldCapture(const std::type_info* type)
+{
+    int interval = g_captureInterval;
+    likely_if(interval == 1 || type == NULL)
+    {
+        return true;
+    }
+    uint32_t count = __atomic_fetch_add(getThrowCount(type), 1, __ATOMIC_RELAXED);
+    if(count == 0)
+    {
+        return true;
+    }
+    return interval > 0 && count % (uint32_t)interval == 0;
+}
+
 // ============================================================================
 #pragma mark - Callbacks -
 // ============================================================================
 
-static void captureStackTrace(void*, std::type_info*, void (*)(void*))
+__attribute__((noinline))
+static void captureStackTrace(void* thrown_exception, std::type_info* tinfo, void (*)(void*))
 {
     if(g_captureNextStackTrace)
     {
-        growingcrashsc_initSelfThread(&g_stackCursor, 2);
+        __atomic_fetch_add(&g_throws, 1, __ATOMIC_RELAXED);
+        ThreadThrows* throws = getThreadThrows(true);
+        unlikely_if(throws == NULL)
+        {
+            return;
+        }
+        ThrowTrace* trace = &throws->traces[throws->nextTrace];
+        throws->nextTrace = (throws->nextTrace + 1) % THROWS_PER_THREAD;
+        trace->exception = thrown_exception;
+        trace->backtraceLength = 0;
+        if(shouldCapture(tinfo))
+        {
+            __atomic_fetch_add(&g_captures, 1, __ATOMIC_RELAXED);
+            trace->backtraceLength = backtrace((void**)trace->backtrace, STACKTRACE_BUFFER_LENGTH);
+        }
     }
 }
 
@@ -111,7 +336,7 @@ extern "C"
         static cxa_throw_type orig_cxa_throw = NULL;
         if (g_cxaSwapEnabled == false)
         {
-            captureStackTrace(NULL, NULL, NULL);
+            captureStackTrace(thrown_exception, tinfo, NULL);
         }
         unlikely_if(orig_cxa_throw == NULL)
         {
@@ -141,6 +366,8 @@ static void CPPExceptionTerminate(void)
         GrowingCrash_MonitorContext* crashContext = &g_monitorContext;
         memset(crashContext, 0, sizeof(*crashContext));
 
+        growingcrashcm_initCPPExceptionStackCursor(&g_stackCursor);
+
         char descriptionBuff[DESCRIPTION_BUFFER_LENGTH];
         const char* description = descriptionBuff;
         descriptionBuff[0] = 0;
@@ -218,6 +445,7 @@ static void initialize()
     {
         isInitialized = true;
         growingcrashsc_initCursor(&g_stackCursor, NULL, NULL);
+        g_threadThrowsKeyCreated = pthread_key_create(&g_threadThrowsKey, releaseThreadThrows) == 0;
     }
 }
 
@@ -255,6 +483,37 @@ extern "C" void growingcrashcm_enableSwapCxaThrow(void)
     }
 }
 
+extern "C" __attribute__((noinline)) bool growingcrashcm_initCPPExceptionStackCursor(GrowingCrashStackCursor* cursor)
+{
+    ThrowTrace* trace = findCurrentThrowTrace();
+    if(trace != NULL)
+    {
+        // Skip captureStackTrace() and __cxa_throw().
+        growingcrashsc_initWithBacktrace(cursor, trace->backtrace, trace->backtraceLength, 2);
+        return true;
+    }
+    // Skip this function.
+    growingcrashsc_initSelfThread(cursor, 1);
+    return false;
+}
+
+extern "C" void growingcrashcm_setCPPExceptionCaptureInterval(int interval)
+{
+    g_captureInterval = interval < 0 ? 0 : interval;
+}
+
+extern "C" void growingcrashcm_getCPPExceptionStats(GrowingCrashCPPExceptionStats* stats)
+{
+    stats->throws = __atomic_load_n(&g_throws, __ATOMIC_RELAXED);
+    stats->captures = __atomic_load_n(&g_captures, __ATOMIC_RELAXED);
+}
+
+extern "C" void growingcrashcm_resetCPPExceptionStats(void)
+{
+    __atomic_store_n(&g_throws, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_captures, 0, __ATOMIC_RELAXED);
+}
+
 extern "C" GrowingCrashMonitorAPI* growingcrashcm_cppexception_getAPI()
 {
     static GrowingCrashMonitorAPI api =
@@ -44,11 +44,49 @@ extern "C" {
 #endif
 
 #include "GrowingCrashMonitor.h"
+#include "GrowingCrashStackCursor.h"
+
+#include <stdint.h>
+
+typedef struct
+{
+    /** Exceptions thrown while the monitor was enabled. */
+    uint64_t throws;
+
+    /** Throws whose backtrace was captured. */
+    uint64_t captures;
+} GrowingCrashCPPExceptionStats;
 
 /** Enable swapping of __cxa_trow symbol with lazy symbols table
  */
 void growingcrashcm_enableSwapCxaThrow(void);
 
+/** Set how often to capture the backtrace of a thrown exception.
+ * The first throw of each type is always captured. After that, one in every
+ * interval throws of that type is, so code that uses exceptions for control
+ * flow doesn't pay for a backtrace on every throw.
+ *
+ * @param interval 1 to capture every throw, 0 to only capture the first
+ *                 throw of each type.
+ */
+void growingcrashcm_setCPPExceptionCaptureInterval(int interval);
+
+/** Get the throw and capture counters. */
+void growingcrashcm_getCPPExceptionStats(GrowingCrashCPPExceptionStats* stats);
+
+/** Reset the throw and capture counters. */
+void growingcrashcm_resetCPPExceptionStats(void);
+
+/** Initialize a stack cursor for the C++ exception currently being handled
+ * on this thread: the backtrace captured when it was thrown, or the calling
+ * thread's stack if its throw wasn't captured.
+ *
+ * @param cursor The stack cursor to initialize.
+ *
+ * @return true if the cursor walks the backtrace captured at the throw.
+ */
+bool growingcrashcm_initCPPExceptionStackCursor(GrowingCrashStackCursor* cursor);
+
 /** Access the Monitor API.
  */
 GrowingCrashMonitorAPI* growingcrashcm_cppexception_getAPI(void);
@@ -109,12 +109,16 @@ static void handleException(NSException* exception, BOOL currentSnapshotUserRepo
         crashContext->crashReason = [[exception reason] UTF8String];
         crashContext->stackCursor = &cursor;
         crashContext->currentSnapshotUserReported = currentSnapshotUserReported;
+        if (currentSnapshotUserReported) {
+            crashContext->suspendedThreads = &threads;
+            crashContext->suspendedThreadsCount = numThreads;
+        }
 
         GrowingCrashLOG_DEBUG(@"Calling main crash handler.");
         growingcrashcm_handleException(crashContext);
 
         free(callstack);
-        if (currentSnapshotUserReported) {
+        if (currentSnapshotUserReported && threads != NULL) {
             growingcrashmc_resumeEnvironment(threads, numThreads);
         }
         if (g_previousUncaughtExceptionHandler != NULL)
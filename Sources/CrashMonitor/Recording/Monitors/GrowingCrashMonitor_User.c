@@ -100,10 +100,15 @@ void growingcrashcm_reportUserException(const char* name,
         context.userException.lineOfCode = lineOfCode;
         context.userException.customStackTrace = stackTrace;
         context.stackCursor = &stackCursor;
+        if(logAllThreads && !terminateProgram)
+        {
+            context.suspendedThreads = &threads;
+            context.suspendedThreadsCount = numThreads;
+        }
 
         growingcrashcm_handleException(&context);
 
-        if(logAllThreads)
+        if(logAllThreads && threads != NULL)
         {
             growingcrashmc_resumeEnvironment(threads, numThreads);
         }
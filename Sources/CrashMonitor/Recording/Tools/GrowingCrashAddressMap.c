@@ -0,0 +1,148 @@
+//
+//  GrowingCrashAddressMap.c
+//  GrowingAnalytics
+//
+//  Created by YoloMao on 2022/9/19.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#include "GrowingCrashAddressMap.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    uintptr_t key;
+    uintptr_t value;
+} GrowingCrashAddressPair;
+
+typedef struct GrowingCrashAddressTable
+{
+    struct GrowingCrashAddressTable* nextRetired;
+    size_t count;
+    GrowingCrashAddressPair pairs[];
+} GrowingCrashAddressTable;
+
+/** Binary search for the first pair whose key is not below key. */
+static size_t lowerBound(const GrowingCrashAddressTable* table, uintptr_t key)
+{
+    size_t low = 0;
+    size_t high = table->count;
+    while(low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+        if(table->pairs[mid].key < key)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+/** Call with the map's mutex held. */
+static void freeRetiredTables(GrowingCrashAddressMap* map)
+{
+    while(map->retired != NULL)
+    {
+        GrowingCrashAddressTable* table = map->retired;
+        map->retired = table->nextRetired;
+        free(table);
+    }
+}
+
+bool growingcrasham_add(GrowingCrashAddressMap* map, uintptr_t key, uintptr_t value)
+{
+    pthread_mutex_lock(&map->mutex);
+    GrowingCrashAddressTable* oldTable = map->table;
+    size_t oldCount = oldTable == NULL ? 0 : oldTable->count;
+    size_t index = oldTable == NULL ? 0 : lowerBound(oldTable, key);
+    if(index < oldCount && oldTable->pairs[index].key == key)
+    {
+        pthread_mutex_unlock(&map->mutex);
+        return false;
+    }
+
+    GrowingCrashAddressTable* table = malloc(sizeof(*table) + sizeof(GrowingCrashAddressPair) * (oldCount + 1));
+    if(table == NULL)
+    {
+        pthread_mutex_unlock(&map->mutex);
+        return false;
+    }
+    table->nextRetired = NULL;
+    table->count = oldCount + 1;
+    if(oldTable != NULL)
+    {
+        memcpy(table->pairs, oldTable->pairs, sizeof(GrowingCrashAddressPair) * index);
+        memcpy(table->pairs + index + 1, oldTable->pairs + index, sizeof(GrowingCrashAddressPair) * (oldCount - index));
+    }
+    table->pairs[index].key = key;
+    table->pairs[index].value = value;
+
+    __atomic_store_n(&map->table, table, __ATOMIC_SEQ_CST);
+    if(oldTable != NULL)
+    {
+        oldTable->nextRetired = map->retired;
+        map->retired = oldTable;
+    }
+    // A lookup that starts after this sees the new table, so if none are
+    // running, nothing can still be using the retired ones.
+    if(__atomic_load_n(&map->lookups, __ATOMIC_SEQ_CST) == 0)
+    {
+        freeRetiredTables(map);
+    }
+    pthread_mutex_unlock(&map->mutex);
+    return true;
+}
+
+uintptr_t growingcrasham_find(GrowingCrashAddressMap* map, uintptr_t key)
+{
+    uintptr_t value = 0;
+    __atomic_add_fetch(&map->lookups, 1, __ATOMIC_SEQ_CST);
+    const GrowingCrashAddressTable* table = __atomic_load_n(&map->table, __ATOMIC_SEQ_CST);
+    if(table != NULL)
+    {
+        size_t index = lowerBound(table, key);
+        if(index < table->count && table->pairs[index].key == key)
+        {
+            value = table->pairs[index].value;
+        }
+    }
+    __atomic_sub_fetch(&map->lookups, 1, __ATOMIC_RELEASE);
+    return value;
+}
+
+size_t growingcrasham_count(GrowingCrashAddressMap* map)
+{
+    __atomic_add_fetch(&map->lookups, 1, __ATOMIC_SEQ_CST);
+    const GrowingCrashAddressTable* table = __atomic_load_n(&map->table, __ATOMIC_SEQ_CST);
+    size_t count = table == NULL ? 0 : table->count;
+    __atomic_sub_fetch(&map->lookups, 1, __ATOMIC_RELEASE);
+    return count;
+}
+
+void growingcrasham_reset(GrowingCrashAddressMap* map)
+{
+    pthread_mutex_lock(&map->mutex);
+    GrowingCrashAddressTable* table = map->table;
+    map->table = NULL;
+    free(table);
+    freeRetiredTables(map);
+    pthread_mutex_unlock(&map->mutex);
+}
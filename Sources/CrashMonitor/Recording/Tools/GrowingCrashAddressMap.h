@@ -0,0 +1,97 @@
+//
+//  GrowingCrashAddressMap.h
+//  GrowingAnalytics
+//
+//  Created by YoloMao on 2022/9/19.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+/* A map from addresses to addresses that can be read without a lock.
+ *
+ * Entries are kept in a table sorted by key that is never modified once it
+ * has been published. Adding an entry publishes a copy of the table with the
+ * entry inserted, and retires the old table. Lookups binary search whatever
+ * table is current. Retired tables are freed once an add sees no lookups in
+ * progress.
+ *
+ * Adding is serialized by a mutex. Looking up is async-safe.
+ */
+
+
+#ifndef HDR_GrowingCrashAddressMap_h
+#define HDR_GrowingCrashAddressMap_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct GrowingCrashAddressTable;
+
+typedef struct
+{
+    /** The current table, or NULL if the map is empty. */
+    struct GrowingCrashAddressTable* table;
+
+    /** Tables that have been replaced, but might still be in use by a lookup. */
+    struct GrowingCrashAddressTable* retired;
+
+    /** Lookups in progress. */
+    int lookups;
+
+    /** Serializes adding entries. */
+    pthread_mutex_t mutex;
+} GrowingCrashAddressMap;
+
+#define GROWINGCRASHAM_INITIALIZER {NULL, NULL, 0, PTHREAD_MUTEX_INITIALIZER}
+
+/** Add an entry to a map. The first value added for a key is kept.
+ *
+ * @param map The map.
+ * @param key The key.
+ * @param value The value for the key.
+ *
+ * @return false if the key was already in the map, or memory ran out.
+ */
+bool growingcrasham_add(GrowingCrashAddressMap* map, uintptr_t key, uintptr_t value);
+
+/** Look up a key.
+ *
+ * @param map The map.
+ * @param key The key.
+ *
+ * @return The key's value, or 0 if the key isn't in the map.
+ */
+uintptr_t growingcrasham_find(GrowingCrashAddressMap* map, uintptr_t key);
+
+/** Get the number of entries in a map. */
+size_t growingcrasham_count(GrowingCrashAddressMap* map);
+
+/** Remove every entry from a map and free its memory. There must be no
+ * lookups in progress.
+ */
+void growingcrasham_reset(GrowingCrashAddressMap* map);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HDR_GrowingCrashAddressMap_h
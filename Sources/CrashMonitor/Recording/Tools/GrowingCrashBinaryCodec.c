@@ -0,0 +1,1698 @@
+//
+//  GrowingCrashBinaryCodec.c
+//  GrowingAnalytics
+//
+//  Created by YoloMao on 2022/9/19.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#include "GrowingCrashBinaryCodec.h"
+
+//#define GrowingCrashLogger_LocalLevel TRACE
+#include "GrowingCrashLogger.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+// ============================================================================
+#pragma mark - Configuration -
+// ============================================================================
+
+/** Size of the buffer used when copying a file into an embedded element. */
+#define GrowingCrashBIN_FileBufferSize 1024
+
+/** String buffer size used when decoding JSON. Matches growingcrashjson_addJSONElement(). */
+#define GrowingCrashBIN_MaxJSONNameLength 100
+#define GrowingCrashBIN_MaxJSONStringLength 5000
+
+/** Name buffer size used when transcoding. Longer names are emptied. */
+#define GrowingCrashBIN_MaxTranscodeNameLength 1024
+
+
+// ============================================================================
+#pragma mark - Helpers -
+// ============================================================================
+
+// Compiler hints for "if" statements
+#define likely_if(x) if(__builtin_expect(x,1))
+#define unlikely_if(x) if(__builtin_expect(x,0))
+
+
+// ============================================================================
+#pragma mark - Format -
+// ============================================================================
+
+static const char g_magic[] = {(char)0xC7, 'G', 'C', 'R'};
+#define FORMAT_VERSION 1
+#define HEADER_LENGTH (sizeof(g_magic) + 1)
+
+enum
+{
+    TYPE_END_CONTAINER = 0,
+    TYPE_BEGIN_OBJECT,
+    TYPE_BEGIN_ARRAY,
+    TYPE_NULL,
+    TYPE_FALSE,
+    TYPE_TRUE,
+    TYPE_UINTEGER,
+    TYPE_NEGATIVE_INTEGER,
+    TYPE_FLOATING_POINT,
+    TYPE_STRING,
+    TYPE_STRING_CHUNKS,
+    TYPE_DATA_CHUNKS,
+    TYPE_UUID,
+    TYPE_EMBEDDED_CHUNKS,
+};
+
+#define TYPE_FLAG_HAS_NAME 0x80
+#define TYPE_MASK 0x7f
+
+/** Low bits of an element's name varint. */
+enum
+{
+    NAME_INLINE = 0,
+    NAME_REFERENCE = 1,
+    NAME_INLINE_INTERNED = 2,
+};
+#define NAME_TAG_BITS 2
+#define NAME_TAG_MASK 3
+
+#define EMBEDDED_FLAG_CLOSE_LAST_CONTAINER 1
+
+#define MAX_VARINT_LENGTH 10
+#define UUID_LENGTH 16
+#define NAME_SLOT_COUNT (sizeof(((GrowingCrashBinaryEncodeContext*)0)->nameSlots) / sizeof(uint16_t))
+
+
+// ============================================================================
+#pragma mark - Encode -
+// ============================================================================
+
+static inline int addData(GrowingCrashBinaryEncodeContext* const context,
+                          const void* const data,
+                          const int length)
+{
+    return context->addData((const char*)data, length, context->userData);
+}
+
+static inline int encodeVarint(uint64_t value, uint8_t* const dst)
+{
+    int length = 0;
+    while(value >= 0x80)
+    {
+        dst[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    dst[length++] = (uint8_t)value;
+    return length;
+}
+
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+/** FNV-1a over a NUL terminated name, also measuring its length. */
+static inline uint32_t hashName(const char* const name, int* const length)
+{
+    uint32_t hash = FNV_OFFSET_BASIS;
+    const unsigned char* ch = (const unsigned char*)name;
+    for(; *ch != 0; ch++)
+    {
+        hash = (hash ^ *ch) * FNV_PRIME;
+    }
+    *length = (int)(ch - (const unsigned char*)name);
+    return hash;
+}
+
+/** FNV-1a over a name of known length. */
+static inline uint32_t hashNameWithLength(const char* const name, const int length)
+{
+    uint32_t hash = FNV_OFFSET_BASIS;
+    for(int i = 0; i < length; i++)
+    {
+        hash = (hash ^ (unsigned char)name[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+/** Look up an interned name.
+ *
+ * @return The name index, or -1 if not found, with *slot set to the hash
+ *         table slot where it would be inserted.
+ */
+static int findName(const GrowingCrashBinaryEncodeContext* const context,
+                    const char* const name,
+                    const int length,
+                    const uint32_t hash,
+                    unsigned* const slot)
+{
+    unsigned mask = NAME_SLOT_COUNT - 1;
+    unsigned index = hash & mask;
+    while(context->nameSlots[index] != 0)
+    {
+        int nameIndex = context->nameSlots[index] - 1;
+        if(context->nameHashes[nameIndex] == hash &&
+           context->nameLengths[nameIndex] == length &&
+           memcmp(context->nameStorage + context->nameOffsets[nameIndex], name, (size_t)length) == 0)
+        {
+            return nameIndex;
+        }
+        index = (index + 1) & mask;
+    }
+    *slot = index;
+    return -1;
+}
+
+static bool internName(GrowingCrashBinaryEncodeContext* const context,
+                       const char* const name,
+                       const int length,
+                       const uint32_t hash,
+                       const unsigned slot)
+{
+    unlikely_if(context->nameCount >= GrowingCrashBIN_MAX_NAMES ||
+                length > UINT8_MAX ||
+                context->nameStorageUsed + length > GrowingCrashBIN_NAME_STORAGE_SIZE)
+    {
+        return false;
+    }
+    int nameIndex = context->nameCount++;
+    memcpy(context->nameStorage + context->nameStorageUsed, name, (size_t)length);
+    context->nameOffsets[nameIndex] = (uint16_t)context->nameStorageUsed;
+    context->nameLengths[nameIndex] = (uint8_t)length;
+    context->nameHashes[nameIndex] = hash;
+    context->nameStorageUsed += length;
+    context->nameSlots[slot] = (uint16_t)(nameIndex + 1);
+    return true;
+}
+
+/** Write an element's type, name, and fixed size payload.
+ *
+ * @param name The element's name, or NULL.
+ *
+ * @param nameLength The name's length, or GrowingCrashJSON_SIZE_AUTOMATIC.
+ */
+static int beginElement(GrowingCrashBinaryEncodeContext* const context,
+                        const uint8_t type,
+                        const char* const name,
+                        int nameLength,
+                        const void* const payload,
+                        const int payloadLength)
+{
+    uint8_t buffer[1 + MAX_VARINT_LENGTH + UUID_LENGTH];
+    int length = 0;
+    bool isInlineName = false;
+
+    if(name == NULL)
+    {
+        buffer[length++] = type;
+    }
+    else
+    {
+        buffer[length++] = type | TYPE_FLAG_HAS_NAME;
+        uint32_t hash = nameLength == GrowingCrashJSON_SIZE_AUTOMATIC
+            ? hashName(name, &nameLength)
+            : hashNameWithLength(name, nameLength);
+        unsigned slot = 0;
+        int nameIndex = findName(context, name, nameLength, hash, &slot);
+        likely_if(nameIndex >= 0)
+        {
+            length += encodeVarint(((uint64_t)nameIndex << NAME_TAG_BITS) | NAME_REFERENCE, buffer + length);
+        }
+        else
+        {
+            int tag = internName(context, name, nameLength, hash, slot) ? NAME_INLINE_INTERNED : NAME_INLINE;
+            length += encodeVarint(((uint64_t)nameLength << NAME_TAG_BITS) | (uint64_t)tag, buffer + length);
+            isInlineName = true;
+        }
+    }
+
+    int result;
+    unlikely_if(isInlineName)
+    {
+        unlikely_if((result = addData(context, buffer, length)) != GrowingCrashJSON_OK)
+        {
+            return result;
+        }
+        unlikely_if((result = addData(context, name, nameLength)) != GrowingCrashJSON_OK)
+        {
+            return result;
+        }
+        buffer[0] = 0;
+        unlikely_if((result = addData(context, buffer, 1)) != GrowingCrashJSON_OK)
+        {
+            return result;
+        }
+        length = 0;
+    }
+
+    if(payloadLength > 0)
+    {
+        memcpy(buffer + length, payload, (size_t)payloadLength);
+        length += payloadLength;
+    }
+    return length > 0 ? addData(context, buffer, length) : GrowingCrashJSON_OK;
+}
+
+static int addVarintElement(GrowingCrashBinaryEncodeContext* const context,
+                            const uint8_t type,
+                            const char* const name,
+                            const uint64_t value)
+{
+    uint8_t payload[MAX_VARINT_LENGTH];
+    return beginElement(context, type, name, GrowingCrashJSON_SIZE_AUTOMATIC, payload, encodeVarint(value, payload));
+}
+
+static int appendChunk(GrowingCrashBinaryEncodeContext* const context,
+                       const char* const value,
+                       const int length)
+{
+    unlikely_if(length <= 0)
+    {
+        // A zero length chunk would terminate the element.
+        return GrowingCrashJSON_OK;
+    }
+    uint8_t header[MAX_VARINT_LENGTH];
+    int result = addData(context, header, encodeVarint((uint64_t)length, header));
+    unlikely_if(result != GrowingCrashJSON_OK)
+    {
+        return result;
+    }
+    return addData(context, value, length);
+}
+
+static int endChunks(GrowingCrashBinaryEncodeContext* const context)
+{
+    const uint8_t terminator = 0;
+    return addData(context, &terminator, 1);
+}
+
+int growingcrashbin_beginEncode(GrowingCrashBinaryEncodeContext* const context,
+                                GrowingCrashJSONAddDataFunc addData,
+                                void* const userData)
+{
+    context->addData = addData;
+    context->userData = userData;
+    context->containerLevel = 0;
+    context->nameCount = 0;
+    context->nameStorageUsed = 0;
+    memset(context->nameSlots, 0, sizeof(context->nameSlots));
+
+    char header[HEADER_LENGTH];
+    memcpy(header, g_magic, sizeof(g_magic));
+    header[sizeof(g_magic)] = FORMAT_VERSION;
+    return addData(header, sizeof(header), userData);
+}
+
+int growingcrashbin_endEncode(GrowingCrashBinaryEncodeContext* const context)
+{
+    int result = GrowingCrashJSON_OK;
+    while(context->containerLevel > 0)
+    {
+        unlikely_if((result = growingcrashbin_endContainer(context)) != GrowingCrashJSON_OK)
+        {
+            return result;
+        }
+    }
+    return result;
+}
+
+int growingcrashbin_addBooleanElement(GrowingCrashBinaryEncodeContext* const context,
+                                      const char* const name,
+                                      const bool value)
+{
+    return beginElement(context, value ? TYPE_TRUE : TYPE_FALSE, name, GrowingCrashJSON_SIZE_AUTOMATIC, NULL, 0);
+}
+
+int growingcrashbin_addIntegerElement(GrowingCrashBinaryEncodeContext* const context,
+                                      const char* const name,
+                                      const int64_t value)
+{
+    unlikely_if(value < 0)
+    {
+        return addVarintElement(context, TYPE_NEGATIVE_INTEGER, name, (uint64_t)(-(value + 1)));
+    }
+    return addVarintElement(context, TYPE_UINTEGER, name, (uint64_t)value);
+}
+
+int growingcrashbin_addUIntegerElement(GrowingCrashBinaryEncodeContext* const context,
+                                       const char* const name,
+                                       const uint64_t value)
+{
+    return addVarintElement(context, TYPE_UINTEGER, name, value);
+}
+
+int growingcrashbin_addFloatingPointElement(GrowingCrashBinaryEncodeContext* const context,
+                                            const char* const name,
+                                            const double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint8_t payload[sizeof(bits)];
+    for(int i = 0; i < (int)sizeof(payload); i++)
+    {
+        payload[i] = (uint8_t)(bits >> (i * 8));
+    }
+    return beginElement(context, TYPE_FLOATING_POINT, name, GrowingCrashJSON_SIZE_AUTOMATIC, payload, sizeof(payload));
+}
+
+int growingcrashbin_addNullElement(GrowingCrashBinaryEncodeContext* const context,
+                                   const char* const name)
+{
+    return beginElement(context, TYPE_NULL, name, GrowingCrashJSON_SIZE_AUTOMATIC, NULL, 0);
+}
+
+static int addStringElementWithNameLength(GrowingCrashBinaryEncodeContext* const context,
+                                          const char* const name,
+                                          const int nameLength,
+                                          const char* const value,
+                                          const int length)
+{
+    uint8_t payload[MAX_VARINT_LENGTH];
+    int result = beginElement(context, TYPE_STRING, name, nameLength, payload, encodeVarint((uint64_t)length, payload));
+    unlikely_if(result != GrowingCrashJSON_OK)
+    {
+        return result;
+    }
+    return length > 0 ? addData(context, value, length) : GrowingCrashJSON_OK;
+}
+
+int growingcrashbin_addStringElement(GrowingCrashBinaryEncodeContext* const context,
+                                     const char* const name,
+                                     const char* const value,
+                                     int length)
+{
+    unlikely_if(value == NULL)
+    {
+        return growingcrashbin_addNullElement(context, name);
+    }
+    if(length == GrowingCrashJSON_SIZE_AUTOMATIC)
+    {
+        length = (int)strlen(value);
+    }
+    return addStringElementWithNameLength(context, name, GrowingCrashJSON_SIZE_AUTOMATIC, value, length);
+}
+
+int growingcrashbin_beginStringElement(GrowingCrashBinaryEncodeContext* const context,
+                                       const char* const name)
+{
+    return beginElement(context, TYPE_STRING_CHUNKS, name, GrowingCrashJSON_SIZE_AUTOMATIC, NULL, 0);
+}
+
+int growingcrashbin_appendStringElement(GrowingCrashBinaryEncodeContext* const context,
+                                        const char* const value,
+                                        const int length)
+{
+    return appendChunk(context, value, length);
+}
+
+int growingcrashbin_endStringElement(GrowingCrashBinaryEncodeContext* const context)
+{
+    return endChunks(context);
+}
+
+int growingcrashbin_addDataElement(GrowingCrashBinaryEncodeContext* const context,
+                                   const char* const name,
+                                   const char* const value,
+                                   const int length)
+{
+    int result = growingcrashbin_beginDataElement(context, name);
+    if(result == GrowingCrashJSON_OK)
+    {
+        result = growingcrashbin_appendDataElement(context, value, length);
+    }
+    if(result == GrowingCrashJSON_OK)
+    {
+        result = growingcrashbin_endDataElement(context);
+    }
+    return result;
+}
+
+int growingcrashbin_beginDataElement(GrowingCrashBinaryEncodeContext* const context,
+                                     const char* const name)
+{
+    return beginElement(context, TYPE_DATA_CHUNKS, name, GrowingCrashJSON_SIZE_AUTOMATIC, NULL, 0);
+}
+
+int growingcrashbin_appendDataElement(GrowingCrashBinaryEncodeContext* const context,
+                                      const char* const value,
+                                      const int length)
+{
+    return appendChunk(context, value, length);
+}
+
+int growingcrashbin_endDataElement(GrowingCrashBinaryEncodeContext* const context)
+{
+    return endChunks(context);
+}
+
+int growingcrashbin_addUUIDElement(GrowingCrashBinaryEncodeContext* const context,
+                                   const char* const name,
+                                   const unsigned char* const value)
+{
+    unlikely_if(value == NULL)
+    {
+        return growingcrashbin_addNullElement(context, name);
+    }
+    return beginElement(context, TYPE_UUID, name, GrowingCrashJSON_SIZE_AUTOMATIC, value, UUID_LENGTH);
+}
+
+static int beginContainerWithNameLength(GrowingCrashBinaryEncodeContext* const context,
+                                        const uint8_t type,
+                                        const char* const name,
+                                        const int nameLength)
+{
+    int result = beginElement(context, type, name, nameLength, NULL, 0);
+    likely_if(result == GrowingCrashJSON_OK)
+    {
+        context->containerLevel++;
+    }
+    return result;
+}
+
+int growingcrashbin_beginObject(GrowingCrashBinaryEncodeContext* const context,
+                                const char* const name)
+{
+    return beginContainerWithNameLength(context, TYPE_BEGIN_OBJECT, name, GrowingCrashJSON_SIZE_AUTOMATIC);
+}
+
+int growingcrashbin_beginArray(GrowingCrashBinaryEncodeContext* const context,
+                               const char* const name)
+{
+    return beginContainerWithNameLength(context, TYPE_BEGIN_ARRAY, name, GrowingCrashJSON_SIZE_AUTOMATIC);
+}
+
+int growingcrashbin_endContainer(GrowingCrashBinaryEncodeContext* const context)
+{
+    unlikely_if(context->containerLevel <= 0)
+    {
+        return GrowingCrashJSON_OK;
+    }
+    context->containerLevel--;
+    const uint8_t type = TYPE_END_CONTAINER;
+    return addData(context, &type, 1);
+}
+
+
+// ============================================================================
+#pragma mark - Add JSON -
+// ============================================================================
+
+typedef struct
+{
+    GrowingCrashBinaryEncodeContext* encodeContext;
+    const char* firstName;
+    bool isFirstElement;
+    bool closeLastContainer;
+    char nameBuffer[GrowingCrashBIN_MaxJSONNameLength];
+    char stringBuffer[GrowingCrashBIN_MaxJSONStringLength];
+} AddJSONContext;
+
+/** Resolve a decoded element name to (ptr, length), unescaping if needed.
+ * The top level element takes the name given to growingcrashbin_addJSONElement().
+ */
+static int resolveJSONName(AddJSONContext* const context,
+                           const GrowingCrashJSONStringView* const name,
+                           const char** const ptr,
+                           int* const length)
+{
+    if(context->isFirstElement)
+    {
+        context->isFirstElement = false;
+        *ptr = context->firstName;
+        *length = GrowingCrashJSON_SIZE_AUTOMATIC;
+        return GrowingCrashJSON_OK;
+    }
+    if(name == NULL)
+    {
+        *ptr = NULL;
+        *length = GrowingCrashJSON_SIZE_AUTOMATIC;
+        return GrowingCrashJSON_OK;
+    }
+    if(!name->needsUnescape)
+    {
+        *ptr = name->ptr;
+        *length = name->length;
+        return GrowingCrashJSON_OK;
+    }
+    *ptr = context->nameBuffer;
+    return growingcrashjson_unescapeString(name, context->nameBuffer, sizeof(context->nameBuffer), length);
+}
+
+#define RESOLVE_JSON_NAME() \
+    AddJSONContext* context = (AddJSONContext*)userData; \
+    const char* namePtr; \
+    int nameLength; \
+    int result = resolveJSONName(context, name, &namePtr, &nameLength); \
+    unlikely_if(result != GrowingCrashJSON_OK) \
+    { \
+        return result; \
+    }
+
+static int addJSON_onBooleanElement(const GrowingCrashJSONStringView* const name, const bool value, void* const userData)
+{
+    RESOLVE_JSON_NAME();
+    return beginElement(context->encodeContext, value ? TYPE_TRUE : TYPE_FALSE, namePtr, nameLength, NULL, 0);
+}
+
+static int addJSON_onFloatingPointElement(const GrowingCrashJSONStringView* const name, const double value, void* const userData)
+{
+    RESOLVE_JSON_NAME();
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint8_t payload[sizeof(bits)];
+    for(int i = 0; i < (int)sizeof(payload); i++)
+    {
+        payload[i] = (uint8_t)(bits >> (i * 8));
+    }
+    return beginElement(context->encodeContext, TYPE_FLOATING_POINT, namePtr, nameLength, payload, sizeof(payload));
+}
+
+static int addJSON_onIntegerElement(const GrowingCrashJSONStringView* const name, const int64_t value, void* const userData)
+{
+    RESOLVE_JSON_NAME();
+    uint8_t payload[MAX_VARINT_LENGTH];
+    unlikely_if(value < 0)
+    {
+        return beginElement(context->encodeContext, TYPE_NEGATIVE_INTEGER, namePtr, nameLength,
+                            payload, encodeVarint((uint64_t)(-(value + 1)), payload));
+    }
+    return beginElement(context->encodeContext, TYPE_UINTEGER, namePtr, nameLength,
+                        payload, encodeVarint((uint64_t)value, payload));
+}
+
+static int addJSON_onUIntegerElement(const GrowingCrashJSONStringView* const name, const uint64_t value, void* const userData)
+{
+    RESOLVE_JSON_NAME();
+    uint8_t payload[MAX_VARINT_LENGTH];
+    return beginElement(context->encodeContext, TYPE_UINTEGER, namePtr, nameLength,
+                        payload, encodeVarint(value, payload));
+}
+
+static int addJSON_onNullElement(const GrowingCrashJSONStringView* const name, void* const userData)
+{
+    RESOLVE_JSON_NAME();
+    return beginElement(context->encodeContext, TYPE_NULL, namePtr, nameLength, NULL, 0);
+}
+
+static int addJSON_onStringElement(const GrowingCrashJSONStringView* const name,
+                                   const GrowingCrashJSONStringView* const value,
+                                   void* const userData)
+{
+    RESOLVE_JSON_NAME();
+    const char* valuePtr = value->ptr;
+    int valueLength = value->length;
+    if(value->needsUnescape)
+    {
+        valuePtr = context->stringBuffer;
+        result = growingcrashjson_unescapeString(value, context->stringBuffer, sizeof(context->stringBuffer), &valueLength);
+        unlikely_if(result != GrowingCrashJSON_OK)
+        {
+            return result;
+        }
+    }
+    return addStringElementWithNameLength(context->encodeContext, namePtr, nameLength, valuePtr, valueLength);
+}
+
+static int addJSON_onBeginObject(const GrowingCrashJSONStringView* const name, void* const userData)
+{
+    RESOLVE_JSON_NAME();
+    return beginContainerWithNameLength(context->encodeContext, TYPE_BEGIN_OBJECT, namePtr, nameLength);
+}
+
+static int addJSON_onBeginArray(const GrowingCrashJSONStringView* const name, void* const userData)
+{
+    RESOLVE_JSON_NAME();
+    return beginContainerWithNameLength(context->encodeContext, TYPE_BEGIN_ARRAY, namePtr, nameLength);
+}
+
+static int addJSON_onEndContainer(void* const userData)
+{
+    AddJSONContext* context = (AddJSONContext*)userData;
+    if(context->closeLastContainer || context->encodeContext->containerLevel > 2)
+    {
+        return growingcrashbin_endContainer(context->encodeContext);
+    }
+    return GrowingCrashJSON_OK;
+}
+
+static int addJSON_onEndData(__unused void* const userData)
+{
+    return GrowingCrashJSON_OK;
+}
+
+int growingcrashbin_addJSONElement(GrowingCrashBinaryEncodeContext* const encodeContext,
+                                   const char* const name,
+                                   const char* const jsonData,
+                                   const int jsonDataLength,
+                                   const bool closeLastContainer)
+{
+    GrowingCrashJSONDecodeStringViewCallbacks callbacks =
+    {
+        .onBeginArray = addJSON_onBeginArray,
+        .onBeginObject = addJSON_onBeginObject,
+        .onBooleanElement = addJSON_onBooleanElement,
+        .onEndContainer = addJSON_onEndContainer,
+        .onEndData = addJSON_onEndData,
+        .onFloatingPointElement = addJSON_onFloatingPointElement,
+        .onIntegerElement = addJSON_onIntegerElement,
+        .onUIntegerElement = addJSON_onUIntegerElement,
+        .onNullElement = addJSON_onNullElement,
+        .onStringElement = addJSON_onStringElement,
+    };
+    AddJSONContext context =
+    {
+        .encodeContext = encodeContext,
+        .firstName = name,
+        .isFirstElement = true,
+        .closeLastContainer = closeLastContainer,
+    };
+    int containerLevel = encodeContext->containerLevel;
+
+    int result = growingcrashjson_decodeStringViews(jsonData, jsonDataLength, &callbacks, &context, NULL);
+    while(closeLastContainer && encodeContext->containerLevel > containerLevel)
+    {
+        growingcrashbin_endContainer(encodeContext);
+    }
+
+    return result;
+}
+
+int growingcrashbin_addJSONFromFile(GrowingCrashBinaryEncodeContext* const context,
+                                    const char* const name,
+                                    const char* const filename,
+                                    const bool closeLastContainer)
+{
+    int fd = open(filename, O_RDONLY);
+    unlikely_if(fd < 0)
+    {
+        GrowingCrashLOG_ERROR("Could not open file %s: %s", filename, strerror(errno));
+        return GrowingCrashJSON_ERROR_INCOMPLETE;
+    }
+
+    const uint8_t flags = closeLastContainer ? EMBEDDED_FLAG_CLOSE_LAST_CONTAINER : 0;
+    int result = beginElement(context, TYPE_EMBEDDED_CHUNKS, name, GrowingCrashJSON_SIZE_AUTOMATIC, &flags, 1);
+    char buffer[GrowingCrashBIN_FileBufferSize];
+    while(result == GrowingCrashJSON_OK)
+    {
+        int bytesRead = (int)read(fd, buffer, sizeof(buffer));
+        if(bytesRead <= 0)
+        {
+            break;
+        }
+        result = appendChunk(context, buffer, bytesRead);
+    }
+    if(result == GrowingCrashJSON_OK)
+    {
+        result = endChunks(context);
+    }
+
+    close(fd);
+    return result;
+}
+
+
+// ============================================================================
+#pragma mark - Decode -
+// ============================================================================
+
+#define MAX_JSON_CONTAINER_LEVEL \
+    ((int)(sizeof(((GrowingCrashJSONEncodeContext*)0)->isObject) / sizeof(bool)) - 1)
+
+/** Holds names and values that can't be passed in place. */
+typedef struct
+{
+    char* data;
+    int length;
+    int capacity;
+} DecodeBuffer;
+
+/** State shared by a document and any documents embedded in it. */
+typedef struct
+{
+    GrowingCrashJSONDecodeStringViewCallbacks* callbacks;
+    void* userData;
+    DecodeBuffer nameBuffer;
+    DecodeBuffer valueBuffer;
+} DecodeState;
+
+typedef struct
+{
+    const uint8_t* ptr;
+    const uint8_t* end;
+    DecodeState* state;
+    const GrowingCrashJSONStringView* firstName;
+    bool closeLastContainer;
+    /** Containers opened outside of this document. */
+    int baseDepth;
+    /** Containers opened by this document that are still open. */
+    int depth;
+    int nameCount;
+    const char* names[GrowingCrashBIN_MAX_NAMES];
+} DecodeContext;
+
+static bool reserveDecodeBuffer(DecodeBuffer* const buffer, const int length)
+{
+    likely_if(buffer->length + length <= buffer->capacity)
+    {
+        return true;
+    }
+    int newCapacity = buffer->capacity > 0 ? buffer->capacity : 256;
+    while(buffer->length + length > newCapacity)
+    {
+        newCapacity *= 2;
+    }
+    char* newData = realloc(buffer->data, (size_t)newCapacity);
+    unlikely_if(newData == NULL)
+    {
+        GrowingCrashLOG_ERROR("Could not allocate %d bytes", newCapacity);
+        return false;
+    }
+    buffer->data = newData;
+    buffer->capacity = newCapacity;
+    return true;
+}
+
+static int addToDecodeBuffer(const char* const data, const int length, void* const userData)
+{
+    DecodeBuffer* buffer = (DecodeBuffer*)userData;
+    unlikely_if(!reserveDecodeBuffer(buffer, length))
+    {
+        return GrowingCrashJSON_ERROR_CANNOT_ADD_DATA;
+    }
+    memcpy(buffer->data + buffer->length, data, (size_t)length);
+    buffer->length += length;
+    return GrowingCrashJSON_OK;
+}
+
+static inline bool needsEscaping(const uint8_t* ptr, const uint8_t* const end)
+{
+    for(; ptr < end; ptr++)
+    {
+        unlikely_if(*ptr == '\\' || *ptr == '\"' || *ptr < ' ')
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Escape raw string chunks into a buffer using the JSON encoder, so that the
+ * view matches what decoding the transcoded JSON would produce. Characters the
+ * encoder rejects are dropped the same way they would have been at crash time.
+ */
+static int beginEscape(GrowingCrashJSONEncodeContext* const encodeContext, DecodeBuffer* const buffer)
+{
+    buffer->length = 0;
+    growingcrashjson_beginEncode(encodeContext, false, addToDecodeBuffer, buffer);
+    return growingcrashjson_beginStringElement(encodeContext, NULL);
+}
+
+static int appendEscape(GrowingCrashJSONEncodeContext* const encodeContext, const uint8_t* const ptr, const int length)
+{
+    int result = growingcrashjson_appendStringElement(encodeContext, (const char*)ptr, length);
+    return result == GrowingCrashJSON_ERROR_CANNOT_ADD_DATA ? result : GrowingCrashJSON_OK;
+}
+
+static int endEscape(GrowingCrashJSONEncodeContext* const encodeContext,
+                     DecodeBuffer* const buffer,
+                     GrowingCrashJSONStringView* const view)
+{
+    int result = growingcrashjson_endStringElement(encodeContext);
+    unlikely_if(result != GrowingCrashJSON_OK)
+    {
+        return result;
+    }
+    // Strip the quotes.
+    view->ptr = buffer->data + 1;
+    view->length = buffer->length - 2;
+    view->needsUnescape = true;
+    return GrowingCrashJSON_OK;
+}
+
+static int makeStringView(DecodeBuffer* const buffer,
+                          const uint8_t* const ptr,
+                          const int length,
+                          GrowingCrashJSONStringView* const view)
+{
+    likely_if(!needsEscaping(ptr, ptr + length))
+    {
+        view->ptr = (const char*)ptr;
+        view->length = length;
+        view->needsUnescape = false;
+        return GrowingCrashJSON_OK;
+    }
+    GrowingCrashJSONEncodeContext encodeContext;
+    int result = beginEscape(&encodeContext, buffer);
+    if(result == GrowingCrashJSON_OK)
+    {
+        result = appendEscape(&encodeContext, ptr, length);
+    }
+    if(result == GrowingCrashJSON_OK)
+    {
+        result = endEscape(&encodeContext, buffer, view);
+    }
+    return result;
+}
+
+/** Read an unsigned varint.
+ *
+ * @return GrowingCrashJSON_OK, GrowingCrashJSON_ERROR_INCOMPLETE if the data
+ *         ends inside the varint, or GrowingCrashJSON_ERROR_INVALID_DATA if it
+ *         doesn't fit in 64 bits.
+ */
+static int readVarint(DecodeContext* const context, uint64_t* const value)
+{
+    uint64_t result = 0;
+    for(int shift = 0; shift < 64; shift += 7)
+    {
+        unlikely_if(context->ptr >= context->end)
+        {
+            return GrowingCrashJSON_ERROR_INCOMPLETE;
+        }
+        uint8_t byte = *context->ptr++;
+        // The last byte only has room for the top bit.
+        unlikely_if(shift == 63 && byte > 1)
+        {
+            return GrowingCrashJSON_ERROR_INVALID_DATA;
+        }
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if((byte & 0x80) == 0)
+        {
+            *value = result;
+            return GrowingCrashJSON_OK;
+        }
+    }
+    return GrowingCrashJSON_ERROR_INVALID_DATA;
+}
+
+static int readLength(DecodeContext* const context, int* const length)
+{
+    uint64_t value;
+    int result = readVarint(context, &value);
+    unlikely_if(result != GrowingCrashJSON_OK)
+    {
+        return result;
+    }
+    unlikely_if(value > (uint64_t)(context->end - context->ptr))
+    {
+        return GrowingCrashJSON_ERROR_INCOMPLETE;
+    }
+    *length = (int)value;
+    return GrowingCrashJSON_OK;
+}
+
+static int readName(DecodeContext* const context, const char** const name)
+{
+    uint64_t value;
+    int result = readVarint(context, &value);
+    unlikely_if(result != GrowingCrashJSON_OK)
+    {
+        return result;
+    }
+    int tag = (int)(value & NAME_TAG_MASK);
+    value >>= NAME_TAG_BITS;
+
+    likely_if(tag == NAME_REFERENCE)
+    {
+        unlikely_if(value >= (uint64_t)context->nameCount)
+        {
+            return GrowingCrashJSON_ERROR_INVALID_DATA;
+        }
+        *name = context->names[value];
+        return GrowingCrashJSON_OK;
+    }
+
+    unlikely_if(value >= (uint64_t)(context->end - context->ptr))
+    {
+        return GrowingCrashJSON_ERROR_INCOMPLETE;
+    }
+    const char* inlineName = (const char*)context->ptr;
+    unlikely_if(inlineName[value] != '\0')
+    {
+        return GrowingCrashJSON_ERROR_INVALID_DATA;
+    }
+    context->ptr += value + 1;
+    if(tag == NAME_INLINE_INTERNED && context->nameCount < GrowingCrashBIN_MAX_NAMES)
+    {
+        context->names[context->nameCount++] = inlineName;
+    }
+    *name = inlineName;
+    return GrowingCrashJSON_OK;
+}
+
+/** Skip over a chunk sequence, counting the complete chunks in it.
+ *
+ * @return GrowingCrashJSON_OK, or GrowingCrashJSON_ERROR_INCOMPLETE if the
+ *         sequence is truncated. The counts cover the chunks before that point.
+ */
+static int skipChunks(DecodeContext* const context,
+                      int* const chunkCount,
+                      int* const totalLength,
+                      bool* const isClean)
+{
+    *chunkCount = 0;
+    *totalLength = 0;
+    if(isClean != NULL)
+    {
+        *isClean = true;
+    }
+    for(;;)
+    {
+        int length;
+        int result = readLength(context, &length);
+        unlikely_if(result != GrowingCrashJSON_OK)
+        {
+            return result;
+        }
+        if(length == 0)
+        {
+            return GrowingCrashJSON_OK;
+        }
+        if(isClean != NULL && *isClean)
+        {
+            *isClean = !needsEscaping(context->ptr, context->ptr + length);
+        }
+        context->ptr += length;
+        (*chunkCount)++;
+        *totalLength += length;
+    }
+}
+
+/** Get the next chunk of a sequence that has already been checked by skipChunks(). */
+static inline const uint8_t* nextChunk(DecodeContext* const context, int* const length)
+{
+    readLength(context, length);
+    const uint8_t* chunk = context->ptr;
+    context->ptr += *length;
+    return chunk;
+}
+
+/** Gather a string or data chunk sequence into a single string view.
+ * Data is hex encoded, the same way the JSON encoder does it.
+ *
+ * @return The result of reading the chunks. A truncated sequence still
+ *         produces a view of what was written.
+ */
+static int readChunks(DecodeContext* const context,
+                      const bool isData,
+                      GrowingCrashJSONStringView* const view,
+                      int* const viewResult)
+{
+    const uint8_t* const start = context->ptr;
+    int chunkCount;
+    int totalLength;
+    bool isClean;
+    int readResult = skipChunks(context, &chunkCount, &totalLength, isData ? NULL : &isClean);
+    const uint8_t* const end = context->ptr;
+    DecodeBuffer* buffer = &context->state->valueBuffer;
+
+    context->ptr = start;
+    *viewResult = GrowingCrashJSON_OK;
+    if(isData)
+    {
+        buffer->length = 0;
+        unlikely_if(!reserveDecodeBuffer(buffer, totalLength * 2))
+        {
+            *viewResult = GrowingCrashJSON_ERROR_CANNOT_ADD_DATA;
+        }
+        else
+        {
+            char* dst = buffer->data;
+            for(int i = 0; i < chunkCount; i++)
+            {
+                int length;
+                const uint8_t* src = nextChunk(context, &length);
+                growingcrashjson_encodeHex(src, length, dst);
+                dst += length * 2;
+            }
+            buffer->length = (int)(dst - buffer->data);
+        }
+        view->ptr = buffer->length > 0 ? buffer->data : "";
+        view->length = buffer->length;
+        view->needsUnescape = false;
+    }
+    else if(chunkCount <= 1 && isClean)
+    {
+        int length = 0;
+        view->ptr = chunkCount == 0 ? (const char*)start : (const char*)nextChunk(context, &length);
+        view->length = length;
+        view->needsUnescape = false;
+    }
+    else if(isClean)
+    {
+        buffer->length = 0;
+        for(int i = 0; i < chunkCount && *viewResult == GrowingCrashJSON_OK; i++)
+        {
+            int length;
+            const uint8_t* chunk = nextChunk(context, &length);
+            *viewResult = addToDecodeBuffer((const char*)chunk, length, buffer);
+        }
+        view->ptr = buffer->data;
+        view->length = buffer->length;
+        view->needsUnescape = false;
+    }
+    else
+    {
+        // Escape chunk by chunk, as the JSON encoder would have appended them.
+        GrowingCrashJSONEncodeContext encodeContext;
+        *viewResult = beginEscape(&encodeContext, buffer);
+        for(int i = 0; i < chunkCount && *viewResult == GrowingCrashJSON_OK; i++)
+        {
+            int length;
+            const uint8_t* chunk = nextChunk(context, &length);
+            *viewResult = appendEscape(&encodeContext, chunk, length);
+        }
+        if(*viewResult == GrowingCrashJSON_OK)
+        {
+            *viewResult = endEscape(&encodeContext, buffer, view);
+        }
+    }
+    context->ptr = end;
+    return readResult;
+}
+
+static int decodeDocument(DecodeState* state,
+                          const GrowingCrashJSONStringView* firstName,
+                          const char* data,
+                          int length,
+                          bool closeLastContainer,
+                          int baseDepth,
+                          int* openContainers);
+
+typedef struct
+{
+    DecodeState* state;
+    const GrowingCrashJSONStringView* firstName;
+    bool isFirstElement;
+    bool closeLastContainer;
+    int baseDepth;
+    int depth;
+} EmbeddedJSONContext;
+
+/** The top level element of an embedded document takes the embedding element's name. */
+static const GrowingCrashJSONStringView* embeddedName(EmbeddedJSONContext* const context,
+                                                     const GrowingCrashJSONStringView* const name)
+{
+    if(context->isFirstElement)
+    {
+        context->isFirstElement = false;
+        return context->firstName;
+    }
+    return name;
+}
+
+static int embedded_onBooleanElement(const GrowingCrashJSONStringView* const name, const bool value, void* const userData)
+{
+    EmbeddedJSONContext* context = (EmbeddedJSONContext*)userData;
+    DecodeState* state = context->state;
+    return state->callbacks->onBooleanElement(embeddedName(context, name), value, state->userData);
+}
+
+static int embedded_onFloatingPointElement(const GrowingCrashJSONStringView* const name, const double value, void* const userData)
+{
+    EmbeddedJSONContext* context = (EmbeddedJSONContext*)userData;
+    DecodeState* state = context->state;
+    return state->callbacks->onFloatingPointElement(embeddedName(context, name), value, state->userData);
+}
+
+static int embedded_onIntegerElement(const GrowingCrashJSONStringView* const name, const int64_t value, void* const userData)
+{
+    EmbeddedJSONContext* context = (EmbeddedJSONContext*)userData;
+    DecodeState* state = context->state;
+    return state->callbacks->onIntegerElement(embeddedName(context, name), value, state->userData);
+}
+
+static int embedded_onUIntegerElement(const GrowingCrashJSONStringView* const name, const uint64_t value, void* const userData)
+{
+    EmbeddedJSONContext* context = (EmbeddedJSONContext*)userData;
+    DecodeState* state = context->state;
+    return state->callbacks->onUIntegerElement(embeddedName(context, name), value, state->userData);
+}
+
+static int embedded_onNullElement(const GrowingCrashJSONStringView* const name, void* const userData)
+{
+    EmbeddedJSONContext* context = (EmbeddedJSONContext*)userData;
+    DecodeState* state = context->state;
+    return state->callbacks->onNullElement(embeddedName(context, name), state->userData);
+}
+
+static int embedded_onStringElement(const GrowingCrashJSONStringView* const name,
+                                    const GrowingCrashJSONStringView* const value,
+                                    void* const userData)
+{
+    EmbeddedJSONContext* context = (EmbeddedJSONContext*)userData;
+    DecodeState* state = context->state;
+    return state->callbacks->onStringElement(embeddedName(context, name), value, state->userData);
+}
+
+static int embedded_onBeginObject(const GrowingCrashJSONStringView* const name, void* const userData)
+{
+    EmbeddedJSONContext* context = (EmbeddedJSONContext*)userData;
+    DecodeState* state = context->state;
+    unlikely_if(context->baseDepth + context->depth >= MAX_JSON_CONTAINER_LEVEL)
+    {
+        return GrowingCrashJSON_ERROR_INVALID_DATA;
+    }
+    context->depth++;
+    return state->callbacks->onBeginObject(embeddedName(context, name), state->userData);
+}
+
+static int embedded_onBeginArray(const GrowingCrashJSONStringView* const name, void* const userData)
+{
+    EmbeddedJSONContext* context = (EmbeddedJSONContext*)userData;
+    DecodeState* state = context->state;
+    unlikely_if(context->baseDepth + context->depth >= MAX_JSON_CONTAINER_LEVEL)
+    {
+        return GrowingCrashJSON_ERROR_INVALID_DATA;
+    }
+    context->depth++;
+    return state->callbacks->onBeginArray(embeddedName(context, name), state->userData);
+}
+
+static int embedded_onEndContainer(void* const userData)
+{
+    EmbeddedJSONContext* context = (EmbeddedJSONContext*)userData;
+    DecodeState* state = context->state;
+    context->depth--;
+    if(context->closeLastContainer || context->depth > 0)
+    {
+        return state->callbacks->onEndContainer(state->userData);
+    }
+    return GrowingCrashJSON_OK;
+}
+
+static int embedded_onEndData(__unused void* const userData)
+{
+    return GrowingCrashJSON_OK;
+}
+
+static int decodeEmbeddedJSON(DecodeState* const state,
+                              const GrowingCrashJSONStringView* const firstName,
+                              const char* const data,
+                              const int length,
+                              const bool closeLastContainer,
+                              const int baseDepth,
+                              int* const openContainers)
+{
+    GrowingCrashJSONDecodeStringViewCallbacks callbacks =
+    {
+        .onBeginArray = embedded_onBeginArray,
+        .onBeginObject = embedded_onBeginObject,
+        .onBooleanElement = embedded_onBooleanElement,
+        .onEndContainer = embedded_onEndContainer,
+        .onEndData = embedded_onEndData,
+        .onFloatingPointElement = embedded_onFloatingPointElement,
+        .onIntegerElement = embedded_onIntegerElement,
+        .onUIntegerElement = embedded_onUIntegerElement,
+        .onNullElement = embedded_onNullElement,
+        .onStringElement = embedded_onStringElement,
+    };
+    EmbeddedJSONContext context =
+    {
+        .state = state,
+        .firstName = firstName,
+        .isFirstElement = true,
+        .closeLastContainer = closeLastContainer,
+        .baseDepth = baseDepth,
+        .depth = 0,
+    };
+    int result = growingcrashjson_decodeStringViews(data, length, &callbacks, &context, NULL);
+    *openContainers = context.depth;
+    return result;
+}
+
+static int decodeEmbedded(DecodeContext* const context, const GrowingCrashJSONStringView* const name)
+{
+    unlikely_if(context->ptr >= context->end)
+    {
+        return GrowingCrashJSON_ERROR_INCOMPLETE;
+    }
+    bool closeLastContainer = (*context->ptr++ & EMBEDDED_FLAG_CLOSE_LAST_CONTAINER) != 0;
+
+    const uint8_t* chunksStart = context->ptr;
+    int chunkCount;
+    int length;
+    int result = skipChunks(context, &chunkCount, &length, NULL);
+    unlikely_if(result != GrowingCrashJSON_OK)
+    {
+        return result;
+    }
+
+    char* data = malloc((size_t)length + 1);
+    unlikely_if(data == NULL)
+    {
+        GrowingCrashLOG_ERROR("Could not allocate %d bytes", length + 1);
+        return GrowingCrashJSON_ERROR_CANNOT_ADD_DATA;
+    }
+    const uint8_t* chunksEnd = context->ptr;
+    context->ptr = chunksStart;
+    char* dst = data;
+    for(int i = 0; i < chunkCount; i++)
+    {
+        int chunkLength;
+        const uint8_t* chunk = nextChunk(context, &chunkLength);
+        memcpy(dst, chunk, (size_t)chunkLength);
+        dst += chunkLength;
+    }
+    *dst = '\0';
+    context->ptr = chunksEnd;
+
+    // Problems in the embedded document only affect that element, as they
+    // would have when it was embedded as JSON.
+    int baseDepth = context->baseDepth + context->depth;
+    int openContainers = 0;
+    if(growingcrashbin_isBinaryData(data, length))
+    {
+        result = decodeDocument(context->state, name, data, length, closeLastContainer, baseDepth, &openContainers);
+    }
+    else
+    {
+        result = decodeEmbeddedJSON(context->state, name, data, length, closeLastContainer, baseDepth, &openContainers);
+    }
+    free(data);
+    while(result != GrowingCrashJSON_ERROR_CANNOT_ADD_DATA && closeLastContainer && openContainers-- > 0)
+    {
+        result = context->state->callbacks->onEndContainer(context->state->userData);
+    }
+    return result == GrowingCrashJSON_ERROR_CANNOT_ADD_DATA ? result : GrowingCrashJSON_OK;
+}
+
+static int decodeUUID(DecodeContext* const context, const GrowingCrashJSONStringView* const name)
+{
+    unlikely_if(context->end - context->ptr < UUID_LENGTH)
+    {
+        return GrowingCrashJSON_ERROR_INCOMPLETE;
+    }
+    char uuidBuffer[37];
+    const unsigned char* src = context->ptr;
+    char* dst = uuidBuffer;
+    for(int i = 0; i < UUID_LENGTH; i += 2)
+    {
+        if(i == 4 || i == 6 || i == 8 || i == 10)
+        {
+            *dst++ = '-';
+        }
+        growingcrashjson_encodeHex(src + i, 2, dst);
+        dst += 4;
+    }
+    context->ptr += UUID_LENGTH;
+    GrowingCrashJSONStringView value = {uuidBuffer, (int)(dst - uuidBuffer), false};
+    return context->state->callbacks->onStringElement(name, &value, context->state->userData);
+}
+
+static int decodeElements(DecodeContext* const context)
+{
+    GrowingCrashJSONDecodeStringViewCallbacks* callbacks = context->state->callbacks;
+    void* userData = context->state->userData;
+    bool isFirstElement = true;
+
+    do
+    {
+        unlikely_if(context->ptr >= context->end)
+        {
+            return GrowingCrashJSON_ERROR_INCOMPLETE;
+        }
+        uint8_t type = *context->ptr++;
+        const char* rawName = NULL;
+        int result = GrowingCrashJSON_OK;
+        if(type & TYPE_FLAG_HAS_NAME)
+        {
+            unlikely_if((result = readName(context, &rawName)) != GrowingCrashJSON_OK)
+            {
+                return result;
+            }
+        }
+        GrowingCrashJSONStringView nameView;
+        const GrowingCrashJSONStringView* name = NULL;
+        if(isFirstElement)
+        {
+            name = context->firstName;
+            isFirstElement = false;
+        }
+        else if(rawName != NULL)
+        {
+            unlikely_if((result = makeStringView(&context->state->nameBuffer,
+                                                 (const uint8_t*)rawName,
+                                                 (int)strlen(rawName),
+                                                 &nameView)) != GrowingCrashJSON_OK)
+            {
+                return result;
+            }
+            name = &nameView;
+        }
+
+        switch(type & TYPE_MASK)
+        {
+            case TYPE_END_CONTAINER:
+                unlikely_if(context->depth == 0)
+                {
+                    return GrowingCrashJSON_ERROR_INVALID_DATA;
+                }
+                context->depth--;
+                if(context->closeLastContainer || context->depth > 0)
+                {
+                    result = callbacks->onEndContainer(userData);
+                }
+                break;
+            case TYPE_BEGIN_OBJECT:
+            case TYPE_BEGIN_ARRAY:
+                unlikely_if(context->baseDepth + context->depth >= MAX_JSON_CONTAINER_LEVEL)
+                {
+                    return GrowingCrashJSON_ERROR_INVALID_DATA;
+                }
+                context->depth++;
+                result = (type & TYPE_MASK) == TYPE_BEGIN_OBJECT
+                    ? callbacks->onBeginObject(name, userData)
+                    : callbacks->onBeginArray(name, userData);
+                break;
+            case TYPE_NULL:
+                result = callbacks->onNullElement(name, userData);
+                break;
+            case TYPE_FALSE:
+            case TYPE_TRUE:
+                result = callbacks->onBooleanElement(name, (type & TYPE_MASK) == TYPE_TRUE, userData);
+                break;
+            case TYPE_UINTEGER:
+            case TYPE_NEGATIVE_INTEGER:
+            {
+                uint64_t value;
+                unlikely_if((result = readVarint(context, &value)) != GrowingCrashJSON_OK)
+                {
+                    return result;
+                }
+                unlikely_if(value > INT64_MAX)
+                {
+                    unlikely_if((type & TYPE_MASK) == TYPE_NEGATIVE_INTEGER)
+                    {
+                        return GrowingCrashJSON_ERROR_INVALID_DATA;
+                    }
+                    result = callbacks->onUIntegerElement(name, value, userData);
+                    break;
+                }
+                // Same as decoding the transcoded JSON: only values that don't
+                // fit in an int64 are reported as unsigned.
+                result = callbacks->onIntegerElement(name,
+                                                     (type & TYPE_MASK) == TYPE_UINTEGER ? (int64_t)value : -(int64_t)value - 1,
+                                                     userData);
+                break;
+            }
+            case TYPE_FLOATING_POINT:
+            {
+                uint64_t bits = 0;
+                unlikely_if(context->end - context->ptr < (int)sizeof(bits))
+                {
+                    return GrowingCrashJSON_ERROR_INCOMPLETE;
+                }
+                for(int i = 0; i < (int)sizeof(bits); i++)
+                {
+                    bits |= (uint64_t)*context->ptr++ << (i * 8);
+                }
+                double value;
+                memcpy(&value, &bits, sizeof(value));
+                result = callbacks->onFloatingPointElement(name, value, userData);
+                break;
+            }
+            case TYPE_STRING:
+            {
+                int length;
+                unlikely_if((result = readLength(context, &length)) != GrowingCrashJSON_OK)
+                {
+                    return result;
+                }
+                GrowingCrashJSONStringView value;
+                result = makeStringView(&context->state->valueBuffer, context->ptr, length, &value);
+                context->ptr += length;
+                likely_if(result == GrowingCrashJSON_OK)
+                {
+                    result = callbacks->onStringElement(name, &value, userData);
+                }
+                break;
+            }
+            case TYPE_STRING_CHUNKS:
+            case TYPE_DATA_CHUNKS:
+            {
+                GrowingCrashJSONStringView value;
+                int readResult = readChunks(context, (type & TYPE_MASK) == TYPE_DATA_CHUNKS, &value, &result);
+                // Pass the string on even if truncated, so the document stays valid.
+                likely_if(result == GrowingCrashJSON_OK)
+                {
+                    result = callbacks->onStringElement(name, &value, userData);
+                }
+                unlikely_if(result == GrowingCrashJSON_OK && readResult != GrowingCrashJSON_OK)
+                {
+                    return readResult;
+                }
+                break;
+            }
+            case TYPE_UUID:
+                result = decodeUUID(context, name);
+                break;
+            case TYPE_EMBEDDED_CHUNKS:
+                result = decodeEmbedded(context, name);
+                break;
+            default:
+                GrowingCrashLOG_ERROR("Invalid element type %d", type & TYPE_MASK);
+                return GrowingCrashJSON_ERROR_INVALID_DATA;
+        }
+        unlikely_if(result != GrowingCrashJSON_OK)
+        {
+            return result;
+        }
+    } while(context->depth > 0);
+
+    return GrowingCrashJSON_OK;
+}
+
+static int decodeDocument(DecodeState* const state,
+                          const GrowingCrashJSONStringView* const firstName,
+                          const char* const data,
+                          const int length,
+                          const bool closeLastContainer,
+                          const int baseDepth,
+                          int* const openContainers)
+{
+    *openContainers = 0;
+    unlikely_if(!growingcrashbin_isBinaryData(data, length))
+    {
+        return GrowingCrashJSON_ERROR_INVALID_DATA;
+    }
+    unlikely_if(data[sizeof(g_magic)] != FORMAT_VERSION)
+    {
+        GrowingCrashLOG_ERROR("Unsupported binary format version %d", data[sizeof(g_magic)]);
+        return GrowingCrashJSON_ERROR_INVALID_DATA;
+    }
+
+    DecodeContext context =
+    {
+        .ptr = (const uint8_t*)data + HEADER_LENGTH,
+        .end = (const uint8_t*)data + length,
+        .state = state,
+        .firstName = firstName,
+        .closeLastContainer = closeLastContainer,
+        .baseDepth = baseDepth,
+        .depth = 0,
+        .nameCount = 0,
+    };
+    int result = decodeElements(&context);
+    *openContainers = context.depth;
+    return result;
+}
+
+bool growingcrashbin_isBinaryData(const char* const data, const int length)
+{
+    return data != NULL &&
+           length >= (int)HEADER_LENGTH &&
+           memcmp(data, g_magic, sizeof(g_magic)) == 0;
+}
+
+int growingcrashbin_decode(const char* const data,
+                           const int length,
+                           GrowingCrashJSONDecodeStringViewCallbacks* const callbacks,
+                           void* const userData)
+{
+    DecodeState state =
+    {
+        .callbacks = callbacks,
+        .userData = userData,
+    };
+    int openContainers;
+    int result = decodeDocument(&state, NULL, data, length, true, 0, &openContainers);
+    likely_if(result == GrowingCrashJSON_OK)
+    {
+        result = callbacks->onEndData(userData);
+    }
+    free(state.nameBuffer.data);
+    free(state.valueBuffer.data);
+    return result;
+}
+
+
+// ============================================================================
+#pragma mark - Transcode -
+// ============================================================================
+
+typedef struct
+{
+    GrowingCrashJSONEncodeContext* encodeContext;
+    char nameBuffer[GrowingCrashBIN_MaxTranscodeNameLength];
+} TranscodeContext;
+
+/** The report writer ignores per-element encoder errors at crash time,
+ * so only stop if the output can't be written.
+ */
+static inline int transcodeResult(const int result)
+{
+    return result == GrowingCrashJSON_ERROR_CANNOT_ADD_DATA ? result : GrowingCrashJSON_OK;
+}
+
+#define RESOLVE_TRANSCODE_NAME() \
+    TranscodeContext* context = (TranscodeContext*)userData; \
+    const char* name = NULL; \
+    if(nameView != NULL) \
+    { \
+        unlikely_if(growingcrashjson_unescapeString(nameView, context->nameBuffer, sizeof(context->nameBuffer), NULL) != GrowingCrashJSON_OK) \
+        { \
+            *context->nameBuffer = '\0'; \
+        } \
+        name = context->nameBuffer; \
+    }
+
+static int transcode_onBooleanElement(const GrowingCrashJSONStringView* const nameView, const bool value, void* const userData)
+{
+    RESOLVE_TRANSCODE_NAME();
+    return transcodeResult(growingcrashjson_addBooleanElement(context->encodeContext, name, value));
+}
+
+static int transcode_onFloatingPointElement(const GrowingCrashJSONStringView* const nameView, const double value, void* const userData)
+{
+    RESOLVE_TRANSCODE_NAME();
+    return transcodeResult(growingcrashjson_addFloatingPointElement(context->encodeContext, name, value));
+}
+
+static int transcode_onIntegerElement(const GrowingCrashJSONStringView* const nameView, const int64_t value, void* const userData)
+{
+    RESOLVE_TRANSCODE_NAME();
+    return transcodeResult(growingcrashjson_addIntegerElement(context->encodeContext, name, value));
+}
+
+static int transcode_onUIntegerElement(const GrowingCrashJSONStringView* const nameView, const uint64_t value, void* const userData)
+{
+    RESOLVE_TRANSCODE_NAME();
+    return transcodeResult(growingcrashjson_addUIntegerElement(context->encodeContext, name, value));
+}
+
+static int transcode_onNullElement(const GrowingCrashJSONStringView* const nameView, void* const userData)
+{
+    RESOLVE_TRANSCODE_NAME();
+    return transcodeResult(growingcrashjson_addNullElement(context->encodeContext, name));
+}
+
+static int transcode_onStringElement(const GrowingCrashJSONStringView* const nameView,
+                                     const GrowingCrashJSONStringView* const value,
+                                     void* const userData)
+{
+    RESOLVE_TRANSCODE_NAME();
+    GrowingCrashJSONEncodeContext* encodeContext = context->encodeContext;
+    likely_if(!value->needsUnescape)
+    {
+        return transcodeResult(growingcrashjson_addStringElement(encodeContext, name, value->ptr, value->length));
+    }
+    // Already escaped, so it can go out as-is.
+    int result = growingcrashjson_beginStringElement(encodeContext, name);
+    if(result == GrowingCrashJSON_OK)
+    {
+        result = growingcrashjson_addRawJSONData(encodeContext, value->ptr, value->length);
+    }
+    if(result == GrowingCrashJSON_OK)
+    {
+        result = growingcrashjson_endStringElement(encodeContext);
+    }
+    return transcodeResult(result);
+}
+
+static int transcode_onBeginObject(const GrowingCrashJSONStringView* const nameView, void* const userData)
+{
+    RESOLVE_TRANSCODE_NAME();
+    return transcodeResult(growingcrashjson_beginObject(context->encodeContext, name));
+}
+
+static int transcode_onBeginArray(const GrowingCrashJSONStringView* const nameView, void* const userData)
+{
+    RESOLVE_TRANSCODE_NAME();
+    return transcodeResult(growingcrashjson_beginArray(context->encodeContext, name));
+}
+
+static int transcode_onEndContainer(void* const userData)
+{
+    TranscodeContext* context = (TranscodeContext*)userData;
+    return transcodeResult(growingcrashjson_endContainer(context->encodeContext));
+}
+
+static int transcode_onEndData(__unused void* const userData)
+{
+    return GrowingCrashJSON_OK;
+}
+
+int growingcrashbin_transcodeToJSON(GrowingCrashJSONEncodeContext* const encodeContext,
+                                    const char* const name,
+                                    const char* const data,
+                                    const int length,
+                                    const bool closeLastContainer)
+{
+    GrowingCrashJSONDecodeStringViewCallbacks callbacks =
+    {
+        .onBeginArray = transcode_onBeginArray,
+        .onBeginObject = transcode_onBeginObject,
+        .onBooleanElement = transcode_onBooleanElement,
+        .onEndContainer = transcode_onEndContainer,
+        .onEndData = transcode_onEndData,
+        .onFloatingPointElement = transcode_onFloatingPointElement,
+        .onIntegerElement = transcode_onIntegerElement,
+        .onUIntegerElement = transcode_onUIntegerElement,
+        .onNullElement = transcode_onNullElement,
+        .onStringElement = transcode_onStringElement,
+    };
+    TranscodeContext context =
+    {
+        .encodeContext = encodeContext,
+    };
+    DecodeState state =
+    {
+        .callbacks = &callbacks,
+        .userData = &context,
+    };
+    GrowingCrashJSONStringView nameView = {name, name == NULL ? 0 : (int)strlen(name), false};
+    int containerLevel = encodeContext->containerLevel;
+    int openContainers;
+
+    int result = decodeDocument(&state,
+                                name == NULL ? NULL : &nameView,
+                                data,
+                                length,
+                                closeLastContainer,
+                                containerLevel,
+                                &openContainers);
+    while(closeLastContainer && encodeContext->containerLevel > containerLevel)
+    {
+        growingcrashjson_endContainer(encodeContext);
+    }
+    free(state.nameBuffer.data);
+    free(state.valueBuffer.data);
+
+    return result;
+}
@@ -0,0 +1,298 @@
+//
+//  GrowingCrashBinaryCodec.h
+//  GrowingAnalytics
+//
+//  Created by YoloMao on 2022/9/19.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+/* Writes a compact tagged binary encoding of a crash report, and transcodes
+ * it back into JSON.
+ *
+ * The encoder mirrors the JSON encoder element for element, so that a report
+ * transcoded at read time is identical to the one the JSON encoder would have
+ * produced at crash time. Integers are stored as varints, data and UUIDs as
+ * raw bytes, and element names are interned so that each distinct name is
+ * only written once per report.
+ *
+ * Layout: a 5 byte header (4 magic bytes and a version), followed by a single
+ * element. Each element starts with a type byte. If the high bit of the type
+ * byte is set, a name follows: a varint whose low 2 bits select a reference to
+ * a previously interned name, or an inline NUL terminated name which may also
+ * be interned. The payload depends on the type:
+ *
+ *   - Containers: child elements, terminated by an end container element.
+ *   - Integers: unsigned varint (negative values store -(value + 1)).
+ *   - Floating point: 8 bytes, little endian IEEE 754.
+ *   - String: varint length, then the bytes.
+ *   - String, data, and embedded chunks: a sequence of varint length + bytes,
+ *     terminated by a zero length chunk.
+ *   - UUID: 16 raw bytes.
+ *
+ * All encoding functions are async-safe and do not allocate memory.
+ */
+
+
+#ifndef HDR_GrowingCrashBinaryCodec_h
+#define HDR_GrowingCrashBinaryCodec_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "GrowingCrashJSONCodec.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** The maximum number of distinct names interned per report. */
+#define GrowingCrashBIN_MAX_NAMES 256
+
+/** Storage for interned names. */
+#define GrowingCrashBIN_NAME_STORAGE_SIZE 4096
+
+
+// ============================================================================
+// Encode
+// ============================================================================
+
+typedef struct
+{
+    /** Function to call to add more encoded data.
+     * Returns GrowingCrashJSON_* result codes.
+     */
+    GrowingCrashJSONAddDataFunc addData;
+
+    /** User-specified data */
+    void* userData;
+
+    /** How many containers deep we are. */
+    int containerLevel;
+
+    /** Number of names interned so far. */
+    int nameCount;
+
+    /** Bytes of nameStorage in use. */
+    int nameStorageUsed;
+
+    /** Open addressed hash table of (name index + 1), 0 = empty. */
+    uint16_t nameSlots[GrowingCrashBIN_MAX_NAMES * 2];
+
+    /** Hash, offset into nameStorage and length of each interned name. */
+    uint32_t nameHashes[GrowingCrashBIN_MAX_NAMES];
+    uint16_t nameOffsets[GrowingCrashBIN_MAX_NAMES];
+    uint8_t nameLengths[GrowingCrashBIN_MAX_NAMES];
+
+    /** Copies of interned names. Names can come from reused buffers, so
+     * they are compared by contents rather than by address.
+     */
+    char nameStorage[GrowingCrashBIN_NAME_STORAGE_SIZE];
+
+} GrowingCrashBinaryEncodeContext;
+
+/** Begin a new encoding process, writing the format header.
+ *
+ * @param context The encoding context.
+ *
+ * @param addData Function to handle adding data.
+ *
+ * @param userData User-specified data which gets passed to addData.
+ *
+ * @return GrowingCrashJSON_OK if the process was successful.
+ */
+int growingcrashbin_beginEncode(GrowingCrashBinaryEncodeContext* context,
+                                GrowingCrashJSONAddDataFunc addData,
+                                void* userData);
+
+/** End the encoding process, ending any remaining open containers.
+ *
+ * @return GrowingCrashJSON_OK if the process was successful.
+ */
+int growingcrashbin_endEncode(GrowingCrashBinaryEncodeContext* context);
+
+int growingcrashbin_addBooleanElement(GrowingCrashBinaryEncodeContext* context,
+                                      const char* name,
+                                      bool value);
+
+int growingcrashbin_addIntegerElement(GrowingCrashBinaryEncodeContext* context,
+                                      const char* name,
+                                      int64_t value);
+
+int growingcrashbin_addUIntegerElement(GrowingCrashBinaryEncodeContext* context,
+                                       const char* name,
+                                       uint64_t value);
+
+int growingcrashbin_addFloatingPointElement(GrowingCrashBinaryEncodeContext* context,
+                                            const char* name,
+                                            double value);
+
+int growingcrashbin_addNullElement(GrowingCrashBinaryEncodeContext* context,
+                                   const char* name);
+
+/** Add a string element.
+ *
+ * @param length the length of the string, or GrowingCrashJSON_SIZE_AUTOMATIC.
+ *               A NULL value is encoded as a null element.
+ */
+int growingcrashbin_addStringElement(GrowingCrashBinaryEncodeContext* context,
+                                     const char* name,
+                                     const char* value,
+                                     int length);
+
+/** Incrementally-built string element. */
+int growingcrashbin_beginStringElement(GrowingCrashBinaryEncodeContext* context,
+                                       const char* name);
+
+int growingcrashbin_appendStringElement(GrowingCrashBinaryEncodeContext* context,
+                                        const char* value,
+                                        int length);
+
+int growingcrashbin_endStringElement(GrowingCrashBinaryEncodeContext* context);
+
+/** Binary data element. The data is stored raw and is hex encoded by the
+ * transcoder, the same way the JSON encoder does it.
+ */
+int growingcrashbin_addDataElement(GrowingCrashBinaryEncodeContext* context,
+                                   const char* name,
+                                   const char* value,
+                                   int length);
+
+int growingcrashbin_beginDataElement(GrowingCrashBinaryEncodeContext* context,
+                                     const char* name);
+
+int growingcrashbin_appendDataElement(GrowingCrashBinaryEncodeContext* context,
+                                      const char* value,
+                                      int length);
+
+int growingcrashbin_endDataElement(GrowingCrashBinaryEncodeContext* context);
+
+/** Add a 16 byte UUID, transcoded to its canonical string form.
+ * A NULL value is encoded as a null element.
+ */
+int growingcrashbin_addUUIDElement(GrowingCrashBinaryEncodeContext* context,
+                                   const char* name,
+                                   const unsigned char* value);
+
+int growingcrashbin_beginObject(GrowingCrashBinaryEncodeContext* context,
+                                const char* name);
+
+int growingcrashbin_beginArray(GrowingCrashBinaryEncodeContext* context,
+                               const char* name);
+
+int growingcrashbin_endContainer(GrowingCrashBinaryEncodeContext* context);
+
+/** Decode a JSON document and add its contents as binary elements.
+ * Behaves like growingcrashjson_addJSONElement().
+ *
+ * @param closeLastContainer If false, do not close the last container.
+ *
+ * @return GrowingCrashJSON_OK if the process was successful.
+ */
+int growingcrashbin_addJSONElement(GrowingCrashBinaryEncodeContext* context,
+                                   const char* name,
+                                   const char* jsonData,
+                                   int jsonDataLength,
+                                   bool closeLastContainer);
+
+/** Embed the raw contents of a JSON or binary encoded file.
+ * The contents are copied verbatim, and decoded by the transcoder the way
+ * growingcrashjson_addJSONFromFile() would have at crash time.
+ *
+ * @param closeLastContainer If false, do not close the last container.
+ *
+ * @return GrowingCrashJSON_OK if the process was successful.
+ */
+int growingcrashbin_addJSONFromFile(GrowingCrashBinaryEncodeContext* context,
+                                    const char* name,
+                                    const char* filename,
+                                    bool closeLastContainer);
+
+
+// ============================================================================
+// Decode
+// ============================================================================
+
+/** Check if some data is in the binary encoding.
+ *
+ * @param data The data to check.
+ *
+ * @param length The length of the data.
+ *
+ * @return true if the data starts with the binary format header.
+ */
+bool growingcrashbin_isBinaryData(const char* data, int length);
+
+/** Decode binary encoded data, calling the callbacks the same way
+ * growingcrashjson_decodeStringViews() would for the transcoded JSON.
+ * This lets a binary report be processed without transcoding it first.
+ *
+ * String views point into the data where possible. Values that had to be
+ * escaped or joined together point to scratch memory that is only valid
+ * until the callback returns.
+ *
+ * @param data The binary encoded data, including its header.
+ *
+ * @param length The length of the data.
+ *
+ * @param callbacks The callbacks to call while decoding.
+ *
+ * @param userData Data that will be passed to the callbacks.
+ *
+ * @return GrowingCrashJSON_OK if the process was successful, or
+ *         GrowingCrashJSON_ERROR_INCOMPLETE if the data was truncated. In
+ *         that case onEndData is not called, and any containers that were
+ *         open at that point are left open.
+ */
+int growingcrashbin_decode(const char* data,
+                           int length,
+                           GrowingCrashJSONDecodeStringViewCallbacks* callbacks,
+                           void* userData);
+
+
+// ============================================================================
+// Transcode
+// ============================================================================
+
+/** Transcode binary encoded data into a JSON encoder.
+ *
+ * Truncated data (for example from a crash during crash handling) is
+ * transcoded as far as it goes, and any containers it opened are closed.
+ *
+ * @param encodeContext The JSON encoding context to add elements to.
+ *
+ * @param name The name to give the top level element.
+ *
+ * @param data The binary encoded data, including its header.
+ *
+ * @param length The length of the data.
+ *
+ * @param closeLastContainer If false, do not close the last container.
+ *
+ * @return GrowingCrashJSON_OK if the process was successful, or
+ *         GrowingCrashJSON_ERROR_INCOMPLETE if the data was truncated.
+ */
+int growingcrashbin_transcodeToJSON(GrowingCrashJSONEncodeContext* encodeContext,
+                                    const char* name,
+                                    const char* data,
+                                    int length,
+                                    bool closeLastContainer);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HDR_GrowingCrashBinaryCodec_h
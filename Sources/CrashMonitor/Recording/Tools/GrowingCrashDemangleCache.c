@@ -0,0 +1,403 @@
+//
+//  GrowingCrashDemangleCache.c
+//  GrowingAnalytics
+//
+//  Created by YoloMao on 2022/9/19.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#include "GrowingCrashDemangleCache.h"
+#include "GrowingCrashSystemCapabilities.h"
+#include "GrowingCrashDemangle_CPP.h"
+#if GROWINGCRASH_HAS_SWIFT
+#include "GrowingCrashDemangle_Swift.h"
+#endif
+
+//#define GrowingCrashLogger_LocalLevel TRACE
+#include "GrowingCrashLogger.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define likely_if(x) if(__builtin_expect(x,1))
+#define unlikely_if(x) if(__builtin_expect(x,0))
+
+
+// ============================================================================
+#pragma mark - Configuration -
+// ============================================================================
+
+/** Swift symbols are demangled into a stack buffer of this size first. */
+#define GrowingCrashDMC_SwiftBufferSize 1024
+
+
+// ============================================================================
+#pragma mark - Types -
+// ============================================================================
+
+/** A cached symbol. The mangled and demangled names are stored after the
+ * entry in the same allocation.
+ */
+typedef struct CacheEntry
+{
+    /** Next entry in the same hash bucket. */
+    struct CacheEntry* bucketNext;
+
+    /** Neighbours in the recently used list. */
+    struct CacheEntry* newer;
+    struct CacheEntry* older;
+
+    uint32_t hash;
+    int mangledLength;
+
+    /** The demangled name, or NULL if the symbol couldn't be demangled. */
+    char* demangled;
+
+    char mangled[];
+} CacheEntry;
+
+
+// ============================================================================
+#pragma mark - Globals -
+// ============================================================================
+
+static pthread_mutex_t g_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** Hash buckets. There are at least as many buckets as entries. */
+static CacheEntry** g_buckets = NULL;
+static uint32_t g_bucketMask = 0;
+
+/** Most and least recently used entries. */
+static CacheEntry* g_newest = NULL;
+static CacheEntry* g_oldest = NULL;
+
+static int g_count = 0;
+static int g_capacity = GrowingCrashDMC_DEFAULT_CAPACITY;
+static uint64_t g_hits = 0;
+static uint64_t g_misses = 0;
+static uint64_t g_evictions = 0;
+
+#if GROWINGCRASH_HAS_SWIFT
+static pthread_key_t g_swiftDemanglerKey;
+static pthread_once_t g_swiftDemanglerOnce = PTHREAD_ONCE_INIT;
+#endif
+
+
+// ============================================================================
+#pragma mark - Utility -
+// ============================================================================
+
+/** FNV-1a */
+static uint32_t hashSymbol(const char* symbol, int length)
+{
+    uint32_t hash = 2166136261u;
+    for(int i = 0; i < length; i++)
+    {
+        hash = (hash ^ (uint8_t)symbol[i]) * 16777619u;
+    }
+    return hash;
+}
+
+#if GROWINGCRASH_HAS_SWIFT
+static void destroySwiftDemangler(void* demangler)
+{
+    growingcrashdm_destroySwiftDemangler(demangler);
+}
+
+static void createSwiftDemanglerKey(void)
+{
+    pthread_key_create(&g_swiftDemanglerKey, destroySwiftDemangler);
+}
+
+/** Each thread keeps its own demangler, since they can't be shared. */
+static GrowingCrashSwiftDemangler* getSwiftDemangler(void)
+{
+    pthread_once(&g_swiftDemanglerOnce, createSwiftDemanglerKey);
+    GrowingCrashSwiftDemangler* demangler = pthread_getspecific(g_swiftDemanglerKey);
+    if(demangler == NULL)
+    {
+        demangler = growingcrashdm_createSwiftDemangler();
+        pthread_setspecific(g_swiftDemanglerKey, demangler);
+    }
+    return demangler;
+}
+
+static char* demangleSwift(const char* mangledSymbol)
+{
+    GrowingCrashSwiftDemangler* demangler = getSwiftDemangler();
+    if(demangler == NULL)
+    {
+        return growingcrashdm_demangleSwift(mangledSymbol);
+    }
+
+    char buffer[GrowingCrashDMC_SwiftBufferSize];
+    int length = growingcrashdm_demangleSwiftWith(demangler, mangledSymbol, buffer, sizeof(buffer));
+    if(length == 0)
+    {
+        return NULL;
+    }
+    char* demangled = malloc((size_t)length + 1);
+    if(demangled == NULL)
+    {
+        return NULL;
+    }
+    if(length < (int)sizeof(buffer))
+    {
+        memcpy(demangled, buffer, (size_t)length + 1);
+    }
+    else
+    {
+        growingcrashdm_demangleSwiftWith(demangler, mangledSymbol, demangled, length + 1);
+    }
+    return demangled;
+}
+#endif
+
+static char* demangleSymbol(const char* mangledSymbol)
+{
+    const char* demangledCPP = growingcrashdm_demangleCPPReusingBuffer(mangledSymbol);
+    if(demangledCPP != NULL)
+    {
+        return strdup(demangledCPP);
+    }
+#if GROWINGCRASH_HAS_SWIFT
+    return demangleSwift(mangledSymbol);
+#else
+    return NULL;
+#endif
+}
+
+static void unlinkRecent(CacheEntry* entry)
+{
+    if(entry->newer != NULL)
+    {
+        entry->newer->older = entry->older;
+    }
+    else
+    {
+        g_newest = entry->older;
+    }
+    if(entry->older != NULL)
+    {
+        entry->older->newer = entry->newer;
+    }
+    else
+    {
+        g_oldest = entry->newer;
+    }
+}
+
+static void linkNewest(CacheEntry* entry)
+{
+    entry->newer = NULL;
+    entry->older = g_newest;
+    if(g_newest != NULL)
+    {
+        g_newest->newer = entry;
+    }
+    g_newest = entry;
+    if(g_oldest == NULL)
+    {
+        g_oldest = entry;
+    }
+}
+
+/** Call with g_mutex held. */
+static CacheEntry* findEntry(const char* symbol, int length, uint32_t hash)
+{
+    if(g_buckets == NULL)
+    {
+        return NULL;
+    }
+    for(CacheEntry* entry = g_buckets[hash & g_bucketMask]; entry != NULL; entry = entry->bucketNext)
+    {
+        if(entry->hash == hash && entry->mangledLength == length && memcmp(entry->mangled, symbol, (size_t)length) == 0)
+        {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/** Call with g_mutex held. */
+static void removeEntry(CacheEntry* entry)
+{
+    CacheEntry** link = &g_buckets[entry->hash & g_bucketMask];
+    while(*link != entry)
+    {
+        link = &(*link)->bucketNext;
+    }
+    *link = entry->bucketNext;
+    unlinkRecent(entry);
+    g_count--;
+    free(entry);
+}
+
+/** Call with g_mutex held. */
+static bool allocateBuckets(void)
+{
+    if(g_buckets != NULL)
+    {
+        return true;
+    }
+    uint32_t bucketCount = 1;
+    while(bucketCount < (uint32_t)g_capacity)
+    {
+        bucketCount <<= 1;
+    }
+    g_buckets = calloc(bucketCount, sizeof(*g_buckets));
+    if(g_buckets == NULL)
+    {
+        GrowingCrashLOG_ERROR("Could not allocate %u demangle cache buckets", bucketCount);
+        return false;
+    }
+    g_bucketMask = bucketCount - 1;
+    return true;
+}
+
+/** Call with g_mutex held. */
+static void addEntry(const char* symbol, int length, uint32_t hash, const char* demangled)
+{
+    if(g_capacity <= 0 || !allocateBuckets())
+    {
+        return;
+    }
+    int demangledLength = demangled == NULL ? 0 : (int)strlen(demangled) + 1;
+    CacheEntry* entry = malloc(sizeof(*entry) + (size_t)length + 1 + (size_t)demangledLength);
+    if(entry == NULL)
+    {
+        return;
+    }
+    if(g_count >= g_capacity)
+    {
+        removeEntry(g_oldest);
+        g_evictions++;
+    }
+
+    entry->hash = hash;
+    entry->mangledLength = length;
+    memcpy(entry->mangled, symbol, (size_t)length + 1);
+    if(demangled == NULL)
+    {
+        entry->demangled = NULL;
+    }
+    else
+    {
+        entry->demangled = entry->mangled + length + 1;
+        memcpy(entry->demangled, demangled, (size_t)demangledLength);
+    }
+
+    CacheEntry** bucket = &g_buckets[hash & g_bucketMask];
+    entry->bucketNext = *bucket;
+    *bucket = entry;
+    linkNewest(entry);
+    g_count++;
+}
+
+/** Call with g_mutex held. */
+static void clearEntries(void)
+{
+    CacheEntry* entry = g_newest;
+    while(entry != NULL)
+    {
+        CacheEntry* older = entry->older;
+        free(entry);
+        entry = older;
+    }
+    free(g_buckets);
+    g_buckets = NULL;
+    g_bucketMask = 0;
+    g_newest = NULL;
+    g_oldest = NULL;
+    g_count = 0;
+}
+
+
+// ============================================================================
+#pragma mark - API -
+// ============================================================================
+
+char* growingcrashdmc_demangle(const char* mangledSymbol)
+{
+    if(mangledSymbol == NULL)
+    {
+        return NULL;
+    }
+
+    int length = (int)strlen(mangledSymbol);
+    uint32_t hash = hashSymbol(mangledSymbol, length);
+
+    pthread_mutex_lock(&g_mutex);
+    CacheEntry* entry = findEntry(mangledSymbol, length, hash);
+    likely_if(entry != NULL)
+    {
+        g_hits++;
+        unlinkRecent(entry);
+        linkNewest(entry);
+        char* result = entry->demangled == NULL ? NULL : strdup(entry->demangled);
+        pthread_mutex_unlock(&g_mutex);
+        return result;
+    }
+    g_misses++;
+    pthread_mutex_unlock(&g_mutex);
+
+    // Demangling is slow, so other threads can use the cache in the meantime.
+    char* demangled = demangleSymbol(mangledSymbol);
+
+    pthread_mutex_lock(&g_mutex);
+    if(findEntry(mangledSymbol, length, hash) == NULL)
+    {
+        addEntry(mangledSymbol, length, hash, demangled);
+    }
+    pthread_mutex_unlock(&g_mutex);
+    return demangled;
+}
+
+void growingcrashdmc_setCapacity(int capacity)
+{
+    pthread_mutex_lock(&g_mutex);
+    clearEntries();
+    g_capacity = capacity < 0 ? 0 : capacity;
+    pthread_mutex_unlock(&g_mutex);
+}
+
+void growingcrashdmc_clear(void)
+{
+    pthread_mutex_lock(&g_mutex);
+    clearEntries();
+    pthread_mutex_unlock(&g_mutex);
+}
+
+void growingcrashdmc_getStats(GrowingCrashDemangleCacheStats* stats)
+{
+    pthread_mutex_lock(&g_mutex);
+    stats->hits = g_hits;
+    stats->misses = g_misses;
+    stats->evictions = g_evictions;
+    stats->count = g_count;
+    stats->capacity = g_capacity;
+    pthread_mutex_unlock(&g_mutex);
+}
+
+void growingcrashdmc_resetStats(void)
+{
+    pthread_mutex_lock(&g_mutex);
+    g_hits = 0;
+    g_misses = 0;
+    g_evictions = 0;
+    pthread_mutex_unlock(&g_mutex);
+}
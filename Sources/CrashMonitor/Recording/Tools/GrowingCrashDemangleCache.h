@@ -0,0 +1,97 @@
+//
+//  GrowingCrashDemangleCache.h
+//  GrowingAnalytics
+//
+//  Created by YoloMao on 2022/9/19.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+/* Remembers demangled symbol names between report fixups.
+ *
+ * The same few hundred symbols show up in every thread of every report, and
+ * demangling them (Swift symbols especially) is by far the most expensive
+ * part of fixing up a report. Results, including failures, are kept in a
+ * bounded least recently used cache that is shared by all threads.
+ *
+ * Not async-safe. Only for use when reading reports.
+ */
+
+
+#ifndef HDR_GrowingCrashDemangleCache_h
+#define HDR_GrowingCrashDemangleCache_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdint.h>
+
+/** The default maximum number of symbols to remember. */
+#define GrowingCrashDMC_DEFAULT_CAPACITY 2048
+
+typedef struct
+{
+    /** Lookups that were answered from the cache. */
+    uint64_t hits;
+
+    /** Lookups that had to demangle. */
+    uint64_t misses;
+
+    /** Symbols dropped to make room for new ones. */
+    uint64_t evictions;
+
+    /** Symbols currently cached. */
+    int count;
+
+    /** The maximum number of symbols to cache. */
+    int capacity;
+} GrowingCrashDemangleCacheStats;
+
+/** Demangle a C++ or Swift symbol, using the cached result if there is one.
+ *
+ * @param mangledSymbol The mangled symbol.
+ *
+ * @return A demangled symbol, or NULL if demangling failed.
+ *         MEMORY MANAGEMENT WARNING: User is responsible for calling free() on the returned value.
+ */
+char* growingcrashdmc_demangle(const char* mangledSymbol);
+
+/** Set the maximum number of symbols to cache. This clears the cache.
+ *
+ * @param capacity The maximum number of symbols, or 0 to disable caching.
+ */
+void growingcrashdmc_setCapacity(int capacity);
+
+/** Free all cached symbols, e.g. at the end of an upload session.
+ * The statistics are kept.
+ */
+void growingcrashdmc_clear(void);
+
+/** Get the cache statistics.
+ *
+ * @param stats Receives the statistics.
+ */
+void growingcrashdmc_getStats(GrowingCrashDemangleCacheStats* stats);
+
+/** Reset the hit, miss and eviction counters. */
+void growingcrashdmc_resetStats(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HDR_GrowingCrashDemangleCache_h
@@ -43,9 +43,133 @@
 #include "GrowingCrashDemangle_CPP.h"
 #include "GrowingCrashLogger.h"
 
+#include <pthread.h>
+#include <stdlib.h>
+
+/** Output buffer kept by each thread for growingcrashdm_demangleCPPReusingBuffer(). */
+typedef struct
+{
+    char* data;
+
+    /** The number of bytes known to be allocated for data. */
+    size_t capacity;
+} DemangleBuffer;
+
+static pthread_key_t g_bufferKey;
+static pthread_once_t g_bufferOnce = PTHREAD_ONCE_INIT;
+
+static uint64_t g_calls;
+static uint64_t g_skipped;
+static uint64_t g_failures;
+
+static void destroyBuffer(void* userData)
+{
+    DemangleBuffer* buffer = (DemangleBuffer*)userData;
+    free(buffer->data);
+    free(buffer);
+}
+
+static void createBufferKey(void)
+{
+    pthread_key_create(&g_bufferKey, destroyBuffer);
+}
+
+static DemangleBuffer* getBuffer(void)
+{
+    pthread_once(&g_bufferOnce, createBufferKey);
+    DemangleBuffer* buffer = (DemangleBuffer*)pthread_getspecific(g_bufferKey);
+    if(buffer == NULL)
+    {
+        buffer = (DemangleBuffer*)calloc(1, sizeof(*buffer));
+        if(buffer != NULL)
+        {
+            pthread_setspecific(g_bufferKey, buffer);
+        }
+    }
+    return buffer;
+}
+
+/** Itanium manglings start with _Z, and block invocations inside C++
+ * functions with ___Z. On Apple platforms they carry one more underscore.
+ */
+static bool isCPPMangledName(const char* symbol)
+{
+    int underscores = 0;
+    while(symbol[underscores] == '_' && underscores < 4)
+    {
+        underscores++;
+    }
+    return underscores > 0 && symbol[underscores] == 'Z';
+}
+
+static bool shouldDemangle(const char* mangledSymbol)
+{
+    __atomic_fetch_add(&g_calls, 1, __ATOMIC_RELAXED);
+    if(mangledSymbol == NULL || !isCPPMangledName(mangledSymbol))
+    {
+        __atomic_fetch_add(&g_skipped, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    return true;
+}
+
 extern "C" char* growingcrashdm_demangleCPP(const char* mangledSymbol)
 {
+    if(!shouldDemangle(mangledSymbol))
+    {
+        return NULL;
+    }
     int status = 0;
     char* demangled = __cxxabiv1::__cxa_demangle(mangledSymbol, NULL, NULL, &status);
-    return status == 0 ? demangled : NULL;
+    if(status != 0)
+    {
+        __atomic_fetch_add(&g_failures, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    return demangled;
+}
+
+extern "C" const char* growingcrashdm_demangleCPPReusingBuffer(const char* mangledSymbol)
+{
+    if(!shouldDemangle(mangledSymbol))
+    {
+        return NULL;
+    }
+    DemangleBuffer* buffer = getBuffer();
+    if(buffer == NULL)
+    {
+        return NULL;
+    }
+    int status = 0;
+    // __cxa_demangle reallocs the buffer if the result doesn't fit. libc++abi
+    // then sets the length to the bytes it used rather than the bytes
+    // allocated, so keep the capacity separately, or every name after a short
+    // one would grow the buffer again.
+    size_t length = buffer->capacity;
+    char* demangled = __cxxabiv1::__cxa_demangle(mangledSymbol, buffer->data, &length, &status);
+    if(status != 0)
+    {
+        __atomic_fetch_add(&g_failures, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    if(demangled != buffer->data || length > buffer->capacity)
+    {
+        buffer->data = demangled;
+        buffer->capacity = length;
+    }
+    return demangled;
+}
+
+extern "C" void growingcrashdm_getCPPStats(GrowingCrashDemangleCPPStats* stats)
+{
+    stats->calls = __atomic_load_n(&g_calls, __ATOMIC_RELAXED);
+    stats->skipped = __atomic_load_n(&g_skipped, __ATOMIC_RELAXED);
+    stats->failures = __atomic_load_n(&g_failures, __ATOMIC_RELAXED);
+}
+
+extern "C" void growingcrashdm_resetCPPStats(void)
+{
+    __atomic_store_n(&g_calls, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_skipped, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&g_failures, 0, __ATOMIC_RELAXED);
 }
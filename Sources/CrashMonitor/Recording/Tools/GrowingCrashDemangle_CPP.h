@@ -45,7 +45,22 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
+
+typedef struct
+{
+    /** Symbols passed in. */
+    uint64_t calls;
+
+    /** Symbols that weren't C++ manglings, and were never demangled. */
+    uint64_t skipped;
+
+    /** C++ manglings that failed to demangle. */
+    uint64_t failures;
+} GrowingCrashDemangleCPPStats;
+
 /** Demangle a C++ symbol.
+ * Symbols that aren't Itanium manglings (_Z...) fail without calling into the ABI.
  *
  * @param mangledSymbol The mangled symbol.
  *
@@ -54,6 +69,25 @@ extern "C" {
  */
 char* growingcrashdm_demangleCPP(const char* mangledSymbol);
 
+/** Demangle a C++ symbol into a buffer that each thread keeps and reuses,
+ * so that demangling doesn't allocate once the buffer is big enough.
+ *
+ * @param mangledSymbol The mangled symbol.
+ *
+ * @return A demangled symbol, or NULL if demangling failed. It is only
+ *         valid until the next call on the same thread. Do not free it.
+ */
+const char* growingcrashdm_demangleCPPReusingBuffer(const char* mangledSymbol);
+
+/** Get the C++ demangling statistics, for all threads.
+ *
+ * @param stats Receives the statistics.
+ */
+void growingcrashdm_getCPPStats(GrowingCrashDemangleCPPStats* stats);
+
+/** Reset the C++ demangling statistics. */
+void growingcrashdm_resetCPPStats(void);
+
 #ifdef __cplusplus
 }
 #endif
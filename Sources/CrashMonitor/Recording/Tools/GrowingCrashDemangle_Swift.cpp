@@ -42,6 +42,27 @@
 #include "Demangle.h"
 #include "GrowingCrashDemangle_Swift.h"
 
+#include <new>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct GrowingCrashSwiftDemangler
+{
+    swift::Demangle::Context context;
+    swift::Demangle::DemangleOptions options;
+    /** Fixed node memory, or NULL to use the heap. */
+    char* arena;
+    /** Where to go when the arena runs out. */
+    sigjmp_buf arenaExhaustedJump;
+};
+
+static void onArenaExhausted(void* context)
+{
+    GrowingCrashSwiftDemangler* demangler = (GrowingCrashSwiftDemangler*)context;
+    siglongjmp(demangler->arenaExhaustedJump, 1);
+}
+
 extern "C" char* growingcrashdm_demangleSwift(const char* mangledSymbol)
 {
     swift::Demangle::DemangleOptions options = swift::Demangle::DemangleOptions::SimplifiedUIDemangleOptions();
@@ -52,3 +73,111 @@ extern "C" char* growingcrashdm_demangleSwift(const char* mangledSymbol)
     }
     return strdup(demangled.c_str());
 }
+
+extern "C" GrowingCrashSwiftDemangler* growingcrashdm_createSwiftDemangler(void)
+{
+    GrowingCrashSwiftDemangler* demangler = new (std::nothrow) GrowingCrashSwiftDemangler();
+    if(demangler != NULL)
+    {
+        demangler->options = swift::Demangle::DemangleOptions::SimplifiedUIDemangleOptions();
+        demangler->arena = NULL;
+    }
+    return demangler;
+}
+
+extern "C" GrowingCrashSwiftDemangler* growingcrashdm_createSwiftArenaDemangler(int arenaSize)
+{
+    if(arenaSize <= 0)
+    {
+        return NULL;
+    }
+    GrowingCrashSwiftDemangler* demangler = growingcrashdm_createSwiftDemangler();
+    if(demangler == NULL)
+    {
+        return NULL;
+    }
+    demangler->arena = (char*)malloc((size_t)arenaSize);
+    if(demangler->arena == NULL)
+    {
+        delete demangler;
+        return NULL;
+    }
+    // Embedded symbols would be demangled with a new heap allocated context.
+    demangler->options.DemangleSpecializationPayloads = false;
+    demangler->context.useArena(demangler->arena, (size_t)arenaSize, onArenaExhausted, demangler);
+    return demangler;
+}
+
+extern "C" void growingcrashdm_destroySwiftDemangler(GrowingCrashSwiftDemangler* demangler)
+{
+    if(demangler == NULL)
+    {
+        return;
+    }
+    char* arena = demangler->arena;
+    delete demangler;
+    free(arena);
+}
+
+static int failArenaDemangle(GrowingCrashSwiftDemangler* demangler, char* buffer, int bufferLength)
+{
+    demangler->context.clear();
+    if(bufferLength > 0)
+    {
+        buffer[0] = '\0';
+    }
+    return 0;
+}
+
+/** Demangle into a buffer, printing either the full name or the signature key. */
+static int demangleWith(GrowingCrashSwiftDemangler* demangler,
+                        const char* mangledSymbol,
+                        char* buffer,
+                        int bufferLength,
+                        bool signatureKey)
+{
+    if(demangler->arena != NULL)
+    {
+        // Old style manglings are demangled with heap allocated strings.
+        if(!swift::Demangle::isMangledName(mangledSymbol))
+        {
+            return failArenaDemangle(demangler, buffer, bufferLength);
+        }
+        if(sigsetjmp(demangler->arenaExhaustedJump, 0) != 0)
+        {
+            return failArenaDemangle(demangler, buffer, bufferLength);
+        }
+    }
+
+    int length = 0;
+    size_t bufferSize = bufferLength > 0 ? (size_t)bufferLength : 0;
+    swift::Demangle::NodePointer root = demangler->context.demangleSymbolAsNode(mangledSymbol);
+    if(signatureKey)
+    {
+        length = (int)swift::Demangle::nodeToSignatureKey(root, buffer, bufferSize);
+    }
+    else
+    {
+        // Also empties the buffer when the symbol couldn't be demangled.
+        length = (int)swift::Demangle::nodeToBuffer(root, buffer, bufferSize, demangler->options);
+    }
+    // Frees the nodes but keeps the largest slab for the next symbol.
+    demangler->context.clear();
+    return length;
+}
+
+extern "C" int growingcrashdm_demangleSwiftWith(GrowingCrashSwiftDemangler* demangler,
+                                                const char* mangledSymbol,
+                                                char* buffer,
+                                                int bufferLength)
+{
+    return demangleWith(demangler, mangledSymbol, buffer, bufferLength, false);
+}
+
+extern "C" int growingcrashdm_swiftSignatureKeyWith(GrowingCrashSwiftDemangler* demangler,
+                                                    const char* mangledSymbol,
+                                                    char* buffer,
+                                                    int bufferLength)
+{
+    return demangleWith(demangler, mangledSymbol, buffer, bufferLength, true);
+}
@@ -53,6 +53,69 @@ extern "C" {
  *         MEMORY MANAGEMENT WARNING: User is responsible for calling free() on the returned value.
  */
 char* growingcrashdm_demangleSwift(const char* mangledSymbol);
+
+/** A reusable Swift demangler, for demangling many symbols in a row.
+ * It keeps its node memory between symbols instead of setting up and tearing
+ * down a new demangler for each one, and prints without allocating.
+ * Not thread safe.
+ */
+typedef struct GrowingCrashSwiftDemangler GrowingCrashSwiftDemangler;
+
+/** Create a reusable Swift demangler.
+ *
+ * @return The demangler, or NULL if it could not be allocated.
+ */
+GrowingCrashSwiftDemangler* growingcrashdm_createSwiftDemangler(void);
+
+/** Create a demangler that doesn't allocate any memory once it is created,
+ * so that it can be used while writing a crash report.
+ *
+ * Nodes are allocated from a fixed arena. Symbols fail to demangle if they
+ * need more memory than the arena has, or would need the heap for something
+ * else (old style manglings and a few rare thunks).
+ *
+ * @param arenaSize The size of the arena in bytes.
+ *
+ * @return The demangler, or NULL if it could not be allocated.
+ */
+GrowingCrashSwiftDemangler* growingcrashdm_createSwiftArenaDemangler(int arenaSize);
+
+/** Destroy a demangler created by growingcrashdm_createSwiftDemangler() or
+ * growingcrashdm_createSwiftArenaDemangler().
+ */
+void growingcrashdm_destroySwiftDemangler(GrowingCrashSwiftDemangler* demangler);
+
+/** Demangle a Swift symbol into a buffer.
+ *
+ * @param demangler The demangler to use.
+ *
+ * @param mangledSymbol The mangled symbol.
+ *
+ * @param buffer Receives the null terminated demangled symbol. It is
+ *               truncated if it doesn't fit.
+ *
+ * @param bufferLength The length of the buffer. Pass 0 to only get the length.
+ *
+ * @return The length of the demangled symbol, or 0 if demangling failed.
+ *         A value of bufferLength or more means the result was truncated.
+ */
+int growingcrashdm_demangleSwiftWith(GrowingCrashSwiftDemangler* demangler,
+                                     const char* mangledSymbol,
+                                     char* buffer,
+                                     int bufferLength);
+
+/** Get a short key that identifies the function a Swift symbol refers to,
+ * for grouping frames: the module, enclosing types and name, e.g.
+ * "main.Foo.bar". Signatures, generic arguments and specializations are left
+ * out, so this is much cheaper than demangling the whole symbol.
+ *
+ * Buffer handling and the return value are the same as for
+ * growingcrashdm_demangleSwiftWith().
+ */
+int growingcrashdm_swiftSignatureKeyWith(GrowingCrashSwiftDemangler* demangler,
+                                         const char* mangledSymbol,
+                                         char* buffer,
+                                         int bufferLength);
     
 #ifdef __cplusplus
 }
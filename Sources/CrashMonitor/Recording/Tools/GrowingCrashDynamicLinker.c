@@ -45,11 +45,15 @@
 #include <mach-o/nlist.h>
 #include <mach-o/stab.h>
 #include <mach-o/getsect.h>
+#include <pthread.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include "GrowingCrashImageRanges.h"
 #include "GrowingCrashLogger.h"
 #include "GrowingCrashMemory.h"
 #include "GrowingCrashPlatformSpecificDefines.h"
+#include "GrowingCrashSymbolTable.h"
 
 #ifndef GrowingCrashDL_MaxCrashInfoStringLength
     #define GrowingCrashDL_MaxCrashInfoStringLength 1024
@@ -69,6 +73,37 @@ typedef struct {
 #pragma pack()
 #define GrowingCrashDL_SECT_CRASH_INFO "__crash_info"
 
+/** The segments of all loaded images, sorted by start address. An index is
+ * never modified once it has been published. Adding or removing an image
+ * publishes a new one, so that lookups don't need a lock.
+ */
+typedef struct ImageIndex
+{
+    struct ImageIndex* nextRetired;
+
+    /** A symbol table that no newer index refers to. It is freed along with
+     * this index.
+     */
+    GrowingCrashSymbolTable* unusedSymbolTable;
+
+    /** The number of images that have been added to the index. */
+    uint32_t imageCount;
+
+    int count;
+    GrowingCrashImageRange ranges[];
+} ImageIndex;
+
+static ImageIndex* g_imageIndex = NULL;
+
+/** Indexes that have been replaced, but might still be in use by a lookup. */
+static ImageIndex* g_retiredImageIndexes = NULL;
+
+/** Lookups in progress. Retired indexes are freed when there are none. */
+static int g_imageIndexLookups = 0;
+
+/** Serializes updates to the index. */
+static pthread_mutex_t g_imageIndexMutex = PTHREAD_MUTEX_INITIALIZER;
+
 
 /** Get the address of the first command following a header (which will be of
  * type struct load_command).
@@ -94,12 +129,13 @@ static uintptr_t firstCmdAfterHeader(const struct mach_header* const header)
     }
 }
 
-/** Get the image index that the specified address is part of.
+/** Get the image index that the specified address is part of, by checking
+ * the segments of every image.
  *
  * @param address The address to examine.
  * @return The index of the image it is part of, or UINT_MAX if none was found.
  */
-static uint32_t imageIndexContainingAddress(const uintptr_t address)
+static uint32_t scanImagesForAddress(const uintptr_t address)
 {
     const uint32_t imageCount = _dyld_image_count();
     const struct mach_header* header = 0;
@@ -148,13 +184,11 @@ static uint32_t imageIndexContainingAddress(const uintptr_t address)
  *
  * This is required for any symtab command offsets.
  *
- * @param idx The image index.
- * @return The image's base address, or 0 if none was found.
+ * @param header The image's header.
+ * @return The image's base address without its slide, or 0 if none was found.
  */
-static uintptr_t segmentBaseOfImageIndex(const uint32_t idx)
+static uintptr_t segmentBaseOfImage(const struct mach_header* const header)
 {
-    const struct mach_header* header = _dyld_get_image_header(idx);
-    
     // Look for a segment command and return the file image address.
     uintptr_t cmdPtr = firstCmdAfterHeader(header);
     if(cmdPtr == 0)
@@ -186,6 +220,378 @@ static uintptr_t segmentBaseOfImageIndex(const uint32_t idx)
     return 0;
 }
 
+// ============================================================================
+#pragma mark - Image Address Index -
+// ============================================================================
+
+static void freeRetiredImageIndexes(void)
+{
+    while(g_retiredImageIndexes != NULL)
+    {
+        ImageIndex* index = g_retiredImageIndexes;
+        g_retiredImageIndexes = index->nextRetired;
+        growingcrashst_destroy(index->unusedSymbolTable);
+        free(index);
+    }
+}
+
+static uint32_t currentImageIndex(const struct mach_header* const header, const uint32_t hint)
+{
+    const uint32_t imageCount = _dyld_image_count();
+    if(hint < imageCount && _dyld_get_image_header(hint) == header)
+    {
+        return hint;
+    }
+    for(uint32_t iImg = imageCount; iImg > 0; iImg--)
+    {
+        if(_dyld_get_image_header(iImg - 1) == header)
+        {
+            return iImg - 1;
+        }
+    }
+    return UINT_MAX;
+}
+
+/** Build a new index from the current one. Call with g_imageIndexMutex held.
+ *
+ * @param removedHeader The image to leave out, or NULL.
+ * @param addedRanges Ranges to add. They are sorted in place.
+ * @param addedCount The number of ranges to add.
+ * @param imageCount The number of images in the new index.
+ * @return The new index, or NULL if it couldn't be allocated.
+ */
+static ImageIndex* createImageIndex(const struct mach_header* const removedHeader,
+                                    GrowingCrashImageRange* const addedRanges,
+                                    const int addedCount,
+                                    const uint32_t imageCount)
+{
+    const ImageIndex* oldIndex = g_imageIndex;
+    const GrowingCrashImageRange* oldRanges = oldIndex == NULL ? NULL : oldIndex->ranges;
+    int oldCount = oldIndex == NULL ? 0 : oldIndex->count;
+
+    ImageIndex* index = malloc(sizeof(*index) + sizeof(GrowingCrashImageRange) * (size_t)(oldCount + addedCount));
+    if(index == NULL)
+    {
+        GrowingCrashLOG_ERROR("Could not allocate an image index of %d ranges", oldCount + addedCount);
+        return NULL;
+    }
+    index->nextRetired = NULL;
+    index->unusedSymbolTable = NULL;
+    index->imageCount = imageCount;
+    index->count = growingcrashir_buildImageRanges(oldRanges, oldCount, removedHeader, addedRanges, addedCount, index->ranges);
+    return index;
+}
+
+/** Replace the current index. Call with g_imageIndexMutex held.
+ *
+ * @param index The new index.
+ * @param unusedSymbolTable A symbol table that the new index no longer refers
+ *                          to, or NULL.
+ */
+static void publishImageIndex(ImageIndex* const index, GrowingCrashSymbolTable* const unusedSymbolTable)
+{
+    ImageIndex* oldIndex = g_imageIndex;
+    __atomic_store_n(&g_imageIndex, index, __ATOMIC_SEQ_CST);
+    if(oldIndex != NULL)
+    {
+        oldIndex->unusedSymbolTable = unusedSymbolTable;
+        oldIndex->nextRetired = g_retiredImageIndexes;
+        g_retiredImageIndexes = oldIndex;
+    }
+    // A lookup that starts after this sees the new index, so if none are
+    // running, nothing can still be using the retired ones.
+    if(__atomic_load_n(&g_imageIndexLookups, __ATOMIC_SEQ_CST) == 0)
+    {
+        freeRetiredImageIndexes();
+    }
+}
+
+/** Add or remove an image. Call with g_imageIndexMutex held. */
+static void updateImageIndex(const struct mach_header* const removedHeader,
+                             GrowingCrashImageRange* const addedRanges,
+                             const int addedCount,
+                             const uint32_t imageCount)
+{
+    GrowingCrashSymbolTable* unusedSymbolTable = NULL;
+    if(removedHeader != NULL && g_imageIndex != NULL)
+    {
+        for(int i = 0; i < g_imageIndex->count; i++)
+        {
+            if(g_imageIndex->ranges[i].header == removedHeader)
+            {
+                unusedSymbolTable = g_imageIndex->ranges[i].symbolTable;
+                break;
+            }
+        }
+    }
+    ImageIndex* index = createImageIndex(removedHeader, addedRanges, addedCount, imageCount);
+    if(index != NULL)
+    {
+        publishImageIndex(index, unusedSymbolTable);
+    }
+}
+
+/** Call with g_imageIndexMutex held. */
+static bool isImageIndexed(const struct mach_header* const header)
+{
+    if(g_imageIndex == NULL)
+    {
+        return false;
+    }
+    // The header is in the image's __TEXT segment.
+    const GrowingCrashImageRange* range;
+    growingcrashir_findImageRange(g_imageIndex->ranges, g_imageIndex->count, (uintptr_t)header, &range);
+    return range != NULL && range->header == header;
+}
+
+static void onImageAdded(const struct mach_header* header, intptr_t slide)
+{
+    pthread_mutex_lock(&g_imageIndexMutex);
+    // Images that were already loaded were indexed by growingcrashdl_initialize().
+    if(!isImageIndexed(header))
+    {
+        uint32_t imageIndex = currentImageIndex(header, UINT_MAX);
+        int count = growingcrashir_getImageRanges(header, (uintptr_t)slide, imageIndex, NULL, 0);
+        GrowingCrashImageRange* ranges = malloc(sizeof(*ranges) * (size_t)(count > 0 ? count : 1));
+        if(ranges != NULL)
+        {
+            growingcrashir_getImageRanges(header, (uintptr_t)slide, imageIndex, ranges, count);
+            uint32_t imageCount = g_imageIndex == NULL ? 0 : g_imageIndex->imageCount;
+            updateImageIndex(NULL, ranges, count, imageCount + 1);
+            free(ranges);
+        }
+    }
+    pthread_mutex_unlock(&g_imageIndexMutex);
+}
+
+static void onImageRemoved(const struct mach_header* header, __unused intptr_t slide)
+{
+    pthread_mutex_lock(&g_imageIndexMutex);
+    if(g_imageIndex != NULL)
+    {
+        uint32_t imageCount = g_imageIndex->imageCount;
+        updateImageIndex(header, NULL, 0, imageCount > 0 ? imageCount - 1 : 0);
+    }
+    pthread_mutex_unlock(&g_imageIndexMutex);
+}
+
+/** Index all images that are loaded now in one go, rather than one at a time
+ * as dyld reports them. Call with g_imageIndexMutex held.
+ */
+static void indexLoadedImages(void)
+{
+    const uint32_t imageCount = _dyld_image_count();
+    int count = 0;
+    for(uint32_t iImg = 0; iImg < imageCount; iImg++)
+    {
+        const struct mach_header* header = _dyld_get_image_header(iImg);
+        if(header != NULL)
+        {
+            count += growingcrashir_getImageRanges(header, 0, iImg, NULL, 0);
+        }
+    }
+    GrowingCrashImageRange* ranges = malloc(sizeof(*ranges) * (size_t)(count > 0 ? count : 1));
+    if(ranges == NULL)
+    {
+        return;
+    }
+    int index = 0;
+    for(uint32_t iImg = 0; iImg < imageCount; iImg++)
+    {
+        const struct mach_header* header = _dyld_get_image_header(iImg);
+        if(header != NULL)
+        {
+            uintptr_t slide = (uintptr_t)_dyld_get_image_vmaddr_slide(iImg);
+            int found = growingcrashir_getImageRanges(header, slide, iImg, ranges + index, count - index);
+            index += found < count - index ? found : count - index;
+        }
+    }
+    updateImageIndex(NULL, ranges, index, imageCount);
+    free(ranges);
+}
+
+static int compareHeaders(const void* a, const void* b)
+{
+    uintptr_t headerA = (uintptr_t)*(const struct mach_header* const*)a;
+    uintptr_t headerB = (uintptr_t)*(const struct mach_header* const*)b;
+    return headerA < headerB ? -1 : headerA > headerB;
+}
+
+/** Build the symbol table of one image and publish an index that uses it.
+ * Call with g_imageIndexMutex held, which keeps the image from being
+ * unloaded in the meantime.
+ */
+static void addSymbolTable(const struct mach_header* const header)
+{
+    const GrowingCrashImageRange* imageRange = NULL;
+    for(int i = 0; i < g_imageIndex->count; i++)
+    {
+        if(g_imageIndex->ranges[i].header == header)
+        {
+            imageRange = &g_imageIndex->ranges[i];
+            break;
+        }
+    }
+    if(imageRange == NULL || imageRange->symbolTable != NULL)
+    {
+        return;
+    }
+    const uintptr_t segmentBase = segmentBaseOfImage(header) + imageRange->slide;
+    if(segmentBase == 0)
+    {
+        return;
+    }
+    GrowingCrashSymbolTable* symbolTable = growingcrashst_create(header, segmentBase);
+    if(symbolTable == NULL)
+    {
+        return;
+    }
+    ImageIndex* index = createImageIndex(NULL, NULL, 0, g_imageIndex->imageCount);
+    if(index == NULL)
+    {
+        growingcrashst_destroy(symbolTable);
+        return;
+    }
+    for(int i = 0; i < index->count; i++)
+    {
+        if(index->ranges[i].header == header)
+        {
+            index->ranges[i].symbolTable = symbolTable;
+        }
+    }
+    publishImageIndex(index, NULL);
+}
+
+static void* buildSymbolTables(__unused void* const userData)
+{
+    // Take a list of the images first, so that the mutex is only held for
+    // one image at a time.
+    pthread_mutex_lock(&g_imageIndexMutex);
+    int headerCount = g_imageIndex == NULL ? 0 : g_imageIndex->count;
+    const struct mach_header** headers = malloc(sizeof(*headers) * (size_t)(headerCount > 0 ? headerCount : 1));
+    if(headers != NULL)
+    {
+        for(int i = 0; i < headerCount; i++)
+        {
+            headers[i] = g_imageIndex->ranges[i].header;
+        }
+    }
+    pthread_mutex_unlock(&g_imageIndexMutex);
+    if(headers == NULL)
+    {
+        return NULL;
+    }
+
+    qsort(headers, (size_t)headerCount, sizeof(*headers), compareHeaders);
+    for(int i = 0; i < headerCount; i++)
+    {
+        if(i == 0 || headers[i] != headers[i - 1])
+        {
+            pthread_mutex_lock(&g_imageIndexMutex);
+            addSymbolTable(headers[i]);
+            pthread_mutex_unlock(&g_imageIndexMutex);
+        }
+    }
+    free(headers);
+    GrowingCrashLOG_DEBUG("Built symbol tables for %d image ranges", headerCount);
+    return NULL;
+}
+
+/** Get the current index, and keep it (and any index or symbol table that was
+ * current when this was called) from being freed until endImageIndexLookup().
+ */
+static const ImageIndex* beginImageIndexLookup(void)
+{
+    __atomic_add_fetch(&g_imageIndexLookups, 1, __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&g_imageIndex, __ATOMIC_SEQ_CST);
+}
+
+static void endImageIndexLookup(void)
+{
+    __atomic_sub_fetch(&g_imageIndexLookups, 1, __ATOMIC_RELEASE);
+}
+
+/** Get the image index that the specified address is part of.
+ *
+ * Uses the image address index when it has an unambiguous answer, and
+ * otherwise checks every image. The index can briefly lag behind dyld while
+ * images are being added or removed, so a miss is only trusted when the
+ * index has as many images as dyld does.
+ *
+ * @param index The index from beginImageIndexLookup(), or NULL.
+ * @param address The address to examine.
+ * @param symbolTable Receives the image's symbol table, or NULL if it has none.
+ *                    It is valid until endImageIndexLookup().
+ * @return The index of the image it is part of, or UINT_MAX if none was found.
+ */
+static uint32_t imageIndexContainingAddress(const ImageIndex* const index,
+                                            const uintptr_t address,
+                                            const GrowingCrashSymbolTable** const symbolTable)
+{
+    *symbolTable = NULL;
+    bool isMissed = false;
+    if(index != NULL)
+    {
+        const GrowingCrashImageRange* range;
+        bool isUnambiguous = growingcrashir_findImageRange(index->ranges, index->count, address, &range);
+        if(range != NULL)
+        {
+            uint32_t imageIndex = currentImageIndex(range->header, range->imageIndexHint);
+            if(imageIndex != UINT_MAX)
+            {
+                *symbolTable = range->symbolTable;
+                return imageIndex;
+            }
+        }
+        else
+        {
+            isMissed = isUnambiguous && index->imageCount == _dyld_image_count();
+        }
+    }
+    if(isMissed)
+    {
+        return UINT_MAX;
+    }
+    return scanImagesForAddress(address);
+}
+
+void growingcrashdl_initialize(void)
+{
+    static bool isInitialized = false;
+    if(!isInitialized)
+    {
+        isInitialized = true;
+        pthread_mutex_lock(&g_imageIndexMutex);
+        indexLoadedImages();
+        pthread_mutex_unlock(&g_imageIndexMutex);
+        // This calls onImageAdded() for every image that is already loaded.
+        _dyld_register_func_for_add_image(onImageAdded);
+        _dyld_register_func_for_remove_image(onImageRemoved);
+    }
+}
+
+
+void growingcrashdl_buildSymbolTablesInBackground(void)
+{
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int error = pthread_create(&thread,
+                               &attr,
+                               &buildSymbolTables,
+                               "GrowingCrash Symbol Tables");
+    if(error != 0)
+    {
+        GrowingCrashLOG_ERROR("pthread_create: %s", strerror(error));
+    }
+    pthread_attr_destroy(&attr);
+}
+
+// ============================================================================
+#pragma mark - API -
+// ============================================================================
+
 uint32_t growingcrashdl_imageNamed(const char* const imageName, bool exactMatch)
 {
     if(imageName != NULL)
@@ -214,6 +620,15 @@ uint32_t growingcrashdl_imageNamed(const char* const imageName, bool exactMatch)
     return UINT32_MAX;
 }
 
+uint32_t growingcrashdl_imageIndexContainingAddress(const uintptr_t address)
+{
+    const GrowingCrashSymbolTable* symbolTable;
+    const ImageIndex* imageIndex = beginImageIndexLookup();
+    const uint32_t idx = imageIndexContainingAddress(imageIndex, address, &symbolTable);
+    endImageIndexLookup();
+    return idx;
+}
+
 const uint8_t* growingcrashdl_imageUUID(const char* const imageName, bool exactMatch)
 {
     if(imageName != NULL)
@@ -244,22 +659,24 @@ const uint8_t* growingcrashdl_imageUUID(const char* const imageName, bool exactM
     return NULL;
 }
 
-bool growingcrashdl_dladdr(const uintptr_t address, Dl_info* const info)
+/** Find the symbol nearest to an address in an image.
+ *
+ * @param idx The image's index.
+ * @param address The address to look up.
+ * @param symbolTable The image's sorted symbol table, or NULL to scan its
+ *                    LC_SYMTAB instead.
+ * @param info Receives the image and symbol.
+ * @return false if the image couldn't be examined.
+ */
+static bool findSymbolInImage(const uint32_t idx,
+                              const uintptr_t address,
+                              const GrowingCrashSymbolTable* const symbolTable,
+                              Dl_info* const info)
 {
-    info->dli_fname = NULL;
-    info->dli_fbase = NULL;
-    info->dli_sname = NULL;
-    info->dli_saddr = NULL;
-
-    const uint32_t idx = imageIndexContainingAddress(address);
-    if(idx == UINT_MAX)
-    {
-        return false;
-    }
     const struct mach_header* header = _dyld_get_image_header(idx);
     const uintptr_t imageVMAddrSlide = (uintptr_t)_dyld_get_image_vmaddr_slide(idx);
     const uintptr_t addressWithSlide = address - imageVMAddrSlide;
-    const uintptr_t segmentBase = segmentBaseOfImageIndex(idx) + imageVMAddrSlide;
+    const uintptr_t segmentBase = segmentBaseOfImage(header) + imageVMAddrSlide;
     if(segmentBase == 0)
     {
         return false;
@@ -268,6 +685,18 @@ bool growingcrashdl_dladdr(const uintptr_t address, Dl_info* const info)
     info->dli_fname = _dyld_get_image_name(idx);
     info->dli_fbase = (void*)header;
 
+    if(symbolTable != NULL)
+    {
+        uintptr_t symbolAddress;
+        const char* symbolName;
+        if(growingcrashst_lookup(symbolTable, addressWithSlide, &symbolAddress, &symbolName))
+        {
+            info->dli_saddr = (void*)(symbolAddress + imageVMAddrSlide);
+            info->dli_sname = symbolName;
+        }
+        return true;
+    }
+
     // Find symbol tables and get whichever symbol is closest to the address.
     const nlist_t* bestMatch = NULL;
     uintptr_t bestDistance = ULONG_MAX;
@@ -332,6 +761,21 @@ bool growingcrashdl_dladdr(const uintptr_t address, Dl_info* const info)
     return true;
 }
 
+bool growingcrashdl_dladdr(const uintptr_t address, Dl_info* const info)
+{
+    info->dli_fname = NULL;
+    info->dli_fbase = NULL;
+    info->dli_sname = NULL;
+    info->dli_saddr = NULL;
+
+    const GrowingCrashSymbolTable* symbolTable;
+    const ImageIndex* imageIndex = beginImageIndexLookup();
+    const uint32_t idx = imageIndexContainingAddress(imageIndex, address, &symbolTable);
+    bool isFound = idx != UINT_MAX && findSymbolInImage(idx, address, symbolTable, info);
+    endImageIndexLookup();
+    return isFound;
+}
+
 static bool isValidCrashInfoMessage(const char* str)
 {
     if(str == NULL)
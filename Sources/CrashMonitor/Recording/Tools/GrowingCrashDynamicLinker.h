@@ -66,6 +66,24 @@ typedef struct
     const char* crashInfoMessage2;
 } GrowingCrashBinaryImage;
 
+/** Start keeping an index of where loaded images are in memory, which makes
+ * growingcrashdl_dladdr() much faster. Images are added to and removed from
+ * the index as they are loaded and unloaded.
+ *
+ * Not async-safe.
+ */
+void growingcrashdl_initialize(void);
+
+/** Build sorted copies of the symbol tables of all images loaded so far on a
+ * background thread, so that growingcrashdl_dladdr() can find a symbol with
+ * a binary search instead of checking every symbol of the image. Images
+ * loaded afterwards are still searched symbol by symbol. Costs about 8 bytes
+ * per symbol address.
+ *
+ * Call after growingcrashdl_initialize(). Not async-safe.
+ */
+void growingcrashdl_buildSymbolTablesInBackground(void);
+
 /** Get the number of loaded binary images.
  */
 int growingcrashdl_imageCount(void);
@@ -102,6 +120,17 @@ bool growingcrashdl_getBinaryImageForHeader(const void* const header_ptr, const
  */
 uint32_t growingcrashdl_imageNamed(const char* const imageName, bool exactMatch);
 
+/** Find the loaded binary image containing an address, without looking up
+ * the symbol.
+ *
+ * This function is async-safe.
+ *
+ * @param address The address to look for.
+ *
+ * @return the index of the image, or UINT32_MAX if not found.
+ */
+uint32_t growingcrashdl_imageIndexContainingAddress(const uintptr_t address);
+
 /** Get the UUID of a loaded binary image with the specified name.
  *
  * @param imageName The image name to look for.
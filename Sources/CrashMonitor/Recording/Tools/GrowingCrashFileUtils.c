@@ -47,9 +47,11 @@
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -336,6 +338,63 @@ done:
     return isSuccessful;
 }
 
+bool growingcrashfu_mapFile(const char* const path, const char** data, int* length)
+{
+    *data = NULL;
+    *length = 0;
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        GrowingCrashLOG_ERROR("Could not open %s: %s", path, strerror(errno));
+        return false;
+    }
+
+    bool isSuccessful = false;
+    struct stat st;
+    if(fstat(fd, &st) < 0)
+    {
+        GrowingCrashLOG_ERROR("Could not stat %s: %s", path, strerror(errno));
+        goto done;
+    }
+    if(st.st_size > INT_MAX)
+    {
+        GrowingCrashLOG_ERROR("File %s is too large to map (%lld bytes)", path, (long long)st.st_size);
+        goto done;
+    }
+    if(st.st_size == 0)
+    {
+        // mmap() rejects empty mappings.
+        *data = "";
+        isSuccessful = true;
+        goto done;
+    }
+
+    void* mem = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(mem == MAP_FAILED)
+    {
+        GrowingCrashLOG_ERROR("Could not map %s: %s", path, strerror(errno));
+        goto done;
+    }
+    // Reports are read front to back in a single pass.
+    madvise(mem, (size_t)st.st_size, MADV_SEQUENTIAL);
+    *data = mem;
+    *length = (int)st.st_size;
+    isSuccessful = true;
+
+done:
+    close(fd);
+    return isSuccessful;
+}
+
+void growingcrashfu_unmapFile(const char* data, int length)
+{
+    if(data != NULL && length > 0)
+    {
+        munmap((void*)data, (size_t)length);
+    }
+}
+
 bool growingcrashfu_writeStringToFD(const int fd, const char* const string)
 {
     if(*string != 0)
@@ -104,6 +104,29 @@ bool growingcrashfu_readBytesFromFD(const int fd, char* bytes, int length);
  */
 bool growingcrashfu_readEntireFile(const char* path, char** data, int* length, int maxLength);
 
+/** Map an entire file into memory, read only. Unlike growingcrashfu_readEntireFile(),
+ * the contents are paged in from the file as they are accessed rather than
+ * copied onto the heap, so large files can be read in a single pass cheaply.
+ * The mapping stays valid if the file is deleted, but not if it is truncated.
+ *
+ * @param path The path to the file.
+ *
+ * @param data Place to store a pointer to the mapped data (NOT null terminated).
+ *
+ * @param length Place to store the length of the mapped data.
+ *
+ * @return true if the operation was successful.
+ */
+bool growingcrashfu_mapFile(const char* path, const char** data, int* length);
+
+/** Unmap a file mapped with growingcrashfu_mapFile().
+ *
+ * @param data The mapped data.
+ *
+ * @param length The length of the mapped data.
+ */
+void growingcrashfu_unmapFile(const char* data, int length);
+
 /** Write a string to a file.
  *
  * @param fd The file descriptor.
@@ -0,0 +1,90 @@
+//
+//  GrowingCrashGrowableBuffer.c
+//  GrowingAnalytics
+//
+//  Created by YoloMao on 2022/9/19.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#include "GrowingCrashGrowableBuffer.h"
+
+//#define GrowingCrashLogger_LocalLevel TRACE
+#include "GrowingCrashLogger.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define likely_if(x) if(__builtin_expect(x,1))
+#define unlikely_if(x) if(__builtin_expect(x,0))
+
+/** The capacity of a buffer that grows before anything was reserved. */
+#define kInitialCapacity 65536
+
+
+/** Make room for some more bytes, plus one spare byte for a terminator.
+ */
+static bool ensureSpace(GrowingCrashGrowableBuffer* buffer, int length)
+{
+    likely_if(buffer->length + length < buffer->capacity)
+    {
+        return true;
+    }
+
+    int newCapacity = buffer->capacity > 0 ? buffer->capacity * 2 : kInitialCapacity;
+    while(buffer->length + length >= newCapacity)
+    {
+        newCapacity *= 2;
+    }
+    return growingcrashgb_reserve(buffer, newCapacity);
+}
+
+bool growingcrashgb_reserve(GrowingCrashGrowableBuffer* buffer, int capacity)
+{
+    if(capacity <= buffer->capacity)
+    {
+        return true;
+    }
+
+    char* newData = realloc(buffer->data, (unsigned)capacity);
+    unlikely_if(newData == NULL)
+    {
+        GrowingCrashLOG_ERROR("Could not allocate %d bytes", capacity);
+        return false;
+    }
+    buffer->data = newData;
+    buffer->capacity = capacity;
+    return true;
+}
+
+bool growingcrashgb_append(GrowingCrashGrowableBuffer* buffer, const char* data, int length)
+{
+    unlikely_if(!ensureSpace(buffer, length))
+    {
+        return false;
+    }
+    memcpy(buffer->data + buffer->length, data, (unsigned)length);
+    buffer->length += length;
+    return true;
+}
+
+bool growingcrashgb_terminate(GrowingCrashGrowableBuffer* buffer)
+{
+    unlikely_if(!ensureSpace(buffer, 0))
+    {
+        return false;
+    }
+    buffer->data[buffer->length] = '\0';
+    return true;
+}
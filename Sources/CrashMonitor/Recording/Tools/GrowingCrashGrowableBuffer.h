@@ -0,0 +1,87 @@
+//
+//  GrowingCrashGrowableBuffer.h
+//  GrowingAnalytics
+//
+//  Created by YoloMao on 2022/9/19.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+/* A heap buffer that grows as data is appended to it.
+ *
+ * Used to collect a report that is written out in pieces. Not async-safe.
+ */
+
+
+#ifndef HDR_GrowingCrashGrowableBuffer_h
+#define HDR_GrowingCrashGrowableBuffer_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdbool.h>
+
+typedef struct
+{
+    /** The buffer's contents, or NULL if nothing has been allocated yet.
+     * The caller owns this, and must free() it.
+     */
+    char* data;
+
+    /** The number of bytes appended so far. */
+    int length;
+
+    /** The number of bytes allocated. */
+    int capacity;
+} GrowingCrashGrowableBuffer;
+
+/** Make sure a buffer can hold at least a number of bytes without growing.
+ *
+ * @param buffer The buffer.
+ * @param capacity The number of bytes to allocate up front.
+ *
+ * @return false if the memory could not be allocated.
+ */
+bool growingcrashgb_reserve(GrowingCrashGrowableBuffer* buffer, int capacity);
+
+/** Append data to a buffer, growing it if needed.
+ *
+ * On failure, the buffer keeps everything appended before.
+ *
+ * @param buffer The buffer.
+ * @param data The data to append.
+ * @param length The length of the data.
+ *
+ * @return false if the buffer could not be grown.
+ */
+bool growingcrashgb_append(GrowingCrashGrowableBuffer* buffer, const char* data, int length);
+
+/** NUL terminate a buffer's contents, so that data can be used as a string.
+ * The terminator is not counted in length, so more data can still be
+ * appended afterwards.
+ *
+ * @param buffer The buffer.
+ *
+ * @return false if the buffer could not be grown.
+ */
+bool growingcrashgb_terminate(GrowingCrashGrowableBuffer* buffer);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HDR_GrowingCrashGrowableBuffer_h
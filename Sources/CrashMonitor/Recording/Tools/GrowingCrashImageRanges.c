@@ -0,0 +1,186 @@
+//
+//  GrowingCrashImageRanges.c
+//  GrowingAnalytics
+//
+//  Created by YoloMao on 2022/9/19.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#include "GrowingCrashImageRanges.h"
+
+#include <stdlib.h>
+
+
+// ============================================================================
+#pragma mark - Utility -
+// ============================================================================
+
+static uintptr_t firstCmdAfterHeader(const struct mach_header* const header)
+{
+    switch(header->magic)
+    {
+        case MH_MAGIC:
+        case MH_CIGAM:
+            return (uintptr_t)(header + 1);
+        case MH_MAGIC_64:
+        case MH_CIGAM_64:
+            return (uintptr_t)(((struct mach_header_64*)header) + 1);
+        default:
+            // Header is corrupt
+            return 0;
+    }
+}
+
+static int compareImageRanges(const void* a, const void* b)
+{
+    const GrowingCrashImageRange* rangeA = a;
+    const GrowingCrashImageRange* rangeB = b;
+    if(rangeA->start != rangeB->start)
+    {
+        return rangeA->start < rangeB->start ? -1 : 1;
+    }
+    return 0;
+}
+
+
+// ============================================================================
+#pragma mark - API -
+// ============================================================================
+
+int growingcrashir_getImageRanges(const struct mach_header* const header,
+                                  const uintptr_t slide,
+                                  const uint32_t imageIndex,
+                                  GrowingCrashImageRange* const ranges,
+                                  const int maxRanges)
+{
+    int count = 0;
+    uintptr_t cmdPtr = firstCmdAfterHeader(header);
+    if(cmdPtr == 0)
+    {
+        return 0;
+    }
+    for(uint32_t iCmd = 0; iCmd < header->ncmds; iCmd++)
+    {
+        const struct load_command* loadCmd = (struct load_command*)cmdPtr;
+        uintptr_t vmaddr = 0;
+        uintptr_t vmsize = 0;
+        if(loadCmd->cmd == LC_SEGMENT)
+        {
+            const struct segment_command* segCmd = (struct segment_command*)cmdPtr;
+            vmaddr = segCmd->vmaddr;
+            vmsize = segCmd->vmsize;
+        }
+        else if(loadCmd->cmd == LC_SEGMENT_64)
+        {
+            const struct segment_command_64* segCmd = (struct segment_command_64*)cmdPtr;
+            vmaddr = (uintptr_t)segCmd->vmaddr;
+            vmsize = (uintptr_t)segCmd->vmsize;
+        }
+        if(vmsize != 0)
+        {
+            if(count < maxRanges)
+            {
+                GrowingCrashImageRange* range = &ranges[count];
+                range->start = vmaddr + slide;
+                range->end = vmaddr + slide + vmsize;
+                range->maxEnd = range->end;
+                range->header = header;
+                range->slide = slide;
+                range->symbolTable = NULL;
+                range->imageIndexHint = imageIndex;
+            }
+            count++;
+        }
+        cmdPtr += loadCmd->cmdsize;
+    }
+    return count;
+}
+
+int growingcrashir_buildImageRanges(const GrowingCrashImageRange* const oldRanges,
+                                    const int oldCount,
+                                    const struct mach_header* const removedHeader,
+                                    GrowingCrashImageRange* const addedRanges,
+                                    const int addedCount,
+                                    GrowingCrashImageRange* const ranges)
+{
+    if(addedCount > 1)
+    {
+        qsort(addedRanges, (size_t)addedCount, sizeof(*addedRanges), compareImageRanges);
+    }
+
+    int count = 0;
+    int iOld = 0;
+    int iAdded = 0;
+    while(iOld < oldCount || iAdded < addedCount)
+    {
+        if(iOld < oldCount && oldRanges[iOld].header == removedHeader)
+        {
+            iOld++;
+            continue;
+        }
+        if(iAdded >= addedCount || (iOld < oldCount && oldRanges[iOld].start <= addedRanges[iAdded].start))
+        {
+            ranges[count] = oldRanges[iOld++];
+        }
+        else
+        {
+            ranges[count] = addedRanges[iAdded++];
+        }
+        ranges[count].maxEnd = ranges[count].end;
+        if(count > 0 && ranges[count - 1].maxEnd > ranges[count].maxEnd)
+        {
+            ranges[count].maxEnd = ranges[count - 1].maxEnd;
+        }
+        count++;
+    }
+    return count;
+}
+
+bool growingcrashir_findImageRange(const GrowingCrashImageRange* const ranges,
+                                   const int count,
+                                   const uintptr_t address,
+                                   const GrowingCrashImageRange** const found)
+{
+    *found = NULL;
+
+    // Find the last range starting at or before the address.
+    int low = 0;
+    int high = count;
+    while(low < high)
+    {
+        int mid = low + (high - low) / 2;
+        if(ranges[mid].start <= address)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    for(int i = low - 1; i >= 0 && ranges[i].maxEnd > address; i--)
+    {
+        if(address < ranges[i].end)
+        {
+            if(*found != NULL)
+            {
+                *found = NULL;
+                return false;
+            }
+            *found = &ranges[i];
+        }
+    }
+    return true;
+}
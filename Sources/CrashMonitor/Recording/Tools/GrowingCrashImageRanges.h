@@ -0,0 +1,127 @@
+//
+//  GrowingCrashImageRanges.h
+//  GrowingAnalytics
+//
+//  Created by YoloMao on 2022/9/19.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+/* Sorted address ranges of loaded images' segments.
+ *
+ * Finding the image containing an address means checking every segment of
+ * every loaded image. The ranges built here from each image's load commands
+ * are kept sorted by start address, so a lookup is a binary search.
+ *
+ * Nothing here talks to dyld. The caller supplies each image's header and
+ * slide, and keeps track of which images are loaded.
+ *
+ * Building ranges is not async-safe. Finding a range is.
+ */
+
+
+#ifndef HDR_GrowingCrashImageRanges_h
+#define HDR_GrowingCrashImageRanges_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "GrowingCrashSymbolTable.h"
+
+#include <mach-o/loader.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/** One segment of a loaded image, with the image's slide applied. */
+typedef struct
+{
+    uintptr_t start;
+    uintptr_t end;
+
+    /** The highest end of this and all earlier ranges in the list. */
+    uintptr_t maxEnd;
+
+    const struct mach_header* header;
+    uintptr_t slide;
+
+    /** The image's sorted symbol table, if it has been built. */
+    GrowingCrashSymbolTable* symbolTable;
+
+    /** The image's index when it was added. Indexes shift as images are
+     * removed, so this has to be checked before it is used.
+     */
+    uint32_t imageIndexHint;
+} GrowingCrashImageRange;
+
+/** Get the address ranges of an image's segments. Segments that take no
+ * address space are left out.
+ *
+ * @param header The image's header, followed by its load commands.
+ * @param slide The image's slide.
+ * @param imageIndex The image's current index.
+ * @param ranges Receives up to maxRanges ranges, in load command order. May be
+ *               NULL if maxRanges is 0.
+ * @param maxRanges The size of ranges.
+ *
+ * @return The number of ranges the image has, which may be more than maxRanges.
+ */
+int growingcrashir_getImageRanges(const struct mach_header* header,
+                                  uintptr_t slide,
+                                  uint32_t imageIndex,
+                                  GrowingCrashImageRange* ranges,
+                                  int maxRanges);
+
+/** Build a sorted list from an existing one, leaving out one image's ranges
+ * and adding new ones.
+ *
+ * @param oldRanges The existing ranges, sorted by start.
+ * @param oldCount The number of old ranges.
+ * @param removedHeader The image to leave out, or NULL.
+ * @param addedRanges Ranges to add. They are sorted in place.
+ * @param addedCount The number of ranges to add.
+ * @param ranges Receives the ranges. Must hold oldCount + addedCount ranges.
+ *
+ * @return The number of ranges in the new list.
+ */
+int growingcrashir_buildImageRanges(const GrowingCrashImageRange* oldRanges,
+                                    int oldCount,
+                                    const struct mach_header* removedHeader,
+                                    GrowingCrashImageRange* addedRanges,
+                                    int addedCount,
+                                    GrowingCrashImageRange* ranges);
+
+/** Find the range containing an address.
+ *
+ * @param ranges Ranges from growingcrashir_buildImageRanges().
+ * @param count The number of ranges.
+ * @param address The address to look for.
+ * @param found Receives the range containing the address, or NULL if no range
+ *              does or more than one does (the __LINKEDIT segments of the
+ *              dyld shared cache images all overlap, for example).
+ *
+ * @return false if the address is in more than one range.
+ */
+bool growingcrashir_findImageRange(const GrowingCrashImageRange* ranges,
+                                   int count,
+                                   uintptr_t address,
+                                   const GrowingCrashImageRange** found);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HDR_GrowingCrashImageRanges_h
@@ -49,6 +49,9 @@
 #include <string.h>
 #include <unistd.h>
 #include <limits.h>
+#include <locale.h>
+#include <math.h>
+#include <stdlib.h>
 
 
 // ============================================================================
@@ -73,6 +76,24 @@
     #define GrowingCrashJSONCODEC_WorkBufferSize 512
 #endif
 
+/** The longest floating point number (in characters) that the decoder accepts. */
+#ifndef GrowingCrashJSONCODEC_MaxNumberLength
+    #define GrowingCrashJSONCODEC_MaxNumberLength 100
+#endif
+
+/** Set to 0 to disable the vectorized scan for characters that need escaping. */
+#ifndef GrowingCrashJSONCODEC_UseSIMD
+    #define GrowingCrashJSONCODEC_UseSIMD 1
+#endif
+
+#if GrowingCrashJSONCODEC_UseSIMD && defined(__SSE2__)
+    #define GrowingCrashJSONCODEC_UseSSE2 1
+    #include <emmintrin.h>
+#elif GrowingCrashJSONCODEC_UseSIMD && defined(__ARM_NEON) && defined(__aarch64__)
+    #define GrowingCrashJSONCODEC_UseNEON 1
+    #include <arm_neon.h>
+#endif
+
 
 // ============================================================================
 #pragma mark - Helpers -
@@ -82,12 +103,27 @@
 #define likely_if(x) if(__builtin_expect(x,1))
 #define unlikely_if(x) if(__builtin_expect(x,0))
 
-/** Used for writing hex string values. */
-static char g_hexNybbles[] =
-{
-    '0', '1', '2', '3', '4', '5', '6', '7',
-    '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
-};
+/** If false, findEscapableChar() scans one byte at a time. */
+static bool g_useVectorizedEscapeScan = true;
+
+/** Every byte value as two hex digits, so that each byte takes one lookup. */
+static const char g_hexPairs[256 * 2 + 1] =
+    "000102030405060708090A0B0C0D0E0F"
+    "101112131415161718191A1B1C1D1E1F"
+    "202122232425262728292A2B2C2D2E2F"
+    "303132333435363738393A3B3C3D3E3F"
+    "404142434445464748494A4B4C4D4E4F"
+    "505152535455565758595A5B5C5D5E5F"
+    "606162636465666768696A6B6C6D6E6F"
+    "707172737475767778797A7B7C7D7E7F"
+    "808182838485868788898A8B8C8D8E8F"
+    "909192939495969798999A9B9C9D9E9F"
+    "A0A1A2A3A4A5A6A7A8A9AAABACADAEAF"
+    "B0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+    "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECF"
+    "D0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+    "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEF"
+    "F0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
 
 const char* growingcrashjson_stringForError(const int error)
 {
@@ -109,6 +145,413 @@ const char* growingcrashjson_stringForError(const int error)
 }
 
 
+// ============================================================================
+#pragma mark - Number Formatting -
+// ============================================================================
+
+/* Numbers are formatted by hand rather than with sprintf(), which is slow,
+ * depends on the current locale, and isn't async-signal-safe.
+ * Floating point uses Grisu2 (Florian Loitsch, "Printing Floating-Point
+ * Numbers Quickly and Accurately with Integers"), which always produces a
+ * string that reads back as the same double, and almost always the shortest.
+ */
+
+/** Big enough for any formatted int64, uint64 or double. */
+#define NUMBER_BUFFER_SIZE 32
+
+/** Pairs of decimal digits, for formatting two digits at a time. */
+static const char g_digitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/** Format an unsigned integer in decimal.
+ *
+ * @param value The value to format.
+ *
+ * @param buffer Where to write the digits (not null terminated).
+ *
+ * @return The number of characters written.
+ */
+static int formatUInt64(uint64_t value, char* const buffer)
+{
+    char digits[20];
+    char* ptr = digits + sizeof(digits);
+    while(value >= 100)
+    {
+        const char* pair = g_digitPairs + (value % 100) * 2;
+        value /= 100;
+        *--ptr = pair[1];
+        *--ptr = pair[0];
+    }
+    if(value >= 10)
+    {
+        const char* pair = g_digitPairs + value * 2;
+        *--ptr = pair[1];
+        *--ptr = pair[0];
+    }
+    else
+    {
+        *--ptr = (char)('0' + value);
+    }
+    int length = (int)(digits + sizeof(digits) - ptr);
+    memcpy(buffer, ptr, (size_t)length);
+    return length;
+}
+
+/** Format a signed integer in decimal.
+ *
+ * @param value The value to format.
+ *
+ * @param buffer Where to write the digits (not null terminated).
+ *
+ * @return The number of characters written.
+ */
+static int formatInt64(int64_t value, char* const buffer)
+{
+    if(value < 0)
+    {
+        buffer[0] = '-';
+        // Negate as unsigned so that INT64_MIN works.
+        return 1 + formatUInt64(0 - (uint64_t)value, buffer + 1);
+    }
+    return formatUInt64((uint64_t)value, buffer);
+}
+
+/** A floating point value with a 64-bit significand: f * 2^e */
+typedef struct
+{
+    uint64_t f;
+    int e;
+} DiyFp;
+
+#define DP_SIGNIFICAND_MASK 0x000FFFFFFFFFFFFFULL
+#define DP_EXPONENT_MASK    0x7FF0000000000000ULL
+#define DP_HIDDEN_BIT       0x0010000000000000ULL
+#define DP_EXPONENT_BIAS    (0x3FF + 52)
+
+/** Normalized powers of ten 10^-348, 10^-340, ..., 10^340. */
+static const uint64_t g_cachedPowersF[] =
+{
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL, 0xcf42894a5dce35eaULL,
+    0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL, 0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL,
+    0xbe5691ef416bd60cULL, 0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL, 0xc21094364dfb5637ULL,
+    0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL, 0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL,
+    0xb23867fb2a35b28eULL, 0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL, 0xb5b5ada8aaff80b8ULL,
+    0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL, 0x964e858c91ba2655ULL, 0xdff9772470297ebdULL,
+    0xa6dfbd9fb8e5b88fULL, 0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL, 0xaa242499697392d3ULL,
+    0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL, 0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL,
+    0x9c40000000000000ULL, 0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL, 0x9f4f2726179a2245ULL,
+    0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL, 0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL,
+    0x924d692ca61be758ULL, 0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL, 0x952ab45cfa97a0b3ULL,
+    0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL, 0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL,
+    0x88fcf317f22241e2ULL, 0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL, 0x8bab8eefb6409c1aULL,
+    0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL, 0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL,
+    0x80444b5e7aa7cf85ULL, 0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+};
+
+static const int16_t g_cachedPowersE[] =
+{
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034,
+    -1007, -980, -954, -927, -901, -874, -847, -821,
+    -794, -768, -741, -715, -688, -661, -635, -608,
+    -582, -555, -529, -502, -475, -449, -422, -396,
+    -369, -343, -316, -289, -263, -236, -210, -183,
+    -157, -130, -103, -77, -50, -24, 3, 30,
+    56, 83, 109, 136, 162, 189, 216, 242,
+    269, 295, 322, 348, 375, 402, 428, 455,
+    481, 508, 534, 561, 588, 614, 641, 667,
+    694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+static const uint64_t g_powersOfTen[] =
+{
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL,
+};
+
+static inline DiyFp diyFpMultiply(DiyFp lhs, DiyFp rhs)
+{
+    const uint64_t M32 = 0xFFFFFFFFULL;
+    const uint64_t a = lhs.f >> 32;
+    const uint64_t b = lhs.f & M32;
+    const uint64_t c = rhs.f >> 32;
+    const uint64_t d = rhs.f & M32;
+    const uint64_t ac = a * c;
+    const uint64_t bc = b * c;
+    const uint64_t ad = a * d;
+    const uint64_t bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+    tmp += 1ULL << 31; // Round
+    DiyFp result = {ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), lhs.e + rhs.e + 64};
+    return result;
+}
+
+static inline DiyFp diyFpNormalize(DiyFp value)
+{
+    int shift = __builtin_clzll(value.f);
+    DiyFp result = {value.f << shift, value.e - shift};
+    return result;
+}
+
+/** Get the boundaries m- and m+ between which any value reads back as v. */
+static void diyFpNormalizedBoundaries(DiyFp v, DiyFp* minus, DiyFp* plus)
+{
+    DiyFp pl = {(v.f << 1) + 1, v.e - 1};
+    while(!(pl.f & (DP_HIDDEN_BIT << 1)))
+    {
+        pl.f <<= 1;
+        pl.e--;
+    }
+    pl.f <<= 64 - 52 - 2;
+    pl.e -= 64 - 52 - 2;
+
+    DiyFp mi;
+    if(v.f == DP_HIDDEN_BIT)
+    {
+        mi.f = (v.f << 2) - 1;
+        mi.e = v.e - 2;
+    }
+    else
+    {
+        mi.f = (v.f << 1) - 1;
+        mi.e = v.e - 1;
+    }
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+
+    *plus = pl;
+    *minus = mi;
+}
+
+static DiyFp getCachedPower(int e, int* K)
+{
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int k = (int)dk;
+    if(dk - k > 0.0)
+    {
+        k++;
+    }
+    unsigned index = (unsigned)((k >> 3) + 1);
+    *K = -(-348 + (int)(index << 3));
+    DiyFp result = {g_cachedPowersF[index], g_cachedPowersE[index]};
+    return result;
+}
+
+static inline void grisuRound(char* buffer, int length, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t wpw)
+{
+    while(rest < wpw && delta - rest >= tenKappa &&
+          (rest + tenKappa < wpw || wpw - rest > rest + tenKappa - wpw))
+    {
+        buffer[length - 1]--;
+        rest += tenKappa;
+    }
+}
+
+static inline int countDecimalDigits32(uint32_t n)
+{
+    int count = 1;
+    while(n >= 10 && count < 9)
+    {
+        n /= 10;
+        count++;
+    }
+    return count;
+}
+
+static void grisuDigitGen(DiyFp W, DiyFp Mp, uint64_t delta, char* buffer, int* length, int* K)
+{
+    const DiyFp one = {1ULL << -Mp.e, Mp.e};
+    const uint64_t wpw = Mp.f - W.f;
+    uint32_t p1 = (uint32_t)(Mp.f >> -one.e);
+    uint64_t p2 = Mp.f & (one.f - 1);
+    int kappa = countDecimalDigits32(p1);
+    *length = 0;
+
+    while(kappa > 0)
+    {
+        uint32_t divisor = (uint32_t)g_powersOfTen[kappa - 1];
+        uint32_t d = p1 / divisor;
+        p1 %= divisor;
+        if(d || *length)
+        {
+            buffer[(*length)++] = (char)('0' + d);
+        }
+        kappa--;
+        uint64_t tmp = ((uint64_t)p1 << -one.e) + p2;
+        if(tmp <= delta)
+        {
+            *K += kappa;
+            grisuRound(buffer, *length, delta, tmp, g_powersOfTen[kappa] << -one.e, wpw);
+            return;
+        }
+    }
+
+    for(;;)
+    {
+        p2 *= 10;
+        delta *= 10;
+        char d = (char)(p2 >> -one.e);
+        if(d || *length)
+        {
+            buffer[(*length)++] = (char)('0' + d);
+        }
+        p2 &= one.f - 1;
+        kappa--;
+        if(p2 < delta)
+        {
+            *K += kappa;
+            int index = -kappa;
+            grisuRound(buffer, *length, delta, p2, one.f, wpw * (index < 20 ? g_powersOfTen[index] : 0));
+            return;
+        }
+    }
+}
+
+/** Generate the digits of a positive, finite, non-zero double.
+ * The value is digits * 10^K.
+ */
+static void grisu2(double value, char* digits, int* length, int* K)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int biasedExponent = (int)((bits & DP_EXPONENT_MASK) >> 52);
+    uint64_t significand = bits & DP_SIGNIFICAND_MASK;
+    DiyFp v;
+    if(biasedExponent != 0)
+    {
+        v.f = significand + DP_HIDDEN_BIT;
+        v.e = biasedExponent - DP_EXPONENT_BIAS;
+    }
+    else
+    {
+        v.f = significand;
+        v.e = 1 - DP_EXPONENT_BIAS;
+    }
+
+    DiyFp wMinus;
+    DiyFp wPlus;
+    diyFpNormalizedBoundaries(v, &wMinus, &wPlus);
+
+    const DiyFp cachedPower = getCachedPower(wPlus.e, K);
+    const DiyFp W = diyFpMultiply(diyFpNormalize(v), cachedPower);
+    DiyFp Wp = diyFpMultiply(wPlus, cachedPower);
+    DiyFp Wm = diyFpMultiply(wMinus, cachedPower);
+    Wm.f++;
+    Wp.f--;
+    grisuDigitGen(W, Wp, Wp.f - Wm.f, digits, length, K);
+}
+
+/** Format a double using the fewest digits that read back as the same value.
+ * Small and moderate magnitudes are written in positional notation
+ * (12.5, 0.001, 300), everything else in exponent notation (1.5e+300).
+ * Whole numbers get no decimal point, as with "%g".
+ *
+ * @param value The value to format.
+ *
+ * @param buffer Where to write the number (not null terminated).
+ *               Must hold at least NUMBER_BUFFER_SIZE characters.
+ *
+ * @return The number of characters written.
+ */
+static int formatDouble(double value, char* const buffer)
+{
+    char* ptr = buffer;
+    unlikely_if(value != value)
+    {
+        memcpy(ptr, "nan", 3);
+        return 3;
+    }
+    if(signbit(value))
+    {
+        *ptr++ = '-';
+        value = -value;
+    }
+    unlikely_if(isinf(value))
+    {
+        memcpy(ptr, "inf", 3);
+        return (int)(ptr - buffer) + 3;
+    }
+    if(value == 0)
+    {
+        *ptr++ = '0';
+        return (int)(ptr - buffer);
+    }
+
+    char digits[20];
+    int length = 0;
+    int K = 0;
+    grisu2(value, digits, &length, &K);
+
+    // The value lies in [10^(decimalExponent-1), 10^decimalExponent)
+    const int decimalExponent = length + K;
+    if(K >= 0 && decimalExponent <= 17)
+    {
+        // 1234e3 -> 1234000
+        memcpy(ptr, digits, (size_t)length);
+        ptr += length;
+        for(int i = 0; i < K; i++)
+        {
+            *ptr++ = '0';
+        }
+    }
+    else if(decimalExponent > 0 && decimalExponent <= 17)
+    {
+        // 1234e-2 -> 12.34
+        memcpy(ptr, digits, (size_t)decimalExponent);
+        ptr += decimalExponent;
+        *ptr++ = '.';
+        memcpy(ptr, digits + decimalExponent, (size_t)(length - decimalExponent));
+        ptr += length - decimalExponent;
+    }
+    else if(decimalExponent > -5 && decimalExponent <= 0)
+    {
+        // 1234e-6 -> 0.001234
+        *ptr++ = '0';
+        *ptr++ = '.';
+        for(int i = decimalExponent; i < 0; i++)
+        {
+            *ptr++ = '0';
+        }
+        memcpy(ptr, digits, (size_t)length);
+        ptr += length;
+    }
+    else
+    {
+        // 1234e30 -> 1.234e+33
+        *ptr++ = digits[0];
+        if(length > 1)
+        {
+            *ptr++ = '.';
+            memcpy(ptr, digits + 1, (size_t)(length - 1));
+            ptr += length - 1;
+        }
+        int exponent = decimalExponent - 1;
+        *ptr++ = 'e';
+        *ptr++ = exponent < 0 ? '-' : '+';
+        ptr += formatUInt64((uint64_t)(exponent < 0 ? -exponent : exponent), ptr);
+    }
+    return (int)(ptr - buffer);
+}
+
+
 // ============================================================================
 #pragma mark - Encode -
 // ============================================================================
@@ -127,7 +570,70 @@ const char* growingcrashjson_stringForError(const int error)
 #define addJSONData(CONTEXT,DATA,LENGTH) \
     (CONTEXT)->addJSONData(DATA, LENGTH, (CONTEXT)->userData)
 
-/** Escape a string portion for use with JSON and send to data handler.
+/** Check if a character must be escaped inside a JSON string.
+ *
+ * @param ch The character to test.
+ *
+ * @return true if the character needs escaping.
+ */
+static inline bool isEscapableChar(unsigned char ch)
+{
+    return ch == '\\' || ch == '\"' || ch < ' ';
+}
+
+/** Find the next character that needs escaping.
+ * Scans 16 bytes at a time with SSE2 or NEON where available, falling back
+ * to a byte-by-byte scan for the tail and on other architectures.
+ *
+ * @param src The start of the data to scan.
+ *
+ * @param srcEnd The end of the data to scan.
+ *
+ * @return A pointer to the first escapable character, or srcEnd if none.
+ */
+static inline const char* findEscapableChar(const char* src, const char* const srcEnd)
+{
+#if defined(GrowingCrashJSONCODEC_UseSSE2)
+    const __m128i quote = _mm_set1_epi8('\"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(' ' - 1);
+    for(; g_useVectorizedEscapeScan && srcEnd - src >= 16; src += 16)
+    {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(const void*)src);
+        __m128i isQuote = _mm_cmpeq_epi8(chunk, quote);
+        __m128i isBackslash = _mm_cmpeq_epi8(chunk, backslash);
+        // Unsigned (chunk <= 0x1f) is the same as (min(chunk, 0x1f) == chunk)
+        __m128i isControl = _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk);
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(isQuote, isBackslash), isControl));
+        unlikely_if(mask != 0)
+        {
+            return src + __builtin_ctz((unsigned)mask);
+        }
+    }
+#elif defined(GrowingCrashJSONCODEC_UseNEON)
+    const uint8x16_t quote = vdupq_n_u8('\"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    const uint8x16_t space = vdupq_n_u8(' ');
+    for(; g_useVectorizedEscapeScan && srcEnd - src >= 16; src += 16)
+    {
+        uint8x16_t chunk = vld1q_u8((const uint8_t*)src);
+        uint8x16_t matches = vorrq_u8(vorrq_u8(vceqq_u8(chunk, quote),
+                                               vceqq_u8(chunk, backslash)),
+                                      vcltq_u8(chunk, space));
+        unlikely_if(vmaxvq_u8(matches) != 0)
+        {
+            break;
+        }
+    }
+#endif
+    for(; src < srcEnd && !isEscapableChar((unsigned char)*src); src++)
+    {
+    }
+    return src;
+}
+
+/** Escape a run of special characters for use with JSON and send to data handler.
+ * Stops at the first character that doesn't need escaping.
  *
  * @param context The JSON context.
  *
@@ -135,29 +641,23 @@ const char* growingcrashjson_stringForError(const int error)
  *
  * @param length The length of the string.
  *
+ * @param consumed Receives the number of source characters that were escaped.
+ *
  * @return GrowingCrashJSON_OK if the data was handled successfully.
  */
-static int appendEscapedString(GrowingCrashJSONEncodeContext* const context,
-                               const char* restrict const string,
-                               int length)
+static int appendEscapedChars(GrowingCrashJSONEncodeContext* const context,
+                              const char* restrict const string,
+                              int length,
+                              int* consumed)
 {
     char workBuffer[GrowingCrashJSONCODEC_WorkBufferSize];
     const char* const srcEnd = string + length;
+    const char* const dstEnd = workBuffer + sizeof(workBuffer) - 2;
 
     const char* restrict src = string;
     char* restrict dst = workBuffer;
 
-    // Simple case (no escape or special characters)
-    for(; src < srcEnd &&
-        *src != '\\' &&
-        *src != '\"' &&
-        (unsigned char)*src >= ' '; src++)
-    {
-        *dst++ = *src;
-    }
-
-    // Deal with complicated case (if any)
-    for(; src < srcEnd; src++)
+    for(; src < srcEnd && dst < dstEnd && isEscapableChar((unsigned char)*src); src++)
     {
         switch(*src)
         {
@@ -187,21 +687,18 @@ static int appendEscapedString(GrowingCrashJSONEncodeContext* const context,
                 *dst++ = 't';
                 break;
             default:
-                unlikely_if((unsigned char)*src < ' ')
-            {
                 GrowingCrashLOG_DEBUG("Invalid character 0x%02x in string: %s",
                             *src, string);
                 return GrowingCrashJSON_ERROR_INVALID_CHARACTER;
-            }
-                *dst++ = *src;
         }
     }
-    int encLength = (int)(dst - workBuffer);
-    dst -= encLength;
-    return addJSONData(context, dst, encLength);
+    *consumed = (int)(src - string);
+    return addJSONData(context, workBuffer, (int)(dst - workBuffer));
 }
 
 /** Escape a string for use with JSON and send to data handler.
+ * Runs of characters that need no escaping are passed straight through to the
+ * data handler without being copied.
  *
  * @param context The JSON context.
  *
@@ -216,22 +713,32 @@ static int addEscapedString(GrowingCrashJSONEncodeContext* const context,
                             int length)
 {
     int result = GrowingCrashJSON_OK;
+    const char* src = string;
+    const char* const srcEnd = string + length;
 
-    // Keep adding portions until the whole string has been processed.
-    int offset = 0;
-    while(offset < length)
+    while(src < srcEnd)
     {
-        int toAdd = length - offset;
-        unlikely_if(toAdd > GrowingCrashJSONCODEC_WorkBufferSize / 2)
+        const char* cleanEnd = findEscapableChar(src, srcEnd);
+        likely_if(cleanEnd > src)
+        {
+            result = addJSONData(context, src, (int)(cleanEnd - src));
+            unlikely_if(result != GrowingCrashJSON_OK)
+            {
+                break;
+            }
+            src = cleanEnd;
+        }
+        likely_if(src >= srcEnd)
         {
-            toAdd = GrowingCrashJSONCODEC_WorkBufferSize / 2;
+            break;
         }
-        result = appendEscapedString(context, string + offset, toAdd);
+        int consumed = 0;
+        result = appendEscapedChars(context, src, (int)(srcEnd - src), &consumed);
         unlikely_if(result != GrowingCrashJSON_OK)
         {
             break;
         }
-        offset += toAdd;
+        src += consumed;
     }
     return result;
 }
@@ -263,6 +770,11 @@ static int addQuotedEscapedString(GrowingCrashJSONEncodeContext* const context,
     return result || closeResult;
 }
 
+void growingcrashjson_setUseVectorizedEscapeScan(bool useVectorizedEscapeScan)
+{
+    g_useVectorizedEscapeScan = useVectorizedEscapeScan;
+}
+
 int growingcrashjson_beginElement(GrowingCrashJSONEncodeContext* const context, const char* const name)
 {
     int result = GrowingCrashJSON_OK;
@@ -361,9 +873,8 @@ int growingcrashjson_addFloatingPointElement(GrowingCrashJSONEncodeContext* cons
     {
         return result;
     }
-    char buff[30];
-    sprintf(buff, "%lg", value);
-    return addJSONData(context, buff, (int)strlen(buff));
+    char buff[NUMBER_BUFFER_SIZE];
+    return addJSONData(context, buff, formatDouble(value, buff));
 }
 
 int growingcrashjson_addIntegerElement(GrowingCrashJSONEncodeContext* const context,
@@ -375,9 +886,8 @@ int growingcrashjson_addIntegerElement(GrowingCrashJSONEncodeContext* const cont
     {
         return result;
     }
-    char buff[30];
-    sprintf(buff, "%" PRId64, value);
-    return addJSONData(context, buff, (int)strlen(buff));
+    char buff[NUMBER_BUFFER_SIZE];
+    return addJSONData(context, buff, formatInt64(value, buff));
 }
 
 int growingcrashjson_addUIntegerElement(GrowingCrashJSONEncodeContext* const context,
@@ -389,9 +899,8 @@ int growingcrashjson_addUIntegerElement(GrowingCrashJSONEncodeContext* const con
     {
         return result;
     }
-    char buff[30];
-    sprintf(buff, "%" PRIu64, value);
-    return addJSONData(context, buff, (int)strlen(buff));
+    char buff[NUMBER_BUFFER_SIZE];
+    return addJSONData(context, buff, formatUInt64(value, buff));
 }
 
 int growingcrashjson_addNullElement(GrowingCrashJSONEncodeContext* const context,
@@ -473,24 +982,33 @@ int growingcrashjson_beginDataElement(GrowingCrashJSONEncodeContext* const conte
     return growingcrashjson_beginStringElement(context, name);
 }
 
+void growingcrashjson_encodeHex(const void* const data, const int length, char* const dst)
+{
+    const unsigned char* src = data;
+    char* out = dst;
+    for(int i = 0; i < length; i++)
+    {
+        memcpy(out, g_hexPairs + src[i] * 2, 2);
+        out += 2;
+    }
+}
+
 int growingcrashjson_appendDataElement(GrowingCrashJSONEncodeContext* const context,
                              const char* const value,
                              int length)
 {
-    unsigned char* currentByte = (unsigned char*)value;
-    unsigned char* end = currentByte + length;
-    char chars[2];
+    char chars[512];
+    const int bytesPerChunk = sizeof(chars) / 2;
     int result = GrowingCrashJSON_OK;
-    while(currentByte < end)
+    for(int offset = 0; offset < length; offset += bytesPerChunk)
     {
-        chars[0] = g_hexNybbles[(*currentByte>>4)&15];
-        chars[1] = g_hexNybbles[*currentByte&15];
-        result = addJSONData(context, chars, sizeof(chars));
+        int chunkLength = length - offset < bytesPerChunk ? length - offset : bytesPerChunk;
+        growingcrashjson_encodeHex(value + offset, chunkLength, chars);
+        result = addJSONData(context, chars, chunkLength * 2);
         if(result != GrowingCrashJSON_OK)
         {
             break;
         }
-        currentByte++;
     }
     return result;
 }
@@ -616,6 +1134,11 @@ typedef struct
     int stringBufferLength;
     /** The callbacks to call while decoding. */
     GrowingCrashJSONDecodeCallbacks* const callbacks;
+    /** The string view callbacks to call while decoding.
+     * If not NULL, these are used instead of callbacks, and no names or
+     * strings get copied into the name and string buffers.
+     */
+    GrowingCrashJSONDecodeStringViewCallbacks* const viewCallbacks;
     /** Data that was specified when calling growingcrashjson_decode(). */
     void* userData;
 } GrowingCrashJSONDecodeContext;
@@ -656,6 +1179,16 @@ static const unsigned int g_hexConversion[] =
  */
 static int writeUTF8(unsigned int character, char** dst);
 
+/** Find the bounds of a string value without decoding it.
+ *
+ * @param context The decoding context.
+ *
+ * @param view Receives the location of the string's contents.
+ *
+ * @return GrowingCrashJSON_OK if successful.
+ */
+static int scanString(GrowingCrashJSONDecodeContext* context, GrowingCrashJSONStringView* view);
+
 /** Decode a string value.
  *
  * @param context The decoding context.
@@ -671,12 +1204,13 @@ static int decodeString(GrowingCrashJSONDecodeContext* context, char* dstBuffer,
 /** Decode a JSON element.
  *
  * @param name This element's name (or NULL if it has none).
+ *             When decoding without string views, name->ptr is null terminated.
  *
  * @param context The decoding context.
  *
  * @return GrowingCrashJSON_OK if successful.
  */
-static int decodeElement(const char* const name,
+static int decodeElement(const GrowingCrashJSONStringView* const name,
                                 GrowingCrashJSONDecodeContext* context);
 
 
@@ -691,6 +1225,18 @@ while(CONTEXT->bufferPtr < CONTEXT->bufferEnd && isspace(*CONTEXT->bufferPtr)) \
 }
 
 
+/** Check if a character is a decimal digit.
+ * Unlike isdigit(), this doesn't depend on the current locale.
+ *
+ * @param ch The character to test.
+ *
+ * @return true if the character is a digit.
+ */
+static inline bool isDigit(char ch)
+{
+    return (unsigned char)(ch - '0') <= 9;
+}
+
 /** Check if a character is valid for representing part of a floating point
  * number.
  *
@@ -711,6 +1257,160 @@ static inline bool isFPChar(char ch)
     }
 }
 
+/** The largest mantissa that a double can represent exactly (2^53). */
+#define MAX_EXACT_MANTISSA (1ULL << 53)
+
+/** Powers of ten that a double can represent exactly. */
+static const double g_exactPowersOfTen[] =
+{
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+    1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+    1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+#define MAX_EXACT_POWER_OF_TEN ((int)(sizeof(g_exactPowersOfTen) / sizeof(*g_exactPowersOfTen)) - 1)
+
+/** Convert a floating point number using the C library.
+ * The number is copied so that it can be null terminated, and its decimal
+ * point is adjusted to match the current locale, which strtod() expects.
+ *
+ * @param start The first character of the number.
+ *
+ * @param length The length of the number.
+ *
+ * @param value Receives the converted value.
+ *
+ * @return GrowingCrashJSON_OK if successful.
+ */
+static int convertFloatingPointSlow(const char* const start, const int length, double* const value)
+{
+    char numberBuffer[GrowingCrashJSONCODEC_MaxNumberLength];
+    if(length >= (int)sizeof(numberBuffer))
+    {
+        GrowingCrashLOG_DEBUG("Number is too long.");
+        return GrowingCrashJSON_ERROR_DATA_TOO_LONG;
+    }
+    memcpy(numberBuffer, start, (size_t)length);
+    numberBuffer[length] = '\0';
+
+    const char* decimalPoint = localeconv()->decimal_point;
+    unlikely_if(decimalPoint[0] != '.' && decimalPoint[0] != '\0' && decimalPoint[1] == '\0')
+    {
+        char* ptr = strchr(numberBuffer, '.');
+        if(ptr != NULL)
+        {
+            *ptr = decimalPoint[0];
+        }
+    }
+
+    *value = strtod(numberBuffer, NULL);
+    return GrowingCrashJSON_OK;
+}
+
+/** Decode an unsigned floating point number.
+ *
+ * Numbers whose significant digits fit in a double's mantissa and whose
+ * exponent is a small power of ten are converted exactly with a single
+ * multiply or divide (Clinger's fast path). This covers nearly every number
+ * found in a crash report. Anything else goes through strtod().
+ *
+ * @param context The decoding context. bufferPtr must point to the first digit.
+ *
+ * @param value Receives the decoded value.
+ *
+ * @return GrowingCrashJSON_OK if successful.
+ */
+static int decodeFloatingPoint(GrowingCrashJSONDecodeContext* context, double* value)
+{
+    const char* const start = context->bufferPtr;
+    const char* const end = context->bufferEnd;
+    const char* ptr = start;
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    bool isExact = true;
+
+    for(; ptr < end && isDigit(*ptr); ptr++)
+    {
+        uint64_t next = mantissa * 10 + (uint64_t)(*ptr - '0');
+        unlikely_if(next > MAX_EXACT_MANTISSA)
+        {
+            isExact = false;
+        }
+        mantissa = next;
+    }
+
+    if(ptr < end && *ptr == '.')
+    {
+        ptr++;
+        unlikely_if(ptr >= end || !isDigit(*ptr))
+        {
+            GrowingCrashLOG_DEBUG("Expected a digit after '.'");
+            return ptr >= end ? GrowingCrashJSON_ERROR_INCOMPLETE : GrowingCrashJSON_ERROR_INVALID_CHARACTER;
+        }
+        for(; ptr < end && isDigit(*ptr); ptr++)
+        {
+            likely_if(isExact)
+            {
+                uint64_t next = mantissa * 10 + (uint64_t)(*ptr - '0');
+                unlikely_if(next > MAX_EXACT_MANTISSA)
+                {
+                    isExact = false;
+                }
+                mantissa = next;
+                exponent--;
+            }
+        }
+    }
+
+    if(ptr < end && (*ptr == 'e' || *ptr == 'E'))
+    {
+        ptr++;
+        int exponentSign = 1;
+        if(ptr < end && (*ptr == '+' || *ptr == '-'))
+        {
+            exponentSign = *ptr == '-' ? -1 : 1;
+            ptr++;
+        }
+        unlikely_if(ptr >= end || !isDigit(*ptr))
+        {
+            GrowingCrashLOG_DEBUG("Expected a digit in exponent");
+            return ptr >= end ? GrowingCrashJSON_ERROR_INCOMPLETE : GrowingCrashJSON_ERROR_INVALID_CHARACTER;
+        }
+        int exponentValue = 0;
+        for(; ptr < end && isDigit(*ptr); ptr++)
+        {
+            likely_if(exponentValue < 100000)
+            {
+                exponentValue = exponentValue * 10 + (*ptr - '0');
+            }
+        }
+        exponent += exponentSign * exponentValue;
+    }
+
+    unlikely_if(ptr >= end)
+    {
+        GrowingCrashLOG_DEBUG("Premature end of data");
+        return GrowingCrashJSON_ERROR_INCOMPLETE;
+    }
+    context->bufferPtr = ptr;
+
+    likely_if(isExact && exponent >= -MAX_EXACT_POWER_OF_TEN && exponent <= MAX_EXACT_POWER_OF_TEN)
+    {
+        double result = (double)mantissa;
+        if(exponent < 0)
+        {
+            result /= g_exactPowersOfTen[-exponent];
+        }
+        else
+        {
+            result *= g_exactPowersOfTen[exponent];
+        }
+        *value = result;
+        return GrowingCrashJSON_OK;
+    }
+
+    return convertFloatingPointSlow(start, (int)(ptr - start), value);
+}
+
 static int writeUTF8(unsigned int character, char** dst)
 {
     likely_if(character <= 0x7f)
@@ -750,9 +1450,8 @@ static int writeUTF8(unsigned int character, char** dst)
     return GrowingCrashJSON_ERROR_INVALID_CHARACTER;
 }
 
-static int decodeString(GrowingCrashJSONDecodeContext* context, char* dstBuffer, int dstBufferLength)
+static int scanString(GrowingCrashJSONDecodeContext* context, GrowingCrashJSONStringView* view)
 {
-    *dstBuffer = '\0';
     unlikely_if(*context->bufferPtr != '\"')
     {
         GrowingCrashLOG_DEBUG("Expected '\"' but got '%c'", *context->bufferPtr);
@@ -760,13 +1459,13 @@ static int decodeString(GrowingCrashJSONDecodeContext* context, char* dstBuffer,
     }
 
     const char* src = context->bufferPtr + 1;
-    bool fastCopy = true;
+    bool needsUnescape = false;
 
     for(; src < context->bufferEnd && *src != '\"'; src++)
     {
         unlikely_if(*src == '\\')
         {
-            fastCopy = false;
+            needsUnescape = true;
             src++;
         }
     }
@@ -775,26 +1474,40 @@ static int decodeString(GrowingCrashJSONDecodeContext* context, char* dstBuffer,
         GrowingCrashLOG_DEBUG("Premature end of data");
         return GrowingCrashJSON_ERROR_INCOMPLETE;
     }
-    const char* srcEnd = src;
-    src = context->bufferPtr + 1;
-    int length = (int)(srcEnd - src);
-    if(length >= dstBufferLength)
+
+    view->ptr = context->bufferPtr + 1;
+    view->length = (int)(src - view->ptr);
+    view->needsUnescape = needsUnescape;
+    context->bufferPtr = src + 1;
+    return GrowingCrashJSON_OK;
+}
+
+int growingcrashjson_unescapeString(const GrowingCrashJSONStringView* const view,
+                                    char* const buffer,
+                                    const int bufferLength,
+                                    int* const length)
+{
+    unlikely_if(view->length >= bufferLength)
     {
         GrowingCrashLOG_DEBUG("String is too long");
         return GrowingCrashJSON_ERROR_DATA_TOO_LONG;
     }
 
-    context->bufferPtr = srcEnd + 1;
-
     // If no escape characters were encountered, we can fast copy.
-    likely_if(fastCopy)
+    likely_if(!view->needsUnescape)
     {
-        memcpy(dstBuffer, src, length);
-        dstBuffer[length] = 0;
+        memcpy(buffer, view->ptr, (size_t)view->length);
+        buffer[view->length] = 0;
+        if(length != NULL)
+        {
+            *length = view->length;
+        }
         return GrowingCrashJSON_OK;
     }
 
-    char* dst = dstBuffer;
+    const char* src = view->ptr;
+    const char* const srcEnd = src + view->length;
+    char* dst = buffer;
 
     for(; src < srcEnd; src++)
     {
@@ -886,8 +1599,8 @@ static int decodeString(GrowingCrashJSONDecodeContext* context, char* dstBuffer,
                                         accum2);
                             return GrowingCrashJSON_ERROR_INVALID_CHARACTER;
                         }
-                        // And combine 20 bit result.
-                        accum = ((accum - 0xd800) << 10) | (accum2 - 0xdc00);
+                        // And combine 20 bit result, above the basic plane.
+                        accum = 0x10000 + (((accum - 0xd800) << 10) | (accum2 - 0xdc00));
                     }
 
                     int result = writeUTF8(accum, &dst);
@@ -906,10 +1619,34 @@ static int decodeString(GrowingCrashJSONDecodeContext* context, char* dstBuffer,
     }
 
     *dst = 0;
+    if(length != NULL)
+    {
+        *length = (int)(dst - buffer);
+    }
     return GrowingCrashJSON_OK;
 }
 
-static int decodeElement(const char* const name, GrowingCrashJSONDecodeContext* context)
+static int decodeString(GrowingCrashJSONDecodeContext* context, char* dstBuffer, int dstBufferLength)
+{
+    *dstBuffer = '\0';
+    GrowingCrashJSONStringView view;
+    int result = scanString(context, &view);
+    unlikely_if(result != GrowingCrashJSON_OK)
+    {
+        return result;
+    }
+    return growingcrashjson_unescapeString(&view, dstBuffer, dstBufferLength, NULL);
+}
+
+/** Get the null terminated form of a name passed to decodeElement().
+ * Only valid when not decoding with string views.
+ */
+static inline const char* cName(const GrowingCrashJSONStringView* const name)
+{
+    return name == NULL ? NULL : name->ptr;
+}
+
+static int decodeElement(const GrowingCrashJSONStringView* const name, GrowingCrashJSONDecodeContext* context)
 {
     SKIP_WHITESPACE(context);
     unlikely_if(context->bufferPtr >= context->bufferEnd)
@@ -926,7 +1663,9 @@ static int decodeElement(const char* const name, GrowingCrashJSONDecodeContext*
         case '[':
         {
             context->bufferPtr++;
-            result = context->callbacks->onBeginArray(name, context->userData);
+            result = context->viewCallbacks != NULL
+                ? context->viewCallbacks->onBeginArray(name, context->userData)
+                : context->callbacks->onBeginArray(cName(name), context->userData);
             unlikely_if(result != GrowingCrashJSON_OK) return result;
             while(context->bufferPtr < context->bufferEnd)
             {
@@ -938,7 +1677,9 @@ static int decodeElement(const char* const name, GrowingCrashJSONDecodeContext*
                 unlikely_if(*context->bufferPtr == ']')
                 {
                     context->bufferPtr++;
-                    return context->callbacks->onEndContainer(context->userData);
+                    return context->viewCallbacks != NULL
+                        ? context->viewCallbacks->onEndContainer(context->userData)
+                        : context->callbacks->onEndContainer(context->userData);
                 }
                 result = decodeElement(NULL, context);
                 unlikely_if(result != GrowingCrashJSON_OK) return result;
@@ -958,7 +1699,9 @@ static int decodeElement(const char* const name, GrowingCrashJSONDecodeContext*
         case '{':
         {
             context->bufferPtr++;
-            result = context->callbacks->onBeginObject(name, context->userData);
+            result = context->viewCallbacks != NULL
+                ? context->viewCallbacks->onBeginObject(name, context->userData)
+                : context->callbacks->onBeginObject(cName(name), context->userData);
             unlikely_if(result != GrowingCrashJSON_OK) return result;
             while(context->bufferPtr < context->bufferEnd)
             {
@@ -970,9 +1713,22 @@ static int decodeElement(const char* const name, GrowingCrashJSONDecodeContext*
                 unlikely_if(*context->bufferPtr == '}')
                 {
                     context->bufferPtr++;
-                    return context->callbacks->onEndContainer(context->userData);
+                    return context->viewCallbacks != NULL
+                        ? context->viewCallbacks->onEndContainer(context->userData)
+                        : context->callbacks->onEndContainer(context->userData);
+                }
+                GrowingCrashJSONStringView elementName;
+                if(context->viewCallbacks != NULL)
+                {
+                    result = scanString(context, &elementName);
+                }
+                else
+                {
+                    result = decodeString(context, context->nameBuffer, context->nameBufferLength);
+                    elementName.ptr = context->nameBuffer;
+                    elementName.length = 0;
+                    elementName.needsUnescape = false;
                 }
-                result = decodeString(context, context->nameBuffer, context->nameBufferLength);
                 unlikely_if(result != GrowingCrashJSON_OK) return result;
                 SKIP_WHITESPACE(context);
                 unlikely_if(context->bufferPtr >= context->bufferEnd)
@@ -986,7 +1742,7 @@ static int decodeElement(const char* const name, GrowingCrashJSONDecodeContext*
                 }
                 context->bufferPtr++;
                 SKIP_WHITESPACE(context);
-                result = decodeElement(context->nameBuffer, context);
+                result = decodeElement(&elementName, context);
                 unlikely_if(result != GrowingCrashJSON_OK) return result;
                 SKIP_WHITESPACE(context);
                 unlikely_if(context->bufferPtr >= context->bufferEnd)
@@ -1003,9 +1759,16 @@ static int decodeElement(const char* const name, GrowingCrashJSONDecodeContext*
         }
         case '\"':
         {
+            if(context->viewCallbacks != NULL)
+            {
+                GrowingCrashJSONStringView value;
+                result = scanString(context, &value);
+                unlikely_if(result != GrowingCrashJSON_OK) return result;
+                return context->viewCallbacks->onStringElement(name, &value, context->userData);
+            }
             result = decodeString(context, context->stringBuffer, context->stringBufferLength);
             unlikely_if(result != GrowingCrashJSON_OK) return result;
-            result = context->callbacks->onStringElement(name,
+            result = context->callbacks->onStringElement(cName(name),
                                                 context->stringBuffer,
                                                 context->userData);
             return result;
@@ -1027,7 +1790,9 @@ static int decodeElement(const char* const name, GrowingCrashJSONDecodeContext*
                 return GrowingCrashJSON_ERROR_INVALID_CHARACTER;
             }
             context->bufferPtr += 5;
-            return context->callbacks->onBooleanElement(name, false, context->userData);
+            return context->viewCallbacks != NULL
+                ? context->viewCallbacks->onBooleanElement(name, false, context->userData)
+                : context->callbacks->onBooleanElement(cName(name), false, context->userData);
         }
         case 't':
         {
@@ -1045,7 +1810,9 @@ static int decodeElement(const char* const name, GrowingCrashJSONDecodeContext*
                 return GrowingCrashJSON_ERROR_INVALID_CHARACTER;
             }
             context->bufferPtr += 4;
-            return context->callbacks->onBooleanElement(name, true, context->userData);
+            return context->viewCallbacks != NULL
+                ? context->viewCallbacks->onBooleanElement(name, true, context->userData)
+                : context->callbacks->onBooleanElement(cName(name), true, context->userData);
         }
         case 'n':
         {
@@ -1063,12 +1830,19 @@ static int decodeElement(const char* const name, GrowingCrashJSONDecodeContext*
                 return GrowingCrashJSON_ERROR_INVALID_CHARACTER;
             }
             context->bufferPtr += 4;
-            return context->callbacks->onNullElement(name, context->userData);
+            return context->viewCallbacks != NULL
+                ? context->viewCallbacks->onNullElement(name, context->userData)
+                : context->callbacks->onNullElement(cName(name), context->userData);
         }
         case '-':
             sign = -1;
             context->bufferPtr++;
-            unlikely_if(!isdigit(*context->bufferPtr))
+            unlikely_if(context->bufferPtr >= context->bufferEnd)
+            {
+                GrowingCrashLOG_DEBUG("Premature end of data");
+                return GrowingCrashJSON_ERROR_INCOMPLETE;
+            }
+            unlikely_if(!isDigit(*context->bufferPtr))
         {
             GrowingCrashLOG_DEBUG("Not a digit: '%c'", *context->bufferPtr);
             return GrowingCrashJSON_ERROR_INVALID_CHARACTER;
@@ -1082,7 +1856,7 @@ static int decodeElement(const char* const name, GrowingCrashJSONDecodeContext*
             bool isOverflow = false;
             const char* const start = context->bufferPtr;
 
-            for(; context->bufferPtr < context->bufferEnd && isdigit(*context->bufferPtr); context->bufferPtr++)
+            for(; context->bufferPtr < context->bufferEnd && isDigit(*context->bufferPtr); context->bufferPtr++)
             {
                 unlikely_if((isOverflow = accum > (ULLONG_MAX / 10)))
                 {
@@ -1105,42 +1879,36 @@ static int decodeElement(const char* const name, GrowingCrashJSONDecodeContext*
 
             if(!isFPChar(*context->bufferPtr) && !isOverflow)
             {
+                if(sign > 0 && accum > (uint64_t)LLONG_MAX)
+                {
+                    if(context->viewCallbacks != NULL)
+                    {
+                        return context->viewCallbacks->onUIntegerElement(name, accum, context->userData);
+                    }
+                    if(context->callbacks->onUIntegerElement != NULL)
+                    {
+                        return context->callbacks->onUIntegerElement(cName(name), accum, context->userData);
+                    }
+                }
                 if(sign > 0 || accum <= ((uint64_t)LLONG_MAX + 1))
                 {
-                    int64_t signedAccum = (int64_t)accum;
-                    signedAccum *= sign;
-                    return context->callbacks->onIntegerElement(name, signedAccum, context->userData);
+                    // Negate in unsigned arithmetic, so that INT64_MIN doesn't overflow.
+                    int64_t signedAccum = (int64_t)(sign > 0 ? accum : 0 - accum);
+                    return context->viewCallbacks != NULL
+                        ? context->viewCallbacks->onIntegerElement(name, signedAccum, context->userData)
+                        : context->callbacks->onIntegerElement(cName(name), signedAccum, context->userData);
                 }
             }
 
-            while(context->bufferPtr < context->bufferEnd && isFPChar(*context->bufferPtr))
-            {
-                context->bufferPtr++;
-            }
-
-            unlikely_if(context->bufferPtr >= context->bufferEnd)
-            {
-                GrowingCrashLOG_DEBUG("Premature end of data");
-                return GrowingCrashJSON_ERROR_INCOMPLETE;
-            }
-
-            // our buffer is not necessarily NULL-terminated, so
-            // it would be undefined to call sscanf/sttod etc. directly.
-            // instead we create a temporary string.
+            context->bufferPtr = start;
             double value;
-            int len = (int)(context->bufferPtr - start);
-            if(len >= context->stringBufferLength)
-            {
-                GrowingCrashLOG_DEBUG("Number is too long.");
-                return GrowingCrashJSON_ERROR_DATA_TOO_LONG;
-            }
-            strncpy(context->stringBuffer, start, len);
-            context->stringBuffer[len] = '\0';
-
-            sscanf(context->stringBuffer, "%lg", &value);
+            result = decodeFloatingPoint(context, &value);
+            unlikely_if(result != GrowingCrashJSON_OK) return result;
 
             value *= sign;
-            return context->callbacks->onFloatingPointElement(name, value, context->userData);
+            return context->viewCallbacks != NULL
+                ? context->viewCallbacks->onFloatingPointElement(name, value, context->userData)
+                : context->callbacks->onFloatingPointElement(cName(name), value, context->userData);
         }
     }
     GrowingCrashLOG_DEBUG("Invalid character '%c'", *context->bufferPtr);
@@ -1168,6 +1936,7 @@ int growingcrashjson_decode(const char* const data,
         .stringBuffer = stringBuffer,
         .stringBufferLength = (int)stringBufferLength,
         .callbacks = callbacks,
+        .viewCallbacks = NULL,
         .userData = userData
     };
 
@@ -1186,6 +1955,38 @@ int growingcrashjson_decode(const char* const data,
     return result;
 }
 
+int growingcrashjson_decodeStringViews(const char* const data,
+                                       int length,
+                                       GrowingCrashJSONDecodeStringViewCallbacks* const callbacks,
+                                       void* const userData,
+                                       int* const errorOffset)
+{
+    GrowingCrashJSONDecodeContext context =
+    {
+        .bufferPtr = data,
+        .bufferEnd = data + length,
+        .nameBuffer = NULL,
+        .nameBufferLength = 0,
+        .stringBuffer = NULL,
+        .stringBufferLength = 0,
+        .callbacks = NULL,
+        .viewCallbacks = callbacks,
+        .userData = userData
+    };
+
+    int result = decodeElement(NULL, &context);
+    likely_if(result == GrowingCrashJSON_OK)
+    {
+        result = callbacks->onEndData(userData);
+    }
+
+    unlikely_if(result != GrowingCrashJSON_OK && errorOffset != NULL)
+    {
+        *errorOffset = (int)(context.bufferPtr - data);
+    }
+    return result;
+}
+
 struct JSONFromFileContext;
 typedef void (*UpdateDecoderCallback)(struct JSONFromFileContext* context);
 
@@ -1263,6 +2064,16 @@ static int addJSONFromFile_onIntegerElement(const char* const name,
     return result;
 }
 
+static int addJSONFromFile_onUIntegerElement(const char* const name,
+                                             const uint64_t value,
+                                             void* const userData)
+{
+    JSONFromFileContext* context = (JSONFromFileContext*)userData;
+    int result = growingcrashjson_addUIntegerElement(context->encodeContext, name, value);
+    context->updateDecoderCallback(context);
+    return result;
+}
+
 static int addJSONFromFile_onNullElement(const char* const name,
                                          void* const userData)
 {
@@ -1331,6 +2142,7 @@ int growingcrashjson_addJSONFromFile(GrowingCrashJSONEncodeContext* const encode
         .onEndData = addJSONFromFile_onEndData,
         .onFloatingPointElement = addJSONFromFile_onFloatingPointElement,
         .onIntegerElement = addJSONFromFile_onIntegerElement,
+        .onUIntegerElement = addJSONFromFile_onUIntegerElement,
         .onNullElement = addJSONFromFile_onNullElement,
         .onStringElement = addJSONFromFile_onStringElement,
     };
@@ -1346,6 +2158,7 @@ int growingcrashjson_addJSONFromFile(GrowingCrashJSONEncodeContext* const encode
         .stringBuffer = stringBuffer,
         .stringBufferLength = sizeof(stringBuffer),
         .callbacks = &callbacks,
+        .viewCallbacks = NULL,
         .userData = NULL,
     };
 
@@ -1368,7 +2181,8 @@ int growingcrashjson_addJSONFromFile(GrowingCrashJSONEncodeContext* const encode
     decodeContext.bufferPtr = decodeContext.bufferEnd;
     jsonContext.updateDecoderCallback(&jsonContext);
 
-    int result = decodeElement(name, &decodeContext);
+    GrowingCrashJSONStringView nameView = {name, 0, false};
+    int result = decodeElement(name == NULL ? NULL : &nameView, &decodeContext);
     close(fd);
     while(closeLastContainer && encodeContext->containerLevel > containerLevel)
     {
@@ -1393,6 +2207,7 @@ int growingcrashjson_addJSONElement(GrowingCrashJSONEncodeContext* const encodeC
         .onEndData = addJSONFromFile_onEndData,
         .onFloatingPointElement = addJSONFromFile_onFloatingPointElement,
         .onIntegerElement = addJSONFromFile_onIntegerElement,
+        .onUIntegerElement = addJSONFromFile_onUIntegerElement,
         .onNullElement = addJSONFromFile_onNullElement,
         .onStringElement = addJSONFromFile_onStringElement,
     };
@@ -1407,6 +2222,7 @@ int growingcrashjson_addJSONElement(GrowingCrashJSONEncodeContext* const encodeC
         .stringBuffer = stringBuffer,
         .stringBufferLength = sizeof(stringBuffer),
         .callbacks = &callbacks,
+        .viewCallbacks = NULL,
         .userData = NULL,
     };
     
@@ -1424,7 +2240,8 @@ int growingcrashjson_addJSONElement(GrowingCrashJSONEncodeContext* const encodeC
     decodeContext.userData = &jsonContext;
     int containerLevel = encodeContext->containerLevel;
     
-    int result = decodeElement(name, &decodeContext);
+    GrowingCrashJSONStringView nameView = {name, 0, false};
+    int result = decodeElement(name == NULL ? NULL : &nameView, &decodeContext);
     while(closeLastContainer && encodeContext->containerLevel > containerLevel)
     {
         growingcrashjson_endContainer(encodeContext);
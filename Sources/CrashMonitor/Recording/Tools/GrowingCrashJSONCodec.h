@@ -328,6 +328,17 @@ int growingcrashjson_appendDataElement(GrowingCrashJSONEncodeContext* const cont
  */
 int growingcrashjson_endDataElement(GrowingCrashJSONEncodeContext* const context);
 
+/** Hex encode data the way data elements are encoded: two uppercase hex
+ * digits per byte. Async-safe.
+ *
+ * @param data The data to encode.
+ *
+ * @param length The length of the data.
+ *
+ * @param dst Receives length * 2 characters. No NUL terminator is added.
+ */
+void growingcrashjson_encodeHex(const void* data, int length, char* dst);
+
 /** Add a pre-formatted JSON element.
  *
  * @param encodeContext The encoding context.
@@ -419,6 +430,14 @@ int growingcrashjson_addJSONFromFile(GrowingCrashJSONEncodeContext* const contex
                            const char* restrict const filename,
                            const bool closeLastContainer);
 
+/** Enable or disable the vectorized scan for characters that need escaping.
+ * It is enabled by default where SSE2 or NEON is available. Disabling it
+ * makes strings be scanned one byte at a time, which gives the same output.
+ *
+ * @param useVectorizedEscapeScan If true, scan 16 bytes at a time.
+ */
+void growingcrashjson_setUseVectorizedEscapeScan(bool useVectorizedEscapeScan);
+
 
 // ============================================================================
 // Decode
@@ -473,6 +492,21 @@ typedef struct GrowingCrashJSONDecodeCallbacks
                             int64_t value,
                             void* userData);
 
+    /** Called when an integer element too big for an int64 is decoded.
+     * Optional: if NULL, the value is passed to onIntegerElement as an int64.
+     *
+     * @param name The element's name.
+     *
+     * @param value The element's value.
+     *
+     * @param userData Data that was specified when calling growingcrashjson_decode().
+     *
+     * @return GrowingCrashJSON_OK if decoding should continue.
+     */
+    int (*onUIntegerElement)(const char* name,
+                             uint64_t value,
+                             void* userData);
+
     /** Called when a null element is decoded.
      *
      * @param name The element's name.
@@ -569,6 +603,127 @@ int growingcrashjson_decode(const char* data,
                   int* errorOffset);
 
 
+// ============================================================================
+// Decode (string views)
+// ============================================================================
+
+/**
+ * A reference to a string token inside the data being decoded.
+ * The string is NOT null terminated.
+ */
+typedef struct
+{
+    /** Start of the token's contents (excluding quotes). */
+    const char* ptr;
+
+    /** Length of the token's contents in bytes. */
+    int length;
+
+    /** If true, the token contains escape sequences, and must be run through
+     * growingcrashjson_unescapeString() to get the actual string value.
+     * If false, ptr points to the exact string value.
+     */
+    bool needsUnescape;
+
+} GrowingCrashJSONStringView;
+
+/**
+ * Callbacks called during a string view decode process.
+ * All function pointers must point to valid functions.
+ *
+ * Names and string values are passed as views directly into the source data,
+ * so nothing gets copied. Name is NULL for elements that have no name.
+ * Views are valid for as long as the source data is.
+ */
+typedef struct GrowingCrashJSONDecodeStringViewCallbacks
+{
+    /** Called when a boolean element is decoded. */
+    int (*onBooleanElement)(const GrowingCrashJSONStringView* name,
+                            bool value,
+                            void* userData);
+
+    /** Called when a floating point element is decoded. */
+    int (*onFloatingPointElement)(const GrowingCrashJSONStringView* name,
+                                  double value,
+                                  void* userData);
+
+    /** Called when an integer element is decoded. */
+    int (*onIntegerElement)(const GrowingCrashJSONStringView* name,
+                            int64_t value,
+                            void* userData);
+
+    /** Called when a positive integer element too large for int64_t is decoded. */
+    int (*onUIntegerElement)(const GrowingCrashJSONStringView* name,
+                             uint64_t value,
+                             void* userData);
+
+    /** Called when a null element is decoded. */
+    int (*onNullElement)(const GrowingCrashJSONStringView* name,
+                         void* userData);
+
+    /** Called when a string element is decoded. */
+    int (*onStringElement)(const GrowingCrashJSONStringView* name,
+                           const GrowingCrashJSONStringView* value,
+                           void* userData);
+
+    /** Called when a new object is encountered. */
+    int (*onBeginObject)(const GrowingCrashJSONStringView* name,
+                         void* userData);
+
+    /** Called when a new array is encountered. */
+    int (*onBeginArray)(const GrowingCrashJSONStringView* name,
+                        void* userData);
+
+    /** Called when leaving the current container and returning to the next
+     * higher level container.
+     */
+    int (*onEndContainer)(void* userData);
+
+    /** Called when the end of the input data is reached. */
+    int (*onEndData)(void* userData);
+
+} GrowingCrashJSONDecodeStringViewCallbacks;
+
+/** Decode JSON data, passing names and strings to the callbacks as views into
+ * the source data instead of copying them.
+ *
+ * @param data UTF-8 encoded JSON data.
+ *
+ * @param length Length of the data.
+ *
+ * @param callbacks The callbacks to call while decoding.
+ *
+ * @param userData Any data you would like passed to the callbacks.
+ *
+ * @oaram errorOffset If not null, will contain the offset into the data
+ *                    where the error (if any) occurred.
+ *
+ * @return GrowingCrashJSON_OK if succesful. An error code otherwise.
+ */
+int growingcrashjson_decodeStringViews(const char* data,
+                                       int length,
+                                       GrowingCrashJSONDecodeStringViewCallbacks* callbacks,
+                                       void* userData,
+                                       int* errorOffset);
+
+/** Copy a string view into a null terminated buffer, processing any escape
+ * sequences.
+ *
+ * @param view The string view to copy.
+ *
+ * @param buffer The buffer to copy into.
+ *
+ * @param bufferLength The length of the buffer. Must be greater than view->length.
+ *
+ * @param length If not null, will contain the length of the resulting string.
+ *
+ * @return GrowingCrashJSON_OK if succesful. An error code otherwise.
+ */
+int growingcrashjson_unescapeString(const GrowingCrashJSONStringView* view,
+                                    char* buffer,
+                                    int bufferLength,
+                                    int* length);
+
 #ifdef __cplusplus
 }
 #endif
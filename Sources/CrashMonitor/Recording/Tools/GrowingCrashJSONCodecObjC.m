@@ -51,7 +51,10 @@
 #pragma mark Properties
 
 /** Callbacks from the C library */
-@property(nonatomic,readwrite,assign) GrowingCrashJSONDecodeCallbacks* callbacks;
+@property(nonatomic,readwrite,assign) GrowingCrashJSONDecodeStringViewCallbacks* callbacks;
+
+/** Scratch space for unescaping strings */
+@property(nonatomic,readwrite,retain) NSMutableData* unescapeBuffer;
 
 /** Stack of arrays/objects as the decoded content is built */
 @property(nonatomic,readwrite,retain) NSMutableArray* containerStack;
@@ -120,6 +123,7 @@
 @synthesize currentContainer = _currentContainer;
 @synthesize containerStack = _containerStack;
 @synthesize callbacks = _callbacks;
+@synthesize unescapeBuffer = _unescapeBuffer;
 @synthesize serializedData = _serializedData;
 @synthesize error = _error;
 @synthesize prettyPrint = _prettyPrint;
@@ -149,6 +153,7 @@
         self.callbacks->onEndData = onEndData;
         self.callbacks->onFloatingPointElement = onFloatingPointElement;
         self.callbacks->onIntegerElement = onIntegerElement;
+        self.callbacks->onUIntegerElement = onUIntegerElement;
         self.callbacks->onNullElement = onNullElement;
         self.callbacks->onStringElement = onStringElement;
         self.prettyPrint = (encodeOptions & GrowingCrashJSONEncodeOptionPretty) != 0;
@@ -166,13 +171,32 @@
 
 #pragma mark Utility
 
-static inline NSString* stringFromCString(const char* const string)
+static inline NSString* stringFromStringView(GrowingCrashJSONCodec* codec, const GrowingCrashJSONStringView* const view)
 {
-    if(string == NULL)
+    if(view == NULL)
     {
         return nil;
     }
-    return [NSString stringWithCString:string encoding:NSUTF8StringEncoding];
+    if(!view->needsUnescape)
+    {
+        return [[NSString alloc] initWithBytes:view->ptr
+                                        length:(NSUInteger)view->length
+                                      encoding:NSUTF8StringEncoding];
+    }
+
+    NSMutableData* buffer = codec->_unescapeBuffer;
+    if(buffer.length <= (NSUInteger)view->length)
+    {
+        buffer.length = (NSUInteger)view->length + 1;
+    }
+    int length = 0;
+    if(growingcrashjson_unescapeString(view, buffer.mutableBytes, (int)buffer.length, &length) != GrowingCrashJSON_OK)
+    {
+        return nil;
+    }
+    return [[NSString alloc] initWithBytes:buffer.mutableBytes
+                                    length:(NSUInteger)length
+                                  encoding:NSUTF8StringEncoding];
 }
 
 #pragma mark Callbacks
@@ -219,36 +243,46 @@ static int onBeginContainer(GrowingCrashJSONCodec* codec, NSString* name, id con
     return GrowingCrashJSON_OK;
 }
 
-static int onBooleanElement(const char* const cName, const bool value, void* const userData)
+static int onBooleanElement(const GrowingCrashJSONStringView* const cName, const bool value, void* const userData)
 {
-    NSString* name = stringFromCString(cName);
-    id element = [NSNumber numberWithBool:value];
     GrowingCrashJSONCodec* codec = (__bridge GrowingCrashJSONCodec*)userData;
+    NSString* name = stringFromStringView(codec, cName);
+    id element = [NSNumber numberWithBool:value];
     return onElement(codec, name, element);
 }
 
-static int onFloatingPointElement(const char* const cName, const double value, void* const userData)
+static int onFloatingPointElement(const GrowingCrashJSONStringView* const cName, const double value, void* const userData)
 {
-    NSString* name = stringFromCString(cName);
-    id element = [NSNumber numberWithDouble:value];
     GrowingCrashJSONCodec* codec = (__bridge GrowingCrashJSONCodec*)userData;
+    NSString* name = stringFromStringView(codec, cName);
+    id element = [NSNumber numberWithDouble:value];
     return onElement(codec, name, element);
 }
 
-static int onIntegerElement(const char* const cName,
+static int onIntegerElement(const GrowingCrashJSONStringView* const cName,
                                        const int64_t value,
                                        void* const userData)
 {
-    NSString* name = stringFromCString(cName);
+    GrowingCrashJSONCodec* codec = (__bridge GrowingCrashJSONCodec*)userData;
+    NSString* name = stringFromStringView(codec, cName);
     id element = [NSNumber numberWithLongLong:value];
+    return onElement(codec, name, element);
+}
+
+static int onUIntegerElement(const GrowingCrashJSONStringView* const cName,
+                             const uint64_t value,
+                             void* const userData)
+{
     GrowingCrashJSONCodec* codec = (__bridge GrowingCrashJSONCodec*)userData;
+    NSString* name = stringFromStringView(codec, cName);
+    id element = [NSNumber numberWithUnsignedLongLong:value];
     return onElement(codec, name, element);
 }
 
-static int onNullElement(const char* const cName, void* const userData)
+static int onNullElement(const GrowingCrashJSONStringView* const cName, void* const userData)
 {
-    NSString* name = stringFromCString(cName);
     GrowingCrashJSONCodec* codec = (__bridge GrowingCrashJSONCodec*)userData;
+    NSString* name = stringFromStringView(codec, cName);
 
     if((codec->_ignoreNullsInArrays &&
         [codec->_currentContainer isKindOfClass:[NSArray class]]) ||
@@ -261,28 +295,29 @@ static int onNullElement(const char* const cName, void* const userData)
     return onElement(codec, name, [NSNull null]);
 }
 
-static int onStringElement(const char* const cName, const char* const value, void* const userData)
+static int onStringElement(const GrowingCrashJSONStringView* const cName,
+                           const GrowingCrashJSONStringView* const value,
+                           void* const userData)
 {
-    NSString* name = stringFromCString(cName);
-    id element = [NSString stringWithCString:value
-                                    encoding:NSUTF8StringEncoding];
     GrowingCrashJSONCodec* codec = (__bridge GrowingCrashJSONCodec*)userData;
+    NSString* name = stringFromStringView(codec, cName);
+    id element = stringFromStringView(codec, value);
     return onElement(codec, name, element);
 }
 
-static int onBeginObject(const char* const cName, void* const userData)
+static int onBeginObject(const GrowingCrashJSONStringView* const cName, void* const userData)
 {
-    NSString* name = stringFromCString(cName);
-    id container = [NSMutableDictionary dictionary];
     GrowingCrashJSONCodec* codec = (__bridge GrowingCrashJSONCodec*)userData;
+    NSString* name = stringFromStringView(codec, cName);
+    id container = [NSMutableDictionary dictionary];
     return onBeginContainer(codec, name, container);
 }
 
-static int onBeginArray(const char* const cName, void* const userData)
+static int onBeginArray(const GrowingCrashJSONStringView* const cName, void* const userData)
 {
-    NSString* name = stringFromCString(cName);
-    id container = [NSMutableArray array];
     GrowingCrashJSONCodec* codec = (__bridge GrowingCrashJSONCodec*)userData;
+    NSString* name = stringFromStringView(codec, cName);
+    id container = [NSMutableArray array];
     return onBeginContainer(codec, name, container);
 }
 
@@ -449,14 +484,12 @@ static int encodeObject(GrowingCrashJSONCodec* codec, id object, NSString* name,
 {
     GrowingCrashJSONCodec* codec = [self codecWithEncodeOptions:0
                                         decodeOptions:decodeOptions];
-    NSMutableData* stringData = [NSMutableData dataWithLength:10001];
+    codec.unescapeBuffer = [NSMutableData dataWithLength:10001];
     int errorOffset;
-    int result = growingcrashjson_decode(JSONData.bytes,
-                               (int)JSONData.length,
-                               stringData.mutableBytes,
-                               (int)stringData.length,
-                               codec.callbacks,
-                               (__bridge void*)codec, &errorOffset);
+    int result = growingcrashjson_decodeStringViews(JSONData.bytes,
+                                          (int)JSONData.length,
+                                          codec.callbacks,
+                                          (__bridge void*)codec, &errorOffset);
     if(result != GrowingCrashJSON_OK && codec.error == nil)
     {
         codec.error = [NSError growingCrash_errorWithDomain:@"GrowingCrashJSONCodecObjC"
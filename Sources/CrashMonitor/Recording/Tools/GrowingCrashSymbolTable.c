@@ -0,0 +1,260 @@
+//
+//  GrowingCrashSymbolTable.c
+//  GrowingAnalytics
+//
+//  Created by YoloMao on 2022/9/19.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+#include "GrowingCrashSymbolTable.h"
+#include "GrowingCrashPlatformSpecificDefines.h"
+
+//#define GrowingCrashLogger_LocalLevel TRACE
+#include "GrowingCrashLogger.h"
+
+#include <mach-o/nlist.h>
+#include <mach-o/stab.h>
+#include <stdlib.h>
+
+#define likely_if(x) if(__builtin_expect(x,1))
+#define unlikely_if(x) if(__builtin_expect(x,0))
+
+/** The name offset of a symbol in a stripped image. */
+#define kNoName UINT32_MAX
+
+
+// ============================================================================
+#pragma mark - Types -
+// ============================================================================
+
+typedef struct
+{
+    /** The symbol's address, relative to the table's base address. */
+    uint32_t addressOffset;
+
+    /** The symbol's offset into the string table, or kNoName. */
+    uint32_t nameOffset;
+} SymbolEntry;
+
+struct GrowingCrashSymbolTable
+{
+    /** The lowest symbol address. */
+    uintptr_t baseAddress;
+
+    const char* stringTable;
+    int count;
+    SymbolEntry entries[];
+};
+
+
+// ============================================================================
+#pragma mark - Utility -
+// ============================================================================
+
+static uintptr_t firstCmdAfterHeader(const struct mach_header* const header)
+{
+    switch(header->magic)
+    {
+        case MH_MAGIC:
+        case MH_CIGAM:
+            return (uintptr_t)(header + 1);
+        case MH_MAGIC_64:
+        case MH_CIGAM_64:
+            return (uintptr_t)(((struct mach_header_64*)header) + 1);
+        default:
+            // Header is corrupt
+            return 0;
+    }
+}
+
+/** Get the image's symbol table command. Images with more than one are
+ * rejected, since a scan stops at the first one containing a match.
+ */
+static const struct symtab_command* getSymtabCommand(const struct mach_header* const header)
+{
+    const struct symtab_command* result = NULL;
+    uintptr_t cmdPtr = firstCmdAfterHeader(header);
+    if(cmdPtr == 0)
+    {
+        return NULL;
+    }
+    for(uint32_t iCmd = 0; iCmd < header->ncmds; iCmd++)
+    {
+        const struct load_command* loadCmd = (struct load_command*)cmdPtr;
+        if(loadCmd->cmd == LC_SYMTAB)
+        {
+            if(result != NULL)
+            {
+                return NULL;
+            }
+            result = (struct symtab_command*)cmdPtr;
+        }
+        cmdPtr += loadCmd->cmdsize;
+    }
+    return result;
+}
+
+static bool isIndexedSymbol(const nlist_t* const symbol)
+{
+    // Skip all debug N_STAB symbols. If n_value is 0, the symbol refers to
+    // an external object.
+    return (symbol->n_type & N_STAB) == 0 && symbol->n_value != 0;
+}
+
+static int compareKeys(const void* a, const void* b)
+{
+    uint64_t keyA = *(const uint64_t*)a;
+    uint64_t keyB = *(const uint64_t*)b;
+    return keyA < keyB ? -1 : keyA > keyB;
+}
+
+
+// ============================================================================
+#pragma mark - API -
+// ============================================================================
+
+GrowingCrashSymbolTable* growingcrashst_create(const struct mach_header* header, uintptr_t linkeditBase)
+{
+    const struct symtab_command* symtabCmd = getSymtabCommand(header);
+    if(symtabCmd == NULL)
+    {
+        return NULL;
+    }
+    const nlist_t* symbolTable = (nlist_t*)(linkeditBase + symtabCmd->symoff);
+
+    uintptr_t lowest = UINTPTR_MAX;
+    uintptr_t highest = 0;
+    uint32_t symbolCount = 0;
+    for(uint32_t iSym = 0; iSym < symtabCmd->nsyms; iSym++)
+    {
+        if(isIndexedSymbol(&symbolTable[iSym]))
+        {
+            uintptr_t value = (uintptr_t)symbolTable[iSym].n_value;
+            lowest = value < lowest ? value : lowest;
+            highest = value > highest ? value : highest;
+            symbolCount++;
+        }
+    }
+    if(symbolCount == 0 || symbolCount > INT32_MAX || highest - lowest > UINT32_MAX)
+    {
+        return NULL;
+    }
+
+    // Sort by address, then by position in the symbol table. Of several
+    // symbols at the same address, a scan picks the last one.
+    uint64_t* keys = malloc(sizeof(*keys) * symbolCount);
+    if(keys == NULL)
+    {
+        return NULL;
+    }
+    uint32_t keyCount = 0;
+    for(uint32_t iSym = 0; iSym < symtabCmd->nsyms; iSym++)
+    {
+        if(isIndexedSymbol(&symbolTable[iSym]))
+        {
+            uint64_t addressOffset = (uint64_t)((uintptr_t)symbolTable[iSym].n_value - lowest);
+            keys[keyCount++] = (addressOffset << 32) | iSym;
+        }
+    }
+    qsort(keys, keyCount, sizeof(*keys), compareKeys);
+
+    int count = 0;
+    for(uint32_t iKey = 0; iKey < keyCount; iKey++)
+    {
+        if(iKey + 1 == keyCount || (keys[iKey] >> 32) != (keys[iKey + 1] >> 32))
+        {
+            count++;
+        }
+    }
+    GrowingCrashSymbolTable* table = malloc(sizeof(*table) + sizeof(SymbolEntry) * (size_t)count);
+    if(table == NULL)
+    {
+        free(keys);
+        return NULL;
+    }
+    table->baseAddress = lowest;
+    table->stringTable = (const char*)(linkeditBase + symtabCmd->stroff);
+    table->count = 0;
+    for(uint32_t iKey = 0; iKey < keyCount; iKey++)
+    {
+        if(iKey + 1 == keyCount || (keys[iKey] >> 32) != (keys[iKey + 1] >> 32))
+        {
+            const nlist_t* symbol = &symbolTable[(uint32_t)keys[iKey]];
+            SymbolEntry* entry = &table->entries[table->count++];
+            entry->addressOffset = (uint32_t)(keys[iKey] >> 32);
+            // A stripped image's name is meaningless, and almost certainly
+            // resolves to "_mh_execute_header".
+            entry->nameOffset = symbol->n_desc == 16 ? kNoName : symbol->n_un.n_strx;
+        }
+    }
+    free(keys);
+
+    GrowingCrashLOG_TRACE("Built a symbol table of %d addresses from %u symbols", table->count, symtabCmd->nsyms);
+    return table;
+}
+
+void growingcrashst_destroy(GrowingCrashSymbolTable* table)
+{
+    free(table);
+}
+
+int growingcrashst_count(const GrowingCrashSymbolTable* table)
+{
+    return table->count;
+}
+
+bool growingcrashst_lookup(const GrowingCrashSymbolTable* table,
+                           uintptr_t address,
+                           uintptr_t* symbolAddress,
+                           const char** symbolName)
+{
+    unlikely_if(address < table->baseAddress)
+    {
+        return false;
+    }
+    uintptr_t addressOffset = address - table->baseAddress;
+
+    // Find the first entry after the address.
+    int low = 0;
+    int high = table->count;
+    while(low < high)
+    {
+        int mid = low + (high - low) / 2;
+        if(table->entries[mid].addressOffset <= addressOffset)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    // The first entry is at the base address, so low is at least 1 here.
+    const SymbolEntry* entry = &table->entries[low - 1];
+    *symbolAddress = table->baseAddress + entry->addressOffset;
+    if(entry->nameOffset == kNoName)
+    {
+        *symbolName = NULL;
+    }
+    else
+    {
+        *symbolName = table->stringTable + entry->nameOffset;
+        if(**symbolName == '_')
+        {
+            (*symbolName)++;
+        }
+    }
+    return true;
+}
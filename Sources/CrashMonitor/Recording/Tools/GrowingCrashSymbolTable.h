@@ -0,0 +1,92 @@
+//
+//  GrowingCrashSymbolTable.h
+//  GrowingAnalytics
+//
+//  Created by YoloMao on 2022/9/19.
+//  Copyright (C) 2022 Beijing Yishu Technology Co., Ltd.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+
+
+/* Sorted copies of an image's symbol table.
+ *
+ * Finding the symbol nearest to an address means checking every entry of
+ * the image's LC_SYMTAB. A table built here ahead of time holds the same
+ * answers as a sorted array of symbol addresses and name offsets, so a
+ * lookup is a binary search.
+ *
+ * Building a table is not async-safe. Looking up a symbol is.
+ */
+
+
+#ifndef HDR_GrowingCrashSymbolTable_h
+#define HDR_GrowingCrashSymbolTable_h
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <mach-o/loader.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct GrowingCrashSymbolTable GrowingCrashSymbolTable;
+
+/** Build a sorted table from an image's symbol table.
+ *
+ * The table refers to the image's string table rather than copying it, so it
+ * is only valid for as long as the image is.
+ *
+ * @param header The image's header. For a Mach-O file read into memory, this
+ *               is the start of the file.
+ * @param linkeditBase The address that the LC_SYMTAB file offsets are relative
+ *                     to: the slid __LINKEDIT vmaddr minus its fileoff for a
+ *                     loaded image, or the start of a Mach-O file in memory.
+ *
+ * @return The table, or NULL if the image has no usable symbol table.
+ */
+GrowingCrashSymbolTable* growingcrashst_create(const struct mach_header* header, uintptr_t linkeditBase);
+
+/** Free a table.
+ *
+ * @param table The table to free. May be NULL.
+ */
+void growingcrashst_destroy(GrowingCrashSymbolTable* table);
+
+/** Get the number of distinct symbol addresses in a table.
+ */
+int growingcrashst_count(const GrowingCrashSymbolTable* table);
+
+/** Find the symbol nearest to an address, exactly as a scan of the image's
+ * symbol table would.
+ *
+ * @param table The table to search.
+ * @param address The address to look up, without the image's slide.
+ * @param symbolAddress Receives the symbol's address, without the slide.
+ * @param symbolName Receives the symbol's name without its leading underscore,
+ *                   or NULL if the image has been stripped.
+ *
+ * @return false if there is no symbol at or before the address.
+ */
+bool growingcrashst_lookup(const GrowingCrashSymbolTable* table,
+                           uintptr_t address,
+                           uintptr_t* symbolAddress,
+                           const char** symbolName);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HDR_GrowingCrashSymbolTable_h
@@ -68,6 +68,7 @@
 #include <stdlib.h>
 #include <execinfo.h>
 #include <dlfcn.h>
+#include <pthread.h>
 #include <string.h>
 #include <sys/mman.h>
 #include <sys/types.h>
@@ -75,6 +76,7 @@
 #include <mach-o/dyld.h>
 #include <mach-o/nlist.h>
 
+#include "GrowingCrashAddressMap.h"
 #include "GrowingCrashgetsect.h"
 #include "GrowingCrashPlatformSpecificDefines.h"
 
@@ -82,40 +84,11 @@
 #define SEG_DATA_CONST  "__DATA_CONST"
 #endif
 
-typedef struct
-{
-    uintptr_t image;
-    uintptr_t function;
-} GrowingCrashAddressPair;
-
 static cxa_throw_type g_cxa_throw_handler = NULL;
 static const char *const g_cxa_throw_name = "__cxa_throw";
 
-static GrowingCrashAddressPair *g_cxa_originals = NULL;
-static size_t g_cxa_originals_capacity = 0;
-static size_t g_cxa_originals_count = 0;
-
-static void addPair(GrowingCrashAddressPair pair)
-{
-    if (g_cxa_originals_count == g_cxa_originals_capacity)
-    {
-        g_cxa_originals_capacity *= 2;
-        g_cxa_originals = (GrowingCrashAddressPair *) realloc(g_cxa_originals, sizeof(GrowingCrashAddressPair) * g_cxa_originals_capacity);
-    }
-    memcpy(&g_cxa_originals[g_cxa_originals_count++], &pair, sizeof(GrowingCrashAddressPair));
-}
-
-static uintptr_t findAddress(void *address)
-{
-    for (size_t i = 0; i < g_cxa_originals_count; i++)
-    {
-        if (g_cxa_originals[i].image == (uintptr_t) address)
-        {
-            return g_cxa_originals[i].function;
-        }
-    }
-    return (uintptr_t) NULL;
-}
+/** Original __cxa_throw of each image, keyed by image address. */
+static GrowingCrashAddressMap g_cxa_originals = GROWINGCRASHAM_INITIALIZER;
 
 static void __cxa_throw_decorator(void *thrown_exception, void *tinfo, void (*dest)(void *))
 {
@@ -131,7 +104,7 @@ static void __cxa_throw_decorator(void *thrown_exception, void *tinfo, void (*de
     {
         if (dladdr(backtraceArr[k_requiredFrames - 1], &info) != 0)
         {
-            uintptr_t function = findAddress(info.dli_fbase);
+            uintptr_t function = growingcrasham_find(&g_cxa_originals, (uintptr_t) info.dli_fbase);
             if (function != (uintptr_t) NULL)
             {
                 cxa_throw_type original = (cxa_throw_type) function;
@@ -287,11 +260,15 @@ static void perform_rebinding_with_section(const section_t *section,
         bool symbol_name_longer_than_1 = symbol_name[0] && symbol_name[1];
         if (symbol_name_longer_than_1 && strcmp(&symbol_name[1], g_cxa_throw_name) == 0)
         {
+            if (indirect_symbol_bindings[i] == (void *) __cxa_throw_decorator)
+            {
+                // Already swapped by an earlier growingcrashct_swap().
+                continue;
+            }
             Dl_info info;
             if (dladdr(section, &info) != 0)
             {
-                GrowingCrashAddressPair pair = {(uintptr_t) info.dli_fbase, (uintptr_t) indirect_symbol_bindings[i]};
-                addPair(pair);
+                growingcrasham_add(&g_cxa_originals, (uintptr_t) info.dli_fbase, (uintptr_t) indirect_symbol_bindings[i]);
             }
             indirect_symbol_bindings[i] = (void *) __cxa_throw_decorator;
             continue;
@@ -367,13 +344,6 @@ static void rebind_symbols_for_image(const struct mach_header *header, intptr_t
 
 int growingcrashct_swap(const cxa_throw_type handler)
 {
-    if (g_cxa_originals == NULL)
-    {
-        g_cxa_originals_capacity = 25;
-        g_cxa_originals = (GrowingCrashAddressPair *) malloc(sizeof(GrowingCrashAddressPair) * g_cxa_originals_capacity);
-    }
-    g_cxa_originals_count = 0;
-
     if (g_cxa_throw_handler == NULL)
     {
         g_cxa_throw_handler = handler;
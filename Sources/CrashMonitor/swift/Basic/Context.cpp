@@ -35,6 +35,11 @@ namespace swift {
             D->clear();
         }
         
+        void Context::useArena(char *Memory, size_t Size,
+                               void (*OnExhausted)(void *Context), void *Context) {
+            D->useArena(Memory, Size, OnExhausted, Context);
+        }
+        
         NodePointer Context::demangleSymbolAsNode(llvm::StringRef MangledName) {
             if (isMangledName(MangledName)) {
                 return D->demangleSymbol(MangledName);
@@ -68,6 +73,12 @@ namespace swift {
             return demangling;
         }
         
+        size_t Context::demangleSymbolAsSignatureKey(llvm::StringRef MangledName,
+                                                     char *Buffer, size_t BufferSize) {
+            return nodeToSignatureKey(demangleSymbolAsNode(MangledName), Buffer,
+                                      BufferSize);
+        }
+        
         bool Context::isThunkSymbol(llvm::StringRef MangledName) {
             if (isMangledName(MangledName)) {
                 // First do a quick check
@@ -19,10 +19,12 @@
 #ifndef SWIFT_DEMANGLING_DEMANGLE_H
 #define SWIFT_DEMANGLING_DEMANGLE_H
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <cassert>
 #include <cstdint>
+#include <cstring>
 #include <functional>
 #include "StringRef.h"
 #include "Config.h"
@@ -53,6 +55,9 @@ namespace swift {
             bool ShortenArchetype = false;
             bool ShowPrivateDiscriminators = true;
             bool ShowFunctionArgumentTypes = true;
+            /// Demangle symbols that are embedded in specialization parameters.
+            /// This needs a separate Context, which allocates.
+            bool DemangleSpecializationPayloads = true;
             
             DemangleOptions() {}
             
@@ -357,6 +362,12 @@ NAME,
                 std::string demangleTypeAsString(llvm::StringRef MangledName,
                                                  const DemangleOptions &Options = DemangleOptions());
                 
+                /// Demangle the given symbol and print its signature key.
+                ///
+                /// \returns The length of the key. See nodeToSignatureKey().
+                size_t demangleSymbolAsSignatureKey(llvm::StringRef MangledName,
+                                                    char *Buffer, size_t BufferSize);
+                
                 /// Returns true if the mangledName refers to a thunk function.
                 ///
                 /// Thunk functions are either (ObjC) partial apply forwarder, swift-as-ObjC
@@ -383,6 +394,11 @@ NAME,
                 /// The memory which is used for nodes is not freed but recycled for the next
                 /// demangling operation.
                 void clear();
+                
+                /// Allocates nodes only from \p Memory from now on. See
+                /// NodeFactory::useArena().
+                void useArena(char *Memory, size_t Size,
+                              void (*OnExhausted)(void *Context), void *Context);
             };
             
             /// Standalone utility function to demangle the given symbol as string.
@@ -508,18 +524,48 @@ NAME,
             std::string nodeToString(NodePointer Root,
                                      const DemangleOptions &Options = DemangleOptions());
 
-            /// A class for printing to a std::string.
+            /// Prints the node tree \p Root into a fixed size buffer, without
+            /// allocating memory for the result.
+            ///
+            /// \param Buffer Receives the null terminated result, which is truncated
+            /// if it doesn't fit.
+            /// \param BufferSize The size of \p Buffer. Pass 0 to only measure.
+            /// \returns The length of the full result, which is BufferSize or more
+            /// if it was truncated, or 0 on failure.
+            size_t nodeToBuffer(NodePointer Root, char *Buffer, size_t BufferSize,
+                                const DemangleOptions &Options = DemangleOptions());
+
+            /// Prints a compact key for the entity of the symbol \p Root: its
+            /// module, enclosing types and name, e.g. "main.Foo.bar". Types,
+            /// signatures, generic arguments, specializations and discriminators
+            /// are left out and never visited, so the key is stable and much
+            /// cheaper to print than the full demangling.
+            /// Thunks and protocol witnesses get the key of the function they wrap.
+            ///
+            /// \param Buffer Receives the null terminated key, which is truncated
+            /// if it doesn't fit.
+            /// \param BufferSize The size of \p Buffer. Pass 0 to only measure.
+            /// \returns The length of the full key, which is BufferSize or more
+            /// if it was truncated, or 0 if the symbol has no named entity.
+            size_t nodeToSignatureKey(NodePointer Root, char *Buffer, size_t BufferSize);
+
+            /// A class for printing to a std::string, or to a fixed size buffer.
             class DemanglerPrinter {
             public:
                 DemanglerPrinter() = default;
                 
+                /// Print into a fixed size buffer instead of a std::string. Output
+                /// that doesn't fit is dropped, but still counted by size().
+                DemanglerPrinter(char *Buffer, size_t Capacity)
+                : FixedBuffer(Buffer), FixedCapacity(Capacity) {}
+                
                 DemanglerPrinter &operator<<(llvm::StringRef Value) & {
-                    Stream.append(Value.data(), Value.size());
+                    append(Value.data(), Value.size());
                     return *this;
                 }
                 
                 DemanglerPrinter &operator<<(char c) & {
-                    Stream.push_back(c);
+                    append(&c, 1);
                     return *this;
                 }
                 DemanglerPrinter &operator<<(unsigned long long n) &;
@@ -546,15 +592,41 @@ NAME,
                 
                 std::string &&str() && { return std::move(Stream); }
                 
-                llvm::StringRef getStringRef() const { return Stream; }
+                llvm::StringRef getStringRef() const {
+                    if (FixedBuffer)
+                        return llvm::StringRef(FixedBuffer, std::min(FixedLength, FixedCapacity));
+                    return Stream;
+                }
+                
+                /// The length of everything printed so far.
+                size_t size() const {
+                    return FixedBuffer ? FixedLength : Stream.size();
+                }
                 
                 /// Shrinks the buffer.
                 void resetSize(size_t toPos) {
-                    assert(toPos <= Stream.size());
-                    Stream.resize(toPos);
+                    assert(toPos <= size());
+                    if (FixedBuffer)
+                        FixedLength = toPos;
+                    else
+                        Stream.resize(toPos);
                 }
             private:
+                void append(const char *Data, size_t Length) {
+                    if (!FixedBuffer) {
+                        Stream.append(Data, Length);
+                        return;
+                    }
+                    if (Length > 0 && FixedLength < FixedCapacity)
+                        memcpy(FixedBuffer + FixedLength, Data,
+                               std::min(Length, FixedCapacity - FixedLength));
+                    FixedLength += Length;
+                }
+                
                 std::string Stream;
+                char *FixedBuffer = nullptr;
+                size_t FixedCapacity = 0;
+                size_t FixedLength = 0;
             };
             
             /// Returns a the node kind \p k as string.
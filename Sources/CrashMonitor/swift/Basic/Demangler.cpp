@@ -19,6 +19,7 @@
 #include "ManglingMacros.h"
 #include "Punycode.h"
 #include "SwiftStrings.h"
+#include <cstdlib>
 
 using namespace swift;
 using namespace Mangle;
@@ -330,7 +331,29 @@ void NodeFactory::freeSlabs(Slab *slab) {
     }
 }
 
+void NodeFactory::useArena(char *Memory, size_t Size,
+                           ArenaExhaustedHandler OnExhausted, void *Context) {
+    assert(OnExhausted && "an arena needs an exhausted handler");
+    freeSlabs(CurrentSlab);
+    CurrentSlab = nullptr;
+    ArenaStart = Memory;
+    CurPtr = Memory;
+    End = Memory + Size;
+    OnArenaExhausted = OnExhausted;
+    ArenaExhaustedContext = Context;
+}
+
+void NodeFactory::arenaExhausted() {
+    OnArenaExhausted(ArenaExhaustedContext);
+    // The handler must not return.
+    std::abort();
+}
+
 void NodeFactory::clear() {
+    if (isUsingArena()) {
+        CurPtr = ArenaStart;
+        return;
+    }
     if (CurrentSlab) {
         freeSlabs(CurrentSlab->Previous);
         
@@ -856,10 +879,14 @@ NodePointer Demangler::demangleIdentifier() {
             return nullptr;
         StringRef Slice = StringRef(Text.data() + Pos, numChars);
         if (isPunycoded) {
-            std::string PunycodedString;
-            if (!Punycode::decodePunycodeUTF8(Slice, PunycodedString))
+            // Decode straight into node memory. It is recycled with the nodes.
+            uint32_t *CodePoints = Allocate<uint32_t>(Slice.size());
+            size_t DecodedLength = Punycode::getMaxDecodedUTF8Length(Slice);
+            char *Decoded = Allocate<char>(DecodedLength);
+            if (!Punycode::decodePunycodeUTF8(Slice, Decoded, DecodedLength,
+                                              CodePoints))
                 return nullptr;
-            Identifier.append(StringRef(PunycodedString), *this);
+            Identifier.append(StringRef(Decoded, DecodedLength), *this);
         } else {
             Identifier.append(Slice, *this);
             int wordStartPos = -1;
@@ -2020,6 +2047,8 @@ NodePointer Demangler::demangleThunkOrSpecialization() {
             
             bool isSerialized = nextIf('q');
             
+            if (isUsingArena())
+                return nullptr;
             std::vector<NodePointer> types;
             auto node = popNode();
             if (!node || node->getKind() != Node::Kind::Type)
@@ -2098,6 +2127,8 @@ NodePointer Demangler::demangleThunkOrSpecialization() {
             bool isSerialized = nextIf('q');
             
             NodePointer genericSig = nullptr;
+            if (isUsingArena())
+                return nullptr;
             std::vector<NodePointer> types;
             
             auto node = popNode();
@@ -2139,6 +2170,8 @@ NodePointer Demangler::demangleThunkOrSpecialization() {
             return createNode(Node::Kind::OutlinedVariable, Idx);
         }
         case 'e': {
+            if (isUsingArena())
+                return nullptr;
             std::string Params = demangleBridgedMethodParams();
             if (Params.empty())
                 return nullptr;
@@ -70,6 +70,19 @@ namespace swift {
             
             static void freeSlabs(Slab *slab);
             
+        public:
+            /// Called when a fixed arena runs out. It must not return, e.g. it can
+            /// longjmp back to where demangling started.
+            typedef void (*ArenaExhaustedHandler)(void *Context);
+            
+        private:
+            /// The fixed arena, if useArena() was called.
+            char *ArenaStart = nullptr;
+            ArenaExhaustedHandler OnArenaExhausted = nullptr;
+            void *ArenaExhaustedContext = nullptr;
+            
+            [[noreturn]] void arenaExhausted();
+            
         public:
             
             NodeFactory() {
@@ -87,6 +100,17 @@ namespace swift {
             
             virtual void clear();
             
+            /// Allocate only from \p Memory from now on, and never from the heap.
+            /// This makes it possible to demangle where malloc can't be used.
+            ///
+            /// Code paths that would need the heap for anything else fail instead.
+            /// When the arena runs out, \p OnExhausted is called.
+            void useArena(char *Memory, size_t Size, ArenaExhaustedHandler OnExhausted,
+                          void *Context);
+            
+            /// Returns true if allocating from a fixed arena.
+            bool isUsingArena() const { return ArenaStart != nullptr; }
+            
             /// Allocates an object of type T or an array of objects of type T.
             template<typename T> T *Allocate(size_t NumObjects = 1) {
                 size_t ObjectSize = NumObjects * sizeof(T);
@@ -98,6 +122,9 @@ namespace swift {
                 
                 // Do we have enough space in the current slab?
                 if (CurPtr + ObjectSize > End) {
+                    if (isUsingArena())
+                        arenaExhausted();
+                    
                     // No. We have to malloc a new slab.
                     // We double the slab size for each allocated slab.
                     SlabSize = std::max(SlabSize * 2, ObjectSize + alignof(T));
@@ -34,19 +34,19 @@ static void printer_unreachable(const char *Message) {
 DemanglerPrinter &DemanglerPrinter::operator<<(unsigned long long n) & {
     char buffer[32];
     snprintf(buffer, sizeof(buffer), "%llu", n);
-    Stream.append(buffer);
+    append(buffer, strlen(buffer));
     return *this;
 }
 DemanglerPrinter &DemanglerPrinter::writeHex(unsigned long long n) & {
     char buffer[32];
     snprintf(buffer, sizeof(buffer), "%llX", n);
-    Stream.append(buffer);
+    append(buffer, strlen(buffer));
     return *this;
 }
 DemanglerPrinter &DemanglerPrinter::operator<<(long long n) & {
     char buffer[32];
     snprintf(buffer, sizeof(buffer), "%lld",n);
-    Stream.append(buffer);
+    append(buffer, strlen(buffer));
     return *this;
 }
 
@@ -65,9 +65,9 @@ std::string Demangle::archetypeName(Node::IndexType index,
 namespace {
     
     struct QuotedString {
-        std::string Value;
+        StringRef Value;
         
-        explicit QuotedString(std::string Value) : Value(Value) {}
+        explicit QuotedString(StringRef Value) : Value(Value) {}
     };
     
     static DemanglerPrinter &operator<<(DemanglerPrinter &printer,
@@ -181,6 +181,9 @@ namespace {
     public:
         NodePrinter(DemangleOptions options) : Options(options) {}
         
+        NodePrinter(DemangleOptions options, char *Buffer, size_t Capacity)
+        : Printer(Buffer, Capacity), Options(options) {}
+        
         std::string printRoot(NodePointer root) {
             isValid = true;
             print(root);
@@ -189,7 +192,29 @@ namespace {
             return "";
         }
         
+        /// Print into the fixed buffer, returning the full length or 0.
+        size_t printRootToBuffer(NodePointer root) {
+            isValid = true;
+            print(root);
+            if (isValid)
+                return Printer.size();
+            return 0;
+        }
+        
     private:
+        /// Same as archetypeName(), without the temporary string.
+        void printArchetypeName(Node::IndexType index, Node::IndexType depth) {
+            char name[32];
+            size_t length = 0;
+            do {
+                name[length++] = (char)('A' + (index % 26));
+                index /= 26;
+            } while (index && length < sizeof(name));
+            Printer << StringRef(name, length);
+            if (depth != 0)
+                Printer << depth;
+        }
+        
         /// Called when the node tree in valid.
         ///
         /// The demangler already catches most error cases and mostly produces valid
@@ -668,7 +693,7 @@ case Node::Kind::Name:
                 return;
             }
             
-            auto getLabelFor = [&](NodePointer Param, unsigned Index) -> std::string {
+            auto getLabelFor = [&](NodePointer Param, unsigned Index) -> StringRef {
                 auto Label = LabelList->getChild(Index);
                 assert(Label && (Label->getKind() == Node::Kind::Identifier ||
                                  Label->getKind() == Node::Kind::FirstElementMarker));
@@ -830,11 +855,15 @@ unsigned NodePrinter::printFunctionSigSpecializationParam(NodePointer Node,
             print(Node->getChild(Idx++));
             Printer << " : ";
             const auto &text = Node->getChild(Idx++)->getText();
-            std::string demangledName = demangleSymbolAsString(text);
-            if (demangledName.empty()) {
+            if (!Options.DemangleSpecializationPayloads) {
                 Printer << text;
             } else {
-                Printer << demangledName;
+                std::string demangledName = demangleSymbolAsString(text);
+                if (demangledName.empty()) {
+                    Printer << text;
+                } else {
+                    Printer << demangledName;
+                }
             }
             Printer << "]";
             return Idx;
@@ -1287,6 +1316,10 @@ return nullptr;
             return nullptr;
         }
         case Node::Kind::FunctionSignatureSpecializationParamPayload: {
+            if (!Options.DemangleSpecializationPayloads) {
+                Printer << Node->getText();
+                return nullptr;
+            }
             std::string demangledName = demangleSymbolAsString(Node->getText());
             if (demangledName.empty()) {
                 Printer << Node->getText();
@@ -1963,7 +1996,7 @@ return nullptr;
                     }
                     // FIXME: Depth won't match when a generic signature applies to a
                     // method in generic type context.
-                    Printer << archetypeName(index, depth);
+                    printArchetypeName(index, depth);
                 }
             }
             
@@ -2272,11 +2305,11 @@ printEntity(NodePointer Entity, bool asPrefixContext, TypePrinting TypePr,
             // later in suffix form.
             PostfixContext = Context;
         } else {
-            size_t CurrentPos = Printer.getStringRef().size();
+            size_t CurrentPos = Printer.size();
             PostfixContext = print(Context, /*asPrefixContext*/true);
             
             // Was the context printed as prefix?
-            if (Printer.getStringRef().size() != CurrentPos)
+            if (Printer.size() != CurrentPos)
                 Printer << '.';
         }
     }
@@ -2288,7 +2321,7 @@ printEntity(NodePointer Entity, bool asPrefixContext, TypePrinting TypePr,
             Printer << " of ";
             ExtraName = "";
         }
-        size_t CurrentPos = Printer.getStringRef().size();
+        size_t CurrentPos = Printer.size();
         if (!OverwriteName.empty()) {
             Printer << OverwriteName;
         } else {
@@ -2299,7 +2332,7 @@ printEntity(NodePointer Entity, bool asPrefixContext, TypePrinting TypePr,
             if (auto PrivateName = getChildIf(Entity, Node::Kind::PrivateDeclName))
                 print(PrivateName);
         }
-        if (Printer.getStringRef().size() != CurrentPos && !ExtraName.empty())
+        if (Printer.size() != CurrentPos && !ExtraName.empty())
             Printer << '.';
     }
     if (!ExtraName.empty()) {
@@ -2386,3 +2419,169 @@ std::string Demangle::nodeToString(NodePointer root,
     
     return NodePrinter(options).printRoot(root);
 }
+
+size_t Demangle::nodeToBuffer(NodePointer root, char *buffer, size_t bufferSize,
+                              const DemangleOptions &options) {
+    if (!root) {
+        if (bufferSize > 0)
+            buffer[0] = '\0';
+        return 0;
+    }
+    
+    // Leave room for the terminator. A zero size buffer just measures.
+    size_t capacity = bufferSize > 0 ? bufferSize - 1 : 0;
+    size_t length = NodePrinter(options, buffer, capacity).printRootToBuffer(root);
+    if (bufferSize > 0)
+        buffer[std::min(length, capacity)] = '\0';
+    return length;
+}
+
+namespace {
+    /// Prints only the context chain and the name of an entity, for use as a
+    /// grouping key. Types, signatures and generic arguments are never visited.
+    class SignatureKeyPrinter {
+        DemanglerPrinter Printer;
+        
+    public:
+        SignatureKeyPrinter(char *Buffer, size_t Capacity)
+        : Printer(Buffer, Capacity) {}
+        
+        size_t size() const { return Printer.size(); }
+        
+        /// Returns false if \p Global has no entity that a key can be made for.
+        bool printGlobal(NodePointer Global) {
+            // Specializations, thunks and attributes are siblings of the entity
+            // they apply to.
+            for (NodePointer Child : *Global) {
+                if (printEntity(Child))
+                    return true;
+                Printer.resetSize(0);
+            }
+            return false;
+        }
+        
+    private:
+        bool printEntity(NodePointer Entity) {
+            switch (Entity->getKind()) {
+                case Node::Kind::Function:
+                case Node::Kind::Variable:
+                    return printContextAndName(Entity, /*hasName*/true);
+                case Node::Kind::Subscript:
+                    return printContextAndName(Entity, /*hasName*/false, "subscript");
+                case Node::Kind::Allocator:
+                case Node::Kind::Constructor:
+                    return printContextAndName(Entity, /*hasName*/false, "init");
+                case Node::Kind::Deallocator:
+                case Node::Kind::Destructor:
+                    return printContextAndName(Entity, /*hasName*/false, "deinit");
+                case Node::Kind::ExplicitClosure:
+                case Node::Kind::ImplicitClosure:
+                    return printContextAndName(Entity, /*hasName*/false, "closure");
+                case Node::Kind::Getter:
+                case Node::Kind::GlobalGetter:
+                    return printAccessor(Entity, "getter");
+                case Node::Kind::Setter:
+                    return printAccessor(Entity, "setter");
+                case Node::Kind::WillSet:
+                    return printAccessor(Entity, "willset");
+                case Node::Kind::DidSet:
+                    return printAccessor(Entity, "didset");
+                case Node::Kind::ReadAccessor:
+                    return printAccessor(Entity, "read");
+                case Node::Kind::ModifyAccessor:
+                    return printAccessor(Entity, "modify");
+                case Node::Kind::MaterializeForSet:
+                    return printAccessor(Entity, "materializeForSet");
+                case Node::Kind::BoundGenericFunction:
+                case Node::Kind::Static:
+                case Node::Kind::CurryThunk:
+                case Node::Kind::DispatchThunk:
+                    return Entity->hasChildren() && printEntity(Entity->getFirstChild());
+                case Node::Kind::ProtocolWitness:
+                    return Entity->getNumChildren() == 2 && printEntity(Entity->getChild(1));
+                default:
+                    return false;
+            }
+        }
+        
+        bool printAccessor(NodePointer Accessor, StringRef Name) {
+            if (!Accessor->hasChildren() || !printEntity(Accessor->getFirstChild()))
+                return false;
+            Printer << '.' << Name;
+            return true;
+        }
+        
+        bool printContextAndName(NodePointer Entity, bool hasName,
+                                 StringRef OverwriteName = StringRef()) {
+            if (!Entity->hasChildren() || !printContext(Entity->getFirstChild()))
+                return false;
+            Printer << '.';
+            if (!hasName) {
+                Printer << OverwriteName;
+                return true;
+            }
+            return Entity->getNumChildren() > 1 && printName(Entity->getChild(1));
+        }
+        
+        bool printContext(NodePointer Context) {
+            switch (Context->getKind()) {
+                case Node::Kind::Module:
+                    Printer << Context->getText();
+                    return true;
+                case Node::Kind::Class:
+                case Node::Kind::Structure:
+                case Node::Kind::Enum:
+                case Node::Kind::Protocol:
+                case Node::Kind::TypeAlias:
+                case Node::Kind::OtherNominalType:
+                    return printContextAndName(Context, /*hasName*/true);
+                case Node::Kind::Extension:
+                    // Members of an extension belong to the extended type.
+                    return Context->getNumChildren() > 1 && printContext(Context->getChild(1));
+                case Node::Kind::Type:
+                case Node::Kind::DeclContext:
+                case Node::Kind::BoundGenericClass:
+                case Node::Kind::BoundGenericStructure:
+                case Node::Kind::BoundGenericEnum:
+                case Node::Kind::BoundGenericProtocol:
+                case Node::Kind::BoundGenericOtherNominalType:
+                case Node::Kind::BoundGenericTypeAlias:
+                    return Context->hasChildren() && printContext(Context->getFirstChild());
+                default:
+                    // Local contexts, e.g. the function around a closure.
+                    return printEntity(Context);
+            }
+        }
+        
+        bool printName(NodePointer Name) {
+            switch (Name->getKind()) {
+                case Node::Kind::Identifier:
+                case Node::Kind::PrefixOperator:
+                case Node::Kind::InfixOperator:
+                case Node::Kind::PostfixOperator:
+                    Printer << Name->getText();
+                    return true;
+                case Node::Kind::LocalDeclName:
+                case Node::Kind::PrivateDeclName:
+                    // Discriminators change as code moves around, so leave them out.
+                    return Name->getNumChildren() == 2 && printName(Name->getChild(1));
+                default:
+                    return false;
+            }
+        }
+    };
+} // end anonymous namespace
+
+size_t Demangle::nodeToSignatureKey(NodePointer root, char *buffer,
+                                    size_t bufferSize) {
+    size_t capacity = bufferSize > 0 ? bufferSize - 1 : 0;
+    size_t length = 0;
+    if (root && root->getKind() == Node::Kind::Global) {
+        SignatureKeyPrinter printer(buffer, capacity);
+        if (printer.printGlobal(root))
+            length = printer.size();
+    }
+    if (bufferSize > 0)
+        buffer[std::min(length, capacity)] = '\0';
+    return length;
+}
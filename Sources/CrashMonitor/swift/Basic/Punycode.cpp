@@ -14,6 +14,8 @@
 #include "ManglingUtils.h"
 #include <vector>
 #include <cstdint>
+#include <climits>
+#include <cstring>
 
 using namespace swift;
 using namespace Punycode;
@@ -71,10 +73,12 @@ static int adapt(int delta, int numpoints, bool firsttime) {
 
 // Section 6.2: Decoding procedure
 
-bool Punycode::decodePunycode(StringRef InputPunycode,
-                              std::vector<uint32_t> &OutCodePoints) {
-    OutCodePoints.clear();
-    OutCodePoints.reserve(InputPunycode.size());
+/// Decodes into \p OutCodePoints, which must have room for
+/// InputPunycode.size() code points. Every input character yields at most one
+/// code point.
+static bool decodeCodePoints(StringRef InputPunycode, uint32_t *OutCodePoints,
+                             size_t &NumCodePoints) {
+    NumCodePoints = 0;
     
     // -- Build the decoded string as UTF32 first because we need random access.
     uint32_t n = initial_n;
@@ -89,7 +93,7 @@ bool Punycode::decodePunycode(StringRef InputPunycode,
             // fail on any non-basic code point
             if (static_cast<unsigned char>(c) > 0x7f)
                 return true;
-            OutCodePoints.push_back(c);
+            OutCodePoints[NumCodePoints++] = c;
         }
         // if more than zero code points were consumed then consume one more
         //  (which will be the last delimiter)
@@ -111,31 +115,50 @@ bool Punycode::decodePunycode(StringRef InputPunycode,
             if (digit < 0)
                 return true;
             
+            // fail on overflow, which would put the insertion point out of
+            // bounds
+            if (digit > (INT_MAX - i) / w)
+                return false;
             i = i + digit * w;
             int t = k <= bias ? tmin
             : k >= bias + tmax ? tmax
             : k - bias;
             if (digit < t)
                 break;
+            if (w > INT_MAX / (base - t))
+                return false;
             w = w * (base - t);
         }
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wconversion"
-        bias = adapt(i - oldi, OutCodePoints.size() + 1, oldi == 0);
+        bias = adapt(i - oldi, NumCodePoints + 1, oldi == 0);
+        n = n + i / (NumCodePoints + 1);
+        i = i % (NumCodePoints + 1);
 #pragma clang diagnostic pop
-        n = n + i / (OutCodePoints.size() + 1);
-        i = i % (OutCodePoints.size() + 1);
         // if n is a basic code point then fail
         if (n < 0x80)
             return true;
         // insert n into output at position i
-        OutCodePoints.insert(OutCodePoints.begin() + i, n);
+        memmove(OutCodePoints + i + 1, OutCodePoints + i,
+                (NumCodePoints - i) * sizeof(uint32_t));
+        OutCodePoints[i] = n;
+        NumCodePoints++;
         i++;
     }
     
     return true;
 }
 
+bool Punycode::decodePunycode(StringRef InputPunycode,
+                              std::vector<uint32_t> &OutCodePoints) {
+    OutCodePoints.resize(InputPunycode.size());
+    size_t NumCodePoints = 0;
+    bool Result = decodeCodePoints(InputPunycode, OutCodePoints.data(),
+                                   NumCodePoints);
+    OutCodePoints.resize(NumCodePoints);
+    return Result;
+}
+
 // Section 6.3: Encoding procedure
 
 bool Punycode::encodePunycode(const std::vector<uint32_t> &InputCodePoints,
@@ -203,75 +226,72 @@ bool Punycode::encodePunycode(const std::vector<uint32_t> &InputCodePoints,
     return true;
 }
 
-static bool encodeToUTF8(const std::vector<uint32_t> &Scalars,
-                         std::string &OutUTF8) {
-    for (auto S : Scalars) {
-        if (!isValidUnicodeScalar(S)) {
-            OutUTF8.clear();
+/// Writes the UTF-8 encoding of \p S to \p OutUTF8, which must have room for
+/// 4 bytes.
+///
+/// Returns the number of bytes written, or 0 if \p S is not a valid scalar.
+static size_t encodeToUTF8(uint32_t S, char *OutUTF8) {
+    if (!isValidUnicodeScalar(S))
+        return 0;
+    if (S >= 0xD800 && S < 0xD880)
+        S -= 0xD800;
+    
+    if (S < 0x80) {
+        OutUTF8[0] = (char)S;
+        return 1;
+    }
+    if (S < 0x800) {
+        OutUTF8[0] = (char)((S >> 6) | 0xC0);
+        OutUTF8[1] = (char)((S & 0x3F) | 0x80);
+        return 2;
+    }
+    if (S < 0x10000) {
+        OutUTF8[0] = (char)((S >> 12) | 0xE0);
+        OutUTF8[1] = (char)(((S >> 6) & 0x3F) | 0x80);
+        OutUTF8[2] = (char)((S & 0x3F) | 0x80);
+        return 3;
+    }
+    OutUTF8[0] = (char)((S >> 18) | 0xF0);
+    OutUTF8[1] = (char)(((S >> 12) & 0x3F) | 0x80);
+    OutUTF8[2] = (char)(((S >> 6) & 0x3F) | 0x80);
+    OutUTF8[3] = (char)((S & 0x3F) | 0x80);
+    return 4;
+}
+
+bool Punycode::decodePunycodeUTF8(StringRef InputPunycode, char *OutUTF8,
+                                  size_t &OutLength, uint32_t *Scratch) {
+    size_t Capacity = OutLength;
+    OutLength = 0;
+    size_t NumCodePoints = 0;
+    if (!decodeCodePoints(InputPunycode, Scratch, NumCodePoints))
+        return false;
+    
+    for (size_t Idx = 0; Idx < NumCodePoints; ++Idx) {
+        char Encoded[4];
+        size_t Bytes = encodeToUTF8(Scratch[Idx], Encoded);
+        if (Bytes == 0 || Bytes > Capacity - OutLength) {
+            OutLength = 0;
             return false;
         }
-        if (S >= 0xD800 && S < 0xD880)
-            S -= 0xD800;
-        
-        unsigned Bytes = 0;
-        if (S < 0x80)
-            Bytes = 1;
-        else if (S < 0x800)
-            Bytes = 2;
-        else if (S < 0x10000)
-            Bytes = 3;
-        else
-            Bytes = 4;
-        
-        switch (Bytes) {
-            case 1:
-                OutUTF8.push_back(S);
-                break;
-            case 2: {
-                uint8_t Byte2 = (S | 0x80) & 0xBF;
-                S >>= 6;
-                uint8_t Byte1 = S | 0xC0;
-                OutUTF8.push_back(Byte1);
-                OutUTF8.push_back(Byte2);
-                break;
-            }
-            case 3: {
-                uint8_t Byte3 = (S | 0x80) & 0xBF;
-                S >>= 6;
-                uint8_t Byte2 = (S | 0x80) & 0xBF;
-                S >>= 6;
-                uint8_t Byte1 = S | 0xE0;
-                OutUTF8.push_back(Byte1);
-                OutUTF8.push_back(Byte2);
-                OutUTF8.push_back(Byte3);
-                break;
-            }
-            case 4: {
-                uint8_t Byte4 = (S | 0x80) & 0xBF;
-                S >>= 6;
-                uint8_t Byte3 = (S | 0x80) & 0xBF;
-                S >>= 6;
-                uint8_t Byte2 = (S | 0x80) & 0xBF;
-                S >>= 6;
-                uint8_t Byte1 = S | 0xF0;
-                OutUTF8.push_back(Byte1);
-                OutUTF8.push_back(Byte2);
-                OutUTF8.push_back(Byte3);
-                OutUTF8.push_back(Byte4);
-                break;
-            }
-        }
+        memcpy(OutUTF8 + OutLength, Encoded, Bytes);
+        OutLength += Bytes;
     }
     return true;
 }
 
 bool Punycode::decodePunycodeUTF8(StringRef InputPunycode,
                                   std::string &OutUTF8) {
-    std::vector<uint32_t> OutCodePoints;
-    if (!decodePunycode(InputPunycode, OutCodePoints))
+    std::vector<uint32_t> Scratch(InputPunycode.size());
+    size_t Start = OutUTF8.size();
+    OutUTF8.resize(Start + getMaxDecodedUTF8Length(InputPunycode));
+    size_t Length = getMaxDecodedUTF8Length(InputPunycode);
+    if (!decodePunycodeUTF8(InputPunycode, &OutUTF8[Start], Length,
+                            Scratch.data())) {
+        OutUTF8.clear();
         return false;
-    
-    return encodeToUTF8(OutCodePoints, OutUTF8);
+    }
+    OutUTF8.resize(Start + Length);
+    return true;
 }
 
 static bool isContinuationByte(uint8_t unit) {
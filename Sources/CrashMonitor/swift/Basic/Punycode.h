@@ -58,6 +58,23 @@ namespace swift {
         
         bool decodePunycodeUTF8(StringRef InputPunycode, std::string &OutUTF8);
         
+        /// The most bytes that decoding \p InputPunycode to UTF-8 can produce.
+        /// Each input character decodes to at most one scalar, and each scalar to
+        /// at most 4 bytes.
+        inline size_t getMaxDecodedUTF8Length(StringRef InputPunycode) {
+            return InputPunycode.size() * 4;
+        }
+        
+        /// Decodes a Punycode string to UTF-8 without allocating memory.
+        ///
+        /// \p OutLength holds the size of \p OutUTF8 on entry, and receives the
+        /// number of bytes written. getMaxDecodedUTF8Length() bytes are always
+        /// enough. \p Scratch must have room for InputPunycode.size() code points.
+        ///
+        /// Returns false if decoding failed or the result didn't fit.
+        bool decodePunycodeUTF8(StringRef InputPunycode, char *OutUTF8,
+                                size_t &OutLength, uint32_t *Scratch);
+        
     } // end namespace Punycode
 } // end namespace swift
 